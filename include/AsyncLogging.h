@@ -2,13 +2,30 @@
  * 异步日志类，用于管理日志前端和后端，实现用户的异步日志输入
  * append(),将前端的日志输出重定向为AsyncLogging的append()，append将前端缓存中的日志信息添加到异步日志类的缓存中
  * LogFile，异步日志调用非线程安全的LogFile提升效率,后端需要使用单线程
- * 后端总共使用4块4MB的缓存，前端用两块，后端用两块，在前后端之间进行流动
- * FIXME:当日志量突然增大时，前端nextbuffer不存在时会不断创建新缓存，导致占用内存不断增大，且无法主动释放。
- * FIXME:解决方法：限制最大缓存数量，当数量超过时，丢弃掉多余的日志buffer，只留两个; 使用内存池防止内存碎片
+ * 前端使用currentBuffer_、nextBuffer_两块4MB的缓存，写满的缓存交给后端写入后归还缓存池，在前后端之间进行流动
+ * 缓存池：所有4MB缓存在start()时一次性预分配，数量固定（setBufferPool），前后端之间只流动不新建也不释放，
+ * 避免日志量突增时不断new缓存导致内存持续增长和堆碎片。池耗尽时按OverflowPolicy处理前端，丢弃的数量由后端写入日志中。
+ * 线程局部模式：每个前端线程写入自己独占的暂存缓存，只有缓存写满（或后端定时刷新收集）时才访问共享的mutex_，
+ * 避免多核下所有前端线程争用同一把锁。代价是不同线程的日志以缓存块为单位交错，不再严格按时间排序。
+ * 每个暂存缓存占用缓存池的一块，暂存缓存最多(缓存池块数 - 2) / 2个（默认7个），保证池中总有缓存在前后端之间流动；
+ * 超过上限后才开始写日志的线程使用共享的currentBuffer_（mutex_路径），线程多时应相应增大setBufferPool。
+ * 后端默认使用LogFile::kWritev，每次交换得到的一批缓存由一次writev直接写入文件，不经过stdio缓冲区。
+ * 使用LogFile::kIoUring时后端只提交写入不等待磁盘，多块缓存同时在途，每块缓存在自己的写入完成后才归还缓存池；
+ * 没有新缓存时后端等待写入完成而不是等待cond_，磁盘卡顿期间写完的缓存能尽快回到前端，减少丢弃。
+ * setCompressInline后后端把每批缓存压缩为帧再写入（LogFile的compressed模式），压缩完的缓存立即归还缓存池。
+ * 运行时指标：metrics()返回写入条数、字节数、每次唤醒写出的缓存数、待写队列的峰值深度、丢弃数量、后端写入和flush的耗时分布、
+ * roll次数、后端LogFile的页缓存与落盘统计（LogFile::IoStats）以及前端等待mutex_的时间。前端写入的条数和字节数在已经持有的锁内计数（mutex_或线程局部暂存缓存的锁），
+ * 等待时间只在有争用时计时，记入分片计数器（见LogMetrics.h），计数不增加前端之间的争用。
+ * setMetricsReport后后端定期把指标按日志行的格式写入日志文件。
+ * setFlightRecorder后缓存池在文件的共享映射中分配（见FlightRecorder.h），进程崩溃时还没写入日志文件的缓存仍在文件中，
+ * 缓存在前后端之间流动时才更新文件头中的状态和序号，append路径不变。
  */
 
 #pragma once
 #include "CountDownLatch.h"
+#include "FlightRecorder.h"
+#include "LogFile.h"
+#include "LogMetrics.h"
 #include "Logger.h"
 #include <atomic>
 #include <boost/noncopyable.hpp>
@@ -24,9 +41,49 @@ using boost::noncopyable;
 class AsyncLogging : public noncopyable {
   public:
     using Buffer = FixedBuffer<kLargeBuffer>;
-    using BufferVector = vector<unique_ptr<Buffer>>;
+    // 在FlightRecorder的映射中构造的缓存由映射管理，不释放
+    struct BufferDeleter {
+        BufferDeleter() : mapped(false) {}
+        explicit BufferDeleter(bool inMapping) : mapped(inMapping) {}
+        bool mapped;
+        void operator()(Buffer *buffer) const {
+            if (!mapped) {
+                delete buffer;
+            }
+        }
+    };
+    using BufferVector = vector<unique_ptr<Buffer, BufferDeleter>>;
     using BufferPtr = BufferVector::value_type;
 
+    // 缓存池耗尽时前端的处理策略
+    enum OverflowPolicy {
+        kBlock,       // 阻塞前端直到后端归还缓存
+        kDropNewest,  // 丢弃当前要写入的日志
+        kDropOldest,  // 丢弃队列中最旧的一块待写缓存，腾出空间给新日志
+        kDropByLevel, // 低于指定级别的日志直接丢弃，其余日志阻塞等待
+    };
+    static const int kDefaultPoolSize = 16; // 默认缓存池大小，共64MB
+
+    // 运行时指标的快照，计数从start()开始累计
+    struct Metrics {
+        int64_t lines;            // 前端写入缓存的日志条数，包括延迟日志记录，不包括被丢弃的日志
+        int64_t bytes;            // 前端写入缓存的字节数
+        int64_t wakeups;          // 后端取到待写缓存的次数
+        int64_t buffersWritten;   // 后端写出的缓存块数
+        int64_t peakQueueDepth;   // 后端一次交换出的待写缓存块数的最大值，即待写队列的峰值深度
+        int64_t droppedMessages;  // 同droppedMessages()
+        int64_t droppedBuffers;   // 同droppedBuffers()
+        int64_t droppedBytes;     // 同droppedBytes()
+        int64_t lockWaits;        // 前端获取mutex_时需要等待的次数，没有争用时不计
+        int64_t lockWaitNs;       // 前端等待mutex_的总时间
+        int64_t poolWaitNs;       // 前端因缓存池耗尽阻塞等待的总时间（kBlock、kDropByLevel）
+        int64_t rolls;            // 日志文件roll的次数，同io.rolls
+        LogFile::IoStats io;      // 后端LogFile的flush、落盘、回写和页缓存统计，后端每次写入后更新
+        LogHistogram::Snapshot buffersPerWakeup; // 每次唤醒写出的缓存块数
+        LogHistogram::Snapshot writeNs;          // 每批缓存交给LogFile写入的耗时，kIoUring下只是提交的耗时
+        LogHistogram::Snapshot flushNs;          // 每次flush的耗时
+    };
+
     AsyncLogging(const char *basename, off_t rollSize, int flushInterval_ = 3);
     ~AsyncLogging() {
         if (running_.load()) {
@@ -36,27 +93,81 @@ class AsyncLogging : public noncopyable {
 
     void start() {
         running_.store(true);
+        preallocateBuffers();
         thread_.push_back(unique_ptr<thread>(new thread(bind(&AsyncLogging::threadFunc, this))));
         latch_.wait();
     }                                      // 启动异步日志类，主要是启动后端写入线程
     void append(const char *msg, int len); // 将前端数据写入前端缓存
+    void appendDeferred(const char *record, int len); // 写入一条延迟格式化的日志记录（见DeferredLog.h），由后端格式化
     void stop() {
         running_.store(false);
         cond_.notify_one();
+        {
+            lock_guard<mutex> lck(mutex_); // 保证阻塞在poolCond_上的前端不会错过running_的变化
+        }
+        poolCond_.notify_all();
         if (thread_[0]->joinable()) {
             thread_[0]->join();
         }
+        if (recorder_) {
+            recorder_->setStopped();
+        }
     } // 结束异步日志类，阻塞等待后端线程结束
 
+    void setThreadLocalBuffer(bool on) { threadLocalBuffer_ = on; } // 是否启用线程局部暂存缓存，暂存缓存数的上限见maxStagings()，需在start()前调用
+    int maxStagings() const { return max(1, (poolSize_ - 2) / 2); } // 线程局部模式下同时持有暂存缓存的线程数上限，由缓存池大小决定
+    void setBufferPool(int poolSize) { poolSize_ = max(poolSize, 4); } // 设置缓存池总块数（含前后端各两块，至少4块），需在start()前调用
+    void setOverflowPolicy(OverflowPolicy policy, Logger::LogLevel minBlockLevel = Logger::WARN) {
+        policy_ = policy;
+        minBlockLevel_ = minBlockLevel;
+    } // 设置缓存池耗尽时的处理策略，kDropByLevel时低于minBlockLevel的日志被丢弃
+    void setFileBackend(LogFile::Backend backend) { backend_ = backend; } // 设置后端写文件的方式，默认kWritev，需在start()前调用
+    void setSyncOnWrite(bool on) { syncOnWrite_ = on; } // 每批缓存写入后追加一次fsync，缓存落盘后才归还缓存池，需在start()前调用
+    void setIoPolicy(const LogFile::IoPolicy &policy) { ioPolicy_ = policy; } // 设置后端LogFile的页缓存与落盘策略，需在start()前调用
+    void setCompressRolled(bool on) { compressRolled_ = on; } // roll后在后台压缩旧文件，需在start()前调用
+    void setCompressInline(bool on) { compressInline_ = on; } // 后端每批缓存压缩为帧后再写入，文件始终是压缩的，需在start()前调用
+    // 为每个日志文件写入时间索引（见LogIndex.h），每intervalBytes字节或intervalMs毫秒一项，需在start()前调用
+    void setTimeIndex(off_t intervalBytes, int intervalMs = 1000) {
+        indexBytes_ = intervalBytes;
+        indexIntervalMs_ = intervalMs;
+    }
+
+    int64_t droppedMessages() const { return droppedMessages_.load(); } // 被丢弃的日志条数（kDropNewest、kDropByLevel）
+    int64_t droppedBuffers() const { return droppedBuffers_.load(); }   // 被整块丢弃的缓存数（kDropOldest）
+    int64_t droppedBytes() const { return droppedBytes_.load(); }       // 被丢弃的日志总字节数
+    Metrics metrics() const;                                            // 运行时指标的快照，可以在任意线程调用
+    void setMetricsReport(int intervalSeconds) { metricsInterval_ = intervalSeconds; } // 后端每隔intervalSeconds秒在日志中写一行指标，0为关闭，需在start()前调用
+    // 缓存池在path文件的共享映射中分配，crashHandler为true时安装信号处理，崩溃时把未写入的缓存追加到path.tail，需在start()前调用
+    // 建议放在tmpfs上，文件大小约为缓存池大小；创建失败时打印错误并使用普通的缓存
+    void setFlightRecorder(const string &path, bool crashHandler = true) {
+        recorderPath_ = path;
+        crashHandler_ = crashHandler;
+    }
+    const FlightRecorder *flightRecorder() const { return recorder_.get(); } // 没有开启或创建失败时为nullptr
+
   private:
+    // 线程局部模式下每个前端线程独占的暂存缓存
+    struct StagingBuffer {
+        mutex mutex_;      // 几乎无竞争，只有后端定时收集未写满的缓存时才会与前端争用
+        BufferPtr buffer_; // 当前线程正在写入的缓存，被后端收走后为空
+        atomic<int64_t> lines_{0}; // 当前线程写入的条数和字节数，在mutex_内更新
+        atomic<int64_t> bytes_{0};
+    };
+    using StagingPtr = shared_ptr<StagingBuffer>;
+
+
     mutex mutex_;             // 用户保护后端存放的缓存，因为前端操作缓存时涉及多线程
     condition_variable cond_; // 通知后端处理缓存，写入本地文件
+    condition_variable poolCond_; // 通知阻塞的前端缓存池中有可用缓存
     CountDownLatch latch_;    // 倒计时器，用于等待后端线程创建
 
     BufferVector buffers_;    // 前端使用的缓存数组，当待写入的缓存满时，放入数组，用以和后端的缓存数组进行交换，swap操作只交换元素指针，速度很快
     BufferPtr currentBuffer_; // 前端待写入的缓存
     BufferPtr nextBuffer_;    // 前端下一块待写入的缓存
 
+    BufferVector recordBuffers_;    // 写满的延迟日志记录缓存，和文本缓存分开，后端需要先格式化再写入
+    BufferPtr currentRecordBuffer_; // 前端待写入的延迟日志记录缓存，首次使用时从缓存池获取
+
     vector<unique_ptr<thread>> thread_; // 用于创建后端线程
 
     const char *basename_;    // 本地文件基本名，初始化AppendFile类
@@ -65,7 +176,66 @@ class AsyncLogging : public noncopyable {
 
     atomic<bool> running_; // 异步日志类是否运行
 
+    const uint64_t id_;           // 实例编号，用于在线程局部存储中区分不同实例的暂存缓存
+    bool threadLocalBuffer_;      // 是否启用线程局部暂存缓存
+    mutable mutex stagingMutex_;  // 保护stagings_
+    vector<StagingPtr> stagings_; // 所有前端线程注册的暂存缓存
+    BufferVector emptyBuffers_;   // 空闲缓存池，由mutex_保护
+
+    LogFile::Backend backend_;           // 后端写文件的方式
+    bool syncOnWrite_;                   // 每批缓存写入后是否落盘
+    LogFile::IoPolicy ioPolicy_;         // 后端LogFile的页缓存与落盘策略
+    bool compressRolled_;                // roll后是否在后台压缩旧文件
+    bool compressInline_;                // 后端是否在写入前压缩
+    off_t indexBytes_;                   // 时间索引的间隔字节数，0表示不写索引
+    int indexIntervalMs_;                // 时间索引的间隔毫秒数
+    BufferVector inFlight_;              // 已提交、尚未写完的缓存，只由后端访问
+    int poolSize_;                       // 缓存池总块数
+    OverflowPolicy policy_;              // 缓存池耗尽时的处理策略
+    Logger::LogLevel minBlockLevel_;     // kDropByLevel策略下不被丢弃的最低级别
+    atomic<int64_t> droppedMessages_;    // 被丢弃的日志条数
+    atomic<int64_t> droppedBuffers_;     // 被整块丢弃的缓存数
+    atomic<int64_t> droppedBytes_;       // 被丢弃的日志总字节数
+    int64_t reportedMessages_;           // 后端上一次报告时的丢弃条数，只由后端访问
+    int64_t reportedBuffers_;            // 后端上一次报告时的丢弃缓存数
+    int64_t reportedBytes_;              // 后端上一次报告时的丢弃字节数
+    atomic<int64_t> lines_;              // 以下为运行时指标，见Metrics；lines_、bytes_在mutex_内更新
+    atomic<int64_t> bytes_;
+    atomic<int64_t> retiredLines_;       // 已退出线程的暂存缓存中计的条数和字节数，在stagingMutex_内更新
+    atomic<int64_t> retiredBytes_;
+    LogCounter lockWaits_;
+    LogCounter lockWaitNs_;
+    LogCounter poolWaitNs_;
+    atomic<int64_t> wakeups_;            // 只由后端写入
+    atomic<int64_t> buffersWritten_;
+    atomic<int64_t> peakQueueDepth_;
+    mutable mutex ioStatsMutex_;         // 保护ioStats_
+    LogFile::IoStats ioStats_;           // 后端LogFile::ioStats()的最近一次快照
+    LogHistogram buffersPerWakeup_;
+    LogHistogram writeNs_;
+    LogHistogram flushNs_;
+    int metricsInterval_;                // 指标报告的间隔秒数，0为不报告
+    string recorderPath_;                // FlightRecorder的文件，空为不使用
+    bool crashHandler_;                  // 是否安装崩溃时的信号处理
+    unique_ptr<FlightRecorder> recorder_; // 缓存池所在的映射，缓存的状态由mutex_保护
+
     void threadFunc();
+    void appendThreadLocal(StagingBuffer *staging, const char *msg, int len); // 线程局部模式的前端写入
+    StagingBuffer *localStaging();                    // 返回当前线程在本实例下的暂存缓存，首次调用时注册，超过上限时返回nullptr
+    void preallocateBuffers();                        // 预分配缓存池
+    BufferPtr takeEmptyBuffer();                      // 从空闲缓存池取一块缓存，池空时返回空指针，需持有mutex_
+    void markActive(const BufferPtr &buffer);         // 文本缓存开始接收日志，在FlightRecorder中分配序号，需持有mutex_
+    void returnBuffer(BufferPtr buffer);              // 清空一块缓存放回空闲缓存池，需持有mutex_
+    bool waitForBuffer(unique_lock<mutex> &lck, const char *msg, int len, bool record); // 池耗尽时按策略处理，返回false表示该条日志被丢弃
+    void reportDropped(LogFile &output);              // 后端将新增的丢弃数量写入日志
+    void reportMetrics(LogFile &output);              // 后端将当前指标按日志行的格式写入日志
+    void lockContended(unique_lock<mutex> &lck);      // try_lock失败后阻塞获取mutex_，记录等待时间
+    void collectStaging(BufferVector &out, bool all); // 收集各线程未写满的暂存缓存，all为false时跳过正在写入的线程
+    void writeRecords(const Buffer &buffer, LogFile &output); // 后端格式化一块延迟日志记录缓存并写入文件
+    void writeBuffers(BufferVector &buffers, LogFile &output); // 后端把一批文本缓存一次提交写入，缓存移入inFlight_
+    void writeBatch(BufferVector &buffers, BufferVector &records, LogFile &output); // 后端写入一批缓存并flush，记录写入指标
+    void releaseBuffer(void *tag);    // 一块缓存写入完成，从inFlight_归还缓存池
+    void recycleBuffers(BufferVector &buffers); // 把一批缓存归还缓存池并唤醒等待的前端
 };
 
 } // namespace myServer
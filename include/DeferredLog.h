@@ -0,0 +1,185 @@
+/** DeferredLog: 延迟格式化日志
+ * LOG_*_DEFER宏在调用线程上只把调用点描述（静态LogSite的地址）、原始时间戳、线程id和参数的二进制值拷贝成一条记录，
+ * 所有文本格式化（时间、级别、数字转字符串）都留给AsyncLogging的后端线程完成，降低调用线程的延迟。
+ * 格式串使用{}作为占位符，依次替换为参数：LOG_INFO_DEFER("user={} latency={}us", id, us);
+ * 记录格式：RecordHeader + 按顺序编码的参数，整数/浮点/指针各8字节，字符串为4字节长度+内容
+ * 输出位置：setOutput设置记录的接收者（通常为AsyncLogging::appendDeferred），未设置时在调用线程上立即格式化并交给Logger的输出函数
+ * 延迟日志与普通LOG_*日志分开缓存，同一线程的两种日志在文件中的先后顺序不保证
+ */
+#pragma once
+#include "CurrentThread.h"
+#include "Logger.h"
+#include "TimeStamp.h"
+#include <stdint.h>
+#include <string>
+#include <type_traits>
+
+namespace myServer {
+namespace deferred {
+// 参数的编码类型
+enum ArgType : uint8_t {
+    kChar,    // char，按1字节存储
+    kInt64,   // 有符号整数
+    kUInt64,  // 无符号整数
+    kDouble,  // 浮点数
+    kPointer, // 指针，以十六进制输出
+    kString,  // C风格字符串或string，拷贝内容
+};
+
+// 日志调用点的静态描述，其地址作为调用点id写入记录
+struct LogSite {
+    const char *format;     // 以{}为占位符的格式串
+    const char *file;       // 源文件名
+    int line;               // 源代码行号
+    Logger::LogLevel level; // 日志级别
+    const char *func;       // 函数名
+};
+
+// 每条记录的头部
+struct RecordHeader {
+    uint32_t size;            // 整条记录的字节数，包括头部
+    int32_t tid;              // 调用线程id
+    const LogSite *site;      // 调用点
+    const ArgType *argTypes;  // 参数类型列表，第一个元素为参数个数
+    int64_t nanoSeconds;      // 调用时的纳秒时间戳
+};
+
+// 参数类型到编码类型的映射，不支持的类型编译失败
+template <typename T, typename Enable = void>
+struct ArgTraits;
+template <>
+struct ArgTraits<char> {
+    static const ArgType type = kChar;
+};
+template <typename T>
+struct ArgTraits<T, typename enable_if<is_integral<T>::value && is_signed<T>::value && !is_same<T, char>::value>::type> {
+    static const ArgType type = kInt64;
+};
+template <typename T>
+struct ArgTraits<T, typename enable_if<is_integral<T>::value && is_unsigned<T>::value>::type> {
+    static const ArgType type = kUInt64;
+};
+template <typename T>
+struct ArgTraits<T, typename enable_if<is_floating_point<T>::value>::type> {
+    static const ArgType type = kDouble;
+};
+template <>
+struct ArgTraits<const char *> {
+    static const ArgType type = kString;
+};
+template <>
+struct ArgTraits<char *> {
+    static const ArgType type = kString;
+};
+template <>
+struct ArgTraits<string> {
+    static const ArgType type = kString;
+};
+template <typename T>
+struct ArgTraits<T *, typename enable_if<!is_same<typename remove_cv<T>::type, char>::value>::type> {
+    static const ArgType type = kPointer;
+};
+
+// 每种参数组合共享一份静态的类型列表
+template <typename... Args>
+struct ArgTypeList {
+    static constexpr ArgType value[sizeof...(Args) + 1] = {static_cast<ArgType>(sizeof...(Args)), ArgTraits<typename decay<Args>::type>::type...};
+};
+template <typename... Args>
+constexpr ArgType ArgTypeList<Args...>::value[];
+
+// 参数编码，空间不足时截断字符串、丢弃其余参数
+class Encoder {
+  public:
+    Encoder(char *buf, size_t size) : cur_(buf), end_(buf + size) {}
+    char *current() const { return cur_; }
+
+    void encode(char v) { put(&v, sizeof(v)); }
+    void encode(int64_t v) { put(&v, sizeof(v)); }
+    void encode(uint64_t v) { put(&v, sizeof(v)); }
+    void encode(double v) { put(&v, sizeof(v)); }
+    void encode(const void *v) { put(&v, sizeof(v)); }
+    void encode(const char *str, uint32_t len);
+
+    template <typename T>
+    void encodeArg(const T &v) {
+        encodeValue(v, integral_constant<ArgType, ArgTraits<typename decay<T>::type>::type>());
+    }
+
+  private:
+    void put(const void *data, size_t len) {
+        if (static_cast<size_t>(end_ - cur_) >= len) {
+            memcpy(cur_, data, len);
+            cur_ += len;
+        } else {
+            end_ = cur_; // 一旦放不下，后面的参数全部丢弃，保证解码时不会错位
+        }
+    }
+    template <typename T>
+    void encodeValue(const T &v, integral_constant<ArgType, kChar>) { encode(static_cast<char>(v)); }
+    template <typename T>
+    void encodeValue(const T &v, integral_constant<ArgType, kInt64>) { encode(static_cast<int64_t>(v)); }
+    template <typename T>
+    void encodeValue(const T &v, integral_constant<ArgType, kUInt64>) { encode(static_cast<uint64_t>(v)); }
+    template <typename T>
+    void encodeValue(const T &v, integral_constant<ArgType, kDouble>) { encode(static_cast<double>(v)); }
+    template <typename T>
+    void encodeValue(const T &v, integral_constant<ArgType, kPointer>) { encode(static_cast<const void *>(v)); }
+    void encodeValue(const char *v, integral_constant<ArgType, kString>) {
+        v = v ? v : "(NULL)";
+        encode(v, static_cast<uint32_t>(strlen(v)));
+    }
+    void encodeValue(const string &v, integral_constant<ArgType, kString>) { encode(v.data(), static_cast<uint32_t>(v.size())); }
+
+    char *cur_;
+    char *end_;
+};
+
+using OutputFunc = Logger::OutputFunc;
+void setOutput(OutputFunc); // 设置记录的接收者，通常为AsyncLogging::appendDeferred
+void output(const char *record, int len);          // 交给接收者，未设置时立即格式化输出
+void formatRecord(const char *record, LogStream &stream); // 将一条记录格式化为与Logger相同格式的日志行，由后端调用
+inline uint32_t recordSize(const char *record) {
+    uint32_t size;
+    memcpy(&size, record, sizeof(size));
+    return size;
+} // 返回记录的字节数
+inline Logger::LogLevel recordLevel(const char *record) {
+    RecordHeader header;
+    memcpy(&header, record, sizeof(header));
+    return header.site->level;
+} // 返回记录的日志级别
+
+// 在调用线程上编码一条记录并交给接收者
+template <typename... Args>
+void log(const LogSite &site, const Args &...args) {
+    char buf[kSmallBuffer];
+    Encoder encoder(buf + sizeof(RecordHeader), sizeof(buf) - sizeof(RecordHeader));
+    int dummy[] = {0, (encoder.encodeArg(args), 0)...};
+    (void)dummy;
+
+    RecordHeader header;
+    header.size = static_cast<uint32_t>(encoder.current() - buf);
+    header.tid = currentThread::tid();
+    header.site = &site;
+    header.argTypes = ArgTypeList<Args...>::value;
+    header.nanoSeconds = TimeStamp::now().nanoSecondsSinceEpoch();
+    memcpy(buf, &header, sizeof(header));
+    output(buf, static_cast<int>(header.size));
+}
+} // namespace deferred
+
+// 延迟格式化的日志宏，调用点描述在编译期常量初始化，不需要运行时构造；低于YKLOG_MIN_LEVEL的在编译期去掉
+#define YKLOG_DEFER_(lvl, fmt, ...)                                                                         \
+    do {                                                                                                    \
+        if (YKLOG_COMPILED_(lvl) && YKLOG_SITE_ON_(lvl)) {                                                  \
+            static const myServer::deferred::LogSite yklogSite_ = {fmt, __FILE__, __LINE__, lvl, __func__}; \
+            myServer::deferred::log(yklogSite_, ##__VA_ARGS__);                                             \
+        }                                                                                                   \
+    } while (0)
+#define LOG_TRACE_DEFER(fmt, ...) YKLOG_DEFER_(myServer::Logger::TRACE, fmt, ##__VA_ARGS__)
+#define LOG_DEBUG_DEFER(fmt, ...) YKLOG_DEFER_(myServer::Logger::DEBUG, fmt, ##__VA_ARGS__)
+#define LOG_INFO_DEFER(fmt, ...) YKLOG_DEFER_(myServer::Logger::INFO, fmt, ##__VA_ARGS__)
+#define LOG_WARN_DEFER(fmt, ...) YKLOG_DEFER_(myServer::Logger::WARN, fmt, ##__VA_ARGS__)
+#define LOG_ERROR_DEFER(fmt, ...) YKLOG_DEFER_(myServer::Logger::ERROR, fmt, ##__VA_ARGS__)
+} // namespace myServer
@@ -0,0 +1,19 @@
+/** DoubleConversion: 浮点数转字符串
+ * formatDouble/formatFloat用Grisu2算法输出能被strtod/strtof精确还原的十进制表示，约99.9%的情况下是最短的，其余情况最多17位有效数字，
+ * 只使用整数运算和一张10的幂的缓存表，不依赖locale，也不经过snprintf的格式串解析。
+ * 十进制指数在[-4, 17)之间时输出普通小数（整数不带小数点），否则输出与printf相同形式的科学计数法，如1.5e+20、1e-05。
+ * nan、inf、-inf按printf的写法输出。
+ * formatFixed输出固定precision位小数（四舍五入），precision超出[0, 9]或数值过大无法用64位整数表示时退化为formatDouble。
+ * 所有函数都直接写入buf并返回长度，不写入'\0'，调用者保证buf至少有kMaxDoubleSize字节
+ */
+#pragma once
+#include <stddef.h>
+
+namespace myServer {
+const int kMaxDoubleSize = 32;    // 输出的最大长度
+const int kMaxFixedPrecision = 9; // formatFixed支持的最大小数位数
+
+size_t formatDouble(char *buf, double value);
+size_t formatFloat(char *buf, float value);
+size_t formatFixed(char *buf, double value, int precision);
+} // namespace myServer
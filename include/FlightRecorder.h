@@ -0,0 +1,90 @@
+/** FlightRecorder: 异步日志前端缓存的崩溃保护
+ * AsyncLogging::setFlightRecorder(path)后，start()时缓存池的全部缓存在path文件的共享映射（MAP_SHARED）中就地构造，
+ * 前端写入缓存就是写入这个文件的页缓存，进程崩溃（包括SIGKILL、OOM）后内核仍会保留并回写这些页，append路径上没有任何额外操作。
+ * 文件开头是文件头，每块缓存一个槽，记录状态和序号：缓存开始接收日志（成为currentBuffer_或线程局部暂存缓存）时标记为活跃并分配递增的序号，
+ * 写入完成归还缓存池时标记为空闲，只在缓存在前后端之间流动时（每4MB一次）更新，在AsyncLogging的mutex_内调用。
+ * 崩溃时活跃的缓存就是还没有写入日志文件的尾部，按序号排列即为写入顺序；缓存的写入位置cur_也在映射中，
+ * 用文件头记录的映射地址换算为长度。缓存写完到归还之间崩溃时，恢复的尾部可能与日志文件的末尾重复一小段。
+ * 延迟日志记录（DeferredLog.h）的缓存不标记：记录要在后端格式化，崩溃后无法在进程外恢复，不在恢复的尾部中。
+ * 崩溃处理：installCrashHandler()后，SIGSEGV、SIGBUS、SIGFPE、SIGILL、SIGABRT（包括LOG_FATAL的abort()）的信号处理函数
+ *   只用open/write把活跃缓存按序号追加到path.tail，再交给原来的处理方式。尽力而为：不加锁，前端或后端可能正在修改其中的缓存。
+ * 没有执行信号处理的崩溃（SIGKILL、OOM、掉电以外的主机故障）由ylogrecover从文件中取出尾部，下一次用同一路径启动时也会先自动取出到path.tail。
+ * 映射文件建议放在tmpfs（如/dev/shm），映射的脏页不会回写磁盘；进程崩溃后文件仍然存在，主机重启后丢失。
+ */
+#pragma once
+#include "LogStream.h"
+#include <atomic>
+#include <boost/noncopyable.hpp>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+
+namespace myServer {
+using boost::noncopyable;
+using namespace std;
+
+class FlightRecorder : noncopyable {
+  public:
+    using Buffer = FixedBuffer<kLargeBuffer>;
+    static const int kMaxSlots = 1024;
+
+    enum SlotState : uint32_t { kFree,   // 在缓存池中，或用于延迟日志记录
+                                kActive }; // 前端文本缓存，或等待写入、正在写入
+    enum RingState : uint32_t { kRunning, // 正在使用，或进程没有经过信号处理就退出了
+                                kStopped, // 正常stop()，所有缓存都已写入
+                                kDrained }; // 信号处理函数已经把尾部写入path.tail
+
+    struct Slot {
+        atomic<uint64_t> seq; // 最近一次标记为活跃时分配的序号
+        atomic<uint32_t> state;
+        uint32_t reserved;
+    };
+    // 文件头，位于文件开头，缓存从dataOffset开始，每块占slotSize字节
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        atomic<uint32_t> state; // RingState
+        uint32_t slotCount;
+        int32_t pid;
+        uint64_t slotSize;
+        uint64_t dataOffset;
+        uint64_t bufferSize;   // 缓存的数据区大小
+        uint64_t cursorOffset; // 缓存对象中cur_的偏移
+        uint64_t baseAddress;  // 写入进程中文件的映射地址，用于把cur_换算为长度
+        atomic<uint64_t> nextSeq;
+        int64_t startTime;     // 创建的时间，1970至今的秒数
+        char basename[128];    // AsyncLogging的basename，'\0'结尾
+        Slot slots[kMaxSlots];
+    };
+
+    // 创建或重建path文件并映射，slots块缓存全部就地构造并清零；文件中有上次没有取出的尾部时先追加到path.tail
+    // 失败（或slots超过kMaxSlots）时打印错误并返回nullptr，调用者退回普通的缓存
+    static FlightRecorder *create(const string &path, int slots, const string &basename);
+    ~FlightRecorder(); // 卸载信号处理并解除映射，缓存不再可用
+
+    Buffer *buffer(int index) { return reinterpret_cast<Buffer *>(base_ + header_->dataOffset + index * header_->slotSize); }
+    int slots() const { return static_cast<int>(header_->slotCount); }
+    void activate(const Buffer *buffer); // 缓存开始接收日志，分配新的序号
+    void release(const Buffer *buffer);  // 缓存写入完成或被丢弃，回到缓存池
+    void setStopped();                   // 正常结束，所有缓存都已写入
+    void installCrashHandler();          // 同一时刻只有一个实例的信号处理生效，后安装的替换先安装的
+    int64_t drain(int fd) const;         // 把活跃缓存按序号写入fd，只使用write，可以在信号处理函数中调用；返回写入的字节数
+    const string &tailPath() const { return tailPath_; }
+
+    // 工具使用：把path中活跃缓存的内容按序号写入fd，文件不是FlightRecorder的格式时返回-1并设置error
+    static int64_t recover(const string &path, int fd, string *error);
+    static bool describe(const string &path, FILE *out, string *error); // 打印文件头和每个活跃的槽
+
+  private:
+    FlightRecorder(const string &path, int fd, char *base, size_t size);
+    static void crashHandler(int sig);
+
+    const string path_;
+    const string tailPath_;
+    int fd_;
+    char *base_;
+    size_t size_;
+    Header *header_;
+};
+
+} // namespace myServer
@@ -0,0 +1,216 @@
+/** FormatString: 编译期解析的格式串
+ * LOG_INFO_FMT("user={} latency={}us", id, us)在编译期把格式串拆分为字面量片段和占位符，
+ * 占位符个数与参数个数不一致、或有未配对的{、}时编译失败。{{和}}分别输出{和}。
+ * 运行时不解析格式串、不分配内存：先算出整条消息的最大长度做一次边界检查，
+ * 然后把字面量（编译期已知长度的memcpy）和参数依次直接写入LogStream的缓冲区。
+ * 缓冲区剩余空间不足时退化为逐段带检查的写入，行为与<<链一致。
+ */
+#pragma once
+#include "LogStream.h"
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace myServer {
+namespace fmt {
+// 一个输出片段：格式串中[begin, begin + len)的字面量，或者第arg个参数
+struct Segment {
+    int begin;
+    int len;
+    int arg; // -1表示字面量
+};
+
+const int kInvalidFormat = -1;
+
+// 遍历格式串，统计片段数和占位符数，格式串不合法时都返回kInvalidFormat
+constexpr int scan(const char *s, bool countArgs) {
+    int segments = 0;
+    int args = 0;
+    int begin = 0;
+    int i = 0;
+    while (s[i]) {
+        if ((s[i] == '{' && s[i + 1] == '{') || (s[i] == '}' && s[i + 1] == '}')) {
+            ++segments;
+            i += 2;
+            begin = i;
+        } else if (s[i] == '{' && s[i + 1] == '}') {
+            segments += (i > begin) + 1;
+            ++args;
+            i += 2;
+            begin = i;
+        } else if (s[i] == '{' || s[i] == '}') {
+            return kInvalidFormat;
+        } else {
+            ++i;
+        }
+    }
+    segments += i > begin;
+    return countArgs ? args : segments;
+}
+
+template <int N>
+struct Layout {
+    Segment segments[N > 0 ? N : 1];
+};
+
+// 把格式串拆分为N个片段，转义的括号作为字面量的最后一个字符，第二个括号跳过
+template <int N>
+constexpr Layout<N> parse(const char *s) {
+    Layout<N> layout{};
+    int n = 0;
+    int arg = 0;
+    int begin = 0;
+    int i = 0;
+    while (s[i]) {
+        if ((s[i] == '{' && s[i + 1] == '{') || (s[i] == '}' && s[i + 1] == '}')) {
+            layout.segments[n++] = Segment{begin, i + 1 - begin, -1};
+            i += 2;
+            begin = i;
+        } else if (s[i] == '{' && s[i + 1] == '}') {
+            if (i > begin) {
+                layout.segments[n++] = Segment{begin, i - begin, -1};
+            }
+            layout.segments[n++] = Segment{0, 0, arg++};
+            i += 2;
+            begin = i;
+        } else {
+            ++i;
+        }
+    }
+    if (i > begin) {
+        layout.segments[n++] = Segment{begin, i - begin, -1};
+    }
+    return layout;
+}
+
+// 编译期解析结果，S::value()返回格式串字面量
+template <typename S>
+struct Parsed {
+    static constexpr const char *str = S::value();
+    static constexpr int kArgs = scan(str, true);
+    static constexpr int kSegments = scan(str, false);
+    static constexpr Layout<kSegments> layout = parse<kSegments>(kSegments < 0 ? "" : str); // 不合法的格式串由formatTo中的static_assert报错
+
+    static constexpr size_t literalSize() {
+        size_t size = 0;
+        for (int i = 0; i < kSegments; ++i) {
+            size += layout.segments[i].len;
+        }
+        return size;
+    }
+};
+
+// 参数写入：maxSize为编译期已知的最大长度，字符串长度在运行时由argLength给出
+// char*、char[N]与const char*一样按字符串处理（<<同样如此），不能落入通用的模板
+template <typename T>
+constexpr size_t maxSize() {
+    using U = typename decay<T>::type;
+    if (is_same<U, char>::value) {
+        return 1;
+    }
+    if (is_same<U, const char *>::value || is_same<U, char *>::value) {
+        return 0;
+    }
+    return is_arithmetic<U>::value || is_pointer<U>::value || is_same<U, Fixed>::value ? LogStream::kMaxNumericSize : 0;
+}
+inline size_t argLength(const char *v) { return v ? strlen(v) : 6; }
+inline size_t argLength(char *v) { return argLength(static_cast<const char *>(v)); }
+template <size_t N>
+inline size_t argLength(const char (&v)[N]) { return argLength(static_cast<const char *>(v)); }
+inline size_t argLength(const string &v) { return v.size(); }
+template <typename T>
+inline size_t argLength(const T &) { return 0; }
+
+inline char *writeArg(char *p, char v, size_t) {
+    *p = v;
+    return p + 1;
+}
+inline char *writeArg(char *p, const char *v, size_t len) {
+    memcpy(p, v ? v : "(NULL)", len);
+    return p + len;
+}
+inline char *writeArg(char *p, const string &v, size_t len) {
+    memcpy(p, v.data(), len);
+    return p + len;
+}
+inline char *writeArg(char *p, const void *v, size_t) {
+    p[0] = '0';
+    p[1] = 'x';
+    return p + 2 + convertHex(p + 2, reinterpret_cast<uintptr_t>(v));
+}
+template <typename T>
+inline typename enable_if<is_integral<T>::value && !is_same<T, char>::value, char *>::type writeArg(char *p, T v, size_t) {
+    // 小于int的整数（包括bool、signed char）提升为int
+    using U = typename conditional<(sizeof(T) < sizeof(int)), int, T>::type;
+    return p + convert(p, static_cast<U>(v));
+}
+inline char *writeArg(char *p, float v, size_t) {
+    return p + convertFloat(p, v);
+}
+template <typename T>
+inline typename enable_if<is_floating_point<T>::value && !is_same<T, float>::value, char *>::type writeArg(char *p, T v, size_t) {
+    return p + convertDouble(p, static_cast<double>(v));
+}
+inline char *writeArg(char *p, const Fixed &v, size_t) {
+    return p + formatFixed(p, v.value(), v.precision());
+}
+
+// 第I个片段的写入
+template <typename P, size_t I, typename Tuple>
+inline char *writeSegment(char *p, const Tuple &args, const size_t *lens) {
+    constexpr Segment seg = P::layout.segments[I];
+    if constexpr (seg.arg < 0) {
+        memcpy(p, P::str + seg.begin, seg.len);
+        return p + seg.len;
+    } else {
+        return writeArg(p, get<seg.arg>(args), lens[seg.arg]);
+    }
+}
+template <typename P, size_t I, typename Tuple>
+inline void streamSegment(LogStream &stream, const Tuple &args) {
+    constexpr Segment seg = P::layout.segments[I];
+    if constexpr (seg.arg < 0) {
+        stream.append(P::str + seg.begin, seg.len);
+    } else {
+        stream << get<seg.arg>(args);
+    }
+}
+
+template <typename P, typename Tuple, size_t... I>
+inline void writeAll(LogStream &stream, const Tuple &args, const size_t *lens, size_t need, index_sequence<I...>) {
+    (void)args; // 没有参数的格式串展开为空，避免未使用警告
+    (void)lens;
+    LogStream::Buffer &buffer = stream.buffer();
+    if (__builtin_expect(static_cast<size_t>(buffer.avail()) > need, 1)) {
+        char *p = buffer.current();
+        ((p = writeSegment<P, I>(p, args, lens)), ...);
+        buffer.add(p - buffer.current());
+    } else {
+        (streamSegment<P, I>(stream, args), ...);
+    }
+}
+
+// 按编译期解析的格式串把参数写入stream，S由YKLOG_FMT_STRING_生成
+template <typename S, typename... Args>
+void formatTo(LogStream &stream, S, const Args &...args) {
+    using P = Parsed<S>;
+    static_assert(P::kArgs != kInvalidFormat, "unmatched { or } in log format string, use {{ and }} for literal braces");
+    static_assert(P::kArgs == sizeof...(Args), "number of {} placeholders does not match number of arguments");
+    const size_t lens[] = {argLength(args)..., 0};
+    size_t need = P::literalSize() + (maxSize<Args>() + ... + 0);
+    for (size_t i = 0; i < sizeof...(Args); ++i) {
+        need += lens[i];
+    }
+    writeAll<P>(stream, forward_as_tuple(args...), lens, need, make_index_sequence<(P::kSegments > 0 ? P::kSegments : 0)>());
+}
+} // namespace fmt
+} // namespace myServer
+
+// 把格式串字面量包装成一个类型，使其能在模板中作为编译期常量使用
+#define YKLOG_FMT_STRING_(s)                                 \
+    [] {                                                     \
+        struct Str {                                         \
+            static constexpr const char *value() { return s; } \
+        };                                                   \
+        return Str{};                                        \
+    }()
@@ -0,0 +1,117 @@
+/** IntegerConversion: 整数转字符串
+ * 先由最高位的位置查表算出十进制位数，再从末尾向前每次除以100，用200字节的两位数字表一次写入两个字符，
+ * 不需要先逆序生成再reverse。32位以内的整数全程使用32位运算。
+ * 除formatInteger外，还提供十六进制、补齐到最小宽度、固定宽度（用于时间戳等定长字段）几种变体。
+ * 所有函数都直接写入buf并返回长度，不写入'\0'，调用者保证buf足够大（十进制最多20位数字加符号）
+ */
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+
+namespace myServer {
+// "00" "01" ... "99"
+inline constexpr char kDigitPairs[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+inline constexpr uint64_t kPowersOf10[20] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL, 1000000000ULL,
+    10000000000ULL, 100000000000ULL, 1000000000000ULL, 10000000000000ULL, 100000000000000ULL,
+    1000000000000000ULL, 10000000000000000ULL, 100000000000000000ULL, 1000000000000000000ULL,
+    10000000000000000000ULL};
+
+// 十进制位数，0返回1
+inline int countDigits(uint64_t value) {
+    // 二进制位数 * log10(2) ≈ bits * 1233 / 4096，得到的t是实际位数或少1，再和10的幂比较修正
+    int t = (64 - __builtin_clzll(value | 1)) * 1233 >> 12;
+    return t + ((value | 1) >= kPowersOf10[t]); // 0按1处理，返回1位
+}
+
+// 十六进制位数，0返回1
+inline int countHexDigits(uint64_t value) {
+    return (64 - __builtin_clzll(value | 1) + 3) >> 2;
+}
+
+// 把value的十进制数字写入到end之前，调用者已经按countDigits留好位置
+template <typename U>
+inline void writeDigitsBackward(char *end, U value) {
+    while (value >= 100) {
+        U r = value % 100;
+        value /= 100;
+        end -= 2;
+        memcpy(end, kDigitPairs + r * 2, 2);
+    }
+    if (value >= 10) {
+        memcpy(end - 2, kDigitPairs + value * 2, 2);
+    } else {
+        end[-1] = static_cast<char>('0' + value);
+    }
+}
+
+// 任意整数类型的十进制表示，负数带'-'
+template <typename T>
+inline size_t formatInteger(char *buf, T value) {
+    static_assert(std::is_integral<T>::value, "formatInteger requires an integral type");
+    using U = typename std::conditional<(sizeof(T) <= sizeof(uint32_t)), uint32_t, uint64_t>::type;
+    char *p = buf;
+    U u = static_cast<U>(value);
+    if constexpr (std::is_signed<T>::value) {
+        if (value < 0) {
+            *p++ = '-';
+            u = 0 - u; // 对最小值也正确
+        }
+    }
+    int n = countDigits(u);
+    writeDigitsBackward(p + n, u);
+    return p - buf + n;
+}
+
+// 大写十六进制，不带0x前缀
+inline size_t formatHex(char *buf, uint64_t value) {
+    static const char digitsHex[] = "0123456789ABCDEF";
+    int n = countHexDigits(value);
+    for (char *p = buf + n; p != buf; value >>= 4) {
+        *--p = digitsHex[value & 0xF];
+    }
+    return n;
+}
+
+// 至少width位，不足时左侧补pad，width不超过20
+inline size_t formatPadded(char *buf, uint64_t value, int width, char pad = '0') {
+    int n = countDigits(value);
+    if (n < width) {
+        memset(buf, pad, width - n);
+        n = width;
+    }
+    writeDigitsBackward(buf + n, value);
+    return n;
+}
+
+// 恰好width位，不足时左侧补0，超出时只保留低width位，用于时间戳等定长字段
+inline void formatFixedWidth(char *buf, uint32_t value, int width) {
+    char *p = buf + width;
+    while (p - buf >= 2) {
+        p -= 2;
+        memcpy(p, kDigitPairs + value % 100 * 2, 2);
+        value /= 100;
+    }
+    if (p != buf) {
+        *buf = static_cast<char>('0' + value % 10);
+    }
+}
+
+// 两位数字，value在[0, 100)
+inline void format2Digits(char *buf, uint32_t value) {
+    memcpy(buf, kDigitPairs + value * 2, 2);
+}
+} // namespace myServer
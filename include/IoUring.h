@@ -0,0 +1,57 @@
+/** IoUring: 不依赖liburing的最小io_uring封装
+ * 直接调用io_uring_setup/io_uring_enter，映射提交队列（SQ）和完成队列（CQ）的共享内存
+ * 只提供日志后端需要的操作：准备写入和fsync提交项、提交、取完成事件、带超时等待完成事件
+ * 要求内核支持IORING_FEAT_SINGLE_MMAP和IORING_FEAT_EXT_ARG（5.11及以上），不满足时valid()为false，
+ * 调用者应退回普通的write路径，见available()
+ * 非线程安全，由单个后端线程使用
+ */
+#pragma once
+#include <boost/noncopyable.hpp>
+#include <linux/io_uring.h>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace myServer {
+using boost::noncopyable;
+
+class IoUring : noncopyable {
+  public:
+    explicit IoUring(unsigned entries); // 提交队列长度，内核会向上取整为2的幂，完成队列是其两倍
+    ~IoUring();
+
+    static bool available(); // 内核是否支持，第一次调用时探测一次，不支持时向标准错误打印原因
+    bool valid() const { return ringFd_ >= 0; }
+    unsigned entries() const { return sqEntries_; }
+
+    struct io_uring_sqe *getSqe(); // 取一个空闲的提交项并清零，提交队列已满时返回nullptr
+    // offset为(uint64_t)-1时从文件当前位置写入（管道等不可定位的文件）
+    static void prepWrite(struct io_uring_sqe *sqe, int fd, const void *buf, unsigned len, uint64_t offset, uint64_t userData);
+    static void prepFsync(struct io_uring_sqe *sqe, int fd, bool dataOnly, uint64_t userData);
+
+    int submit();              // 提交所有已准备的提交项，返回提交数量，失败返回-errno
+    int wait(int timeoutMs);   // 提交并等待至少一个完成事件，超时返回-ETIME，timeoutMs小于0时一直等待
+    bool peek(uint64_t *userData, int *res); // 取出一个完成事件，没有时返回false
+
+  private:
+    int enter(unsigned toSubmit, unsigned minComplete, unsigned flags, const void *arg, size_t argSize);
+
+    int ringFd_;
+    unsigned sqEntries_;
+    void *ring_;      // SQ和CQ共用的映射（IORING_FEAT_SINGLE_MMAP）
+    size_t ringSize_;
+    struct io_uring_sqe *sqes_;
+    size_t sqesSize_;
+
+    unsigned *sqHead_; // 内核消费提交项后推进
+    unsigned *sqTail_; // 用户准备好提交项后推进
+    unsigned sqMask_;
+    unsigned sqLocalTail_; // 已准备但尚未发布给内核的提交项的尾部
+    unsigned sqSubmitted_; // 已发布给内核的尾部
+
+    unsigned *cqHead_; // 用户取出完成事件后推进
+    unsigned *cqTail_; // 内核写入完成事件后推进
+    unsigned cqMask_;
+    struct io_uring_cqe *cqes_;
+};
+
+} // namespace myServer
@@ -0,0 +1,151 @@
+/** LogArchive: 分块压缩的日志归档文件
+ * 文件格式（整数均为小端）：
+ *   文件头   "YKLZ" | u32 版本
+ *   数据块   u32 原始长度 | u32 压缩长度 | LZ4块数据；压缩长度等于原始长度时数据未压缩（压缩后反而更长）
+ *   索引     每块一项：u64 块在文件中的偏移 | u32 原始长度 | u32 压缩长度 | i64 块内最早的日志时间 | i64 最晚的日志时间（纳秒，没有时间时为0）
+ *   文件尾   u64 索引偏移 | u32 块数 | "YKLI"
+ * 数据块在行边界切分，每块最多kBlockSize字节，可以单独解压；读取时只需读文件尾和索引，就能按原始偏移或时间定位到块
+ * 块内日志的时间不一定有序（线程局部缓存、延迟格式化都会让不同线程的日志交错），索引记录的是块内的最小和最大时间
+ *
+ * LogArchiveWriter: 写入原始日志，写满一块压缩一块，finish()写入索引
+ * LogArchiveReader: 读取索引，按块解压，readRange()只解压时间范围内的块并输出范围内的行
+ * LogCompressor: 低优先级的后台压缩线程，LogFile roll时把旧文件交给它压缩为"文件名.lz"，完成后删除原文件
+ * compressLogFile(): 同步压缩一个文件
+ *
+ * 流式帧格式：写入时直接压缩的日志文件（LogFile的compressed模式）没有索引，由一串可以单独解压的帧组成
+ *   帧       "YKLF" | u32 原始长度 | u32 数据长度 | u32 数据的校验和 | LZ4块数据；数据长度等于原始长度时未压缩
+ * 进程崩溃或掉电时最后一帧可能不完整（kMmap下还可能是预分配的0），LogFrameReader读到不完整或校验失败的帧时停止，
+ * 之前的帧都能读出，即最多丢失最后一帧
+ */
+#pragma once
+#include "TimeStamp.h"
+#include <boost/noncopyable.hpp>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <sys/types.h>
+#include <thread>
+#include <vector>
+
+namespace myServer {
+using boost::noncopyable;
+using std::string;
+
+class LogArchiveWriter : noncopyable {
+  public:
+    static const size_t kBlockSize = 256 * 1024; // 每块原始数据的最大长度
+
+    explicit LogArchiveWriter(const string &filename);
+    ~LogArchiveWriter(); // 没有调用finish()时自动finish
+
+    bool valid() const { return fd_ >= 0; }
+    void append(const char *data, size_t len); // 写入原始日志，满一块时压缩写出
+    bool finish();                             // 写出剩余数据、索引和文件尾，返回是否全部写入成功
+
+    int64_t rawBytes() const { return rawBytes_; }               // 已写入的原始字节数
+    int64_t compressedBytes() const { return compressedBytes_; } // 已写出的文件字节数
+
+  private:
+    struct IndexEntry {
+        uint64_t offset;
+        uint32_t rawSize;
+        uint32_t compressedSize;
+        int64_t firstTime;
+        int64_t lastTime;
+    };
+    void writeBlock(const char *data, size_t len);
+    bool writeAll(const char *data, size_t len);
+
+    int fd_;
+    bool finished_;
+    bool failed_;
+    std::vector<char> pending_;    // 不满一块的原始数据
+    std::vector<char> compressed_; // 压缩输出，大小为compressBound(kBlockSize) + 块头
+    std::vector<IndexEntry> index_;
+    int64_t rawBytes_;
+    int64_t compressedBytes_;
+};
+
+class LogArchiveReader : noncopyable {
+  public:
+    struct Block {
+        off_t offset;            // 块头在文件中的偏移
+        uint32_t rawSize;
+        uint32_t compressedSize;
+        int64_t rawOffset;       // 块的原始数据在解压后文件中的偏移
+        TimeStamp first;         // 块内最早的日志时间，没有时为invalid
+        TimeStamp last;          // 块内最晚的日志时间
+    };
+    using LineCallback = std::function<void(const char *line, size_t len)>; // 包括结尾的'\n'
+
+    explicit LogArchiveReader(const string &filename); // 打开并读取索引，失败时valid()为false
+    ~LogArchiveReader();
+
+    bool valid() const { return valid_; }
+    const std::vector<Block> &blocks() const { return blocks_; }
+    int64_t rawSize() const { return rawSize_; }
+
+    bool readBlock(size_t i, string *out) const; // 解压第i块，失败返回false
+    int findBlock(int64_t rawOffset) const;      // 包含原始偏移rawOffset的块，超出范围时返回-1
+    // 输出时间在[from, to]内的行，只解压时间范围有交集的块；没有时间的行（如多行日志的后续行）跟随上一行
+    bool readRange(TimeStamp from, TimeStamp to, const LineCallback &cb) const;
+
+  private:
+    int fd_;
+    bool valid_;
+    std::vector<Block> blocks_;
+    int64_t rawSize_;
+};
+
+class LogCompressor : noncopyable {
+  public:
+    LogCompressor();
+    ~LogCompressor(); // 压缩完队列中剩余的文件后退出
+
+    void add(const string &filename); // 把已关闭的日志文件加入压缩队列
+    void wait();                      // 等待队列中的文件全部压缩完成
+    int64_t compressedFiles() const;  // 已压缩的文件数
+
+  private:
+    void threadFunc();
+
+    mutable std::mutex mutex_;
+    std::condition_variable cond_;     // 通知压缩线程有新文件或退出
+    std::condition_variable doneCond_; // 通知wait()队列已清空
+    std::deque<string> queue_;
+    bool running_;
+    bool busy_;              // 正在压缩一个文件
+    int64_t compressedFiles_;
+    std::thread thread_;
+};
+
+const size_t kFrameHeaderSize = 16;
+inline size_t frameBound(size_t len) { return kFrameHeaderSize + len + len / 255 + 16; } // 一帧编码后的最大长度
+size_t encodeFrame(const char *data, size_t len, char *out); // 把data编码为一帧写入out（至少frameBound(len)字节），返回帧长度
+
+class LogFrameReader : noncopyable {
+  public:
+    explicit LogFrameReader(const string &filename);
+    ~LogFrameReader();
+
+    bool valid() const { return fd_ >= 0; }
+    bool next(string *out);                  // 读出下一帧解压后的数据，到结尾或遇到损坏的帧时返回false
+    bool truncated() const { return truncated_; } // 是否因为不完整或损坏的帧而停止（而不是正好读到文件结尾）
+    off_t offset() const { return offset_; } // 下一帧在文件中的偏移，停止后即有效数据的长度
+
+  private:
+    int fd_;
+    off_t offset_;
+    bool truncated_;
+    string payload_;
+};
+
+bool isFrameFile(const string &filename); // 文件是否以流式帧开头
+
+// 把src压缩为dst（先写入dst.tmp再改名），成功后按removeSource删除src及其时间索引src.idx
+bool compressLogFile(const string &src, const string &dst, bool removeSource = false);
+
+} // namespace myServer
@@ -1,44 +1,117 @@
 /**
  * LogFile: 后端日志管理
- * AppendFile: 实现类，写入缓冲，fflush
- * append(): 写入
+ * AppendFile: 实现类，写入缓冲，fflush；按Backend选择stdio缓冲写入、fd直接writev、io_uring异步写入或mmap
+ * append(): 写入，也可以传入一组iovec一次写入一批缓存
+ * appendAsync(): 异步写入一批缓存，每块写完后以调用者给出的tag调用WriteCallback，调用者在回调前不能修改或释放该块；
+ *                kIoUring下多块写入同时在途，其余写入方式同步写完后立即回调
+ * sync(): 把已写入的数据落盘（fdatasync），kIoUring下提交一个排在之前所有写入之后的fsync请求
  * flush(): 刷新缓冲，当短时间内日志长度较小时，不能将日志信息长时间放如缓存中，因此日志每记录1024次数就检查一次距前一次flush到文件的时间是否超过3s
+ * setIoPolicy(): 页缓存与落盘策略，见IoPolicy；ioStats()返回flush、落盘次数和日志占用页缓存的估计
+ * setCompressRolled(): roll时把关闭的文件交给后台线程压缩为分块的.lz归档（见LogArchive.h），压缩完成后删除原文件
+ * compressed: 另一种压缩方式，每批缓存在写入前压缩为可单独解压的帧，文件始终是压缩的，rollSize按压缩后的字节计算；
+ *             此时setCompressRolled不起作用
+ * setTimeIndex(): 为每个日志文件写入稀疏的时间索引"文件名.idx"（见LogIndex.h），每intervalBytes字节或intervalMs毫秒一项，
+ *                 写入时只解析每块数据首尾两行的时间；compressed模式下文件偏移不对应原文，不写索引
  * rollFile(): 滚动日志，当日志消息记录长度达到设定值或日志记录时间超过当天进行日志滚动
  * getLogFileName(): 获得日志文件名字
  * m_mutex: 可选择是否对append和flush进行锁操作保证线程安全，因为append内部使用的是fwrite_unlocked()
  * 基本逻辑：
  *  AppendFile实现非线程安全的写入和刷新操作，在LogFile中来决定是否对写入和刷新加锁
  *  对于roll的时机：一是当前写入文件的字节数大于rollSize; 二是到了新的一天
- *  对于flush的时机：一是roll时关闭文件强制刷新；二是距离上一次刷新时间超过flushInterval秒
- *  对于进行roll和flush的检测时机：当append()后检测
+ *  对于flush的时机：一是roll时关闭文件强制刷新；二是距离上一次刷新时间超过flushInterval秒；
+ *                  设置IoPolicy后，三是未刷新的数据超过flushBytes；四是距离上一次刷新超过flushLatencyMs
+ *  对于进行roll和flush的检测时机：当append()后检测；设置flushLatencyMs后每次append都读取时钟，不再每checkEveryN次检测一次
  */
 #pragma once
 #include <boost/noncopyable.hpp>
+#include <functional>
 #include <memory>
 #include <mutex>
+#include <stdint.h>
+#include <sys/uio.h>
 using boost::noncopyable;
 using namespace std;
 namespace myServer {
+class LogCompressor;
+class LogIndexWriter;
 
 class LogFile : public noncopyable {
   public:
-    LogFile(const string &basename, //  日志文件名，默认保存在当前工作目录下
-            off_t rollSize,         //  日志文件超过设定值进行roll
-            bool threadSafe = true, //  默认线程安全，使用互斥锁操作将消息写入缓冲区
-            int flushInterval = 3,  //  flush刷新时间间隔
-            int checkEveryN = 1024  //  每1024次日志操作，检查一个是否刷新、是否roll
+    // 文件写入方式
+    enum Backend {
+        kStdio,  // 经过64KB的stdio缓冲区，适合同步写入的短消息
+        kWritev, // 直接对fd调用writev，整批缓存一次写入，不额外拷贝，适合异步日志的后端
+        kIoUring, // 通过io_uring提交写入，后端线程不阻塞在磁盘上，多块缓存同时在途；内核不支持时退回kWritev
+        kMmap,    // 按rollSize预分配文件，直接memcpy到映射窗口，写入没有系统调用，进程崩溃时已写入的数据保留在页缓存中
+    };
+    using WriteCallback = function<void(void *tag)>; // 异步写入完成（或出错放弃）时的回调，在调用LogFile的线程中执行
+    // 页缓存与落盘策略，各项为0（false）时不启用，默认与原先的行为一致
+    struct IoPolicy {
+        off_t writeBehindBytes = 0; // 每新写入这么多字节，对这段数据调用sync_file_range启动回写，避免脏页堆积后集中回写
+        bool dropCache = false;     // 等上一段回写完成后posix_fadvise(DONTNEED)释放它的页缓存，不挤占业务的热数据；需要writeBehindBytes
+        int syncIntervalMs = 0;     // 每隔这么多毫秒fdatasync一次，在检测flush时一并检测
+        off_t flushBytes = 0;       // 未flush的数据达到这么多字节时立即flush
+        int flushLatencyMs = 0;     // 距上一次flush超过这么多毫秒时flush，取代flushInterval和每checkEveryN次检测一次的方式
+    };
+    // 写入统计，跨越roll累计
+    struct IoStats {
+        int64_t flushes;           // flush次数
+        int64_t syncs;             // 落盘次数
+        int64_t writeBehindBytes;  // 由sync_file_range启动回写的字节数
+        int64_t droppedCacheBytes; // 由posix_fadvise释放页缓存的字节数
+        int64_t rolls;             // roll的次数，不含打开第一个文件
+        int64_t cachedBytes;       // 当前文件仍占用的页缓存估计值：已写入未释放的字节数，内核自行回收的部分不计入，因此是上限；
+                                   // 已roll的文件不再计入（可能已被压缩删除，剩余的页缓存由内核回收）
+    };
+    LogFile(const string &basename,  //  日志文件名，默认保存在当前工作目录下
+            off_t rollSize,          //  日志文件超过设定值进行roll
+            bool threadSafe = true,  //  默认线程安全，使用互斥锁操作将消息写入缓冲区
+            int flushInterval = 3,   //  flush刷新时间间隔
+            int checkEveryN = 1024,  //  每1024次日志操作，检查一个是否刷新、是否roll
+            Backend backend = kStdio, //  文件写入方式
+            bool compressed = false   //  写入前压缩为流式帧（见LogArchive.h），文件名以.log.lzs结尾
     );
     ~LogFile(); // 不能将析构函数作为内联的，因为使用前置申明，不知道AppendFile的大小
     void append(const char *logline, int len);
+    void append(const struct iovec *iov, int count); // 一次写入一批缓存，每块计为一次写入操作
     void flush();
     bool rollFile();
 
-  private:
+    void setWriteCallback(WriteCallback cb) { writeCallback_ = move(cb); } // 设置异步写入完成的回调，需在appendAsync之前调用
+    // 异步写入count块缓存，第i块写完后调用writeCallback_(tags[i])；sync为true时这批缓存之后追加一次fsync，
+    // 整批在fsync完成后才回调，即回调时数据已经落盘
+    void appendAsync(const struct iovec *iov, int count, void *const *tags, bool sync = false);
+    int waitWrites(int timeoutMs); // 处理已完成的异步写入，没有时最多等待timeoutMs毫秒，返回完成的请求数
+    int writesInFlight() const;    // 尚未完成的异步写入请求数，只能在写入线程中调用
+    void sync();                   // 刷新缓冲区并落盘
+    Backend backend() const { return backend_; } // 实际使用的写入方式，kIoUring不可用时为kWritev
+    void setIoPolicy(const IoPolicy &policy);     // 设置页缓存与落盘策略
+    IoStats ioStats();                            // 返回写入统计
+    void setCompressRolled(bool on);              // roll后是否在后台压缩旧文件，关闭时等待已提交的文件压缩完成
+    LogCompressor *compressor() const { return compressor_.get(); } // 后台压缩线程，未开启时为空
+    void setTimeIndex(off_t intervalBytes, int intervalMs = 1000); // 为当前及之后的文件写入时间索引，intervalBytes为0时关闭
+    const string &filename() const { return filename_; }          // 当前文件名
+
     class AppendFile;
+
+  private:
     unique_ptr<AppendFile> file_; // PIMPL手法
+    string filename_;             // 当前文件名
+    unique_ptr<LogCompressor> compressor_;
+    unique_ptr<LogIndexWriter> index_; // 当前文件的时间索引，未开启时为空
+    off_t indexBytes_;
+    int indexIntervalMs_;
 
     void append_unlocked(const char *logline, int len);                // 不加锁版本的append
-    static string getLogFileName(const string &basename, time_t *now); // 获取roll时刻的文件名
+    void append_unlocked(const struct iovec *iov, int count);
+    void appendAsync_unlocked(const struct iovec *iov, int count, void *const *tags, bool sync);
+    void afterAppend(int appends);                                     // 写入后检查是否需要roll和flush
+    void addToIndex(const struct iovec *iov, int count);               // 把即将写入的数据记入时间索引
+    void flushFile();                                                  // 刷新缓冲区并记录统计
+    void syncFile();                                                   // 落盘并记录统计
+    void writeBehind();                                                // 对writeBehindMark_之后的数据启动回写，需要时释放上一段的页缓存
+    void releaseCache(off_t end);                                      // 等待releasedMark_到end的数据回写完成后释放其页缓存
+    static string getLogFileName(const string &basename, time_t *now, bool compressed); // 获取roll时刻的文件名
 
     mutex mutex_; // 对append()操作加锁
 
@@ -47,13 +120,24 @@ class LogFile : public noncopyable {
     const bool threadSafe_;
     const int flushInterval_;
     const int checkEveryN_;
+    const Backend backend_;
+    const bool compressed_;
+    WriteCallback writeCallback_;
 
     time_t startOfPeriod_;                            // 用于标记同一天的时间戳(GMT的零点)
     time_t lastRoll_;                                 // 上一次roll的时间戳
-    time_t lastFlush_;                                // 上一次flush的时间戳
+    int64_t lastFlushMs_;                             // 上一次按时flush的毫秒时间戳
+    int64_t lastSyncMs_;                              // 上一次按时落盘的毫秒时间戳
     const static int kRollPerSeconds_ = 60 * 60 * 24; // 每过一天自动roll
 
     int count_; // 记录进行了多少次写入日志操作，当进行到checkEveryN次时检查是否需要roll
+
+    IoPolicy policy_;
+    IoStats stats_;
+    off_t fileBase_;        // 当前文件打开时已有的长度，以下标记都是相对它的偏移
+    off_t flushMark_;       // 上一次flush时已写入的字节数
+    off_t writeBehindMark_; // 已启动回写的数据的末尾
+    off_t releasedMark_;    // 已释放页缓存的数据的末尾
 };
 
 } // namespace myServer
@@ -0,0 +1,74 @@
+/** LogGrep: 按Logger的行格式快速过滤日志文本
+ * Logger写出的每行为"时间Z 线程号 级别  正文 - 文件:行号\n"，其中线程号为"%5d "，级别固定6个字符（见Logger.cpp）；
+ * parseLogPrefix()解析行首的时间、线程号和级别，多行日志的后续行没有行首，沿用上一个有行首的行的判断
+ *
+ * LogMatcher: 一组过滤条件（子串、最低级别、线程号、时间范围、来源"文件[:行号]"），scan()输出一段文本中满足条件的行
+ *   有子串时先在整段文本中查找子串，只对命中的行解析行首，不命中的大段文本以查找子串的速度跳过；
+ *   没有子串时逐行切分，每次比较32（AVX2）或16（SSE2）字节找出所有换行
+ *   x86上运行时检测AVX2，不支持时使用SSE2，其他平台使用memchr/memmem
+ */
+#pragma once
+#include "Logger.h"
+#include "TimeStamp.h"
+#include <functional>
+#include <stddef.h>
+#include <string>
+
+namespace myServer {
+using std::string;
+
+struct LogPrefix {
+    TimeStamp time;
+    int tid;
+    Logger::LogLevel level;
+};
+// 解析Logger写出的行首，不是这种格式（如多行日志的后续行）时返回false
+bool parseLogPrefix(const char *line, size_t len, LogPrefix *prefix);
+
+// 在[begin, end)中查找needle，返回第一次出现的位置，没有时返回end
+const char *findSubstring(const char *begin, const char *end, const char *needle, size_t needleLen);
+// 在[begin, end)中查找'\n'，没有时返回end
+const char *findNewline(const char *begin, const char *end);
+const char *simdLevel();                // 实际使用的指令集："avx2"、"sse2"或"scalar"
+bool setSimdLevel(const string &level); // 指定指令集（用于测试和对比），CPU不支持时返回false；需在扫描开始前调用
+
+class LogMatcher {
+  public:
+    using LineCallback = std::function<void(const char *line, size_t len)>; // 包括结尾的'\n'（最后一行没有换行时不包括）
+
+    LogMatcher();
+
+    void setPattern(const string &pattern) { pattern_ = pattern; } // 行中包含的子串，区分大小写
+    void setMinLevel(Logger::LogLevel level) { minLevel_ = level; }
+    void setThread(int tid) { tid_ = tid; }
+    void setTimeRange(TimeStamp from, TimeStamp to) {
+        from_ = from;
+        to_ = to;
+    }
+    void setSource(const string &source) { source_ = source; } // "文件名"或"文件名:行号"，与行尾" - 文件:行号"比较，多行日志按整条判断
+
+    bool hasPrefixFilter() const; // 是否有需要解析行首的条件
+    // 输出data中满足条件的行，data从行首开始，返回行数
+    size_t scan(const char *data, size_t len, const LineCallback &cb) const;
+    // 不输出，只计数
+    size_t count(const char *data, size_t len) const;
+
+  private:
+    bool matchPrefix(const char *line, size_t len, bool *hasPrefix) const; // 行首是否满足条件
+    bool matchSource(const char *line, size_t len) const;
+    bool matchEntrySource(const char *line, const char *end, const char **entryEnd) const; // line所在条目的来源是否满足条件
+    template <typename Emit>
+    size_t scanLines(const char *data, size_t len, Emit emit) const;
+    template <typename Emit>
+    size_t scanPattern(const char *data, size_t len, Emit emit) const;
+    bool matchOwner(const char *data, const char *line) const; // 后续行向前找到所属的行首判断
+
+    string pattern_;
+    int minLevel_;
+    int tid_; // 0表示不限
+    TimeStamp from_;
+    TimeStamp to_;
+    string source_;
+};
+
+} // namespace myServer
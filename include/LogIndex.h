@@ -0,0 +1,86 @@
+/** LogIndex: 日志文件旁的稀疏时间索引（"日志文件名.idx"）
+ * 文件格式（整数均为小端）：
+ *   文件头   "YKLX" | u32 版本
+ *   索引项   u64 段在日志文件中的偏移 | u64 段长度 | i64 段内最早的日志时间 | i64 最晚的日志时间（纳秒，没有时间时为0）
+ * 日志文件被切分为连续的段，每段约intervalBytes字节或intervalMs毫秒的日志，段在行边界切分；段结束时追加一项，
+ * 进程崩溃时最后一段没有索引项，读取时最后一项之后的数据按未索引的结尾处理（总是扫描）
+ *
+ * 时间不是逐行解析的：写入的每块数据（AsyncLogging的一块缓存或一次同步写入）只解析第一行和最后一行的时间，
+ * 块内的日志来自同一个缓存，时间基本有序，首尾两行即是块内的时间范围；不同块之间可以乱序（线程局部缓存），
+ * 因此段记录的是其中各块首尾时间的最小值和最大值，而不是段首的时间；共享缓存中相邻的行可能有微秒级的乱序，
+ * 读取时把段的时间范围放宽100ms
+ *
+ * LogIndexWriter: 由LogFile在写入前调用，记录每块数据的偏移和首尾时间
+ * LogIndexReader: 读取索引，readRange()只读取时间范围有交集的段和未索引的结尾；没有索引文件时扫描全文
+ */
+#pragma once
+#include "TimeStamp.h"
+#include <boost/noncopyable.hpp>
+#include <functional>
+#include <stdint.h>
+#include <string>
+#include <sys/types.h>
+#include <utility>
+#include <vector>
+
+namespace myServer {
+using boost::noncopyable;
+using std::string;
+
+class LogIndexWriter : noncopyable {
+  public:
+    // 为日志文件logFile写入索引logFile.idx，已存在时接在后面（同一秒内重新打开同名日志文件）；
+    // offset是之后写入的第一块数据在日志文件中的偏移，之后的偏移由写入的长度累计
+    LogIndexWriter(const string &logFile, off_t offset, off_t intervalBytes, int intervalMs);
+    ~LogIndexWriter(); // 写出最后一段
+
+    bool valid() const { return fd_ >= 0; }
+    void append(const char *data, size_t len); // 记入即将写入日志文件的一块数据，data从行首开始
+    int64_t segments() const { return segments_; } // 已写出的索引项数
+
+  private:
+    void addChunk(const char *data, size_t len, int64_t first); // 把一段不需要切分的数据加入当前段
+    void closeSegment();
+
+    int fd_;
+    const off_t intervalBytes_;
+    const int64_t intervalNs_;
+    off_t segmentOffset_; // 当前段的起始偏移
+    off_t segmentEnd_;    // 当前段的结束偏移，等于segmentOffset_时当前段为空
+    int64_t firstNs_;     // 当前段最早的时间，没有时为0
+    int64_t lastNs_;      // 当前段最晚的时间
+    int64_t startNs_;     // 当前段第一个有时间的块的时间，按时间切分的基准
+    int64_t segments_;
+};
+
+class LogIndexReader : noncopyable {
+  public:
+    struct Segment {
+        off_t offset;
+        off_t length;
+        TimeStamp first; // 段内最早的日志时间，没有时为invalid
+        TimeStamp last;  // 段内最晚的日志时间
+    };
+    using LineCallback = std::function<void(const char *line, size_t len)>; // 包括结尾的'\n'
+
+    explicit LogIndexReader(const string &logFile); // 打开日志文件和logFile.idx，没有索引或索引损坏时indexed()为false
+    ~LogIndexReader();
+
+    bool valid() const { return fd_ >= 0; }
+    bool indexed() const { return indexed_; }
+    const std::vector<Segment> &segments() const { return segments_; }
+    off_t fileSize() const { return fileSize_; }
+
+    // 时间范围[from, to]需要读取的文件区间（偏移，长度），相邻的段合并，包括未索引的结尾
+    std::vector<std::pair<off_t, off_t>> ranges(TimeStamp from, TimeStamp to) const;
+    // 输出时间在[from, to]内的行；没有时间的行（如多行日志的后续行）跟随上一行
+    bool readRange(TimeStamp from, TimeStamp to, const LineCallback &cb) const;
+
+  private:
+    int fd_;
+    bool indexed_;
+    off_t fileSize_;
+    std::vector<Segment> segments_;
+};
+
+} // namespace myServer
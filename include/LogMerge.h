@@ -0,0 +1,58 @@
+/** LogMerge: 把多个进程的日志按时间合并为一个有序的输出
+ * 输入为LogFile写出的明文日志文件或目录（目录展开为其中LogFile命名的.log文件）；
+ * 文件名为"basename.YYYYMMDD-HHMMSS.host.pid.log"，basename、host、pid相同的文件是同一个进程依次roll出的文件，
+ * 按文件名中的时间首尾相接作为一路输入，k路输入用最小堆按行首时间归并，时间相同时先输出先加入的一路
+ *
+ * 一条日志从有行首（见LogGrep.h的parseLogPrefix）的行开始，到下一个有行首的行为止，多行日志整体输出，不会被其他日志插入；
+ * 文件开头没有行首的行沿用这一路上一条日志的时间（没有时按最早的时间）；文件尾部的0字节（mmap后端崩溃后的预分配空间）视为文件结束
+ * 每一路内部保持原有顺序（AsyncLogging的线程局部缓存会造成块间的小幅乱序），输出只在每一路有序时全局有序
+ *
+ * 内存与文件大小无关：每一路同时只映射一个文件，已合并过的部分每16MB用MADV_DONTNEED释放，
+ * 输出经过一个固定大小的缓冲区，写满后交给输出回调
+ */
+#pragma once
+#include "TimeStamp.h"
+#include <boost/noncopyable.hpp>
+#include <functional>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace myServer {
+using boost::noncopyable;
+using std::string;
+
+class LogMerger : noncopyable {
+  public:
+    using Output = std::function<void(const char *data, size_t len)>;
+
+    explicit LogMerger(size_t bufferSize = 1 << 20);
+    ~LogMerger();
+
+    // 加入文件或目录，同一进程的文件（包括之前加入的）归入同一路；目录不存在或无法读取时返回false
+    bool add(const string &path);
+    size_t inputs() const { return groups_.size(); } // 输入的路数
+    std::vector<string> files(size_t input) const; // 第input路按时间排序的文件
+
+    // 归并全部输入，返回输出的日志条数；无法打开的文件报告到stderr后跳过
+    int64_t merge(const Output &output);
+
+    // 解析LogFile命名的文件名，key为basename.host.pid（含目录），time为文件名中的时间"YYYYMMDD-HHMMSS"
+    static bool parseLogFileName(const string &path, string *key, string *time);
+
+  private:
+    struct Group {
+        string key;                                   // 不是LogFile命名的文件单独一路，key为空
+        std::vector<std::pair<string, string>> files; // (文件名中的时间, 文件名)，按时间排序
+    };
+    class Source;
+
+    void addFile(const string &path);
+
+    const size_t bufferSize_;
+    std::vector<Group> groups_;
+};
+
+} // namespace myServer
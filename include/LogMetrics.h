@@ -0,0 +1,89 @@
+/** LogMetrics: 日志库运行时指标使用的计数器和直方图
+ * LogCounter：分片计数器，每个线程第一次计数时轮流分到一个分片，各分片独占一个缓存行，
+ *   多个前端线程同时计数时不争用同一个缓存行，读取时把所有分片相加；每次计数仍是一次原子加，适合不在热路径上的计数
+ * addSingleWriter：已经在锁内或只在一个线程中更新的计数，只是一次普通的读和写
+ * LogHistogram：按2的幂分桶的直方图，第i桶记录[2^(i-1), 2^i)的值（第0桶为0），记录一次只有几次relaxed原子加；
+ *   snapshot()复制各桶的计数，percentile()返回分位数所在桶的上界，精度为2倍
+ * 都只使用relaxed原子操作，快照中各项不是同一时刻的精确值，用于监控和报警
+ */
+#pragma once
+#include <atomic>
+#include <boost/noncopyable.hpp>
+#include <stdint.h>
+
+namespace myServer {
+using boost::noncopyable;
+
+// 当前线程的分片编号，线程第一次调用时分配
+inline unsigned threadShard() {
+    static std::atomic<unsigned> nextShard(0);
+    thread_local unsigned shard = ~0u; // 常量初始化，访问时没有线程局部变量的初始化检查
+    if (__builtin_expect(shard == ~0u, 0)) {
+        shard = nextShard.fetch_add(1, std::memory_order_relaxed);
+    }
+    return shard;
+}
+
+// 只有一个写者（或写者之间已由锁互斥）的计数，不需要带lock前缀的原子加，读者可以随时无锁读取
+inline void addSingleWriter(std::atomic<int64_t> &counter, int64_t n) {
+    counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+class LogCounter : noncopyable {
+  public:
+    static const unsigned kShards = 16;
+
+    void add(int64_t n) { shards_[threadShard() % kShards].value.fetch_add(n, std::memory_order_relaxed); }
+    int64_t value() const {
+        int64_t sum = 0;
+        for (const Shard &shard : shards_) {
+            sum += shard.value.load(std::memory_order_relaxed);
+        }
+        return sum;
+    }
+
+  private:
+    struct alignas(64) Shard {
+        std::atomic<int64_t> value{0};
+    };
+    Shard shards_[kShards];
+};
+
+class LogHistogram : noncopyable {
+  public:
+    static const int kBuckets = 64;
+
+    struct Snapshot {
+        int64_t count;
+        int64_t sum;
+        int64_t max;
+        int64_t buckets[kBuckets];
+
+        double mean() const { return count > 0 ? static_cast<double>(sum) / count : 0; }
+        int64_t percentile(double q) const; // q在[0, 1]之间，返回所在桶的上界，不超过max
+    };
+
+    static int bucketOf(int64_t value) {
+        if (value <= 0) {
+            return 0;
+        }
+        int bucket = 64 - __builtin_clzll(static_cast<uint64_t>(value));
+        return bucket < kBuckets ? bucket : kBuckets - 1;
+    }
+
+    void record(int64_t value) {
+        buckets_[bucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+        sum_.fetch_add(value, std::memory_order_relaxed);
+        int64_t max = max_.load(std::memory_order_relaxed);
+        while (value > max && !max_.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+        }
+    }
+    Snapshot snapshot() const;
+    void reset(); // 清零，与record()同时调用时可能留下其中一部分
+
+  private:
+    std::atomic<int64_t> buckets_[kBuckets] = {};
+    std::atomic<int64_t> sum_{0};
+    std::atomic<int64_t> max_{0};
+};
+} // namespace myServer
@@ -0,0 +1,149 @@
+/** LogProfiler: 日志链路的逐阶段周期计数，编译期开关
+ * 以-DYKLOG_PROFILE编译库时（cmake -DYKLOG_PROFILE=ON），每个线程每隔sampleInterval条日志采样一条，
+ * 在各阶段的边界用rdtsc打点：Logger构造（其中formatTime单独计）、用户的operator<<、~Logger、g_output、
+ * AsyncLogging::append等待锁、后端交换缓存，直到这条日志所在的缓存写入完成
+ * 前端的打点都写入线程局部的Record，g_output返回后才统一记入各阶段的直方图（单位为TSC周期），记录本身不计入被测的阶段；
+ * 采样的日志所在的缓存记入一张小表，后端取走缓存和写入完成时在表中打点，得到排队时间、写入时间和从写入缓存到写完的端到端延迟
+ * 没有定义YKLOG_PROFILE时YKLOG_PROF_*宏展开为空，库中不生成任何打点代码，Logger和AsyncLogging的布局也不变
+ */
+#pragma once
+#include "LogMetrics.h"
+#include <stdint.h>
+#include <stdio.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <time.h>
+#endif
+
+namespace myServer {
+namespace profiler {
+enum Stage {
+    kConstruct,     // Logger构造，从进入构造函数到返回，包括取时间和formatTime
+    kFormatTime,    // formatTime
+    kStream,        // 用户的operator<<，从构造返回到进入析构
+    kDestruct,      // ~Logger写入行尾，不包括g_output
+    kOutput,        // g_output，输出到AsyncLogging时包括append
+    kLockWait,      // AsyncLogging::append获取锁（线程局部模式下为暂存缓存的锁）
+    kFrontEnd,      // 从进入Logger构造到g_output返回，即调用者付出的全部时间
+    kSwap,          // 后端交换缓存的临界区，每次唤醒记一次，不采样
+    kQueue,         // 从写入缓存到后端取走这块缓存
+    kWrite,         // 从后端取走缓存到写入完成（kIoUring下为完成回调，setSyncOnWrite时为落盘）
+    kEnqueueToDisk, // 从写入缓存到写入完成，即kQueue + kWrite
+    kNumStages
+};
+extern const char *const StageName[kNumStages];
+
+// 前端一条日志的打点
+enum Mark {
+    kBegin,
+    kTimeBegin,
+    kTimeEnd,
+    kConstructed,
+    kDestructBegin,
+    kOutputBegin,
+    kLockBegin,
+    kLockEnd,
+    kOutputEnd,
+    kNumMarks
+};
+
+// 当前线程正在采样的日志，__thread没有初始化检查，打点只是一次判断和一次rdtsc
+struct Record {
+    uint32_t count;    // 距离上一次采样的条数
+    bool active;       // 当前日志是否被采样
+    uint64_t tsc[kNumMarks];
+    uint64_t overhead; // 采样路径自身在g_output内花费的周期，记录时扣除
+};
+extern __thread Record t_record;
+
+inline uint64_t now() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+bool enabled();                         // 库是否以YKLOG_PROFILE编译
+void setSampleInterval(uint32_t n);     // 每个线程每n条日志采样一条，默认1024，1为全部采样
+void reset();                           // 清空所有直方图
+LogHistogram::Snapshot snapshot(Stage stage); // 单位为周期
+double ticksPerNanoSecond();            // 把周期换算为纳秒，第一次调用时校准约20ms
+void report(FILE *out);                 // 打印每个阶段的采样数、均值和分位数（周期和纳秒）
+
+// 以下由打点宏调用
+void beginSlow(Record &record);
+void endRecord(); // g_output返回后把采样日志的各阶段记入直方图
+void enqueued(const void *buffer); // 采样的日志写入了buffer，在持有保护buffer的锁时调用
+void taken(const void *buffer);    // 后端取走了buffer
+template <typename Buffers>
+void takenAll(const Buffers &buffers) {
+    for (const auto &buffer : buffers) {
+        taken(buffer.get());
+    }
+}
+void written(const void *buffer);  // buffer写入完成
+void discarded(const void *buffer); // buffer中的日志被丢弃（kDropOldest）
+void recordStage(Stage stage, uint64_t cycles);
+
+extern uint32_t g_sampleInterval;
+inline void begin() {
+    Record &record = t_record;
+    if (__builtin_expect(++record.count >= g_sampleInterval, 0)) {
+        beginSlow(record);
+    } else {
+        record.active = false;
+    }
+}
+inline void mark(Mark m) {
+    if (__builtin_expect(t_record.active, 0)) {
+        t_record.tsc[m] = now();
+    }
+}
+inline void end() {
+    if (__builtin_expect(t_record.active, 0)) {
+        t_record.tsc[kOutputEnd] = now();
+        endRecord();
+    }
+}
+
+// 记录一段代码的耗时，每次都记录，用于后端
+class ScopedStage {
+  public:
+    explicit ScopedStage(Stage stage) : stage_(stage), start_(now()) {}
+    ~ScopedStage() { recordStage(stage_, now() - start_); }
+
+  private:
+    Stage stage_;
+    uint64_t start_;
+};
+} // namespace profiler
+} // namespace myServer
+
+#ifdef YKLOG_PROFILE
+#define YKLOG_PROF_BEGIN() myServer::profiler::begin()
+#define YKLOG_PROF_MARK(m) myServer::profiler::mark(myServer::profiler::m)
+#define YKLOG_PROF_END() myServer::profiler::end()
+#define YKLOG_PROF_ENQUEUED(buffer)                   \
+    do {                                              \
+        if (myServer::profiler::t_record.active) {    \
+            myServer::profiler::enqueued(buffer);     \
+        }                                             \
+    } while (0)
+#define YKLOG_PROF_TAKEN(buffers) myServer::profiler::takenAll(buffers)
+#define YKLOG_PROF_WRITTEN(buffer) myServer::profiler::written(buffer)
+#define YKLOG_PROF_DISCARDED(buffer) myServer::profiler::discarded(buffer)
+#define YKLOG_PROF_SCOPE(stage) myServer::profiler::ScopedStage yklogProfScope_(myServer::profiler::stage)
+#else
+#define YKLOG_PROF_BEGIN() ((void)0)
+#define YKLOG_PROF_MARK(m) ((void)0)
+#define YKLOG_PROF_END() ((void)0)
+#define YKLOG_PROF_ENQUEUED(buffer) ((void)0)
+#define YKLOG_PROF_TAKEN(buffers) ((void)0)
+#define YKLOG_PROF_WRITTEN(buffer) ((void)0)
+#define YKLOG_PROF_DISCARDED(buffer) ((void)0)
+#define YKLOG_PROF_SCOPE(stage) ((void)0)
+#endif
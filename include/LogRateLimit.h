@@ -0,0 +1,122 @@
+/** LogRateLimit: 按调用点限制日志频率的宏
+ *   LOG_EVERY_N(WARN, 1000) << ...;           每N次输出一次（第1、N+1、2N+1...次）
+ *   LOG_FIRST_N(ERROR, 10) << ...;            只输出前N次
+ *   LOG_EVERY_MS(WARN, 1000) << ...;          每ms毫秒最多输出一次
+ *   LOG_RATE_LIMITED(WARN, 100, 20) << ...;   令牌桶：平均每秒最多perSecond条，最多连续burst条
+ * 级别参数为TRACE/DEBUG/INFO/WARN/ERROR/FATAL，调用点的级别被关闭时（见Logger::setLogLevel）与普通日志宏一样直接跳过，不计数
+ * 每个调用点有一个静态的状态（宏展开中的lambda内的static，常量初始化，没有初始化保护），多线程无锁访问；
+ * 被抑制的调用只有一次原子加（LOG_EVERY_MS和LOG_RATE_LIMITED另有一次CLOCK_MONOTONIC_COARSE读取和一次原子读），
+ * 下一条输出的日志在正文前写上"[suppressed N] "，N为上一条输出之后被抑制的次数（LOG_FIRST_N之后不再输出，不报告）
+ * 时间使用CLOCK_MONOTONIC_COARSE，精度为一个时钟中断（通常1-4ms），不受墙上时钟调整的影响
+ */
+#pragma once
+#include "Logger.h"
+#include <atomic>
+#include <stdint.h>
+#include <time.h>
+
+namespace myServer {
+namespace ratelimit {
+inline int64_t nowNanoSeconds() {
+    struct timespec ts;
+    ::clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * TimeStamp::kNanoSecondPerSecond + ts.tv_nsec;
+}
+
+// 各调用点的状态独占一个缓存行，不同调用点在不同线程上互不干扰
+struct alignas(64) EveryN {
+    std::atomic<uint64_t> count{0};
+
+    bool allow(uint64_t n, uint64_t *suppressed) {
+        uint64_t c = count.fetch_add(1, std::memory_order_relaxed);
+        if (n <= 1 || c % n == 0) {
+            *suppressed = c == 0 || n <= 1 ? 0 : n - 1;
+            return true;
+        }
+        return false;
+    }
+};
+
+struct alignas(64) FirstN {
+    std::atomic<uint64_t> count{0};
+
+    bool allow(uint64_t n, uint64_t *) {
+        if (count.load(std::memory_order_relaxed) >= n) { // 超过之后只读，不再写共享的缓存行
+            return false;
+        }
+        return count.fetch_add(1, std::memory_order_relaxed) < n;
+    }
+};
+
+struct alignas(64) EveryMs {
+    std::atomic<int64_t> nextNs{0}; // 下一次允许输出的时间
+    std::atomic<uint64_t> suppressed{0};
+
+    bool allow(int64_t ms, uint64_t *reported) {
+        int64_t now = nowNanoSeconds();
+        int64_t next = nextNs.load(std::memory_order_relaxed);
+        if (now >= next && nextNs.compare_exchange_strong(next, now + ms * 1000000, std::memory_order_relaxed)) {
+            *reported = suppressed.exchange(0, std::memory_order_relaxed);
+            return true;
+        }
+        suppressed.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+};
+
+/**
+ * 令牌桶用GCRA表示：tat是令牌桶恰好装满的理论时间，每条日志把tat推后一个间隔，
+ * tat超出当前时间burst个间隔时桶已空；只有一个原子变量，CAS更新
+ */
+struct alignas(64) TokenBucket {
+    std::atomic<int64_t> tat{0};
+    std::atomic<uint64_t> suppressed{0};
+
+    bool allow(double perSecond, int burst, uint64_t *reported) {
+        const int64_t interval = perSecond > 0 ? static_cast<int64_t>(TimeStamp::kNanoSecondPerSecond / perSecond) : INT64_MAX / 4;
+        const int64_t limit = interval * (burst > 0 ? burst : 1);
+        int64_t now = nowNanoSeconds();
+        int64_t old = tat.load(std::memory_order_relaxed);
+        for (;;) {
+            int64_t next = (old > now ? old : now) + interval;
+            if (next - now > limit) {
+                suppressed.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            if (tat.compare_exchange_weak(old, next, std::memory_order_relaxed)) {
+                *reported = suppressed.exchange(0, std::memory_order_relaxed);
+                return true;
+            }
+        }
+    }
+};
+
+// 宏展开中的局部变量：开启的调用点（关闭时为nullptr）和要报告的被抑制次数
+struct Gate {
+    const LogCallSite *site;
+    uint64_t suppressed;
+};
+
+inline LogStream &noteSuppressed(LogStream &stream, uint64_t suppressed) {
+    if (suppressed > 0) {
+        stream << "[suppressed " << suppressed << "] ";
+    }
+    return stream;
+}
+} // namespace ratelimit
+} // namespace myServer
+
+// 每个lambda表达式是不同的类型，其中的static即调用点私有的状态
+// 写成if (!条件) {} else的形式，宏用在不带花括号的if/else中时外层的else不会被这里的if吸收
+#define YKLOG_SITE_STATE_(Type) ([]() -> myServer::ratelimit::Type & { static myServer::ratelimit::Type state; return state; }())
+#define YKLOG_LIMITED_(level, Type, ...)                                                            \
+    if (!YKLOG_COMPILED_(myServer::Logger::level)) {                                                \
+    } else if (myServer::ratelimit::Gate yklogGate_ = {YKLOG_SITE_(myServer::Logger::level), 0};    \
+        !(yklogGate_.site && YKLOG_SITE_STATE_(Type).allow(__VA_ARGS__, &yklogGate_.suppressed))) { \
+    } else                                                                                          \
+        myServer::ratelimit::noteSuppressed(myServer::Logger(*yklogGate_.site).stream(), yklogGate_.suppressed)
+
+#define LOG_EVERY_N(level, n) YKLOG_LIMITED_(level, EveryN, n)
+#define LOG_FIRST_N(level, n) YKLOG_LIMITED_(level, FirstN, n)
+#define LOG_EVERY_MS(level, ms) YKLOG_LIMITED_(level, EveryMs, ms)
+#define LOG_RATE_LIMITED(level, perSecond, burst) YKLOG_LIMITED_(level, TokenBucket, perSecond, burst)
@@ -1,8 +1,11 @@
 #pragma once
+#include "DoubleConversion.h"
+#include "IntegerConversion.h"
 #include <algorithm>
 #include <boost/implicit_cast.hpp>
 #include <boost/noncopyable.hpp>
 #include <cstring>
+#include <stdint.h>
 #include <string>
 
 namespace myServer {
@@ -35,9 +38,30 @@ class FixedBuffer : noncopyable {
 };
 const int kSmallBuffer = 4000;
 const int kLargeBuffer = 4000 * 1000;
+
+// 数字转字符串，直接写入buf并返回长度，不写入'\0'，调用者保证buf至少有LogStream::kMaxNumericSize字节
+template <typename T>
+inline size_t convert(char *buf, T value) { return formatInteger(buf, value); } // 十进制整数，见IntegerConversion.h
+inline size_t convertHex(char buf[], uintptr_t value) { return formatHex(buf, value); } // 十六进制整数，不带0x前缀
+size_t convertDouble(char *buf, double value);   // 浮点数，最短的可还原表示，见DoubleConversion.h
+size_t convertFloat(char *buf, float value);     // 单精度浮点数，按float的精度取最短表示
+
+// 以固定的小数位数输出浮点数：LOG_INFO << "latency=" << Fixed(ms, 3); precision超出[0, 9]时按普通浮点数输出
+class Fixed {
+  public:
+    Fixed(double value, int precision) : value_(value), precision_(precision) {}
+    double value() const { return value_; }
+    int precision() const { return precision_; }
+
+  private:
+    double value_;
+    int precision_;
+};
+
 class LogStream : noncopyable {
   public:
     using Buffer = FixedBuffer<kSmallBuffer>;
+    static const int kMaxNumericSize = 32; // 数字转化为字符串的最大长度，不小于kMaxDoubleSize
 
   public:
     void append(const char *buf, size_t len) {
@@ -65,10 +89,8 @@ class LogStream : noncopyable {
     LogStream &operator<<(int);          // 重载<<运算符，添加int类型
     LogStream &operator<<(unsigned int); // 重载<<运算符，添加unsigned int类型
     LogStream &operator<<(double);
-    LogStream &operator<<(float x) {
-        this->operator<<(static_cast<double>(x));
-        return *this;
-    }
+    LogStream &operator<<(float);
+    LogStream &operator<<(const Fixed &);
     LogStream &operator<<(long);
     LogStream &operator<<(unsigned long);
     LogStream &operator<<(long long);
@@ -80,7 +102,6 @@ class LogStream : noncopyable {
 
   private:
     Buffer buffer_;                        // 4000字节的缓冲区
-    static const int kMaxNumericSize = 32; // 数字转化为字符串的最大长度
     template <typename T>
     void formatInterge(T); // 用于将int类型转化为c风格字符串类型
 };
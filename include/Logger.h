@@ -4,12 +4,21 @@
  * 当Logger对象析构时，将LogStream的日志数据flush到输出目的地，默认是stdout。
  * 每个线程使用使用会先创建一个Logger内部有Logstrem,然后将内容写入stream缓冲区，由于这是单线程操作，所以不需要锁，并且是非阻塞的，当写入完成后，析构时会使用fwrite将这块内存写入到指定缓冲区，fwrite是线程安全的。所以对用户来说是完全非阻塞的，异步的 */
 #pragma once
+#include "FormatString.h"
 #include "LogStream.h"
+#include "TimeStamp.h"
+#include <atomic>
+#include <errno.h>
 #include <functional>
 #include <memory>
+#include <stddef.h>
+#include <stdint.h>
 #include <string.h>
+#include <string>
+#include <vector>
 namespace myServer {
 using namespace std;
+struct LogCallSite;
 class Logger {
   public:
     enum LogLevel { TRACE,
@@ -19,19 +28,19 @@ class Logger {
                     ERROR,
                     FATAL,
                     NUM_LOG_LEVELS };
-    // 计算源文件名
+    // 计算源文件名，数组版本是constexpr，传入字符串字面量时可以在编译期完成
 
     class SourceFile {
       public:
-        const char *data() const { return data_; }
-        int size() const { return size_ - 1; } // 返回不包括'\0'的长度
+        constexpr const char *data() const { return data_; }
+        constexpr int size() const { return size_ - 1; } // 返回不包括'\0'的长度
         template <int N>
-        SourceFile(const char (&arr)[N]) : data_(arr), size_(N) {
-            // The strrchr() function returns a pointer to the last occurrence of the character c in the string s.
-            const char *slash = strrchr(data_, '/');
-            if (slash) {
-                data_ = slash + 1;
-                size_ -= static_cast<int>(data_ - arr);
+        constexpr SourceFile(const char (&arr)[N]) : data_(arr), size_(N) {
+            for (int i = 0; i < N - 1; ++i) {
+                if (arr[i] == '/') {
+                    data_ = arr + i + 1;
+                    size_ = N - i - 1;
+                }
             }
         }
         explicit SourceFile(const char *arr) : data_(arr) {
@@ -39,7 +48,7 @@ class Logger {
             if (slash) {
                 data_ = slash + 1;
             }
-            size_ = static_cast<int>(strlen(data_));
+            size_ = static_cast<int>(strlen(data_)) + 1; // 和数组版本一致，size_包括'\0'
         }
 
       private:
@@ -52,44 +61,171 @@ class Logger {
     Logger(SourceFile file, int line, LogLevel level);
     Logger(SourceFile file, int line, LogLevel level, const char *func);
     Logger(SourceFile file, int line, bool toAbort);
+    explicit Logger(const LogCallSite &site, int savedErrno = 0); // 日志宏使用：文件名、行号和函数名取自调用点的静态存储
+    Logger(const Logger &) = delete; // impl_指向自身的存储，不能拷贝
+    Logger &operator=(const Logger &) = delete;
 
     LogStream &stream(); // 返回impl实现类中的Logstream,主要用于日志宏
 
     static LogLevel logLevel();              // 全局方法，返回日志级别list
     static void setLogLevel(LogLevel level); // 全局方法，设置日志级别list
 
+    // 按调用点的日志级别：每个日志宏展开为一个静态的LogCallSite，第一次执行时注册到全局的调用点列表
+    // pattern是fnmatch的通配符，与调用点的源文件路径（__FILE__）或文件名比较，如"TcpServer.cpp"、"Tcp*"，模块即目录："*/net/*"
+    // 匹配的调用点使用level，多条规则都匹配时后设置的优先，不匹配任何规则的调用点使用全局的logLevel()
+    // 规则对之后才注册的调用点同样生效，返回当前已注册的调用点中匹配的个数
+    static size_t setLogLevel(const string &pattern, LogLevel level);
+    static void clearLogLevels();                    // 删除所有规则，全部调用点回到全局级别
+    static vector<const LogCallSite *> callSites(); // 已注册的调用点（至少执行过一次的日志宏）
+    static bool registerSite(LogCallSite *site);    // 日志宏第一次执行时调用，返回调用点是否开启
+
     using OutputFunc = function<void(const char *msg, int len)>; // 用户传递的调用fwrtie的函数，通常会自己选择输出位置
     using FlushFunc = function<void()>;                          // 用户传递的调用fflush的函数，通常会自己选择输出位置
     static void setOutput(OutputFunc);                           // 全局方法，设置ffwrite
     static void setFlush(FlushFunc);                             // 全局方法，设置flush
+
+    static void setTimePrecision(TimeStamp::Precision precision); // 全局方法，设置日志时间的精度（秒/毫秒/微秒/纳秒），默认微秒
+
+    static void formatTime(LogStream &stream, TimeStamp time); // 写入日志行的时间前缀，线程内缓存分钟级部分，后端格式化延迟日志时复用
   private:
     class Impl;
-    unique_ptr<Impl> impl_; // 内部实现类
+    static const size_t kImplSize = kSmallBuffer + 64; // Impl的大小上限，Logger.cpp中static_assert检查
+    alignas(max_align_t) char implStorage_[kImplSize]; // 在Logger对象内（即调用者的栈上）就地构造Impl，每条日志不再有堆分配
+    Impl *impl_;                                       // 内部实现类，指向implStorage_
 };
 extern Logger::LogLevel g_logLevel;
+extern const char *LogLevelName[Logger::NUM_LOG_LEVELS]; // 级别名称，长度都是6
 inline Logger::LogLevel Logger::logLevel() { return g_logLevel; }
 
+namespace detail {
+// 编译期计算调用点的元数据，参数都是__FILE__、__LINE__
+constexpr const char *sourceBasename(const char *path) {
+    const char *base = path;
+    for (const char *p = path; *p; ++p) {
+        if (*p == '/') {
+            base = p + 1;
+        }
+    }
+    return base;
+}
+constexpr int decimalDigits(int n) {
+    int digits = 1;
+    for (; n >= 10; n /= 10) {
+        ++digits;
+    }
+    return digits;
+}
+constexpr size_t siteSuffixSize(const char *path, int line) {
+    size_t size = 0;
+    for (const char *p = sourceBasename(path); *p; ++p) {
+        ++size;
+    }
+    return size + decimalDigits(line) + 5; // " - " ":" '\n'
+}
+
+// 日志行的结尾" - 文件名:行号\n"，在编译期生成，每条日志只需一次拷贝
+template <size_t N>
+struct SiteSuffix {
+    char data[N];
+
+    constexpr SiteSuffix(const char *path, int line) : data() {
+        size_t i = 0;
+        data[i++] = ' ';
+        data[i++] = '-';
+        data[i++] = ' ';
+        for (const char *p = sourceBasename(path); *p; ++p) {
+            data[i++] = *p;
+        }
+        data[i++] = ':';
+        const int digits = decimalDigits(line);
+        for (int d = digits - 1; d >= 0; --d, line /= 10) {
+            data[i + d] = static_cast<char>('0' + line % 10);
+        }
+        data[i + digits] = '\n';
+    }
+};
+} // namespace detail
+
+// 日志宏的静态调用点，常量初始化，没有初始化保护；state由Logger在修改级别时更新
+// 文件名、行号、函数名和日志行结尾都在编译期确定，写日志时不再计算
+struct LogCallSite {
+    enum State : uint8_t { kUnregistered, // 还没有执行过，下一次执行时注册
+                           kEnabled,
+                           kDisabled };
+    const char *file;     // __FILE__
+    const char *basename; // file中最后一个'/'之后的部分
+    const char *func;
+    int line;
+    Logger::LogLevel level;
+    const char *suffix; // " - basename:line\n"，不以'\0'结尾
+    int suffixSize;
+    atomic<uint8_t> state;
+    LogCallSite *next; // 已注册调用点的链表，由Logger加锁访问
+
+    bool enabled() { return state.load(memory_order_relaxed) == kEnabled || Logger::registerSite(this); }
+};
+
+/** 编译期的最低日志级别，取值同Logger::LogLevel（0为TRACE，5为FATAL），如-DYKLOG_MIN_LEVEL=2去掉TRACE和DEBUG
+ * 低于该级别的日志宏的条件是编译期常量false，整条语句（包括调用点、参数的求值）被编译器删除，但仍然做类型检查
+ * FATAL级别的日志会终止程序，不会被去掉
+ */
+#ifndef YKLOG_MIN_LEVEL
+#define YKLOG_MIN_LEVEL 0
+#endif
+#define YKLOG_COMPILED_(lvl) ((lvl) >= YKLOG_MIN_LEVEL || (lvl) == myServer::Logger::FATAL)
+
 // 定义日志宏，创建并返回一个Logstream
 /** 预定义标识符
  * __FILE__ 当前源文件名
  * __LINE__ 当前源代码行号
  * __func__ 包含封闭函数的未限定和未修饰名称的字符串(函数名)
  */
-// 如果当前Logger内的全局g_logLevel等级小于TRACE,则创建stream
-#define LOG_TRACE                                                \
-    if (myServer::Logger::logLevel() <= myServer::Logger::TRACE) \
-    myServer::Logger(__FILE__, __LINE__, myServer::Logger::TRACE, __func__).stream()
-#define LOG_DEBUG                                                \
-    if (myServer::Logger::logLevel() <= myServer::Logger::DEBUG) \
-    myServer::Logger(__FILE__, __LINE__, myServer::Logger::DEBUG, __func__).stream()
-#define LOG_INFO                                                \
-    if (myServer::Logger::logLevel() <= myServer::Logger::INFO) \
-    myServer::Logger(__FILE__, __LINE__).stream()
-#define LOG_WARN myServer::Logger(__FILE__, __LINE__, myServer::Logger::WARN).stream()
-#define LOG_ERROR myServer::Logger(__FILE__, __LINE__, myServer::Logger::ERROR).stream()
-#define LOG_FATAL myServer::Logger(__FILE__, __LINE__, myServer::Logger::FATAL).stream()
-#define LOG_SYSERR myServer::Logger(__FILE__, __LINE__, false).stream()
+/** 开启时返回调用点，关闭时返回nullptr（GNU语句表达式，__func__为外层函数名）
+ * 已注册并关闭的调用点只有一次relaxed读和一次分支，与比较logLevel()相同；没有注册的调用点进入enabled()注册
+ * FATAL级别的调用点总是开启
+ */
+#define YKLOG_SITE_(lvl)                                                                                                                                  \
+    (YKLOG_COMPILED_(lvl) ? __extension__({                                                                                                               \
+        static constexpr myServer::detail::SiteSuffix<myServer::detail::siteSuffixSize(__FILE__, __LINE__)> yklogSuffix_(__FILE__, __LINE__);             \
+        static myServer::LogCallSite yklogCallSite_ = {__FILE__, myServer::detail::sourceBasename(__FILE__), __func__, __LINE__, lvl,                     \
+                                                       yklogSuffix_.data, sizeof(yklogSuffix_.data), {myServer::LogCallSite::kUnregistered}, nullptr};    \
+        yklogCallSite_.state.load(std::memory_order_relaxed) != myServer::LogCallSite::kDisabled && yklogCallSite_.enabled() ? &yklogCallSite_ : nullptr; \
+    })                                                                                                                                                    \
+                          : nullptr)
+#define YKLOG_SITE_ON_(lvl) (YKLOG_SITE_(lvl) != nullptr)
+
+// 外层的if在编译期确定，-O0时被去掉的语句同样不生成代码
+// 写成if (!条件) {} else的形式，宏用在不带花括号的if/else中时外层的else不会被这里的if吸收
+#define YKLOG_LOG_(lvl)                                                                             \
+    if (!YKLOG_COMPILED_(lvl)) {                                                                    \
+    } else if (const myServer::LogCallSite *yklogSite_ = YKLOG_SITE_(lvl); yklogSite_ == nullptr) { \
+    } else                                                                                          \
+        myServer::Logger(*yklogSite_).stream()
+#define LOG_TRACE YKLOG_LOG_(myServer::Logger::TRACE)
+#define LOG_DEBUG YKLOG_LOG_(myServer::Logger::DEBUG)
+#define LOG_INFO YKLOG_LOG_(myServer::Logger::INFO)
+#define LOG_WARN YKLOG_LOG_(myServer::Logger::WARN)
+#define LOG_ERROR YKLOG_LOG_(myServer::Logger::ERROR)
+#define LOG_FATAL YKLOG_LOG_(myServer::Logger::FATAL)
+#define LOG_SYSERR                                                                                                      \
+    if (!YKLOG_COMPILED_(myServer::Logger::ERROR)) {                                                                    \
+    } else if (const myServer::LogCallSite *yklogSite_ = YKLOG_SITE_(myServer::Logger::ERROR); yklogSite_ == nullptr) { \
+    } else                                                                                                              \
+        myServer::Logger(*yklogSite_, errno).stream()
 #define LOG_SYSFATAL myServer::Logger(__FILE__, __LINE__, true).stream()
 
+// 编译期解析格式串的日志宏，见FormatString.h：LOG_INFO_FMT("user={} latency={}us", id, us);
+#define YKLOG_LOG_FMT_(lvl, format, ...)                                                            \
+    if (!YKLOG_COMPILED_(lvl)) {                                                                    \
+    } else if (const myServer::LogCallSite *yklogSite_ = YKLOG_SITE_(lvl); yklogSite_ == nullptr) { \
+    } else                                                                                          \
+        myServer::fmt::formatTo(myServer::Logger(*yklogSite_).stream(), YKLOG_FMT_STRING_(format), ##__VA_ARGS__)
+#define LOG_TRACE_FMT(format, ...) YKLOG_LOG_FMT_(myServer::Logger::TRACE, format, ##__VA_ARGS__)
+#define LOG_DEBUG_FMT(format, ...) YKLOG_LOG_FMT_(myServer::Logger::DEBUG, format, ##__VA_ARGS__)
+#define LOG_INFO_FMT(format, ...) YKLOG_LOG_FMT_(myServer::Logger::INFO, format, ##__VA_ARGS__)
+#define LOG_WARN_FMT(format, ...) YKLOG_LOG_FMT_(myServer::Logger::WARN, format, ##__VA_ARGS__)
+#define LOG_ERROR_FMT(format, ...) YKLOG_LOG_FMT_(myServer::Logger::ERROR, format, ##__VA_ARGS__)
+#define LOG_FATAL_FMT(format, ...) YKLOG_LOG_FMT_(myServer::Logger::FATAL, format, ##__VA_ARGS__)
+
 const char *strerror_tl(int savedErrno);
 } // namespace myServer
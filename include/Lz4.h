@@ -0,0 +1,20 @@
+/** Lz4: 不依赖外部库的LZ4块格式压缩
+ * 输出与LZ4 block format兼容（可以由官方的LZ4_decompress_safe解压），只实现单线程的快速压缩：
+ * 每次取4字节的哈希查找64KB窗口内的上一次出现位置，匹配失败时按距上一个匹配的距离加大步长跳过不可压缩的数据
+ * 哈希表是线程局部的，不随每次调用清零，残留的位置只会成为需要比较的候选，不影响正确性
+ * decompress检查所有边界，输入损坏时返回-1，不会越界读写
+ */
+#pragma once
+#include <stddef.h>
+
+namespace myServer {
+namespace lz4 {
+// 压缩srcLen字节最多需要的输出长度
+inline size_t compressBound(size_t srcLen) { return srcLen + srcLen / 255 + 16; }
+// 压缩到dst，dstCapacity至少为compressBound(srcLen)，返回压缩后的长度
+size_t compress(const char *src, size_t srcLen, char *dst, size_t dstCapacity);
+// 解压到dst，返回解压后的长度，输入损坏或dstCapacity不足时返回-1
+// 为了整块拷贝，dst中返回长度之后、dstCapacity之内的字节可能被改写
+long decompress(const char *src, size_t srcLen, char *dst, size_t dstCapacity);
+} // namespace lz4
+} // namespace myServer
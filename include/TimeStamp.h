@@ -1,13 +1,16 @@
 /** TimeStamp: 时间戳类
- * 使用int64_t类型的微秒作为时间戳记录；
- * 提供格式化字符串函数返回时间
+ * 使用int64_t类型的纳秒作为时间戳记录（可表示到2262年），对外仍提供微秒、秒的接口；
+ * 提供格式化字符串函数返回时间，以及不分配内存、直接写入char*的格式化函数
  * 静态成员函数获取当前时间戳
  * 静态成员函数获取time_t秒数或加偏移的时间戳。
+ * 格式化使用本地时区，每个线程缓存当前分钟的"年月日 时:分:"，同一分钟内只需写入秒和秒以下的数字，不调用localtime_r
+ * parse()是formatTo的逆操作，用于从日志行首读出时间
  */
 
 #pragma once
 #include <algorithm>
 #include <inttypes.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <string>
 #include <sys/time.h>
@@ -16,56 +19,85 @@
 namespace myServer {
 class TimeStamp {
   public:
-    static const int kMicroSecondPerSecond = 1000 * 1000; // 一秒有多少微秒
-    TimeStamp() : microSecondsSinceEpoch_(0) {}
-    explicit TimeStamp(int64_t x) : microSecondsSinceEpoch_(x) {}
+    static const int kMicroSecondPerSecond = 1000 * 1000;       // 一秒有多少微秒
+    static const int kNanoSecondPerSecond = 1000 * 1000 * 1000; // 一秒有多少纳秒
+    static const int kNanoSecondPerMicroSecond = 1000;          // 一微秒有多少纳秒
+    // 格式化时秒以下的精度
+    enum Precision { kSeconds,      // YYYYMMDD HH:MM:SS
+                     kMilliSeconds, // YYYYMMDD HH:MM:SS.mmm
+                     kMicroSeconds, // YYYYMMDD HH:MM:SS.uuuuuu
+                     kNanoSeconds   // YYYYMMDD HH:MM:SS.nnnnnnnnn
+    };
+    static const int kMaxFormattedSize = 32; // formatTo、formatCompactTo需要的缓冲区大小，包括'\0'
+    // now()使用的时钟
+    enum ClockSource { kWallClock,      // clock_gettime(CLOCK_REALTIME)，默认
+                       kRealtimeCoarse, // clock_gettime(CLOCK_REALTIME_COARSE)，精度为一个时钟中断（通常1-4ms）
+                       kTsc             // 校准过的TSC，见TscClock.h
+    };
+
+    TimeStamp() : nanoSecondsSinceEpoch_(0) {}
+    explicit TimeStamp(int64_t microSeconds) : nanoSecondsSinceEpoch_(microSeconds * kNanoSecondPerMicroSecond) {}
     void swap(TimeStamp &rhs) {
         using std::swap;
-        swap(microSecondsSinceEpoch_, rhs.microSecondsSinceEpoch_);
+        swap(nanoSecondsSinceEpoch_, rhs.nanoSecondsSinceEpoch_);
     }
-    bool valid() { return microSecondsSinceEpoch_ > 0; }                                                              // 返回记录的微秒数是否大于0
-    int64_t microSecondsSinceEpoch() const { return microSecondsSinceEpoch_; }                                        // 返回记录的微秒数
-    time_t SecondsSinceEpoch() const { return static_cast<time_t>(microSecondsSinceEpoch_ / kMicroSecondPerSecond); } //  返回记录的秒数
+    bool valid() const { return nanoSecondsSinceEpoch_ > 0; }                                                                // 返回记录的时间是否大于0
+    int64_t microSecondsSinceEpoch() const { return nanoSecondsSinceEpoch_ / kNanoSecondPerMicroSecond; }                     // 返回记录的微秒数
+    int64_t nanoSecondsSinceEpoch() const { return nanoSecondsSinceEpoch_; }                                                 // 返回记录的纳秒数
+    time_t SecondsSinceEpoch() const { return static_cast<time_t>(nanoSecondsSinceEpoch_ / kNanoSecondPerSecond); }         //  返回记录的秒数
 
     // 格式化时间戳字符串
-    std::string toString() const;
-    std::string toFormatString(bool showMicroSeconds = 0) const;
+    std::string toString() const;                                // "秒.微秒"
+    std::string toFormatString(bool showMicroSeconds = 0) const; // "YYYYMMDD HH:MM:SS[.uuuuuu]"
+    // 不分配内存的格式化，buf至少kMaxFormattedSize字节，末尾写入'\0'，返回不包括'\0'的长度
+    size_t formatTo(char *buf, Precision precision = kMicroSeconds) const; // "YYYYMMDD HH:MM:SS[.秒以下]"
+    size_t formatCompactTo(char *buf) const;                               // "YYYYMMDD-HHMMSS"，用于文件名
+    // 解析formatTo写出的本地时间"YYYYMMDD HH:MM:SS[.秒以下最多9位]"，返回解析的长度，格式不符时返回0
+    // 每个线程缓存上一次的分钟，同一分钟内不调用mktime
+    static size_t parse(const char *buf, size_t len, TimeStamp *ts);
 
     // 静态成员函数获取当前时间戳
-    static TimeStamp now();                            // 获得一个记录当前时间的时间戳
+    static TimeStamp now();                            // 获得一个记录当前时间的时间戳，使用setClockSource选择的时钟
+    static bool setClockSource(ClockSource source);    // 选择now()的时钟，CPU不支持invariant TSC时选择kTsc返回false，时钟不变
+    static ClockSource clockSource();                  // 返回now()当前使用的时钟
     static TimeStamp invalid() { return TimeStamp(); } // 获得一个空的非法的时间戳
 
     // 静态成员函数获取time_t秒数加偏移的时间戳
     static TimeStamp fromUnixTime(time_t t, int microSeconds) { return TimeStamp(static_cast<int64_t>(t) * kMicroSecondPerSecond + microSeconds); }
     static TimeStamp fromUnixTime(time_t t) { return fromUnixTime(t, 0); }
+    static TimeStamp fromNanoSeconds(int64_t nanoSeconds) {
+        TimeStamp ts;
+        ts.nanoSecondsSinceEpoch_ = nanoSeconds;
+        return ts;
+    }
 
   private:
-    int64_t microSecondsSinceEpoch_; // 1970至今的微秒数
+    int64_t nanoSecondsSinceEpoch_; // 1970至今的纳秒数
 };
 
 // 重载一些比较操作符用于容器排序
 // 此处不能申明为member函数，因为需要为所有参数提供隐式类型转换，具体见effective c++ 条款24
 // member函数对 2<timeStamp 无法编译通过
 inline bool operator<(const TimeStamp &lhs, const TimeStamp &rhs) {
-    return lhs.microSecondsSinceEpoch() < rhs.microSecondsSinceEpoch();
+    return lhs.nanoSecondsSinceEpoch() < rhs.nanoSecondsSinceEpoch();
 }
 inline bool operator>(const TimeStamp &lhs, const TimeStamp &rhs) {
-    return lhs.microSecondsSinceEpoch() > rhs.microSecondsSinceEpoch();
+    return lhs.nanoSecondsSinceEpoch() > rhs.nanoSecondsSinceEpoch();
 }
 inline bool operator==(const TimeStamp &lhs, const TimeStamp &rhs) {
-    return lhs.microSecondsSinceEpoch() == rhs.microSecondsSinceEpoch();
+    return lhs.nanoSecondsSinceEpoch() == rhs.nanoSecondsSinceEpoch();
 }
 
 void swap(TimeStamp &lhs, TimeStamp &rhs); // 提供non-member的swap
 
 inline double timeDifference(const TimeStamp &high, const TimeStamp &low) {
-    int64_t diff = high.microSecondsSinceEpoch() - low.microSecondsSinceEpoch();
-    return static_cast<double>(diff) / TimeStamp::kMicroSecondPerSecond;
+    int64_t diff = high.nanoSecondsSinceEpoch() - low.nanoSecondsSinceEpoch();
+    return static_cast<double>(diff) / TimeStamp::kNanoSecondPerSecond;
 }
 // 构造一个延迟delay秒的时间戳
 inline TimeStamp addTime(const TimeStamp &ts, double seconds) {
-    int64_t delta = static_cast<int64_t>(seconds * TimeStamp::kMicroSecondPerSecond); // 精确到double小数点后6位
-    return TimeStamp(ts.microSecondsSinceEpoch() + delta);
+    int64_t delta = static_cast<int64_t>(seconds * TimeStamp::kNanoSecondPerSecond); // 精确到double小数点后9位
+    return TimeStamp::fromNanoSeconds(ts.nanoSecondsSinceEpoch() + delta);
 }
 } // namespace myServer
 
@@ -0,0 +1,114 @@
+/** TscClock: 基于TSC（时间戳计数器）的墙上时钟
+ * rdtsc只需要几纳秒，比clock_gettime快得多。启动时用clock_gettime校准TSC频率，
+ * 把tick换算为纳秒：ns = baseNs + (tsc - baseTsc) * mult >> 32
+ * 后台线程每隔recalibrateInterval重新采样墙上时钟：
+ *  1.用启动以来的长基线估计TSC频率，误差随运行时间减小
+ *  2.与墙上时钟的偏差在kMaxSlewPpm的斜率限制内逐步追平（slew），换算函数在切换点连续，时间不会倒退
+ *  3.偏差超过kMaxStepNs（例如墙上时钟被手动调整）时直接跳到墙上时钟并重新建立基线
+ * 换算参数和跳变次数由seqlock保护，读者无锁；同一线程在两次跳变之间读到的时间单调不减，
+ * 跳变后不再以跳变前读到的时间为下限，墙上时钟被调回时时间随之倒退
+ * 只在CPU支持invariant TSC（频率恒定、各核同步）时可用，见available()
+ */
+#pragma once
+#include <atomic>
+#include <boost/noncopyable.hpp>
+#include <condition_variable>
+#include <mutex>
+#include <stdint.h>
+#include <thread>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace myServer {
+using boost::noncopyable;
+using namespace std;
+
+class TscClock : noncopyable {
+  public:
+    static constexpr int64_t kMaxSlewPpm = 500;              // 追平偏差时频率最多调整百万分之500
+    static constexpr int64_t kMaxStepNs = 10 * 1000 * 1000;  // 偏差超过10ms时直接跳变
+    static constexpr int kDefaultRecalibrateInterval = 1000; // 默认每秒重新校准，单位毫秒
+
+    static bool available(); // CPU是否支持invariant TSC
+    // 返回全局唯一的实例，第一次调用时阻塞约20ms完成初始校准并启动后台线程；不支持时返回nullptr
+    static TscClock *instance();
+
+    static uint64_t rdtsc() {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return 0;
+#endif
+    }
+
+    int64_t nowNanoSeconds() const; // 1970至今的纳秒数
+
+    void setRecalibrateInterval(int milliSeconds); // 重新校准的间隔
+    void setWallClock(int64_t (*wallClock)());     // 校准时参照的墙上时钟（纳秒），默认clock_gettime(CLOCK_REALTIME)，可替换为模拟的时钟
+    double ticksPerSecond() const;                 // 当前估计的TSC频率
+    int64_t lastOffset() const { return lastOffset_.load(std::memory_order_relaxed); } // 最近一次校准时与墙上时钟的偏差，单位纳秒
+    int64_t steps() const { return steps_.load(std::memory_order_relaxed); }           // 发生跳变的次数
+
+  private:
+    TscClock();
+    ~TscClock(); // 实例不销毁，后台线程随进程退出
+
+    struct Sample {
+        uint64_t tsc;
+        int64_t wallNs;
+    };
+    Sample sample() const;               // 采样一对相邻的tsc和墙上时钟
+    int64_t convert(uint64_t tsc) const; // 用当前参数换算，调用者保证参数不在修改中
+    void publish(int64_t baseNs, uint64_t baseTsc, uint64_t mult, bool step);
+    void recalibrate();
+    void threadFunc();
+
+    // seqlock保护的换算参数，seq_为奇数时表示正在修改
+    std::atomic<uint32_t> seq_;
+    std::atomic<int64_t> baseNs_;
+    std::atomic<uint64_t> baseTsc_;
+    std::atomic<uint64_t> mult_; // 每tick的纳秒数 * 2^32
+
+    Sample anchor_;       // 长基线的起点，跳变后重置
+    uint64_t freqMult_;   // 由长基线估计的每tick纳秒数 * 2^32
+    std::atomic<int64_t> lastOffset_;
+    std::atomic<int64_t> steps_; // 在seqlock内与换算参数一起修改，读者据此判断是否发生了跳变
+    std::atomic<int64_t (*)()> wallClock_;
+
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    int recalibrateInterval_; // 毫秒
+    std::thread thread_;
+};
+
+inline int64_t TscClock::convert(uint64_t tsc) const {
+    int64_t delta = static_cast<int64_t>(tsc - baseTsc_.load(std::memory_order_relaxed)); // 乱序执行的rdtsc可能略早于baseTsc
+    return baseNs_.load(std::memory_order_relaxed) + static_cast<int64_t>((static_cast<__int128>(delta) * mult_.load(std::memory_order_relaxed)) >> 32);
+}
+
+inline int64_t TscClock::nowNanoSeconds() const {
+    struct LastRead {
+        const TscClock *clock;
+        int64_t steps;
+        int64_t ns;
+    };
+    static __thread LastRead t_last; // 本线程上一次返回的时间，同一时钟两次跳变之间保证单调
+    int64_t ns;
+    int64_t steps;
+    for (;;) {
+        uint32_t seq = seq_.load(std::memory_order_acquire);
+        ns = convert(rdtsc());
+        steps = steps_.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (!(seq & 1) && seq == seq_.load(std::memory_order_relaxed)) {
+            break;
+        }
+    }
+    if (t_last.clock == this && t_last.steps == steps && ns < t_last.ns) {
+        ns = t_last.ns;
+    }
+    t_last = LastRead{this, steps, ns};
+    return ns;
+}
+} // namespace myServer
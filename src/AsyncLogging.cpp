@@ -1,9 +1,18 @@
 #include "AsyncLogging.h"
+#include "CurrentThread.h"
+#include "DeferredLog.h"
 #include "LogFile.h"
+#include "LogProfiler.h"
 #include "TimeStamp.h"
 #include <assert.h>
 #include <chrono>
 namespace myServer {
+static atomic<uint64_t> g_nextAsyncLoggingId(1); // 实例编号从1开始，0表示线程局部缓存尚未命中任何实例
+
+static int64_t elapsedNs(chrono::steady_clock::time_point start) {
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+}
+
 AsyncLogging::AsyncLogging(const char *basename, off_t rollSize, int flushInterval) : basename_(basename),
                                                                                       rollSize_(rollSize),
                                                                                       flushInterval_(flushInterval),
@@ -11,114 +20,625 @@ AsyncLogging::AsyncLogging(const char *basename, off_t rollSize, int flushInterv
                                                                                       currentBuffer_(new Buffer),
                                                                                       nextBuffer_(new Buffer),
                                                                                       buffers_(),
-                                                                                      running_(true)
+                                                                                      running_(true),
+                                                                                      id_(g_nextAsyncLoggingId.fetch_add(1)),
+                                                                                      threadLocalBuffer_(false),
+                                                                                      backend_(LogFile::kWritev),
+                                                                                      syncOnWrite_(false),
+                                                                                      compressRolled_(false),
+                                                                                      compressInline_(false),
+                                                                                      indexBytes_(0),
+                                                                                      indexIntervalMs_(1000),
+                                                                                      poolSize_(kDefaultPoolSize),
+                                                                                      policy_(kDropNewest),
+                                                                                      minBlockLevel_(Logger::WARN),
+                                                                                      droppedMessages_(0),
+                                                                                      droppedBuffers_(0),
+                                                                                      droppedBytes_(0),
+                                                                                      reportedMessages_(0),
+                                                                                      reportedBuffers_(0),
+                                                                                      reportedBytes_(0),
+                                                                                      lines_(0),
+                                                                                      bytes_(0),
+                                                                                      retiredLines_(0),
+                                                                                      retiredBytes_(0),
+                                                                                      wakeups_(0),
+                                                                                      buffersWritten_(0),
+                                                                                      peakQueueDepth_(0),
+                                                                                      ioStats_(),
+                                                                                      metricsInterval_(0),
+                                                                                      crashHandler_(true)
 
 {
     currentBuffer_->bzero();
     nextBuffer_->bzero();
     buffers_.reserve(16);
 }
+
+/** 预分配缓存池
+ * 除前端的currentBuffer_、nextBuffer_外，其余缓存全部放入空闲池，之后不再新建或释放
+ * 预先清零使物理内存在启动时就分配好，运行中内存占用固定
+ * 使用FlightRecorder时全部缓存（包括currentBuffer_、nextBuffer_）都在映射中，start()之前写入的日志拷贝到映射中的缓存
+ */
+void AsyncLogging::preallocateBuffers() {
+    lock_guard<mutex> lck(mutex_);
+    emptyBuffers_.reserve(poolSize_);
+    buffers_.reserve(poolSize_);
+    if (!recorderPath_.empty()) {
+        recorder_.reset(FlightRecorder::create(recorderPath_, poolSize_, basename_));
+    }
+    if (recorder_) {
+        for (int i = poolSize_ - 1; i >= 0; --i) {
+            emptyBuffers_.push_back(BufferPtr(recorder_->buffer(i), BufferDeleter{true}));
+        }
+        BufferPtr current = takeEmptyBuffer();
+        current->append(currentBuffer_->data(), currentBuffer_->length());
+        currentBuffer_ = move(current);
+        markActive(currentBuffer_);
+        nextBuffer_ = takeEmptyBuffer();
+        if (crashHandler_) {
+            recorder_->installCrashHandler();
+        }
+        return;
+    }
+    while (static_cast<int>(emptyBuffers_.size()) + 2 < poolSize_) {
+        BufferPtr buffer(new Buffer);
+        buffer->bzero();
+        emptyBuffers_.push_back(move(buffer));
+    }
+}
+
 /** 前端写入
  * 如果当前缓冲区大小不足，则将nextBuffer移动给当前缓冲区
- * 如果nextBUffer不存在，则创建一块新的缓存，（只有当日志量很大时会出现）
+ * 如果nextBUffer不存在，则从缓存池中取一块，缓存池耗尽时按OverflowPolicy处理
  */
 void AsyncLogging::append(const char *msg, int len) {
-    unique_lock<mutex> lck(mutex_);
-    if (currentBuffer_->avail() > len) {
-        currentBuffer_->append(msg, len);
-    } else {
+    if (len >= kLargeBuffer) {
+        // 单条日志比一整块缓存还大，无法写入
+        droppedMessages_++;
+        droppedBytes_ += len;
+        return;
+    }
+    if (threadLocalBuffer_) {
+        if (StagingBuffer *staging = localStaging()) {
+            appendThreadLocal(staging, msg, len);
+            return;
+        }
+    }
+    YKLOG_PROF_MARK(kLockBegin);
+    unique_lock<mutex> lck(mutex_, try_to_lock);
+    if (!lck.owns_lock()) {
+        lockContended(lck);
+    }
+    YKLOG_PROF_MARK(kLockEnd);
+    while (!currentBuffer_ || currentBuffer_->avail() <= len) {
         // 当前缓冲区空间不足
-        buffers_.push_back(move(currentBuffer_)); // 右值添加内部调用emplace_back
+        if (currentBuffer_) {
+            buffers_.push_back(move(currentBuffer_)); // 右值添加内部调用emplace_back
+            cond_.notify_one();
+        }
         if (nextBuffer_) {
             currentBuffer_ = move(nextBuffer_);
+        } else if (!(currentBuffer_ = takeEmptyBuffer()) && !waitForBuffer(lck, msg, len, false)) {
+            return;
+        }
+        markActive(currentBuffer_);
+    }
+    currentBuffer_->append(msg, len);
+    addSingleWriter(lines_, 1);
+    addSingleWriter(bytes_, len);
+    YKLOG_PROF_ENQUEUED(currentBuffer_.get());
+}
+
+/** 前端写入延迟日志记录
+ * 记录写入独立的记录缓存，与文本缓存共用缓存池和溢出策略
+ * 线程局部模式下同样走mutex_，延迟日志省掉的是调用线程上的格式化开销
+ */
+void AsyncLogging::appendDeferred(const char *record, int len) {
+    if (len >= kLargeBuffer) {
+        droppedMessages_++;
+        droppedBytes_ += len;
+        return;
+    }
+    unique_lock<mutex> lck(mutex_, try_to_lock);
+    if (!lck.owns_lock()) {
+        lockContended(lck);
+    }
+    while (!currentRecordBuffer_ || currentRecordBuffer_->avail() <= len) {
+        if (currentRecordBuffer_) {
+            recordBuffers_.push_back(move(currentRecordBuffer_));
+            cond_.notify_one();
+        }
+        if (!(currentRecordBuffer_ = takeEmptyBuffer()) && !waitForBuffer(lck, record, len, true)) {
+            return;
+        }
+    }
+    currentRecordBuffer_->append(record, len);
+    addSingleWriter(lines_, 1);
+    addSingleWriter(bytes_, len);
+}
+
+/** 线程局部模式的前端写入
+ * 只锁当前线程自己的暂存缓存，该锁只有后端定时收集时才会被争用
+ * 暂存缓存写满时才获取mutex_，把写满的缓存交给后端并从空闲池中取一块新的
+ */
+void AsyncLogging::appendThreadLocal(StagingBuffer *staging, const char *msg, int len) {
+    YKLOG_PROF_MARK(kLockBegin);
+    lock_guard<mutex> stagingLck(staging->mutex_);
+    YKLOG_PROF_MARK(kLockEnd);
+    if (staging->buffer_ && staging->buffer_->avail() > len) {
+        staging->buffer_->append(msg, len);
+        addSingleWriter(staging->lines_, 1);
+        addSingleWriter(staging->bytes_, len);
+        YKLOG_PROF_ENQUEUED(staging->buffer_.get());
+        return;
+    }
+    {
+        unique_lock<mutex> lck(mutex_, try_to_lock);
+        if (!lck.owns_lock()) {
+            lockContended(lck);
+        }
+        if (staging->buffer_) {
+            buffers_.push_back(move(staging->buffer_));
+            cond_.notify_one();
+        }
+        while (!(staging->buffer_ = takeEmptyBuffer())) {
+            if (!waitForBuffer(lck, msg, len, false)) {
+                return;
+            }
+        }
+        markActive(staging->buffer_);
+    }
+    staging->buffer_->append(msg, len);
+    addSingleWriter(staging->lines_, 1);
+    addSingleWriter(staging->bytes_, len);
+    YKLOG_PROF_ENQUEUED(staging->buffer_.get());
+}
+
+/** 查找当前线程在本实例下的暂存缓存
+ * 线程局部表持有暂存缓存的一份引用，线程退出时表析构，后端发现只剩自己持有时将其回收
+ * 用实例编号而不是this区分实例，避免实例销毁后新实例复用同一地址时误用旧的暂存缓存
+ * 表中只剩自己持有的暂存缓存属于已经销毁的实例，查找时一并删除
+ * 暂存缓存数达到上限时不登记，该线程写入共享的currentBuffer_，下一次换用其他实例后回到本实例时再尝试登记
+ */
+AsyncLogging::StagingBuffer *AsyncLogging::localStaging() {
+    thread_local vector<pair<uint64_t, StagingPtr>> t_stagings;
+    thread_local uint64_t t_lastId = 0;
+    thread_local StagingBuffer *t_lastStaging = nullptr;
+    if (__builtin_expect(t_lastId == id_, 1)) {
+        return t_lastStaging;
+    }
+    StagingPtr staging;
+    for (auto it = t_stagings.begin(); it != t_stagings.end();) {
+        if (it->second.use_count() == 1) {
+            it = t_stagings.erase(it);
+            continue;
+        }
+        if (it->first == id_) {
+            staging = it->second;
+        }
+        ++it;
+    }
+    if (!staging) {
+        lock_guard<mutex> lck(stagingMutex_);
+        if (static_cast<int>(stagings_.size()) < maxStagings()) {
+            staging = make_shared<StagingBuffer>();
+            stagings_.push_back(staging);
+            t_stagings.emplace_back(id_, staging);
+        }
+    }
+    t_lastId = id_;
+    t_lastStaging = staging.get();
+    return t_lastStaging;
+}
+
+// 只在mutex_有争用时才读时钟，没有争用的前端只多一次try_lock失败的判断
+void AsyncLogging::lockContended(unique_lock<mutex> &lck) {
+    auto start = chrono::steady_clock::now();
+    lck.lock();
+    lockWaits_.add(1);
+    lockWaitNs_.add(elapsedNs(start));
+}
+
+AsyncLogging::BufferPtr AsyncLogging::takeEmptyBuffer() {
+    if (emptyBuffers_.empty()) {
+        return BufferPtr();
+    }
+    BufferPtr buffer = move(emptyBuffers_.back());
+    emptyBuffers_.pop_back();
+    return buffer;
+}
+
+/** 映射中的缓存开始接收日志（成为currentBuffer_或暂存缓存）时在FlightRecorder中标记为活跃，分配新的序号
+ * 不在取出时分配：nextBuffer_可能先于之后取出的缓存离开缓存池，却在它之后才被写入，恢复时顺序会颠倒
+ * 延迟日志记录的缓存不标记（崩溃后无法在进程外格式化）
+ */
+void AsyncLogging::markActive(const BufferPtr &buffer) {
+    if (buffer && buffer.get_deleter().mapped) {
+        recorder_->activate(buffer.get());
+    }
+}
+
+void AsyncLogging::returnBuffer(BufferPtr buffer) {
+    if (buffer.get_deleter().mapped) {
+        recorder_->release(buffer.get());
+    }
+    buffer->reset();
+    emptyBuffers_.push_back(move(buffer));
+}
+
+// 从Logger格式化的日志行“日期 时间 线程id 级别 ...”中解析级别，解析失败时按INFO处理
+static Logger::LogLevel parseLevel(const char *msg, int len) {
+    const char *p = msg;
+    const char *end = msg + len;
+    for (int field = 0; field < 3; ++field) {
+        while (p < end && *p == ' ') {
+            ++p;
+        }
+        while (p < end && *p != ' ') {
+            ++p;
+        }
+    }
+    while (p < end && *p == ' ') {
+        ++p;
+    }
+    for (int level = Logger::TRACE; level < Logger::NUM_LOG_LEVELS; ++level) {
+        size_t nameLen = strlen(LogLevelName[level]);
+        if (static_cast<size_t>(end - p) >= nameLen && memcmp(p, LogLevelName[level], nameLen) == 0) {
+            return static_cast<Logger::LogLevel>(level);
+        }
+    }
+    return Logger::INFO;
+}
+
+/** 缓存池耗尽时按策略处理前端，调用时持有mutex_
+ * kBlock：等待后端归还缓存，返回后调用者重新尝试
+ * kDropOldest：把队列中最旧的待写文本缓存清空放回池中，该缓存中的日志被丢弃
+ * kDropByLevel：级别不低于minBlockLevel_的日志按kBlock处理，其余按kDropNewest处理
+ * kDropNewest：丢弃当前日志，返回false
+ * 停止后不再有缓存归还，阻塞策略也退化为丢弃
+ */
+bool AsyncLogging::waitForBuffer(unique_lock<mutex> &lck, const char *msg, int len, bool record) {
+    OverflowPolicy policy = policy_;
+    if (policy == kDropByLevel) {
+        Logger::LogLevel level = record ? deferred::recordLevel(msg) : parseLevel(msg, len);
+        policy = level >= minBlockLevel_ ? kBlock : kDropNewest;
+    }
+    if (policy == kDropOldest && !buffers_.empty()) {
+        BufferPtr oldest = move(buffers_.front());
+        buffers_.erase(buffers_.begin());
+        droppedBuffers_++;
+        droppedBytes_ += oldest->length();
+        YKLOG_PROF_DISCARDED(oldest.get());
+        returnBuffer(move(oldest));
+        return true;
+    }
+    if (policy == kBlock && running_.load()) {
+        auto start = chrono::steady_clock::now();
+        poolCond_.wait(lck);
+        poolWaitNs_.add(elapsedNs(start));
+        return true;
+    }
+    droppedMessages_++;
+    droppedBytes_ += len;
+    return false;
+}
+
+// 后端将自上次报告以来新增的丢弃数量写入日志和标准错误
+void AsyncLogging::reportDropped(LogFile &output) {
+    int64_t messages = droppedMessages_.load();
+    int64_t buffers = droppedBuffers_.load();
+    int64_t bytes = droppedBytes_.load();
+    if (bytes == reportedBytes_ && messages == reportedMessages_ && buffers == reportedBuffers_) {
+        return;
+    }
+    char timeBuf[TimeStamp::kMaxFormattedSize];
+    TimeStamp::now().formatTo(timeBuf, TimeStamp::kSeconds);
+    char buf[256];
+    snprintf(buf, sizeof(buf), "Dropped log messages at %s, %" PRId64 " messages, %" PRId64 " larger buffers, %" PRId64 " bytes\n",
+             timeBuf, messages - reportedMessages_, buffers - reportedBuffers_, bytes - reportedBytes_);
+    fputs(buf, stderr);
+    output.append(buf, static_cast<int>(strlen(buf)));
+    reportedMessages_ = messages;
+    reportedBuffers_ = buffers;
+    reportedBytes_ = bytes;
+}
+
+/** 后端收集暂存缓存
+ * 定时刷新时收集各线程未写满的缓存，保证日志量小的线程也能在flushInterval内落盘
+ * 被收走缓存的线程下次写入时再从空闲池取新缓存
+ * 线程已退出（只剩stagings_持有）的暂存缓存收集后注销
+ */
+void AsyncLogging::collectStaging(BufferVector &out, bool all) {
+    lock_guard<mutex> lck(stagingMutex_);
+    for (auto it = stagings_.begin(); it != stagings_.end();) {
+        StagingBuffer &staging = **it;
+        unique_lock<mutex> stagingLck(staging.mutex_, defer_lock);
+        if (all) {
+            stagingLck.lock();
+        } else if (!stagingLck.try_lock()) {
+            ++it; // 前端正在写入，留到下一次收集
+            continue;
+        }
+        bool orphan = it->use_count() == 1;
+        if (staging.buffer_ && (orphan || staging.buffer_->length() > 0)) {
+            out.push_back(move(staging.buffer_));
+        }
+        stagingLck.unlock();
+        if (orphan) {
+            addSingleWriter(retiredLines_, staging.lines_.load(memory_order_relaxed));
+            addSingleWriter(retiredBytes_, staging.bytes_.load(memory_order_relaxed));
+            it = stagings_.erase(it);
         } else {
-            currentBuffer_.reset(new Buffer);
+            ++it;
         }
-        currentBuffer_->append(msg, len);
-        cond_.notify_one();
     }
 }
 
+/** 一批缓存组成iovec一次提交写入，kWritev时对应一次writev系统调用
+ * 缓存先移入inFlight_，写完后由LogFile回调releaseBuffer归还缓存池；同步的写入方式在appendAsync返回前就已回调
+ */
+void AsyncLogging::writeBuffers(BufferVector &buffers, LogFile &output) {
+    if (buffers.empty()) {
+        return;
+    }
+    vector<struct iovec> iov;
+    vector<void *> tags;
+    iov.reserve(buffers.size());
+    tags.reserve(buffers.size());
+    for (auto &buffer : buffers) {
+        iov.push_back({const_cast<char *>(buffer->data()), static_cast<size_t>(buffer->length())});
+        tags.push_back(buffer.get());
+        inFlight_.push_back(move(buffer));
+    }
+    buffers.clear();
+    output.appendAsync(iov.data(), static_cast<int>(iov.size()), tags.data(), syncOnWrite_);
+}
+
+void AsyncLogging::releaseBuffer(void *tag) {
+    YKLOG_PROF_WRITTEN(tag);
+    for (auto it = inFlight_.begin(); it != inFlight_.end(); ++it) {
+        if (it->get() == tag) {
+            {
+                lock_guard<mutex> lck(mutex_);
+                returnBuffer(move(*it));
+            }
+            inFlight_.erase(it);
+            poolCond_.notify_all();
+            return;
+        }
+    }
+}
+
+void AsyncLogging::recycleBuffers(BufferVector &buffers) {
+    {
+        lock_guard<mutex> lck(mutex_);
+        for (auto &buffer : buffers) {
+            returnBuffer(move(buffer));
+        }
+    }
+    poolCond_.notify_all();
+    buffers.clear();
+}
+
+// 逐条格式化延迟日志记录，攒满一个LogStream缓冲区再写入文件
+void AsyncLogging::writeRecords(const Buffer &buffer, LogFile &output) {
+    LogStream line;
+    LogStream batch;
+    const char *p = buffer.data();
+    const char *end = p + buffer.length();
+    while (p < end) {
+        line.resetBuffer();
+        deferred::formatRecord(p, line);
+        if (batch.buffer().avail() <= line.buffer().length()) {
+            output.append(batch.buffer().data(), batch.buffer().length());
+            batch.resetBuffer();
+        }
+        batch.append(line.buffer().data(), line.buffer().length());
+        p += deferred::recordSize(p);
+    }
+    output.append(batch.buffer().data(), batch.buffer().length());
+}
+
+// 后端写入一批文本缓存和延迟日志记录缓存，然后flush，同时记录写入的指标
+void AsyncLogging::writeBatch(BufferVector &buffers, BufferVector &records, LogFile &output) {
+    int64_t batch = static_cast<int64_t>(buffers.size() + records.size());
+    if (batch > 0) {
+        auto start = chrono::steady_clock::now();
+        writeBuffers(buffers, output);
+        for (const auto &buffer : records) {
+            writeRecords(*buffer, output);
+        }
+        writeNs_.record(elapsedNs(start));
+        buffersPerWakeup_.record(batch);
+        addSingleWriter(wakeups_, 1);
+        addSingleWriter(buffersWritten_, batch);
+        recycleBuffers(records);
+    }
+    auto start = chrono::steady_clock::now();
+    output.flush();
+    flushNs_.record(elapsedNs(start));
+    LogFile::IoStats ioStats = output.ioStats();
+    lock_guard<mutex> lck(ioStatsMutex_);
+    ioStats_ = ioStats;
+}
+
+AsyncLogging::Metrics AsyncLogging::metrics() const {
+    Metrics m;
+    {
+        lock_guard<mutex> lck(stagingMutex_);
+        m.lines = lines_.load(memory_order_relaxed) + retiredLines_.load(memory_order_relaxed);
+        m.bytes = bytes_.load(memory_order_relaxed) + retiredBytes_.load(memory_order_relaxed);
+        for (const StagingPtr &staging : stagings_) {
+            m.lines += staging->lines_.load(memory_order_relaxed);
+            m.bytes += staging->bytes_.load(memory_order_relaxed);
+        }
+    }
+    m.wakeups = wakeups_.load(memory_order_relaxed);
+    m.buffersWritten = buffersWritten_.load(memory_order_relaxed);
+    m.peakQueueDepth = peakQueueDepth_.load(memory_order_relaxed);
+    m.droppedMessages = droppedMessages_.load();
+    m.droppedBuffers = droppedBuffers_.load();
+    m.droppedBytes = droppedBytes_.load();
+    m.lockWaits = lockWaits_.value();
+    m.lockWaitNs = lockWaitNs_.value();
+    m.poolWaitNs = poolWaitNs_.value();
+    {
+        lock_guard<mutex> lck(ioStatsMutex_);
+        m.io = ioStats_;
+    }
+    m.rolls = m.io.rolls;
+    m.buffersPerWakeup = buffersPerWakeup_.snapshot();
+    m.writeNs = writeNs_.snapshot();
+    m.flushNs = flushNs_.snapshot();
+    return m;
+}
+
+// 按Logger的行格式写一行，可以用yklog-grep按"yklog metrics"过滤；计数都是从start()开始的累计值
+void AsyncLogging::reportMetrics(LogFile &output) {
+    Metrics m = metrics();
+    LogStream stream;
+    Logger::formatTime(stream, TimeStamp::now());
+    currentThread::tid();
+    stream.append(currentThread::tidString(), currentThread::tidStringLength());
+    stream.append(LogLevelName[Logger::INFO], 6);
+    stream << "yklog metrics lines=" << m.lines << " bytes=" << m.bytes << " wakeups=" << m.wakeups << " buffers=" << m.buffersWritten
+           << " peak_depth=" << m.peakQueueDepth << " dropped=" << m.droppedMessages << " dropped_buffers=" << m.droppedBuffers
+           << " lock_waits=" << m.lockWaits << " lock_wait_us=" << m.lockWaitNs / 1000 << " pool_wait_us=" << m.poolWaitNs / 1000
+           << " rolls=" << m.rolls << " syncs=" << m.io.syncs << " cached_bytes=" << m.io.cachedBytes
+           << " dropped_cache_bytes=" << m.io.droppedCacheBytes << " write_p99_us=" << m.writeNs.percentile(0.99) / 1000 << " write_max_us=" << m.writeNs.max / 1000
+           << " flush_p99_us=" << m.flushNs.percentile(0.99) / 1000;
+    Logger::SourceFile file = __FILE__;
+    stream << " - ";
+    stream.append(file.data(), file.size());
+    stream << ':' << __LINE__ << '\n';
+    output.append(stream.buffer().data(), stream.buffer().length());
+}
+
 /** 后端线程创建函数
- * 创建后端用缓存，用于和前端缓存交换
- * 临界区内进行缓存数组的交换，临界区触发条件：超时（超过刷新时间），前端写满一个或多个buffer
+ * 临界区内进行缓存数组的交换，并从缓存池补充前端缓存，临界区触发条件：超时（超过刷新时间），前端写满一个或多个buffer，
+ * kIoUring下还有在途的写入完成
  * 非临界区执行文件写入
- * (1) 日志待写入文件buffersToWrite队列超限（短时间堆积，多为异常情况）
+ * (1) 报告前端因缓存池耗尽而丢弃的日志数量
  * (2) buffersToWrited队列中的日志消息交给后端写入
- * (3) 将buffersToWrited队列中的buffer重新填充newBuffer1、newBuffer2
+ * (3) 写完的buffer归还缓存池，唤醒等待缓存的前端；同步写入方式下写入返回时已经全部归还，kIoUring下在各自完成时归还
  */
 void AsyncLogging::threadFunc() {
     assert(running_ == true);
 
-    LogFile output(basename_, rollSize_, false); // 单线程使用非线程安全的写入
+    LogFile output(basename_, rollSize_, false, flushInterval_, 1024, backend_, compressInline_); // 单线程使用非线程安全的写入
+    output.setWriteCallback(bind(&AsyncLogging::releaseBuffer, this, placeholders::_1));
+    output.setIoPolicy(ioPolicy_);
+    output.setCompressRolled(compressRolled_);
+    if (indexBytes_ > 0) {
+        output.setTimeIndex(indexBytes_, indexIntervalMs_);
+    }
 
-    // 创建后端用缓冲和缓冲数组
-    BufferPtr newBuffer1(new Buffer);
-    BufferPtr newBuffer2(new Buffer);
-    newBuffer1->bzero();
-    newBuffer2->bzero();
     BufferVector bufferToWrite; // 待写入本地文件的缓冲数组
-    bufferToWrite.reserve(16);
+    bufferToWrite.reserve(poolSize_);
+    BufferVector recordsToWrite; // 待格式化的延迟日志记录缓冲数组
+    recordsToWrite.reserve(poolSize_);
+    inFlight_.reserve(poolSize_);
+    auto lastCollect = chrono::steady_clock::now(); // 上一次收集线程局部暂存缓存的时间
+    auto lastReport = lastCollect;                  // 上一次报告指标的时间
 
     while (running_.load()) {
         latch_.countDown(); // 保证线程进入到循环，因为可能有一种情况，开始异步日志又马上结束，线程没来得及进入循环，后端无法拿到前端的数据进行写入
         // 单线程，不必考虑cond唤醒之后条件是否满足
-        assert(newBuffer1 && newBuffer1->length() == 0);
-        assert(newBuffer2 && newBuffer2->length() == 0);
         assert(bufferToWrite.empty());
 
-        // 临界区操作：交换缓存数组，移动前后端缓存
+        // 还有在途的写入时等待写入完成而不是cond_，完成的缓存在回调中归还缓存池，之后重新检查是否有写满的缓存
+        if (output.writesInFlight() > 0) {
+            bool idle;
+            {
+                lock_guard<mutex> lck(mutex_);
+                idle = buffers_.empty() && recordBuffers_.empty();
+            }
+            if (idle) {
+                output.waitWrites(flushInterval_ * 1000);
+                continue;
+            }
+        }
+
+        // 临界区操作：交换缓存数组，从缓存池补充前端缓存
         {
             unique_lock<mutex> lck(mutex_);
-            if (buffers_.empty()) {
+            if (buffers_.empty() && recordBuffers_.empty() && output.writesInFlight() == 0) {
                 // 日志量很少时，buffers_为空，等待一次刷新间隔进行唤醒
                 cond_.wait_for(lck, chrono::duration<int>{flushInterval_});
             }
-            buffers_.push_back(move(currentBuffer_));
-            currentBuffer_ = move(newBuffer1); // 移动buffer
+            YKLOG_PROF_SCOPE(kSwap); // 不包括等待cond_
+            // 磁盘跟不上、还有写入在途时不提交未写满的缓存，它只会排在在途写入之后，却提前多占一块缓存
+            bool backlog = output.writesInFlight() > 0;
+            if (currentBuffer_ && currentBuffer_->length() > 0 && !backlog) {
+                buffers_.push_back(move(currentBuffer_));
+            }
             bufferToWrite.swap(buffers_);
+            if (currentRecordBuffer_ && currentRecordBuffer_->length() > 0 && !backlog) {
+                recordBuffers_.push_back(move(currentRecordBuffer_));
+            }
+            recordsToWrite.swap(recordBuffers_);
+            if (!currentBuffer_) {
+                currentBuffer_ = takeEmptyBuffer(); // 池空时为空指针，由前端等待后端归还
+                markActive(currentBuffer_);
+            }
             if (!nextBuffer_) {
                 // nextBuffer不存在时进行补充
-                nextBuffer_ = move(newBuffer2);
+                nextBuffer_ = takeEmptyBuffer();
             }
         }
-
-        // 非临界区操作：写入本地文件
-        // 1. 日志待写入文件buffersToWrite队列超限,只保留两块缓存区，其余的丢弃
-        if (bufferToWrite.size() > 25) {
-            char buf[256];
-            snprintf(buf, sizeof(buf), "Dropped log messages at %s, %zd larger buffers\n", TimeStamp::now().toFormatString().c_str(), bufferToWrite.size() - 2);
-            fputs(buf, stderr);
-            output.append(buf, static_cast<int>(strlen(buf)));
-            bufferToWrite.erase(bufferToWrite.begin() + 2, bufferToWrite.end()); // unique_ptr会自动释放内存
+        poolCond_.notify_all(); // 前端可能正在等待新的currentBuffer_
+        int64_t depth = static_cast<int64_t>(bufferToWrite.size() + recordsToWrite.size());
+        if (depth > peakQueueDepth_.load(memory_order_relaxed)) {
+            peakQueueDepth_.store(depth, memory_order_relaxed);
         }
-        // 2.buffersToWrited队列中的日志消息交给后端写入
-        for (const auto &buffer : bufferToWrite) {
-            output.append(buffer->data(), buffer->length());
+        // 线程局部模式：距离上次收集超过刷新间隔时，收集各线程未写满的暂存缓存
+        if (threadLocalBuffer_) {
+            auto now = chrono::steady_clock::now();
+            if (now - lastCollect >= chrono::seconds(flushInterval_)) {
+                lastCollect = now;
+                collectStaging(bufferToWrite, false);
+            }
         }
-        // 3.将buffersToWrited队列中的buffer重新填充newBuffer1、newBuffer2
-        if (bufferToWrite.size() > 2) {
-            bufferToWrite.resize(2); // resize 会删除掉多余的元素
-            bufferToWrite.reserve(16);
+        YKLOG_PROF_TAKEN(bufferToWrite);
+
+        // 非临界区操作：写入本地文件
+        // 1. 报告前端丢弃的日志
+        reportDropped(output);
+        // 2.buffersToWrited队列中的日志消息整批交给后端写入，延迟日志记录先格式化再写入
+        // 3.延迟日志记录已格式化拷贝，直接归还缓存池
+        writeBatch(bufferToWrite, recordsToWrite, output);
+        // 4.定期把运行时指标写入日志
+        if (metricsInterval_ > 0) {
+            auto now = chrono::steady_clock::now();
+            if (now - lastReport >= chrono::seconds(metricsInterval_)) {
+                lastReport = now;
+                reportMetrics(output);
+            }
         }
-        if (!newBuffer1) {
-            assert(!bufferToWrite.empty());
-            newBuffer1 = move(bufferToWrite.back());
-            bufferToWrite.pop_back();
-            newBuffer1->reset();
+    }
+
+    // 退出前写入剩余的前端缓存，包括最后一次交换之后才写入的日志
+    {
+        unique_lock<mutex> lck(mutex_);
+        if (currentBuffer_ && currentBuffer_->length() > 0) {
+            buffers_.push_back(move(currentBuffer_));
+            currentBuffer_ = takeEmptyBuffer();
+            markActive(currentBuffer_);
         }
-        if (!newBuffer2) {
-            assert(!bufferToWrite.empty());
-            newBuffer2 = move(bufferToWrite.back());
-            bufferToWrite.pop_back();
-            newBuffer2->reset();
+        bufferToWrite.swap(buffers_);
+        if (currentRecordBuffer_) {
+            recordBuffers_.push_back(move(currentRecordBuffer_));
         }
-
-        bufferToWrite.clear();
-        output.flush();
+        recordsToWrite.swap(recordBuffers_);
     }
-
-    output.flush();
+    if (threadLocalBuffer_) {
+        collectStaging(bufferToWrite, true);
+    }
+    YKLOG_PROF_TAKEN(bufferToWrite);
+    reportDropped(output);
+    writeBatch(bufferToWrite, recordsToWrite, output);
+    // output析构时等待在途的写入完成，缓存全部归还缓存池
 }
 
-} // namespace myServer
\ No newline at end of file
+} // namespace myServer
@@ -1,4 +1,5 @@
 #include "CurrentThread.h"
+#include <pthread.h>
 #include <string>
 namespace myServer {
 namespace currentThread {
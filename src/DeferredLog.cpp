@@ -0,0 +1,133 @@
+#include "DeferredLog.h"
+#include <stdio.h>
+
+namespace myServer {
+extern Logger::OutputFunc g_output;
+
+namespace deferred {
+OutputFunc g_deferredOutput; // 记录的接收者，为空时在调用线程上立即格式化
+
+void setOutput(OutputFunc f) {
+    g_deferredOutput = f;
+}
+
+void Encoder::encode(const char *str, uint32_t len) {
+    if (static_cast<size_t>(end_ - cur_) < sizeof(len)) {
+        end_ = cur_;
+        return;
+    }
+    len = min(len, static_cast<uint32_t>(end_ - cur_ - sizeof(len))); // 空间不足时截断字符串
+    memcpy(cur_, &len, sizeof(len));
+    memcpy(cur_ + sizeof(len), str, len);
+    cur_ += sizeof(len) + len;
+}
+
+void output(const char *record, int len) {
+    if (g_deferredOutput) {
+        g_deferredOutput(record, len);
+    } else {
+        LogStream stream;
+        formatRecord(record, stream);
+        g_output(stream.buffer().data(), stream.buffer().length());
+    }
+}
+
+// 按记录中的类型解码一个参数并写入stream，数据不足时返回false
+static bool formatArg(ArgType type, const char *&p, const char *end, LogStream &stream) {
+    if (type == kString) {
+        uint32_t len;
+        if (static_cast<size_t>(end - p) < sizeof(len)) {
+            return false;
+        }
+        memcpy(&len, p, sizeof(len));
+        p += sizeof(len);
+        len = min(len, static_cast<uint32_t>(end - p));
+        stream.append(p, len);
+        p += len;
+        return true;
+    }
+    size_t size = type == kChar ? sizeof(char) : 8;
+    if (static_cast<size_t>(end - p) < size) {
+        return false;
+    }
+    switch (type) {
+    case kChar:
+        stream << *p;
+        break;
+    case kInt64: {
+        int64_t v;
+        memcpy(&v, p, sizeof(v));
+        stream << static_cast<long long>(v);
+        break;
+    }
+    case kUInt64: {
+        uint64_t v;
+        memcpy(&v, p, sizeof(v));
+        stream << static_cast<unsigned long long>(v);
+        break;
+    }
+    case kDouble: {
+        double v;
+        memcpy(&v, p, sizeof(v));
+        stream << v;
+        break;
+    }
+    case kPointer: {
+        const void *v;
+        memcpy(&v, p, sizeof(v));
+        stream << v;
+        break;
+    }
+    default:
+        return false;
+    }
+    p += size;
+    return true;
+}
+
+/** 将一条记录格式化为与Logger相同格式的日志行
+ * “时间 线程id 级别 [函数名] 消息 - 文件名:行号\n”，TRACE和DEBUG级别带函数名
+ * 格式串中的{}依次替换为参数，{{和}}分别输出{和}，参数不足时原样输出{}
+ */
+void formatRecord(const char *record, LogStream &stream) {
+    RecordHeader header;
+    memcpy(&header, record, sizeof(header));
+    const LogSite &site = *header.site;
+    const char *p = record + sizeof(header);
+    const char *end = record + header.size;
+    int numArgs = header.argTypes[0];
+    int argIndex = 0;
+
+    Logger::formatTime(stream, TimeStamp::fromNanoSeconds(header.nanoSeconds));
+    char tidBuf[32];
+    int tidLen = snprintf(tidBuf, sizeof(tidBuf), "%5d ", header.tid);
+    stream.append(tidBuf, tidLen);
+    stream.append(LogLevelName[site.level], 6);
+    if (site.level <= Logger::DEBUG) {
+        stream << site.func << ' ';
+    }
+
+    const char *fmt = site.format;
+    const char *literal = fmt;
+    for (; *fmt; ++fmt) {
+        if ((fmt[0] == '{' && fmt[1] == '{') || (fmt[0] == '}' && fmt[1] == '}')) {
+            stream.append(literal, fmt - literal + 1);
+            literal = ++fmt + 1;
+        } else if (fmt[0] == '{' && fmt[1] == '}') {
+            stream.append(literal, fmt - literal);
+            if (argIndex >= numArgs || !formatArg(header.argTypes[argIndex + 1], p, end, stream)) {
+                stream.append("{}", 2);
+            }
+            ++argIndex;
+            literal = ++fmt + 1;
+        }
+    }
+    stream.append(literal, fmt - literal);
+
+    Logger::SourceFile basename(site.file);
+    stream << " - ";
+    stream.append(basename.data(), basename.size());
+    stream << ':' << site.line << '\n';
+}
+} // namespace deferred
+} // namespace myServer
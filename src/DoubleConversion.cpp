@@ -0,0 +1,304 @@
+/** Grisu2，参考Florian Loitsch, "Printing Floating-Point Numbers Quickly and Accurately with Integers", PLDI 2010
+ * 1.把浮点数v表示为f * 2^e（DiyFp），并求出与相邻浮点数的中点m-、m+，区间(m-, m+)内的任何十进制数都能还原为v
+ * 2.从缓存表中取一个10^-K，使m+ * 10^-K的二进制指数落在[-60, -32]，这样整数部分能放进32位
+ * 3.从高位逐位生成m+ * 10^-K的十进制数字，剩余部分小于区间宽度时停止，得到最短的数字串
+ * 4.在区间内把最后一位向v靠近（GrisuRound），再按十进制指数排版
+ */
+#include "DoubleConversion.h"
+#include "IntegerConversion.h"
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+namespace myServer {
+namespace {
+// 不做规约的浮点数 f * 2^e
+struct DiyFp {
+    uint64_t f;
+    int e;
+};
+
+inline DiyFp operator-(DiyFp a, DiyFp b) { return DiyFp{a.f - b.f, a.e}; }
+// 只保留乘积的高64位，按第63位四舍五入
+inline DiyFp operator*(DiyFp a, DiyFp b) {
+    unsigned __int128 p = static_cast<unsigned __int128>(a.f) * b.f;
+    uint64_t h = static_cast<uint64_t>(p >> 64);
+    uint64_t l = static_cast<uint64_t>(p);
+    h += l >> 63;
+    return DiyFp{h, a.e + b.e + 64};
+}
+inline DiyFp normalize(DiyFp v) {
+    int shift = __builtin_clzll(v.f);
+    return DiyFp{v.f << shift, v.e - shift};
+}
+
+// 按IEEE 754的布局拆分浮点数，Bits为对应宽度的无符号整数
+template <typename Float, typename Bits, int kSignificandSize, int kExponentBias>
+struct Ieee {
+    static const Bits kHiddenBit = static_cast<Bits>(1) << kSignificandSize;
+    static const Bits kSignificandMask = kHiddenBit - 1;
+
+    static DiyFp toDiyFp(Float value) {
+        Bits u;
+        memcpy(&u, &value, sizeof(u));
+        Bits significand = u & kSignificandMask;
+        int biased = static_cast<int>((u & ~(static_cast<Bits>(1) << (sizeof(Bits) * 8 - 1))) >> kSignificandSize);
+        if (biased) {
+            return DiyFp{significand + kHiddenBit, biased - kExponentBias - kSignificandSize};
+        }
+        return DiyFp{significand, 1 - kExponentBias - kSignificandSize}; // 非规格化数
+    }
+    // 求v与相邻浮点数的中点，规格化后两者的指数相同
+    static void boundaries(DiyFp v, DiyFp *minus, DiyFp *plus) {
+        DiyFp pl = normalize(DiyFp{(v.f << 1) + 1, v.e - 1});
+        // v的尾数为2的幂时，与前一个浮点数的间隔只有后一个的一半
+        DiyFp mi = v.f == kHiddenBit ? DiyFp{(v.f << 2) - 1, v.e - 2} : DiyFp{(v.f << 1) - 1, v.e - 1};
+        mi.f <<= mi.e - pl.e;
+        mi.e = pl.e;
+        *minus = mi;
+        *plus = pl;
+    }
+};
+using DoubleBits = Ieee<double, uint64_t, 52, 1023>;
+using FloatBits = Ieee<float, uint32_t, 23, 127>;
+
+// 10^k的规格化近似值，k = -348 + 8 * i
+const DiyFp kCachedPowers[] = {
+    {0xfa8fd5a0081c0288ULL, -1220}, {0xbaaee17fa23ebf76ULL, -1193},
+    {0x8b16fb203055ac76ULL, -1166}, {0xcf42894a5dce35eaULL, -1140},
+    {0x9a6bb0aa55653b2dULL, -1113}, {0xe61acf033d1a45dfULL, -1087},
+    {0xab70fe17c79ac6caULL, -1060}, {0xff77b1fcbebcdc4fULL, -1034},
+    {0xbe5691ef416bd60cULL, -1007}, {0x8dd01fad907ffc3cULL, -980},
+    {0xd3515c2831559a83ULL, -954}, {0x9d71ac8fada6c9b5ULL, -927},
+    {0xea9c227723ee8bcbULL, -901}, {0xaecc49914078536dULL, -874},
+    {0x823c12795db6ce57ULL, -847}, {0xc21094364dfb5637ULL, -821},
+    {0x9096ea6f3848984fULL, -794}, {0xd77485cb25823ac7ULL, -768},
+    {0xa086cfcd97bf97f4ULL, -741}, {0xef340a98172aace5ULL, -715},
+    {0xb23867fb2a35b28eULL, -688}, {0x84c8d4dfd2c63f3bULL, -661},
+    {0xc5dd44271ad3cdbaULL, -635}, {0x936b9fcebb25c996ULL, -608},
+    {0xdbac6c247d62a584ULL, -582}, {0xa3ab66580d5fdaf6ULL, -555},
+    {0xf3e2f893dec3f126ULL, -529}, {0xb5b5ada8aaff80b8ULL, -502},
+    {0x87625f056c7c4a8bULL, -475}, {0xc9bcff6034c13053ULL, -449},
+    {0x964e858c91ba2655ULL, -422}, {0xdff9772470297ebdULL, -396},
+    {0xa6dfbd9fb8e5b88fULL, -369}, {0xf8a95fcf88747d94ULL, -343},
+    {0xb94470938fa89bcfULL, -316}, {0x8a08f0f8bf0f156bULL, -289},
+    {0xcdb02555653131b6ULL, -263}, {0x993fe2c6d07b7facULL, -236},
+    {0xe45c10c42a2b3b06ULL, -210}, {0xaa242499697392d3ULL, -183},
+    {0xfd87b5f28300ca0eULL, -157}, {0xbce5086492111aebULL, -130},
+    {0x8cbccc096f5088ccULL, -103}, {0xd1b71758e219652cULL, -77},
+    {0x9c40000000000000ULL, -50}, {0xe8d4a51000000000ULL, -24},
+    {0xad78ebc5ac620000ULL, 3}, {0x813f3978f8940984ULL, 30},
+    {0xc097ce7bc90715b3ULL, 56}, {0x8f7e32ce7bea5c70ULL, 83},
+    {0xd5d238a4abe98068ULL, 109}, {0x9f4f2726179a2245ULL, 136},
+    {0xed63a231d4c4fb27ULL, 162}, {0xb0de65388cc8ada8ULL, 189},
+    {0x83c7088e1aab65dbULL, 216}, {0xc45d1df942711d9aULL, 242},
+    {0x924d692ca61be758ULL, 269}, {0xda01ee641a708deaULL, 295},
+    {0xa26da3999aef774aULL, 322}, {0xf209787bb47d6b85ULL, 348},
+    {0xb454e4a179dd1877ULL, 375}, {0x865b86925b9bc5c2ULL, 402},
+    {0xc83553c5c8965d3dULL, 428}, {0x952ab45cfa97a0b3ULL, 455},
+    {0xde469fbd99a05fe3ULL, 481}, {0xa59bc234db398c25ULL, 508},
+    {0xf6c69a72a3989f5cULL, 534}, {0xb7dcbf5354e9beceULL, 561},
+    {0x88fcf317f22241e2ULL, 588}, {0xcc20ce9bd35c78a5ULL, 614},
+    {0x98165af37b2153dfULL, 641}, {0xe2a0b5dc971f303aULL, 667},
+    {0xa8d9d1535ce3b396ULL, 694}, {0xfb9b7cd9a4a7443cULL, 720},
+    {0xbb764c4ca7a44410ULL, 747}, {0x8bab8eefb6409c1aULL, 774},
+    {0xd01fef10a657842cULL, 800}, {0x9b10a4e5e9913129ULL, 827},
+    {0xe7109bfba19c0c9dULL, 853}, {0xac2820d9623bf429ULL, 880},
+    {0x80444b5e7aa7cf85ULL, 907}, {0xbf21e44003acdd2dULL, 933},
+    {0x8e679c2f5e44ff8fULL, 960}, {0xd433179d9c8cb841ULL, 986},
+    {0x9e19db92b4e31ba9ULL, 1013}, {0xeb96bf6ebadf77d9ULL, 1039},
+    {0xaf87023b9bf0ee6bULL, 1066},
+};
+const int kCachedPowersMinK = -348;
+const int kCachedPowersStep = 8;
+
+// 返回c = 10^k，使e + c.e + 64落在[-60, -32]，decimalExponent返回-k
+DiyFp cachedPower(int e, int *decimalExponent) {
+    double dk = (-61 - e) * 0.30102999566398114 + 347; // log10(2)
+    int k = static_cast<int>(dk);
+    if (dk - k > 0.0) {
+        ++k;
+    }
+    int index = (k >> 3) + 1;
+    *decimalExponent = -(kCachedPowersMinK + index * kCachedPowersStep);
+    return kCachedPowers[index];
+}
+
+// 在不越出区间的前提下，把最后一位向w靠近
+inline void grisuRound(char *buf, int len, uint64_t delta, uint64_t rest, uint64_t tenKappa, uint64_t wpw) {
+    while (rest < wpw && delta - rest >= tenKappa && (rest + tenKappa < wpw || wpw - rest > rest + tenKappa - wpw)) {
+        --buf[len - 1];
+        rest += tenKappa;
+    }
+}
+
+// 生成mp的十进制数字，误差不超过delta，K累加上被省略的低位数
+void digitGen(DiyFp w, DiyFp mp, uint64_t delta, char *buf, int *len, int *K) {
+    const DiyFp one{static_cast<uint64_t>(1) << -mp.e, mp.e};
+    const uint64_t wpw = (mp - w).f;
+    uint32_t p1 = static_cast<uint32_t>(mp.f >> -one.e); // 整数部分
+    uint64_t p2 = mp.f & (one.f - 1);                    // 小数部分
+    int kappa = countDigits(p1);
+    *len = 0;
+    while (kappa > 0) {
+        uint32_t d = static_cast<uint32_t>(p1 / kPowersOf10[kappa - 1]);
+        p1 = static_cast<uint32_t>(p1 % kPowersOf10[kappa - 1]);
+        if (d || *len) {
+            buf[(*len)++] = static_cast<char>('0' + d);
+        }
+        --kappa;
+        uint64_t rest = (static_cast<uint64_t>(p1) << -one.e) + p2;
+        if (rest <= delta) {
+            *K += kappa;
+            grisuRound(buf, *len, delta, rest, kPowersOf10[kappa] << -one.e, wpw);
+            return;
+        }
+    }
+    for (;;) {
+        p2 *= 10;
+        delta *= 10;
+        char d = static_cast<char>(p2 >> -one.e);
+        if (d || *len) {
+            buf[(*len)++] = static_cast<char>('0' + d);
+        }
+        p2 &= one.f - 1;
+        --kappa;
+        if (p2 < delta) {
+            *K += kappa;
+            grisuRound(buf, *len, delta, p2, one.f, -kappa < 20 ? wpw * kPowersOf10[-kappa] : 0);
+            return;
+        }
+    }
+}
+
+// 输出十进制数字串digits和指数K，value = digits * 10^K
+template <typename Bits, typename Float>
+void grisu2(Float value, char *digits, int *len, int *K) {
+    DiyFp v = Bits::toDiyFp(value);
+    DiyFp minus, plus;
+    Bits::boundaries(v, &minus, &plus);
+    DiyFp c = cachedPower(plus.e, K);
+    DiyFp w = normalize(v) * c;
+    DiyFp wp = plus * c;
+    DiyFp wm = minus * c;
+    ++wm.f; // 乘法有1ulp的误差，区间两端各收缩1保证结果仍在区间内
+    --wp.f;
+    digitGen(w, wp, wp.f - wm.f, digits, len, K);
+}
+
+// 写入e+XX形式的指数，至少两位
+char *writeExponent(char *p, int exp) {
+    *p++ = 'e';
+    if (exp < 0) {
+        *p++ = '-';
+        exp = -exp;
+    } else {
+        *p++ = '+';
+    }
+    if (exp >= 100) {
+        *p++ = static_cast<char>('0' + exp / 100);
+        exp %= 100;
+    }
+    *p++ = static_cast<char>('0' + exp / 10);
+    *p++ = static_cast<char>('0' + exp % 10);
+    return p;
+}
+
+// 把len位数字digits * 10^K排版到p，返回结束位置
+char *prettify(char *p, const char *digits, int len, int K) {
+    const int kk = len + K; // 10^(kk - 1) <= value < 10^kk
+    if (K >= 0 && kk <= 17) {
+        // 整数：1234e2 -> 123400
+        memcpy(p, digits, len);
+        memset(p + len, '0', K);
+        return p + kk;
+    } else if (kk > 0 && kk <= 17) {
+        // 1234e-2 -> 12.34
+        memcpy(p, digits, kk);
+        p[kk] = '.';
+        memcpy(p + kk + 1, digits + kk, len - kk);
+        return p + len + 1;
+    } else if (kk > -4 && kk <= 0) {
+        // 1234e-6 -> 0.001234
+        p[0] = '0';
+        p[1] = '.';
+        memset(p + 2, '0', -kk);
+        memcpy(p + 2 - kk, digits, len);
+        return p + 2 - kk + len;
+    }
+    // 1234e30 -> 1.234e+33
+    *p++ = digits[0];
+    if (len > 1) {
+        *p++ = '.';
+        memcpy(p, digits + 1, len - 1);
+        p += len - 1;
+    }
+    return writeExponent(p, kk - 1);
+}
+
+// nan、inf和0的特殊处理，返回0表示value是普通的非零数
+template <typename Float>
+size_t formatSpecial(char *buf, Float value) {
+    if (isnan(value)) {
+        memcpy(buf, "nan", 3);
+        return 3;
+    }
+    char *p = buf;
+    if (signbit(value)) {
+        *p++ = '-';
+    }
+    if (isinf(value)) {
+        memcpy(p, "inf", 3);
+        return p - buf + 3;
+    }
+    if (value == 0) {
+        *p = '0';
+        return p - buf + 1;
+    }
+    return 0;
+}
+
+template <typename Bits, typename Float>
+size_t formatShortest(char *buf, Float value) {
+    if (size_t len = formatSpecial(buf, value)) {
+        return len;
+    }
+    char *p = buf;
+    if (value < 0) {
+        *p++ = '-';
+        value = -value;
+    }
+    char digits[24];
+    int len, K;
+    grisu2<Bits>(value, digits, &len, &K);
+    return prettify(p, digits, len, K) - buf;
+}
+
+} // namespace
+
+size_t formatDouble(char *buf, double value) {
+    return formatShortest<DoubleBits>(buf, value);
+}
+
+size_t formatFloat(char *buf, float value) {
+    return formatShortest<FloatBits>(buf, value);
+}
+
+size_t formatFixed(char *buf, double value, int precision) {
+    if (precision < 0 || precision > kMaxFixedPrecision || !(fabs(value) < 1e18 / kPowersOf10[precision])) {
+        return formatDouble(buf, value); // 也处理了nan和inf
+    }
+    char *p = buf;
+    if (signbit(value)) {
+        *p++ = '-';
+    }
+    uint64_t scaled = static_cast<uint64_t>(fabs(value) * kPowersOf10[precision] + 0.5);
+    p += formatInteger(p, scaled / kPowersOf10[precision]);
+    if (precision > 0) {
+        *p++ = '.';
+        formatFixedWidth(p, static_cast<uint32_t>(scaled % kPowersOf10[precision]), precision);
+        p += precision;
+    }
+    return p - buf;
+}
+} // namespace myServer
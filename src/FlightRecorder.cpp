@@ -0,0 +1,320 @@
+#include "FlightRecorder.h"
+#include "Logger.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <mutex>
+#include <new>
+#include <signal.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace myServer {
+namespace {
+const char kMagic[8] = {'Y', 'K', 'F', 'L', 'I', 'G', 'H', 'T'};
+const uint32_t kVersion = 1;
+const size_t kPageSize = 4096;
+const int kCrashSignals[] = {SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT};
+const int kNumCrashSignals = sizeof(kCrashSignals) / sizeof(kCrashSignals[0]);
+
+// recover()按文件头中的偏移读取cur_，要求FixedBuffer的布局是数据区之后紧跟cur_
+static_assert(sizeof(FlightRecorder::Buffer) == kLargeBuffer + sizeof(char *), "FixedBuffer layout is data_ followed by cur_");
+
+std::mutex g_handlerMutex;                         // 保护安装和卸载
+std::atomic<FlightRecorder *> g_crashRecorder(nullptr); // 信号处理函数使用的实例
+struct sigaction g_oldActions[kNumCrashSignals];  // 安装前的处理方式
+bool g_installed = false;
+
+size_t roundUp(size_t n) {
+    return (n + kPageSize - 1) / kPageSize * kPageSize;
+}
+
+bool validHeader(const FlightRecorder::Header *header, size_t fileSize) {
+    return fileSize >= sizeof(FlightRecorder::Header) && memcmp(header->magic, kMagic, sizeof(kMagic)) == 0 && header->version == kVersion &&
+           header->slotCount <= FlightRecorder::kMaxSlots && header->dataOffset >= sizeof(FlightRecorder::Header) &&
+           header->cursorOffset + sizeof(uint64_t) <= header->slotSize && header->bufferSize <= header->cursorOffset &&
+           header->dataOffset + header->slotCount * header->slotSize <= fileSize;
+}
+
+// 槽中缓存已写入的长度，cur_不在缓存范围内（被破坏或正在构造）时返回-1
+int64_t slotLength(const char *base, const FlightRecorder::Header *header, int index) {
+    const char *slot = base + header->dataOffset + index * header->slotSize;
+    uint64_t cursor;
+    memcpy(&cursor, slot + header->cursorOffset, sizeof(cursor));
+    uint64_t start = header->baseAddress + header->dataOffset + index * header->slotSize;
+    if (cursor < start || cursor - start > header->bufferSize) {
+        return -1;
+    }
+    return static_cast<int64_t>(cursor - start);
+}
+
+// 活跃且有内容的槽按序号排序，返回个数；只使用栈上的数组，可以在信号处理函数中调用
+int activeSlots(const char *base, const FlightRecorder::Header *header, int order[FlightRecorder::kMaxSlots]) {
+    int n = 0;
+    for (int i = 0; i < static_cast<int>(header->slotCount); ++i) {
+        if (header->slots[i].state.load(std::memory_order_acquire) != FlightRecorder::kActive || slotLength(base, header, i) <= 0) {
+            continue;
+        }
+        uint64_t seq = header->slots[i].seq.load(std::memory_order_relaxed);
+        int j = n++;
+        for (; j > 0 && header->slots[order[j - 1]].seq.load(std::memory_order_relaxed) > seq; --j) {
+            order[j] = order[j - 1];
+        }
+        order[j] = i;
+    }
+    return n;
+}
+
+int64_t writeTail(const char *base, const FlightRecorder::Header *header, int fd) {
+    int order[FlightRecorder::kMaxSlots];
+    int n = activeSlots(base, header, order);
+    int64_t total = 0;
+    for (int i = 0; i < n; ++i) {
+        int64_t length = slotLength(base, header, order[i]);
+        const char *data = base + header->dataOffset + order[i] * header->slotSize;
+        for (int64_t written = 0; written < length;) {
+            ssize_t ret = ::write(fd, data + written, length - written);
+            if (ret < 0 && errno == EINTR) {
+                continue;
+            }
+            if (ret <= 0) {
+                return total;
+            }
+            written += ret;
+            total += ret;
+        }
+    }
+    return total;
+}
+
+// 只读映射一个已有的文件，recover()和describe()使用
+class MappedFile : noncopyable {
+  public:
+    MappedFile(const string &path, string *error) : base_(nullptr), size_(0) {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        struct stat st;
+        if (fd < 0 || ::fstat(fd, &st) != 0) {
+            *error = path + ": " + strerror_tl(errno);
+        } else if (static_cast<size_t>(st.st_size) < sizeof(FlightRecorder::Header)) {
+            *error = path + ": not a flight recorder file";
+        } else {
+            void *base = ::mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+            if (base == MAP_FAILED) {
+                *error = path + ": mmap failed " + strerror_tl(errno);
+            } else {
+                base_ = static_cast<const char *>(base);
+                size_ = st.st_size;
+                if (!validHeader(header(), size_)) {
+                    *error = path + ": not a flight recorder file";
+                    ::munmap(const_cast<char *>(base_), size_);
+                    base_ = nullptr;
+                }
+            }
+        }
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+    ~MappedFile() {
+        if (base_) {
+            ::munmap(const_cast<char *>(base_), size_);
+        }
+    }
+    bool valid() const { return base_ != nullptr; }
+    const char *base() const { return base_; }
+    const FlightRecorder::Header *header() const { return reinterpret_cast<const FlightRecorder::Header *>(base_); }
+
+  private:
+    const char *base_;
+    size_t size_;
+};
+} // namespace
+
+FlightRecorder::FlightRecorder(const string &path, int fd, char *base, size_t size) : path_(path),
+                                                                                      tailPath_(path + ".tail"),
+                                                                                      fd_(fd),
+                                                                                      base_(base),
+                                                                                      size_(size),
+                                                                                      header_(reinterpret_cast<Header *>(base)) {
+}
+
+FlightRecorder *FlightRecorder::create(const string &path, int slots, const string &basename) {
+    if (slots > kMaxSlots) {
+        fprintf(stderr, "FlightRecorder %s: %d buffers, at most %d\n", path.c_str(), slots, kMaxSlots);
+        return nullptr;
+    }
+    // 上一次的进程没有经过信号处理就退出时，先把文件中的尾部取出来，避免被这一次覆盖
+    string error;
+    {
+        MappedFile old(path, &error);
+        if (old.valid() && old.header()->state.load() == kRunning) {
+            int tailFd = ::open((path + ".tail").c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+            if (tailFd >= 0) {
+                int64_t bytes = writeTail(old.base(), old.header(), tailFd);
+                ::close(tailFd);
+                if (bytes > 0) {
+                    fprintf(stderr, "FlightRecorder %s: recovered %" PRId64 " bytes left by pid %d to %s.tail\n", path.c_str(), bytes, old.header()->pid,
+                            path.c_str());
+                }
+            }
+        }
+    }
+
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        fprintf(stderr, "FlightRecorder open %s failed %s\n", path.c_str(), strerror_tl(errno));
+        return nullptr;
+    }
+    size_t dataOffset = roundUp(sizeof(Header));
+    size_t slotSize = roundUp(sizeof(Buffer));
+    size_t size = dataOffset + slots * slotSize;
+    // 先截断为0，丢弃上一次的内容；预分配所有块，避免写入映射时因空间不足触发SIGBUS
+    int err = ::ftruncate(fd, 0) == 0 ? ::posix_fallocate(fd, 0, size) : errno;
+    if (err != 0) {
+        fprintf(stderr, "FlightRecorder allocate %s failed %s\n", path.c_str(), strerror_tl(err));
+        ::close(fd);
+        return nullptr;
+    }
+    void *base = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        fprintf(stderr, "FlightRecorder mmap %s failed %s\n", path.c_str(), strerror_tl(errno));
+        ::close(fd);
+        return nullptr;
+    }
+
+    Header *header = new (base) Header;
+    memset(static_cast<void *>(header), 0, dataOffset);
+    memcpy(header->magic, kMagic, sizeof(kMagic));
+    header->version = kVersion;
+    header->slotCount = slots;
+    header->pid = ::getpid();
+    header->slotSize = slotSize;
+    header->dataOffset = dataOffset;
+    header->bufferSize = kLargeBuffer;
+    header->cursorOffset = sizeof(Buffer) - sizeof(char *);
+    header->baseAddress = reinterpret_cast<uintptr_t>(base);
+    header->nextSeq.store(1);
+    header->startTime = ::time(nullptr);
+    snprintf(header->basename, sizeof(header->basename), "%s", basename.c_str());
+    FlightRecorder *recorder = new FlightRecorder(path, fd, static_cast<char *>(base), size);
+    for (int i = 0; i < slots; ++i) {
+        Buffer *buffer = new (recorder->buffer(i)) Buffer;
+        buffer->bzero(); // 启动时就分配好所有页，写入时不再缺页
+    }
+    header->state.store(kRunning);
+    return recorder;
+}
+
+FlightRecorder::~FlightRecorder() {
+    {
+        std::lock_guard<std::mutex> lck(g_handlerMutex);
+        if (g_installed && g_crashRecorder.load() == this) {
+            g_crashRecorder.store(nullptr);
+            for (int i = 0; i < kNumCrashSignals; ++i) {
+                ::sigaction(kCrashSignals[i], &g_oldActions[i], nullptr);
+            }
+            g_installed = false;
+        }
+    }
+    ::munmap(base_, size_);
+    ::close(fd_);
+}
+
+void FlightRecorder::activate(const Buffer *buffer) {
+    Slot &slot = header_->slots[(reinterpret_cast<const char *>(buffer) - base_ - header_->dataOffset) / header_->slotSize];
+    slot.seq.store(header_->nextSeq.fetch_add(1, std::memory_order_relaxed), std::memory_order_relaxed);
+    slot.state.store(kActive, std::memory_order_release);
+}
+
+void FlightRecorder::release(const Buffer *buffer) {
+    Slot &slot = header_->slots[(reinterpret_cast<const char *>(buffer) - base_ - header_->dataOffset) / header_->slotSize];
+    slot.state.store(kFree, std::memory_order_release);
+}
+
+void FlightRecorder::setStopped() {
+    header_->state.store(kStopped);
+}
+
+int64_t FlightRecorder::drain(int fd) const {
+    return writeTail(base_, header_, fd);
+}
+
+void FlightRecorder::installCrashHandler() {
+    std::lock_guard<std::mutex> lck(g_handlerMutex);
+    g_crashRecorder.store(this);
+    if (g_installed) {
+        return;
+    }
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = crashHandler;
+    sigemptyset(&action.sa_mask);
+    for (int i = 0; i < kNumCrashSignals; ++i) {
+        ::sigaction(kCrashSignals[i], &action, &g_oldActions[i]);
+    }
+    g_installed = true;
+}
+
+/** 信号处理函数，只调用异步信号安全的函数
+ * 只有第一个进入的线程写尾部，然后恢复原来的处理方式并重新触发信号：
+ * 原来是默认处理时，信号处理函数返回后进程按该信号的默认方式终止（产生core）；原来有处理函数时交给它处理
+ */
+void FlightRecorder::crashHandler(int sig) {
+    int savedErrno = errno;
+    FlightRecorder *recorder = g_crashRecorder.exchange(nullptr);
+    if (recorder) {
+        int fd = ::open(recorder->tailPath_.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (fd >= 0) {
+            recorder->drain(fd);
+            ::close(fd);
+        }
+        recorder->header_->state.store(kDrained);
+    }
+    for (int i = 0; i < kNumCrashSignals; ++i) {
+        if (kCrashSignals[i] == sig) {
+            ::sigaction(sig, &g_oldActions[i], nullptr);
+        }
+    }
+    errno = savedErrno;
+    ::raise(sig);
+}
+
+int64_t FlightRecorder::recover(const string &path, int fd, string *error) {
+    MappedFile file(path, error);
+    if (!file.valid()) {
+        return -1;
+    }
+    return writeTail(file.base(), file.header(), fd);
+}
+
+bool FlightRecorder::describe(const string &path, FILE *out, string *error) {
+    MappedFile file(path, error);
+    if (!file.valid()) {
+        return false;
+    }
+    const Header *header = file.header();
+    static const char *const kStateNames[] = {"running", "stopped", "drained"};
+    uint32_t state = header->state.load();
+    char startTime[32];
+    time_t start = header->startTime;
+    struct tm tm;
+    strftime(startTime, sizeof(startTime), "%Y%m%d %H:%M:%S", gmtime_r(&start, &tm));
+    fprintf(out, "%s\nbasename %s, pid %d, started %sZ, state %s, %u buffers of %" PRIu64 " bytes, next seq %" PRIu64 "\n", path.c_str(),
+            header->basename, header->pid, startTime, state < 3 ? kStateNames[state] : "unknown", header->slotCount, header->bufferSize,
+            header->nextSeq.load());
+    int order[kMaxSlots];
+    int n = activeSlots(file.base(), header, order);
+    int64_t total = 0;
+    fprintf(out, "%8s %12s %12s\n", "slot", "seq", "bytes");
+    for (int i = 0; i < n; ++i) {
+        int64_t length = slotLength(file.base(), header, order[i]);
+        fprintf(out, "%8d %12" PRIu64 " %12" PRId64 "\n", order[i], header->slots[order[i]].seq.load(), length);
+        total += length;
+    }
+    fprintf(out, "%d unflushed buffers, %" PRId64 " bytes%s\n", n, total, state == kStopped ? " (stopped cleanly, nothing to recover)" : "");
+    return true;
+}
+} // namespace myServer
@@ -0,0 +1,160 @@
+#include "IoUring.h"
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace myServer {
+
+IoUring::IoUring(unsigned entries) : ringFd_(-1), sqEntries_(0), ring_(MAP_FAILED), ringSize_(0), sqes_(static_cast<struct io_uring_sqe *>(MAP_FAILED)), sqesSize_(0),
+                                     sqHead_(nullptr), sqTail_(nullptr), sqMask_(0), sqLocalTail_(0), sqSubmitted_(0),
+                                     cqHead_(nullptr), cqTail_(nullptr), cqMask_(0), cqes_(nullptr) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int fd = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+    if (fd < 0) {
+        return;
+    }
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_EXT_ARG)) {
+        ::close(fd);
+        errno = EOPNOTSUPP;
+        return;
+    }
+    size_t sqSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    size_t cqSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    ringSize_ = sqSize > cqSize ? sqSize : cqSize;
+    ring_ = ::mmap(nullptr, ringSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    sqesSize_ = params.sq_entries * sizeof(struct io_uring_sqe);
+    void *sqes = ::mmap(nullptr, sqesSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (ring_ == MAP_FAILED || sqes == MAP_FAILED) {
+        int err = errno;
+        if (ring_ != MAP_FAILED) {
+            ::munmap(ring_, ringSize_);
+            ring_ = MAP_FAILED;
+        }
+        if (sqes != MAP_FAILED) {
+            ::munmap(sqes, sqesSize_);
+        }
+        ::close(fd);
+        errno = err;
+        return;
+    }
+    char *base = static_cast<char *>(ring_);
+    sqes_ = static_cast<struct io_uring_sqe *>(sqes);
+    sqHead_ = reinterpret_cast<unsigned *>(base + params.sq_off.head);
+    sqTail_ = reinterpret_cast<unsigned *>(base + params.sq_off.tail);
+    sqMask_ = *reinterpret_cast<unsigned *>(base + params.sq_off.ring_mask);
+    sqLocalTail_ = sqSubmitted_ = *sqTail_;
+    // 提交项在sqes_中的位置与队列位置一一对应，索引数组只需初始化一次
+    unsigned *array = reinterpret_cast<unsigned *>(base + params.sq_off.array);
+    for (unsigned i = 0; i < params.sq_entries; ++i) {
+        array[i] = i;
+    }
+    cqHead_ = reinterpret_cast<unsigned *>(base + params.cq_off.head);
+    cqTail_ = reinterpret_cast<unsigned *>(base + params.cq_off.tail);
+    cqMask_ = *reinterpret_cast<unsigned *>(base + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<struct io_uring_cqe *>(base + params.cq_off.cqes);
+    sqEntries_ = params.sq_entries;
+    ringFd_ = fd;
+}
+
+IoUring::~IoUring() {
+    if (ringFd_ >= 0) {
+        ::munmap(sqes_, sqesSize_);
+        ::munmap(ring_, ringSize_);
+        ::close(ringFd_);
+    }
+}
+
+bool IoUring::available() {
+    static const bool ok = [] {
+        IoUring ring(4);
+        if (!ring.valid()) {
+            fprintf(stderr, "io_uring unavailable (%s), falling back to write\n", strerror(errno));
+        }
+        return ring.valid();
+    }();
+    return ok;
+}
+
+struct io_uring_sqe *IoUring::getSqe() {
+    unsigned head = __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+    if (sqLocalTail_ - head >= sqEntries_) {
+        return nullptr;
+    }
+    struct io_uring_sqe *sqe = &sqes_[sqLocalTail_ & sqMask_];
+    ++sqLocalTail_;
+    memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+void IoUring::prepWrite(struct io_uring_sqe *sqe, int fd, const void *buf, unsigned len, uint64_t offset, uint64_t userData) {
+    sqe->opcode = IORING_OP_WRITE;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uint64_t>(buf);
+    sqe->len = len;
+    sqe->off = offset;
+    sqe->user_data = userData;
+}
+
+void IoUring::prepFsync(struct io_uring_sqe *sqe, int fd, bool dataOnly, uint64_t userData) {
+    sqe->opcode = IORING_OP_FSYNC;
+    sqe->fd = fd;
+    sqe->fsync_flags = dataOnly ? IORING_FSYNC_DATASYNC : 0;
+    sqe->user_data = userData;
+}
+
+int IoUring::enter(unsigned toSubmit, unsigned minComplete, unsigned flags, const void *arg, size_t argSize) {
+    int ret = static_cast<int>(::syscall(__NR_io_uring_enter, ringFd_, toSubmit, minComplete, flags, arg, argSize));
+    return ret < 0 ? -errno : ret;
+}
+
+int IoUring::submit() {
+    unsigned toSubmit = sqLocalTail_ - sqSubmitted_;
+    if (toSubmit == 0) {
+        return 0;
+    }
+    __atomic_store_n(sqTail_, sqLocalTail_, __ATOMIC_RELEASE);
+    int ret;
+    do {
+        ret = enter(toSubmit, 0, 0, nullptr, _NSIG / 8);
+    } while (ret == -EINTR);
+    if (ret > 0) {
+        sqSubmitted_ += ret;
+    }
+    return ret;
+}
+
+int IoUring::wait(int timeoutMs) {
+    unsigned toSubmit = sqLocalTail_ - sqSubmitted_;
+    __atomic_store_n(sqTail_, sqLocalTail_, __ATOMIC_RELEASE);
+    struct __kernel_timespec ts;
+    ts.tv_sec = timeoutMs / 1000;
+    ts.tv_nsec = static_cast<long long>(timeoutMs % 1000) * 1000000;
+    struct io_uring_getevents_arg arg;
+    memset(&arg, 0, sizeof(arg));
+    arg.sigmask_sz = _NSIG / 8;
+    arg.ts = timeoutMs < 0 ? 0 : reinterpret_cast<uint64_t>(&ts);
+    int ret = enter(toSubmit, 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+    if (ret > 0) {
+        sqSubmitted_ += ret;
+    }
+    return ret < 0 ? ret : 0;
+}
+
+bool IoUring::peek(uint64_t *userData, int *res) {
+    unsigned head = *cqHead_;
+    if (head == __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE)) {
+        return false;
+    }
+    const struct io_uring_cqe &cqe = cqes_[head & cqMask_];
+    *userData = cqe.user_data;
+    *res = cqe.res;
+    __atomic_store_n(cqHead_, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+} // namespace myServer
@@ -0,0 +1,485 @@
+#include "LogArchive.h"
+#include "Logger.h"
+#include "Lz4.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace myServer {
+namespace {
+const char kMagic[4] = {'Y', 'K', 'L', 'Z'};
+const char kIndexMagic[4] = {'Y', 'K', 'L', 'I'};
+const char kFrameMagic[4] = {'Y', 'K', 'L', 'F'};
+const uint32_t kVersion = 1;
+const size_t kHeaderSize = 8;      // 文件头
+const size_t kBlockHeaderSize = 8; // 块头
+const size_t kIndexEntrySize = 32; // 索引项
+const size_t kFooterSize = 16;     // 文件尾
+
+inline void put32(char *p, uint32_t v) {
+    for (int i = 0; i < 4; ++i) {
+        p[i] = static_cast<char>(v >> (8 * i));
+    }
+}
+inline void put64(char *p, uint64_t v) {
+    for (int i = 0; i < 8; ++i) {
+        p[i] = static_cast<char>(v >> (8 * i));
+    }
+}
+inline uint32_t get32(const char *p) {
+    uint32_t v = 0;
+    for (int i = 3; i >= 0; --i) {
+        v = (v << 8) | static_cast<unsigned char>(p[i]);
+    }
+    return v;
+}
+inline uint64_t get64(const char *p) {
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; --i) {
+        v = (v << 8) | static_cast<unsigned char>(p[i]);
+    }
+    return v;
+}
+
+// 帧数据的校验和：每次取8字节乘法混合，只用于发现掉电后不完整的帧，不抵抗刻意的篡改
+uint32_t checksum(const char *data, size_t len) {
+    const uint64_t kPrime = 0x9E3779B185EBCA87ULL;
+    uint64_t h = len * kPrime;
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t v;
+        memcpy(&v, data + i, 8);
+        h = (h ^ (v * kPrime)) * kPrime;
+        h ^= h >> 29;
+    }
+    for (; i < len; ++i) {
+        h = (h ^ static_cast<unsigned char>(data[i])) * kPrime;
+    }
+    h ^= h >> 32;
+    return static_cast<uint32_t>(h);
+}
+
+// 读满len字节，文件不够长或出错时返回false
+bool preadAll(int fd, char *buf, size_t len, off_t offset) {
+    while (len > 0) {
+        ssize_t n = ::pread(fd, buf, len, offset);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        buf += n;
+        len -= n;
+        offset += n;
+    }
+    return true;
+}
+} // namespace
+
+LogArchiveWriter::LogArchiveWriter(const string &filename)
+    : fd_(::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)), finished_(false), failed_(false),
+      compressed_(kBlockHeaderSize + lz4::compressBound(kBlockSize)), rawBytes_(0), compressedBytes_(0) {
+    if (fd_ < 0) {
+        fprintf(stderr, "LogArchiveWriter open %s failed %s\n", filename.c_str(), strerror_tl(errno));
+        return;
+    }
+    pending_.reserve(kBlockSize);
+    char header[kHeaderSize];
+    memcpy(header, kMagic, 4);
+    put32(header + 4, kVersion);
+    writeAll(header, sizeof(header));
+}
+
+LogArchiveWriter::~LogArchiveWriter() {
+    if (fd_ >= 0) {
+        finish();
+        ::close(fd_);
+    }
+}
+
+void LogArchiveWriter::append(const char *data, size_t len) {
+    rawBytes_ += len;
+    while (len > 0) {
+        size_t n = std::min(len, kBlockSize - pending_.size());
+        pending_.insert(pending_.end(), data, data + n);
+        data += n;
+        len -= n;
+        if (pending_.size() == kBlockSize) {
+            // 在最后一个完整行之后切分，剩下的半行留到下一块；一整块都没有换行时直接切分
+            const char *newline = static_cast<const char *>(::memrchr(pending_.data(), '\n', kBlockSize));
+            size_t cut = newline ? newline - pending_.data() + 1 : kBlockSize;
+            writeBlock(pending_.data(), cut);
+            pending_.erase(pending_.begin(), pending_.begin() + cut);
+        }
+    }
+}
+
+void LogArchiveWriter::writeBlock(const char *data, size_t len) {
+    IndexEntry entry = {static_cast<uint64_t>(compressedBytes_), static_cast<uint32_t>(len), 0, 0, 0};
+    // 每行开头的时间，取最小和最大值
+    const char *end = data + len;
+    for (const char *line = data; line < end;) {
+        TimeStamp ts;
+        if (TimeStamp::parse(line, end - line, &ts) > 0) {
+            int64_t t = ts.nanoSecondsSinceEpoch();
+            if (entry.firstTime == 0 || t < entry.firstTime) {
+                entry.firstTime = t;
+            }
+            if (t > entry.lastTime) {
+                entry.lastTime = t;
+            }
+        }
+        const char *newline = static_cast<const char *>(memchr(line, '\n', end - line));
+        line = newline ? newline + 1 : end;
+    }
+
+    char *out = compressed_.data();
+    size_t n = lz4::compress(data, len, out + kBlockHeaderSize, compressed_.size() - kBlockHeaderSize);
+    if (n >= len) { // 不可压缩的数据原样保存
+        memcpy(out + kBlockHeaderSize, data, len);
+        n = len;
+    }
+    entry.compressedSize = static_cast<uint32_t>(n);
+    put32(out, entry.rawSize);
+    put32(out + 4, entry.compressedSize);
+    if (writeAll(out, kBlockHeaderSize + n)) {
+        index_.push_back(entry);
+    }
+}
+
+bool LogArchiveWriter::writeAll(const char *data, size_t len) {
+    if (failed_) {
+        return false;
+    }
+    while (len > 0) {
+        ssize_t n = ::write(fd_, data, len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            fprintf(stderr, "LogArchiveWriter write failed %s\n", strerror_tl(errno));
+            failed_ = true;
+            return false;
+        }
+        data += n;
+        len -= n;
+        compressedBytes_ += n;
+    }
+    return true;
+}
+
+bool LogArchiveWriter::finish() {
+    if (fd_ < 0) {
+        return false;
+    }
+    if (finished_) {
+        return !failed_;
+    }
+    finished_ = true;
+    if (!pending_.empty()) {
+        writeBlock(pending_.data(), pending_.size());
+        pending_.clear();
+    }
+    std::vector<char> index(index_.size() * kIndexEntrySize + kFooterSize);
+    char *p = index.data();
+    for (const IndexEntry &entry : index_) {
+        put64(p, entry.offset);
+        put32(p + 8, entry.rawSize);
+        put32(p + 12, entry.compressedSize);
+        put64(p + 16, static_cast<uint64_t>(entry.firstTime));
+        put64(p + 24, static_cast<uint64_t>(entry.lastTime));
+        p += kIndexEntrySize;
+    }
+    put64(p, static_cast<uint64_t>(compressedBytes_));
+    put32(p + 8, static_cast<uint32_t>(index_.size()));
+    memcpy(p + 12, kIndexMagic, 4);
+    writeAll(index.data(), index.size());
+    // 落盘后才能删除原文件；归档很少再读，不占用页缓存
+    ::fdatasync(fd_);
+    ::posix_fadvise(fd_, 0, 0, POSIX_FADV_DONTNEED);
+    return !failed_;
+}
+
+LogArchiveReader::LogArchiveReader(const string &filename)
+    : fd_(::open(filename.c_str(), O_RDONLY | O_CLOEXEC)), valid_(false), rawSize_(0) {
+    struct stat st;
+    if (fd_ < 0 || ::fstat(fd_, &st) != 0 || st.st_size < static_cast<off_t>(kHeaderSize + kFooterSize)) {
+        return;
+    }
+    char header[kHeaderSize];
+    char footer[kFooterSize];
+    if (!preadAll(fd_, header, sizeof(header), 0) || memcmp(header, kMagic, 4) != 0 || get32(header + 4) != kVersion ||
+        !preadAll(fd_, footer, sizeof(footer), st.st_size - kFooterSize) || memcmp(footer + 12, kIndexMagic, 4) != 0) {
+        return;
+    }
+    uint64_t indexOffset = get64(footer);
+    uint32_t count = get32(footer + 8);
+    if (indexOffset < kHeaderSize || indexOffset + static_cast<uint64_t>(count) * kIndexEntrySize + kFooterSize != static_cast<uint64_t>(st.st_size)) {
+        return;
+    }
+    std::vector<char> index(static_cast<size_t>(count) * kIndexEntrySize);
+    if (!preadAll(fd_, index.data(), index.size(), indexOffset)) {
+        return;
+    }
+    blocks_.reserve(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        const char *p = index.data() + i * kIndexEntrySize;
+        Block block;
+        block.offset = static_cast<off_t>(get64(p));
+        block.rawSize = get32(p + 8);
+        block.compressedSize = get32(p + 12);
+        block.rawOffset = rawSize_;
+        block.first = TimeStamp::fromNanoSeconds(static_cast<int64_t>(get64(p + 16)));
+        block.last = TimeStamp::fromNanoSeconds(static_cast<int64_t>(get64(p + 24)));
+        if (block.offset < static_cast<off_t>(kHeaderSize) ||
+            static_cast<uint64_t>(block.offset) + kBlockHeaderSize + block.compressedSize > indexOffset ||
+            block.compressedSize > block.rawSize) {
+            blocks_.clear();
+            return;
+        }
+        rawSize_ += block.rawSize;
+        blocks_.push_back(block);
+    }
+    valid_ = true;
+}
+
+LogArchiveReader::~LogArchiveReader() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+}
+
+bool LogArchiveReader::readBlock(size_t i, string *out) const {
+    if (i >= blocks_.size()) {
+        return false;
+    }
+    const Block &block = blocks_[i];
+    string compressed(kBlockHeaderSize + block.compressedSize, '\0');
+    if (!preadAll(fd_, &compressed[0], compressed.size(), block.offset) || get32(&compressed[0]) != block.rawSize ||
+        get32(&compressed[4]) != block.compressedSize) {
+        return false;
+    }
+    if (block.compressedSize == block.rawSize) {
+        out->assign(compressed, kBlockHeaderSize, string::npos);
+        return true;
+    }
+    out->resize(block.rawSize);
+    return lz4::decompress(&compressed[kBlockHeaderSize], block.compressedSize, &(*out)[0], block.rawSize) == static_cast<long>(block.rawSize);
+}
+
+int LogArchiveReader::findBlock(int64_t rawOffset) const {
+    if (rawOffset < 0 || rawOffset >= rawSize_) {
+        return -1;
+    }
+    size_t lo = 0;
+    size_t hi = blocks_.size();
+    while (hi - lo > 1) { // blocks_[lo].rawOffset <= rawOffset < blocks_[hi].rawOffset
+        size_t mid = (lo + hi) / 2;
+        if (blocks_[mid].rawOffset <= rawOffset) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    return static_cast<int>(lo);
+}
+
+bool LogArchiveReader::readRange(TimeStamp from, TimeStamp to, const LineCallback &cb) const {
+    string data;
+    bool inRange = false; // 上一行是否在范围内，没有时间的行沿用
+    bool previousRead = false;
+    for (size_t i = 0; i < blocks_.size(); ++i) {
+        const Block &block = blocks_[i];
+        bool overlaps = block.first.valid() ? !(block.last < from || to < block.first) : previousRead && inRange;
+        if (!overlaps) {
+            previousRead = false;
+            inRange = false;
+            continue;
+        }
+        if (!readBlock(i, &data)) {
+            return false;
+        }
+        previousRead = true;
+        const char *end = data.data() + data.size();
+        for (const char *line = data.data(); line < end;) {
+            const char *newline = static_cast<const char *>(memchr(line, '\n', end - line));
+            const char *next = newline ? newline + 1 : end;
+            TimeStamp ts;
+            if (TimeStamp::parse(line, next - line, &ts) > 0) {
+                inRange = !(ts < from || to < ts);
+            }
+            if (inRange) {
+                cb(line, next - line);
+            }
+            line = next;
+        }
+    }
+    return true;
+}
+
+size_t encodeFrame(const char *data, size_t len, char *out) {
+    char *payload = out + kFrameHeaderSize;
+    size_t n = lz4::compress(data, len, payload, frameBound(len) - kFrameHeaderSize);
+    if (n >= len) {
+        memcpy(payload, data, len);
+        n = len;
+    }
+    memcpy(out, kFrameMagic, 4);
+    put32(out + 4, static_cast<uint32_t>(len));
+    put32(out + 8, static_cast<uint32_t>(n));
+    put32(out + 12, checksum(payload, n));
+    return kFrameHeaderSize + n;
+}
+
+LogFrameReader::LogFrameReader(const string &filename) : fd_(::open(filename.c_str(), O_RDONLY | O_CLOEXEC)), offset_(0), truncated_(false) {}
+
+LogFrameReader::~LogFrameReader() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+}
+
+bool LogFrameReader::next(string *out) {
+    if (fd_ < 0 || truncated_) {
+        return false;
+    }
+    char header[kFrameHeaderSize];
+    ssize_t n;
+    do {
+        n = ::pread(fd_, header, sizeof(header), offset_);
+    } while (n < 0 && errno == EINTR);
+    if (n == 0) {
+        return false; // 正好在帧边界结束
+    }
+    uint32_t rawSize = get32(header + 4);
+    uint32_t payloadSize = get32(header + 8);
+    if (n != static_cast<ssize_t>(sizeof(header)) || memcmp(header, kFrameMagic, 4) != 0 || payloadSize > rawSize) {
+        truncated_ = true;
+        return false;
+    }
+    payload_.resize(payloadSize);
+    if (!preadAll(fd_, &payload_[0], payloadSize, offset_ + kFrameHeaderSize) || checksum(payload_.data(), payloadSize) != get32(header + 12)) {
+        truncated_ = true;
+        return false;
+    }
+    if (payloadSize == rawSize) {
+        out->swap(payload_);
+    } else {
+        out->resize(rawSize);
+        if (lz4::decompress(payload_.data(), payloadSize, &(*out)[0], rawSize) != static_cast<long>(rawSize)) {
+            truncated_ = true;
+            return false;
+        }
+    }
+    offset_ += kFrameHeaderSize + payloadSize;
+    return true;
+}
+
+bool isFrameFile(const string &filename) {
+    int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    char magic[4];
+    bool frame = fd >= 0 && preadAll(fd, magic, sizeof(magic), 0) && memcmp(magic, kFrameMagic, 4) == 0;
+    if (fd >= 0) {
+        ::close(fd);
+    }
+    return frame;
+}
+
+LogCompressor::LogCompressor() : running_(true), busy_(false), compressedFiles_(0), thread_(&LogCompressor::threadFunc, this) {}
+
+LogCompressor::~LogCompressor() {
+    {
+        std::lock_guard<std::mutex> lck(mutex_);
+        running_ = false;
+    }
+    cond_.notify_one();
+    thread_.join();
+}
+
+void LogCompressor::add(const string &filename) {
+    {
+        std::lock_guard<std::mutex> lck(mutex_);
+        queue_.push_back(filename);
+    }
+    cond_.notify_one();
+}
+
+void LogCompressor::wait() {
+    std::unique_lock<std::mutex> lck(mutex_);
+    doneCond_.wait(lck, [this] { return queue_.empty() && !busy_; });
+}
+
+int64_t LogCompressor::compressedFiles() const {
+    std::lock_guard<std::mutex> lck(mutex_);
+    return compressedFiles_;
+}
+
+void LogCompressor::threadFunc() {
+    // 只降低本线程的CPU和I/O优先级：nice 19，I/O调度的idle类（IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT）
+    pid_t tid = static_cast<pid_t>(::syscall(SYS_gettid));
+    ::setpriority(PRIO_PROCESS, tid, 19);
+    ::syscall(SYS_ioprio_set, 1 /* IOPRIO_WHO_PROCESS */, tid, 3 << 13);
+    std::unique_lock<std::mutex> lck(mutex_);
+    while (true) {
+        cond_.wait(lck, [this] { return !queue_.empty() || !running_; });
+        if (queue_.empty()) {
+            break; // 退出前压缩完所有文件
+        }
+        string filename = queue_.front();
+        queue_.pop_front();
+        busy_ = true;
+        lck.unlock();
+        compressLogFile(filename, filename + ".lz", true);
+        lck.lock();
+        busy_ = false;
+        ++compressedFiles_;
+        doneCond_.notify_all();
+    }
+}
+
+bool compressLogFile(const string &src, const string &dst, bool removeSource) {
+    int fd = ::open(src.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        fprintf(stderr, "compressLogFile open %s failed %s\n", src.c_str(), strerror_tl(errno));
+        return false;
+    }
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    string tmp = dst + ".tmp";
+    bool ok;
+    {
+        LogArchiveWriter writer(tmp);
+        ok = writer.valid();
+        std::vector<char> buf(1024 * 1024);
+        while (ok) {
+            ssize_t n = ::read(fd, buf.data(), buf.size());
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                ok = n == 0;
+                break;
+            }
+            writer.append(buf.data(), n);
+        }
+        ok = writer.finish() && ok;
+    }
+    ::close(fd);
+    if (!ok || ::rename(tmp.c_str(), dst.c_str()) != 0) {
+        fprintf(stderr, "compressLogFile %s failed\n", src.c_str());
+        ::unlink(tmp.c_str());
+        return false;
+    }
+    if (removeSource) {
+        ::unlink(src.c_str());
+        ::unlink((src + ".idx").c_str()); // 原文件的时间索引（见LogIndex.h）随之失效，归档有自己的索引
+    }
+    return true;
+}
+
+} // namespace myServer
@@ -1,27 +1,84 @@
 #include "LogFile.h"
+#include "IoUring.h"
+#include "LogArchive.h"
+#include "LogIndex.h"
 #include "Logger.h"
 #include "TimeStamp.h"
 #include <assert.h>
+#include <deque>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
 
 namespace myServer {
-class LogFile::AppendFile {
+/** AppendFile: 文件写入的实现类
+ * StdioFile: 经过64KB的stdio缓冲区，由fwrite_unlocked写入，适合同步日志的大量短消息
+ * WritevFile: 直接使用fd，一批缓存由一次writev写入，不经过stdio缓冲区的拷贝，适合异步日志后端的整块缓存；
+ *             零散的短消息先攒在64KB的缓冲区中，在下一次批量写入或flush时写出
+ * MmapFile: 预分配文件后直接memcpy到共享映射中，见下方说明
+ * IoUringFile: 通过io_uring异步写入，见下方说明
+ * CompressedFile: 包装以上任一种，写入前压缩为流式帧，见下方说明
+ */
+class LogFile::AppendFile : noncopyable {
+  public:
+    AppendFile() : writtenBytes_(0), done_(nullptr) {}
+    virtual ~AppendFile() = default;
+
+    virtual void append(const char *logline, int len) = 0; // 写入一条日志
+    virtual void append(const struct iovec *iov, int count) { // 写入一批日志，默认逐块append
+        for (int i = 0; i < count; ++i) {
+            append(static_cast<const char *>(iov[i].iov_base), static_cast<int>(iov[i].iov_len));
+        }
+    }
+    // 异步写入一批日志，默认同步写完（sync时再落盘）后立即逐块回调
+    virtual void appendAsync(const struct iovec *iov, int count, void *const *tags, bool sync) {
+        append(iov, count);
+        if (sync) {
+            this->sync();
+        }
+        for (int i = 0; i < count; ++i) {
+            complete(tags[i]);
+        }
+    }
+    virtual int waitWrites(int /*timeoutMs*/) { return 0; } // 处理已完成的异步写入，返回完成的请求数
+    virtual int writesInFlight() const { return 0; }   // 尚未完成的异步写入请求数
+    virtual void flush() = 0;                            // 立刻刷新缓冲区
+    virtual void sync() = 0;                             // 刷新缓冲区并落盘
+    virtual int fd() const = 0;                          // 文件描述符，用于页缓存策略
+    off_t writtenBytes() const { return writtenBytes_; } // 返回已写日志数据的总字节数
+    void setWriteCallback(const WriteCallback *done) { done_ = done; }
+
+  protected:
+    void complete(void *tag) {
+        if (done_ && *done_) {
+            (*done_)(tag);
+        }
+    } // 一块异步写入完成，通知调用者
+
+    off_t writtenBytes_; // 已写日志数据的总字节数。off_t表示文件大小，不同位机器范围不同。
+    const WriteCallback *done_; // 指向LogFile::writeCallback_，滚动后旧文件的回调仍然有效
+};
+
+class StdioFile : public LogFile::AppendFile {
   public:
     // 对文件资源采用RAII手法
-    explicit AppendFile(const string &filename) : fp_(::fopen(filename.c_str(), "ae")), writtenBytes_(0) {
-        init();
-    } // 'e' for O_CLOEXEC
-    explicit AppendFile(const char *filename) : fp_(::fopen(filename, "ae")), writtenBytes_(0) {
-        init();
+    explicit StdioFile(const string &filename) : fp_(::fopen(filename.c_str(), "ae")) { // 'e' for O_CLOEXEC
+        assert(fp_);
+        ::setbuffer(fp_, buffer_, sizeof(buffer_)); // 设置写入文件前的缓冲区，当缓冲区满时一次性写入，减少I/O调用次数
     }
-    ~AppendFile() {
+    ~StdioFile() override {
         fclose(fp_); // 关闭文件时会强制flush
     }
 
-    void append(const char *logline, int len) {
+    void append(const char *logline, int len) override {
         size_t n = write(logline, len); // 先写入缓冲区
         size_t remain = len - n;        // 缓冲区可能无法一次性写完
         while (remain > 0) {
-            size_t x = write(logline, len);
+            size_t x = write(logline + n, remain);
             if (x == 0) {
                 int err = ferror(fp_);
                 if (err) {
@@ -33,29 +90,572 @@ class LogFile::AppendFile {
             remain = len - n;
         }
         writtenBytes_ += len;
-    }                                                    // 调用fwrite_unlocked进行实际的写入动作，由于设置了缓冲区，会先将内容写入缓冲区
-    void flush() { ::fflush(fp_); }                      // 立刻刷新缓冲区
-    off_t writtenBytes() const { return writtenBytes_; } // 返回已写日志数据的总字节数
+    } // 调用fwrite_unlocked进行实际的写入动作，由于设置了缓冲区，会先将内容写入缓冲区
+    using AppendFile::append;
+    void flush() override { ::fflush(fp_); }
+    void sync() override {
+        ::fflush(fp_);
+        ::fdatasync(fileno(fp_));
+    }
+    int fd() const override { return fileno(fp_); }
 
   private:
-    void init() {
-        assert(fp_);
-        ::setbuffer(fp_, buffer_, sizeof(buffer_)); // 设置写入文件前的缓冲区，当缓冲区满时一次性写入，减少I/O调用次数
-    }
-    size_t write(const char *logline, int len) {
+    size_t write(const char *logline, size_t len) {
         return ::fwrite_unlocked(logline, 1, len, fp_);
     } // 调用fwrite_unlocked写入文件
     FILE *fp_;
     char buffer_[64 * 1024]; // 文件输出缓冲区，64kB大小
-    off_t writtenBytes_;     // 已写日志数据的总字节数。off_t表示文件大小，不同位机器范围不同。
+};
+
+class WritevFile : public LogFile::AppendFile {
+  public:
+    explicit WritevFile(const string &filename) : fd_(::open(filename.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644)), pending_(0) {
+        assert(fd_ >= 0);
+    }
+    ~WritevFile() override {
+        flush();
+        ::close(fd_);
+    }
+
+    void append(const char *logline, int len) override {
+        if (pending_ + len > sizeof(buffer_)) {
+            flush();
+        }
+        if (static_cast<size_t>(len) > sizeof(buffer_)) {
+            struct iovec iov = {const_cast<char *>(logline), static_cast<size_t>(len)};
+            writeAll(&iov, 1);
+        } else {
+            memcpy(buffer_ + pending_, logline, len);
+            pending_ += len;
+        }
+    }
+    void append(const struct iovec *iov, int count) override {
+        flush(); // 保证之前的短消息先写入，维持顺序
+        writeAll(iov, count);
+    }
+    void flush() override {
+        if (pending_ > 0) {
+            struct iovec iov = {buffer_, pending_};
+            pending_ = 0;
+            writeAll(&iov, 1);
+        }
+    }
+    void sync() override {
+        flush();
+        ::fdatasync(fd_);
+    }
+    int fd() const override { return fd_; }
+
+  private:
+    // 每次最多IOV_MAX块，部分写入时跳过已写的部分继续，出错时放弃剩余数据
+    void writeAll(const struct iovec *iov, int count) {
+        struct iovec vec[IOV_MAX];
+        while (count > 0) {
+            int n = min(count, IOV_MAX);
+            memcpy(vec, iov, n * sizeof(*iov));
+            iov += n;
+            count -= n;
+            struct iovec *cur = vec;
+            struct iovec *end = vec + n;
+            while (cur != end) {
+                ssize_t written = ::writev(fd_, cur, static_cast<int>(end - cur));
+                if (written < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    fprintf(stderr, "AppendFile::append() failed %s\n", strerror_tl(errno));
+                    return;
+                }
+                writtenBytes_ += written;
+                // 跳过已完整写入的块，调整部分写入的块
+                while (cur != end && static_cast<size_t>(written) >= cur->iov_len) {
+                    written -= cur->iov_len;
+                    ++cur;
+                }
+                if (cur != end) {
+                    cur->iov_base = static_cast<char *>(cur->iov_base) + written;
+                    cur->iov_len -= written;
+                }
+            }
+        }
+    }
+
+    int fd_;
+    char buffer_[64 * 1024]; // 短消息的缓冲区
+    size_t pending_;         // buffer_中未写入的字节数
+};
+
+/** MmapFile: 日志直接memcpy到文件的共享映射中
+ * 打开时用fallocate把文件预分配到rollSize（最多kMaxPreallocate），之后写入不再有系统调用，也没有stdio缓冲区的拷贝；
+ * 每次映射kWindowSize大小的窗口并预先填充页表（MAP_POPULATE），写满后munmap并映射下一段，写入超出预分配大小时倍增地继续fallocate
+ * 数据memcpy后就在页缓存中，进程崩溃也不会丢失，只是文件尾部留有预分配的0字节；关闭（包括roll）时ftruncate到实际长度
+ * fallocate因磁盘空间不足失败时停止写入，避免写到没有空间的页触发SIGBUS；文件系统不支持fallocate时退回ftruncate扩展
+ */
+class MmapFile : public LogFile::AppendFile {
+  public:
+    static constexpr off_t kWindowSize = 16 * 1024 * 1024;        // 映射窗口大小，页大小的整数倍
+    static constexpr off_t kMaxPreallocate = 1024L * 1024 * 1024; // 打开时最多预分配1GB
+
+    MmapFile(const string &filename, off_t rollSize)
+        : fd_(::open(filename.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644)), allocated_(0), end_(0), window_(nullptr), windowOffset_(0), failed_(false) {
+        assert(fd_ >= 0);
+        struct stat st;
+        if (::fstat(fd_, &st) == 0) {
+            allocated_ = end_ = st.st_size; // 同名文件已存在时接在后面写
+        }
+        reserve(min(rollSize, kMaxPreallocate));
+    }
+    ~MmapFile() override {
+        unmapWindow();
+        if (::ftruncate(fd_, end_) != 0) {
+            fprintf(stderr, "AppendFile::close() ftruncate failed %s\n", strerror_tl(errno));
+        }
+        ::close(fd_);
+    }
+
+    void append(const char *logline, int len) override {
+        size_t remain = len;
+        while (remain > 0) {
+            if (!window_ || end_ == windowOffset_ + kWindowSize) {
+                if (!mapWindow()) {
+                    return; // 放弃剩余数据
+                }
+            }
+            size_t n = min(remain, static_cast<size_t>(windowOffset_ + kWindowSize - end_));
+            memcpy(window_ + (end_ - windowOffset_), logline, n);
+            logline += n;
+            remain -= n;
+            end_ += n;
+            writtenBytes_ += n;
+        }
+    }
+    using AppendFile::append;
+    void flush() override {} // 数据已在页缓存中，回写由内核完成
+    void sync() override {
+        if (window_) {
+            ::msync(window_, end_ - windowOffset_, MS_SYNC);
+        }
+        ::fdatasync(fd_);
+    }
+    int fd() const override { return fd_; }
+
+  private:
+    // 映射end_所在的窗口，需要时先扩展预分配的空间
+    bool mapWindow() {
+        if (failed_) {
+            return false;
+        }
+        unmapWindow();
+        off_t offset = end_ / kWindowSize * kWindowSize;
+        // 超出预分配大小（同一秒内不会roll）时按已分配大小倍增，最多一次kMaxPreallocate，避免每个窗口都调用fallocate
+        if (offset + kWindowSize > allocated_ && !reserve(max(offset + kWindowSize, allocated_ + min(allocated_, kMaxPreallocate)))) {
+            failed_ = true;
+            return false;
+        }
+        void *window = ::mmap(nullptr, kWindowSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, offset);
+        if (window == MAP_FAILED) {
+            fprintf(stderr, "AppendFile::append() mmap failed %s\n", strerror_tl(errno));
+            failed_ = true;
+            return false;
+        }
+        ::madvise(window, kWindowSize, MADV_SEQUENTIAL);
+        window_ = static_cast<char *>(window);
+        windowOffset_ = offset;
+        return true;
+    }
+    void unmapWindow() {
+        if (window_) {
+            ::msync(window_, kWindowSize, MS_ASYNC); // 提示内核开始回写写满的窗口
+            ::munmap(window_, kWindowSize);
+            window_ = nullptr;
+        }
+    }
+    // 保证文件至少有size字节的已分配空间
+    bool reserve(off_t size) {
+        if (size <= allocated_) {
+            return true;
+        }
+        if (::fallocate(fd_, 0, allocated_, size - allocated_) != 0) {
+            if (errno != EOPNOTSUPP || ::ftruncate(fd_, size) != 0) {
+                fprintf(stderr, "AppendFile::append() fallocate failed %s\n", strerror_tl(errno));
+                return false;
+            }
+        }
+        allocated_ = size;
+        return true;
+    }
+
+    int fd_;
+    off_t allocated_;     // 文件已分配（预分配）的大小
+    off_t end_;           // 日志数据的实际长度
+    char *window_;        // 当前映射窗口，没有时为空
+    off_t windowOffset_;  // 当前窗口在文件中的偏移
+    bool failed_;         // 空间分配或映射失败后不再写入
+};
+
+/** IoUringFile: 通过io_uring异步写入
+ * 普通文件在提交时按顺序预先分配偏移，各块写入互不依赖，可以同时在途、乱序完成；
+ * 管道等不可定位的文件只能从当前位置写入，同一时刻只有一个写入在途，其余排队以保证顺序
+ * 一次请求（调用者的一块缓存，或sync时的一整批缓存加fsync）的所有操作完成后才回调，调用者在此之前不能复用缓存
+ * fsync带IOSQE_IO_DRAIN，内核在之前提交的所有写入完成后才执行它
+ * 短消息拷贝到64KB的暂存块中，写满、flush或批量写入前提交，写完后回收复用
+ * 只写了一部分时从剩余位置重新提交，出错时放弃该块，和WritevFile一致
+ * 同步的append(iovec)和超过暂存块的长消息不拥有调用者的内存，提交后等待所有写入完成再返回
+ */
+class IoUringFile : public LogFile::AppendFile {
+  public:
+    static const unsigned kQueueDepth = 64;     // 同时在途的操作数上限
+    static const size_t kChunkSize = 64 * 1024; // 短消息暂存块大小
+
+    explicit IoUringFile(const string &filename)
+        : fd_(::open(filename.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644)), ring_(kQueueDepth), seekable_(false), offset_(0),
+          opsInFlight_(0), requestsInFlight_(0), chunk_(-1), pending_(0) {
+        assert(fd_ >= 0);
+        struct stat st;
+        if (::fstat(fd_, &st) == 0 && S_ISREG(st.st_mode)) {
+            seekable_ = true;
+            offset_ = st.st_size; // 不使用O_APPEND，否则内核会忽略指定的偏移
+        }
+        ops_.resize(ring_.entries());
+        for (int i = static_cast<int>(ops_.size()) - 1; i >= 0; --i) {
+            freeOps_.push_back(i);
+        }
+    }
+    ~IoUringFile() override {
+        flush();
+        drain();
+        ::close(fd_);
+    }
+    bool valid() const { return ring_.valid(); }
+
+    void append(const char *logline, int len) override {
+        if (static_cast<size_t>(len) > kChunkSize) {
+            submitChunk();
+            int request = newRequest(nullptr, 0, -1);
+            newWrite(request, logline, len);
+            release(request);
+            drain();
+            return;
+        }
+        if (chunk_ >= 0 && pending_ + len > kChunkSize) {
+            submitChunk();
+            ring_.submit();
+        }
+        if (chunk_ < 0) {
+            chunk_ = takeChunk();
+        }
+        memcpy(chunks_[chunk_].get() + pending_, logline, len);
+        pending_ += len;
+    }
+    void append(const struct iovec *iov, int count) override {
+        submitChunk();
+        int request = newRequest(nullptr, 0, -1);
+        for (int i = 0; i < count; ++i) {
+            newWrite(request, static_cast<const char *>(iov[i].iov_base), iov[i].iov_len);
+        }
+        release(request);
+        drain();
+    }
+    void appendAsync(const struct iovec *iov, int count, void *const *tags, bool sync) override {
+        submitChunk();
+        if (sync) {
+            int request = newRequest(tags, count, -1);
+            for (int i = 0; i < count; ++i) {
+                newWrite(request, static_cast<const char *>(iov[i].iov_base), iov[i].iov_len);
+            }
+            newFsync(request);
+            release(request);
+        } else {
+            for (int i = 0; i < count; ++i) {
+                int request = newRequest(&tags[i], 1, -1);
+                newWrite(request, static_cast<const char *>(iov[i].iov_base), iov[i].iov_len);
+                release(request);
+            }
+        }
+        ring_.submit();
+    }
+    int waitWrites(int timeoutMs) override {
+        ring_.submit();
+        int completed = reap();
+        if (completed == 0 && timeoutMs != 0 && opsInFlight_ > 0) {
+            ring_.wait(timeoutMs);
+            completed = reap();
+        }
+        return completed;
+    }
+    int writesInFlight() const override { return requestsInFlight_; }
+    void flush() override {
+        submitChunk();
+        ring_.submit();
+        reap();
+    }
+    void sync() override {
+        submitChunk();
+        int request = newRequest(nullptr, 0, -1);
+        newFsync(request);
+        release(request);
+        ring_.submit();
+    }
+    int fd() const override { return fd_; }
+
+  private:
+    // 调用者的一次写入请求，所有操作完成后依次回调tags
+    struct Request {
+        vector<void *> tags;
+        int remaining; // 未完成的操作数，准备期间额外持有1，防止提前完成
+        int chunk;     // 写入的暂存块编号，完成后回收，否则为-1
+    };
+    // 提交给io_uring的一个操作，在ops_中的下标作为user_data
+    struct Op {
+        int request;
+        const char *data;
+        size_t len;
+        uint64_t offset;
+        bool fsync;
+    };
+
+    int newRequest(void *const *tags, int count, int chunk) {
+        int id;
+        if (freeRequests_.empty()) {
+            id = static_cast<int>(requests_.size());
+            requests_.emplace_back();
+        } else {
+            id = freeRequests_.back();
+            freeRequests_.pop_back();
+        }
+        Request &request = requests_[id];
+        request.tags.assign(tags, tags + count);
+        request.remaining = 1;
+        request.chunk = chunk;
+        ++requestsInFlight_;
+        return id;
+    }
+    // 准备完成，释放newRequest时额外持有的计数
+    void release(int request) {
+        if (--requests_[request].remaining == 0) {
+            finish(request);
+        }
+    }
+    void finish(int id) {
+        Request &request = requests_[id];
+        vector<void *> tags;
+        tags.swap(request.tags);
+        if (request.chunk >= 0) {
+            freeChunks_.push_back(request.chunk);
+        }
+        freeRequests_.push_back(id);
+        --requestsInFlight_;
+        for (void *tag : tags) {
+            complete(tag);
+        }
+    }
+
+    // 取一个空闲操作，在途操作已达上限时等待完成
+    int newOp(int request, const char *data, size_t len, bool fsync) {
+        while (freeOps_.empty()) {
+            ring_.wait(-1);
+            reap();
+        }
+        int id = freeOps_.back();
+        freeOps_.pop_back();
+        ops_[id] = Op{request, data, len, seekable_ ? static_cast<uint64_t>(offset_) : static_cast<uint64_t>(-1), fsync};
+        ++requests_[request].remaining;
+        return id;
+    }
+    void newWrite(int request, const char *data, size_t len) {
+        if (len == 0) {
+            return;
+        }
+        int id = newOp(request, data, len, false);
+        offset_ += len;
+        writtenBytes_ += len;
+        start(id);
+    }
+    void newFsync(int request) {
+        if (!seekable_) {
+            return; // 管道不需要落盘
+        }
+        start(newOp(request, nullptr, 0, true));
+    }
+    void start(int id) {
+        if (!seekable_ && (opsInFlight_ > 0 || !waiting_.empty())) {
+            waiting_.push_back(id);
+            return;
+        }
+        prepare(id);
+    }
+    void prepare(int id) {
+        const Op &op = ops_[id];
+        struct io_uring_sqe *sqe = ring_.getSqe(); // 操作数不超过队列长度，不会为空
+        assert(sqe);
+        if (op.fsync) {
+            IoUring::prepFsync(sqe, fd_, true, id);
+            sqe->flags |= IOSQE_IO_DRAIN;
+        } else {
+            IoUring::prepWrite(sqe, fd_, op.data, static_cast<unsigned>(min(op.len, static_cast<size_t>(INT_MAX))), op.offset, id);
+        }
+        ++opsInFlight_;
+    }
+
+    // 处理所有已完成的操作，返回完成的请求数
+    int reap() {
+        int completed = 0;
+        uint64_t id;
+        int res;
+        while (ring_.peek(&id, &res)) {
+            completed += onComplete(static_cast<int>(id), res);
+        }
+        ring_.submit(); // 重新提交的部分写入和排队的操作
+        return completed;
+    }
+    int onComplete(int id, int res) {
+        --opsInFlight_;
+        Op &op = ops_[id];
+        if (res == -EINTR || res == -EAGAIN) {
+            prepare(id);
+            return 0;
+        }
+        if (res < 0) {
+            fprintf(stderr, "AppendFile::%s() failed %s\n", op.fsync ? "sync" : "append", strerror_tl(-res));
+        } else if (!op.fsync && static_cast<size_t>(res) < op.len && res > 0) {
+            op.data += res;
+            op.len -= res;
+            if (seekable_) {
+                op.offset += res;
+            }
+            prepare(id);
+            return 0;
+        }
+        int request = op.request;
+        freeOps_.push_back(id);
+        if (!waiting_.empty() && opsInFlight_ == 0) {
+            prepare(waiting_.front());
+            waiting_.pop_front();
+        }
+        if (--requests_[request].remaining == 0) {
+            finish(request);
+            return 1;
+        }
+        return 0;
+    }
+    // 等待所有请求完成
+    void drain() {
+        while (requestsInFlight_ > 0) {
+            ring_.wait(-1);
+            reap();
+        }
+    }
+
+    int takeChunk() {
+        if (freeChunks_.empty()) {
+            chunks_.emplace_back(new char[kChunkSize]);
+            return static_cast<int>(chunks_.size()) - 1;
+        }
+        int chunk = freeChunks_.back();
+        freeChunks_.pop_back();
+        return chunk;
+    }
+    void submitChunk() {
+        if (chunk_ < 0 || pending_ == 0) {
+            return;
+        }
+        int request = newRequest(nullptr, 0, chunk_);
+        newWrite(request, chunks_[chunk_].get(), pending_);
+        release(request);
+        chunk_ = -1;
+        pending_ = 0;
+    }
+
+    int fd_;
+    IoUring ring_;
+    bool seekable_;          // 普通文件，可以指定偏移写入
+    off_t offset_;           // 下一次写入的偏移
+    int opsInFlight_;        // 已交给内核尚未完成的操作数
+    int requestsInFlight_;   // 尚未完成的请求数
+    vector<Op> ops_;         // 操作表，大小等于队列长度
+    vector<int> freeOps_;
+    vector<Request> requests_;
+    vector<int> freeRequests_;
+    deque<int> waiting_;     // 不可定位的文件上等待前一个写入完成的操作
+    vector<unique_ptr<char[]>> chunks_; // 短消息暂存块，随在途数量增长，之后复用
+    vector<int> freeChunks_;
+    int chunk_;              // 正在填充的暂存块，没有时为-1
+    size_t pending_;         // chunk_中已写入的字节数
+};
+
+/** CompressedFile: 写入前把数据压缩为可单独解压的帧（格式见LogArchive.h），再交给实际的写入方式
+ * 批量写入的每块缓存直接从调用者的内存压缩为一帧，压缩后的帧立即同步写入，所以异步写入也在返回前完成并回调，
+ * 原始缓存在压缩完就能归还；短消息先攒在kStagingSize的暂存区中，写满、flush或批量写入前压缩为一帧
+ * writtenBytes为写入文件的压缩后的字节数，rollSize和页缓存策略都按压缩后的大小计算
+ */
+class CompressedFile : public LogFile::AppendFile {
+  public:
+    static const size_t kStagingSize = 256 * 1024;
+
+    explicit CompressedFile(LogFile::AppendFile *file) : file_(file), pending_(0), staging_(new char[kStagingSize]) {}
+    ~CompressedFile() override { flushStaging(); }
+
+    void append(const char *logline, int len) override {
+        if (pending_ + len > kStagingSize) {
+            flushStaging();
+        }
+        if (static_cast<size_t>(len) > kStagingSize) {
+            writeFrame(logline, len);
+        } else {
+            memcpy(staging_.get() + pending_, logline, len);
+            pending_ += len;
+        }
+    }
+    void append(const struct iovec *iov, int count) override {
+        flushStaging(); // 保证之前的短消息先写入，维持顺序
+        for (int i = 0; i < count; ++i) {
+            writeFrame(static_cast<const char *>(iov[i].iov_base), iov[i].iov_len);
+        }
+    }
+    void flush() override {
+        flushStaging();
+        file_->flush();
+    }
+    void sync() override {
+        flushStaging();
+        file_->sync();
+    }
+    int fd() const override { return file_->fd(); }
+
+  private:
+    void flushStaging() {
+        if (pending_ > 0) {
+            size_t len = pending_;
+            pending_ = 0;
+            writeFrame(staging_.get(), len);
+        }
+    }
+    void writeFrame(const char *data, size_t len) {
+        if (len == 0) {
+            return;
+        }
+        if (frame_.size() < frameBound(len)) {
+            frame_.resize(frameBound(len));
+        }
+        file_->append(frame_.data(), static_cast<int>(encodeFrame(data, len, frame_.data())));
+        file_->flush(); // 帧要完整地交给内核，崩溃时最多丢失正在写的一帧
+        writtenBytes_ = file_->writtenBytes();
+    }
+
+    unique_ptr<LogFile::AppendFile> file_;
+    size_t pending_;              // staging_中未压缩的字节数
+    unique_ptr<char[]> staging_;  // 短消息的暂存区
+    vector<char> frame_;          // 压缩输出，按需增长
 };
 
 LogFile::LogFile(const string &basename, //  日志文件名，默认保存在当前工作目录下
                  off_t rollSize,         //  日志文件超过设定值进行roll
                  bool threadSafe,        //  默认线程安全，使用互斥锁操作将消息写入缓冲区
                  int flushInterval,      //  flush刷新时间间隔
-                 int checkEveryN         //  每1024次日志操作，检查一个是否刷新、是否roll
-                 ) : basename_(basename), rollSize_(rollSize), threadSafe_(threadSafe), flushInterval_(flushInterval), checkEveryN_(checkEveryN), startOfPeriod_(0), lastRoll_(0), lastFlush_(0) {
+                 int checkEveryN,        //  每1024次日志操作，检查一个是否刷新、是否roll
+                 Backend backend,        //  文件写入方式
+                 bool compressed         //  写入前压缩为流式帧
+                 ) : indexBytes_(0), indexIntervalMs_(0), basename_(basename), rollSize_(rollSize), threadSafe_(threadSafe), flushInterval_(flushInterval), checkEveryN_(checkEveryN), backend_(backend == kIoUring && !IoUring::available() ? kWritev : backend), compressed_(compressed), startOfPeriod_(0), lastRoll_(0), lastFlushMs_(0), lastSyncMs_(0), count_(0), stats_(), fileBase_(0), flushMark_(0), writeBehindMark_(0), releasedMark_(0) {
     assert(basename.find('/') == string::npos); // 保证basename不包含路径
     rollFile();
 }
@@ -66,7 +666,7 @@ LogFile::LogFile(const string &basename, //  日志文件名，默认保存在
  */
 bool LogFile::rollFile() {
     time_t now = 0;
-    string filename = getLogFileName(basename_, &now);
+    string filename = getLogFileName(basename_, &now, compressed_);
 
     // 注意，这里先除kRollPerSeconds_然后乘KPollPerSeconds表示对齐值kRollPerSeconds_的整数倍，
     // 也就是事件调整到当天零点(/除法会引发取整)
@@ -74,9 +674,41 @@ bool LogFile::rollFile() {
 
     if (now > lastRoll_) {
         lastRoll_ = now;
-        lastFlush_ = now;
+        lastFlushMs_ = lastSyncMs_ = static_cast<int64_t>(now) * 1000;
         startOfPeriod_ = start; // 在roll时更换每天的零点时间戳
-        file_.reset(new AppendFile(filename));
+        if (file_) {
+            ++stats_.rolls;
+            if (policy_.dropCache) {
+                flushFile();
+                releaseCache(file_->writtenBytes()); // 旧文件剩余的页缓存，只等待最后一段回写
+            }
+        }
+        struct stat st;
+        fileBase_ = ::stat(filename.c_str(), &st) == 0 ? st.st_size : 0; // 同一秒内重新打开同名文件时接在后面写
+        flushMark_ = writeBehindMark_ = releasedMark_ = 0;
+        unique_ptr<AppendFile> file;
+        if (backend_ == kIoUring) {
+            file.reset(new IoUringFile(filename));
+        } else if (backend_ == kMmap) {
+            file.reset(new MmapFile(filename, rollSize_));
+        } else if (backend_ == kWritev) {
+            file.reset(new WritevFile(filename));
+        } else {
+            file.reset(new StdioFile(filename));
+        }
+        if (compressed_) {
+            file.reset(new CompressedFile(file.release()));
+        }
+        file->setWriteCallback(&writeCallback_);
+        file_ = move(file); // 旧文件析构时等待其在途的异步写入完成
+        if (compressor_ && !compressed_ && !filename_.empty()) {
+            compressor_->add(filename_); // 旧文件已关闭，交给后台压缩
+        }
+        filename_ = filename;
+        index_.reset(); // 旧索引写出最后一段
+        if (indexBytes_ > 0) {
+            index_.reset(new LogIndexWriter(filename_, fileBase_, indexBytes_, indexIntervalMs_));
+        }
     }
     return false;
 }
@@ -94,30 +726,27 @@ string hostname() {
  * 构造一个日志文件名
  * 日志名由基本名字+时间戳+主机名+进程id+加上“.log”后缀
  */
-string LogFile::getLogFileName(const string &basename, time_t *now) {
+string LogFile::getLogFileName(const string &basename, time_t *now, bool compressed) {
     string filename;
     filename.reserve(basename.size() + 64); // reserve()将字符串的容量设置为至少basename.size() + 64,因为后面要添加时间、主机名、进程id等内容
 
     filename = basename; // 加上文件基本名字
 
     TimeStamp ts(TimeStamp::now());
-    char timeBuf[32] = {0};
-    struct tm tm_time;
     *now = ts.SecondsSinceEpoch();
-    // gmtime_r(now, &tm_time);
-    localtime_r(now, &tm_time);                                      // 使用本地时间
-    strftime(timeBuf, sizeof(timeBuf), ".%Y%m%d-%H%M%S.", &tm_time); // 格式化时间
-    // snprintf(timeBuf, sizeof(timeBuf), ".%4d%02d%02d%-02d%02d%02d.", tm_time.tm_year + 1900, tm_time.tm_mon, tm_time.tm_mday, tm_time.tm_hour, tm_time.tm_min, tm_time.tm_sec);
-    filename += timeBuf; // 加上时间戳（UTC）
+    char timeBuf[TimeStamp::kMaxFormattedSize + 2];
+    timeBuf[0] = '.';
+    size_t len = ts.formatCompactTo(timeBuf + 1); // 使用本地时间
+    timeBuf[len + 1] = '.';
+    filename.append(timeBuf, len + 2); // 加上时间戳
 
     filename += hostname(); // 加上主机名
 
-    char pidbuf[32] = {0};
-    pid_t pid = ::getpid();
-    snprintf(pidbuf, sizeof(pidbuf), ".%d", pid);
-    filename += pidbuf; // 加上进程号
+    char pidbuf[32];
+    pidbuf[0] = '.';
+    filename.append(pidbuf, formatInteger(pidbuf + 1, ::getpid()) + 1); // 加上进程号
 
-    filename += ".log"; // 加上后缀
+    filename += compressed ? ".log.lzs" : ".log"; // 加上后缀
 
     return filename;
 }
@@ -128,25 +757,105 @@ string LogFile::getLogFileName(const string &basename, time_t *now) {
  * 带锁刷新和不带锁刷新（此时只能单线程使用）
  */
 void LogFile::append_unlocked(const char *logline, int len) {
+    if (index_) {
+        struct iovec iov = {const_cast<char *>(logline), static_cast<size_t>(len)};
+        addToIndex(&iov, 1);
+    }
     file_->append(logline, len);
+    afterAppend(1);
+}
+void LogFile::append_unlocked(const struct iovec *iov, int count) {
+    if (index_) {
+        addToIndex(iov, count);
+    }
+    file_->append(iov, count);
+    afterAppend(count);
+}
+// 在写入前记入索引，索引按写入的长度累计偏移
+void LogFile::addToIndex(const struct iovec *iov, int count) {
+    for (int i = 0; i < count; ++i) {
+        index_->append(static_cast<const char *>(iov[i].iov_base), iov[i].iov_len);
+    }
+}
+// 写入appends次后检查roll和flush
+void LogFile::afterAppend(int appends) {
+    off_t written = file_->writtenBytes();
     // 文件中已写入的字节超过roll的限制，就roll,(但是不会把已经超过的部分写到新文件)
-    if (file_->writtenBytes() > rollSize_) {
+    if (written > rollSize_) {
         rollFile();
-    } else {
-        count_++;
-        if (count_ >= checkEveryN_) { // 检查是否需要roll和flush,roll的条件是是否到了新的一天，flush的条件是是否超过3秒没有flush
-            count_ = 0;
-            TimeStamp ts(TimeStamp::now());
-            time_t now = ts.SecondsSinceEpoch();
-            time_t thisPeriod_ = now / kRollPerSeconds_ * kRollPerSeconds_;
-            if (thisPeriod_ != startOfPeriod_) {
-                rollFile();
-            } else if (now - lastFlush_ > flushInterval_) {
-                lastFlush_ = now;
-                file_->flush();
+        return;
+    }
+    if (policy_.writeBehindBytes > 0 && written - writeBehindMark_ >= policy_.writeBehindBytes) {
+        writeBehind();
+    } else if (policy_.flushBytes > 0 && written - flushMark_ >= policy_.flushBytes) {
+        flushFile();
+    }
+    count_ += appends;
+    if (count_ >= checkEveryN_ || policy_.flushLatencyMs > 0) { // 检查是否需要roll和flush,roll的条件是是否到了新的一天，flush的条件是是否超过3秒没有flush
+        count_ = 0;
+        TimeStamp ts(TimeStamp::now());
+        time_t now = ts.SecondsSinceEpoch();
+        time_t thisPeriod_ = now / kRollPerSeconds_ * kRollPerSeconds_;
+        if (thisPeriod_ != startOfPeriod_) {
+            rollFile();
+            return;
+        }
+        int64_t nowMs = ts.microSecondsSinceEpoch() / 1000;
+        if (policy_.flushLatencyMs > 0 ? nowMs - lastFlushMs_ >= policy_.flushLatencyMs : nowMs - lastFlushMs_ > flushInterval_ * 1000) {
+            lastFlushMs_ = nowMs;
+            if (written > flushMark_ || policy_.flushLatencyMs == 0) {
+                flushFile();
             }
         }
+        if (policy_.syncIntervalMs > 0 && nowMs - lastSyncMs_ >= policy_.syncIntervalMs) {
+            lastSyncMs_ = nowMs;
+            syncFile();
+        }
+    }
+}
+void LogFile::flushFile() {
+    file_->flush();
+    flushMark_ = file_->writtenBytes();
+    ++stats_.flushes;
+}
+void LogFile::syncFile() {
+    file_->sync();
+    flushMark_ = file_->writtenBytes();
+    ++stats_.syncs;
+}
+/**
+ * 写后回写：新写入的一段只提交回写不等待（SYNC_FILE_RANGE_WRITE），内核按顺序平滑地写出脏页；
+ * dropCache时再等待上一段回写完成并释放页缓存，上一段已经回写了一整段的时间，通常不需要等待
+ * 管道等不支持的文件上两个调用都返回错误，忽略即可
+ */
+void LogFile::writeBehind() {
+    flushFile(); // 缓冲中的数据先交给内核
+    off_t end = file_->writtenBytes();
+    ::sync_file_range(file_->fd(), fileBase_ + writeBehindMark_, end - writeBehindMark_, SYNC_FILE_RANGE_WRITE);
+    stats_.writeBehindBytes += end - writeBehindMark_;
+    if (policy_.dropCache) {
+        releaseCache(writeBehindMark_);
+    }
+    writeBehindMark_ = end;
+}
+// kMmap仍映射在窗口中的页不会被释放；kIoUring尚未完成的写入所在的页可能留在缓存中
+void LogFile::releaseCache(off_t end) {
+    if (end <= releasedMark_) {
+        return;
+    }
+    int fd = file_->fd();
+    ::sync_file_range(fd, fileBase_ + releasedMark_, end - releasedMark_,
+                      SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER);
+    ::posix_fadvise(fd, fileBase_ + releasedMark_, end - releasedMark_, POSIX_FADV_DONTNEED);
+    stats_.droppedCacheBytes += end - releasedMark_;
+    releasedMark_ = end;
+}
+void LogFile::appendAsync_unlocked(const struct iovec *iov, int count, void *const *tags, bool sync) {
+    if (index_) {
+        addToIndex(iov, count);
     }
+    file_->appendAsync(iov, count, tags, sync);
+    afterAppend(count);
 }
 void LogFile::append(const char *logline, int len) {
     if (threadSafe_) {
@@ -156,14 +865,91 @@ void LogFile::append(const char *logline, int len) {
         append_unlocked(logline, len);
     }
 }
+void LogFile::append(const struct iovec *iov, int count) {
+    if (threadSafe_) {
+        unique_lock<mutex> lck(mutex_);
+        append_unlocked(iov, count);
+    } else {
+        append_unlocked(iov, count);
+    }
+}
+void LogFile::appendAsync(const struct iovec *iov, int count, void *const *tags, bool sync) {
+    if (threadSafe_) {
+        unique_lock<mutex> lck(mutex_);
+        appendAsync_unlocked(iov, count, tags, sync);
+    } else {
+        appendAsync_unlocked(iov, count, tags, sync);
+    }
+}
+int LogFile::waitWrites(int timeoutMs) {
+    if (threadSafe_) {
+        unique_lock<mutex> lck(mutex_);
+        return file_->waitWrites(timeoutMs);
+    }
+    return file_->waitWrites(timeoutMs);
+}
+int LogFile::writesInFlight() const { return file_->writesInFlight(); }
+void LogFile::sync() {
+    if (threadSafe_) {
+        unique_lock<mutex> lck(mutex_);
+        syncFile();
+    } else {
+        syncFile();
+    }
+}
 void LogFile::flush() {
     if (threadSafe_) {
         unique_lock<mutex> lck(mutex_);
-        file_->flush();
+        flushFile();
     } else {
-        file_->flush();
+        flushFile();
     }
 }
+void LogFile::setIoPolicy(const IoPolicy &policy) {
+    if (threadSafe_) {
+        unique_lock<mutex> lck(mutex_);
+        policy_ = policy;
+    } else {
+        policy_ = policy;
+    }
+}
+void LogFile::setCompressRolled(bool on) {
+    unique_lock<mutex> lck(mutex_, defer_lock);
+    if (threadSafe_) {
+        lck.lock();
+    }
+    if (on && !compressor_) {
+        compressor_.reset(new LogCompressor);
+    } else if (!on) {
+        compressor_.reset();
+    }
+}
+void LogFile::setTimeIndex(off_t intervalBytes, int intervalMs) {
+    unique_lock<mutex> lck(mutex_, defer_lock);
+    if (threadSafe_) {
+        lck.lock();
+    }
+    indexBytes_ = compressed_ ? 0 : intervalBytes;
+    indexIntervalMs_ = intervalMs;
+    index_.reset();
+    if (indexBytes_ > 0) {
+        file_->flush(); // 缓冲中的数据计入writtenBytes，作为索引的起始偏移
+        index_.reset(new LogIndexWriter(filename_, fileBase_ + file_->writtenBytes(), indexBytes_, indexIntervalMs_));
+    }
+}
+LogFile::IoStats LogFile::ioStats() {
+    unique_lock<mutex> lck(mutex_, defer_lock);
+    if (threadSafe_) {
+        lck.lock();
+    }
+    IoStats stats = stats_;
+    stats.cachedBytes = file_->writtenBytes() - releasedMark_;
+    return stats;
+}
 
-LogFile::~LogFile() = default;
+LogFile::~LogFile() {
+    file_.reset();       // 先于writeCallback_析构，等待在途的异步写入完成并回调
+    index_.reset();
+    compressor_.reset(); // 等待已roll的文件压缩完成，当前文件不压缩
+}
 } // namespace myServer
\ No newline at end of file
@@ -0,0 +1,306 @@
+#include "LogGrep.h"
+#include <string.h>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace myServer {
+namespace {
+const char *kLevelNames[Logger::NUM_LOG_LEVELS] = {"TRACE ", "DEBUG ", "INFO  ", "WARN  ", "ERROR ", "FATAL "}; // 与Logger.cpp的LogLevelName一致
+
+const char *findSubstringScalar(const char *begin, const char *end, const char *needle, size_t needleLen) {
+    const void *p = ::memmem(begin, end - begin, needle, needleLen);
+    return p ? static_cast<const char *>(p) : end;
+}
+const char *findNewlineScalar(const char *begin, const char *end) {
+    const void *p = ::memchr(begin, '\n', end - begin);
+    return p ? static_cast<const char *>(p) : end;
+}
+
+#if defined(__x86_64__)
+/**
+ * 子串查找：同时比较needle的首字节和尾字节，每次处理一个向量宽度的候选起点，
+ * 两者都相等的位置才逐字节比较中间部分；日志中首尾字节同时相等的位置很少，大部分数据只经过两次比较
+ */
+#define YKLOG_FIND_SUBSTRING(Vec, width, set1, loadu, cmpeq, andv, movemask)                 \
+    if (needleLen == 0) {                                                                 \
+        return begin;                                                                     \
+    }                                                                                     \
+    if (static_cast<size_t>(end - begin) < needleLen) {                                   \
+        return end;                                                                       \
+    }                                                                                     \
+    const Vec first = set1(needle[0]);                                                    \
+    const Vec last = set1(needle[needleLen - 1]);                                         \
+    const char *p = begin;                                                                \
+    const char *const limit = end - needleLen + 1; /* 候选起点的上界 */                 \
+    for (; p + (width) <= limit; p += (width)) {                                          \
+        Vec blockFirst = loadu(reinterpret_cast<const Vec *>(p));                         \
+        Vec blockLast = loadu(reinterpret_cast<const Vec *>(p + needleLen - 1));          \
+        unsigned mask = static_cast<unsigned>(movemask(andv(cmpeq(first, blockFirst), cmpeq(last, blockLast)))); \
+        while (mask) {                                                                    \
+            int bit = __builtin_ctz(mask);                                                \
+            if (needleLen <= 2 || memcmp(p + bit + 1, needle + 1, needleLen - 2) == 0) {  \
+                return p + bit;                                                           \
+            }                                                                             \
+            mask &= mask - 1;                                                             \
+        }                                                                                 \
+    }                                                                                     \
+    return findSubstringScalar(p, end, needle, needleLen);
+
+#define YKLOG_FIND_NEWLINE(Vec, width, set1, loadu, cmpeq, movemask)         \
+    const Vec newline = set1('\n');                                      \
+    const char *p = begin;                                               \
+    for (; p + (width) <= end; p += (width)) {                           \
+        unsigned mask = static_cast<unsigned>(movemask(cmpeq(newline, loadu(reinterpret_cast<const Vec *>(p))))); \
+        if (mask) {                                                      \
+            return p + __builtin_ctz(mask);                              \
+        }                                                                \
+    }                                                                    \
+    return findNewlineScalar(p, end);
+
+const char *findSubstringSse2(const char *begin, const char *end, const char *needle, size_t needleLen) {
+    YKLOG_FIND_SUBSTRING(__m128i, 16, _mm_set1_epi8, _mm_loadu_si128, _mm_cmpeq_epi8, _mm_and_si128, _mm_movemask_epi8)
+}
+const char *findNewlineSse2(const char *begin, const char *end) {
+    YKLOG_FIND_NEWLINE(__m128i, 16, _mm_set1_epi8, _mm_loadu_si128, _mm_cmpeq_epi8, _mm_movemask_epi8)
+}
+__attribute__((target("avx2"))) const char *findSubstringAvx2(const char *begin, const char *end, const char *needle, size_t needleLen) {
+    YKLOG_FIND_SUBSTRING(__m256i, 32, _mm256_set1_epi8, _mm256_loadu_si256, _mm256_cmpeq_epi8, _mm256_and_si256, _mm256_movemask_epi8)
+}
+__attribute__((target("avx2"))) const char *findNewlineAvx2(const char *begin, const char *end) {
+    YKLOG_FIND_NEWLINE(__m256i, 32, _mm256_set1_epi8, _mm256_loadu_si256, _mm256_cmpeq_epi8, _mm256_movemask_epi8)
+}
+#undef YKLOG_FIND_SUBSTRING
+#undef YKLOG_FIND_NEWLINE
+#endif
+
+struct Dispatch {
+    const char *(*findSubstring)(const char *, const char *, const char *, size_t);
+    const char *(*findNewline)(const char *, const char *);
+    const char *name;
+};
+const Dispatch kScalar = {findSubstringScalar, findNewlineScalar, "scalar"};
+#if defined(__x86_64__)
+const Dispatch kSse2 = {findSubstringSse2, findNewlineSse2, "sse2"};
+const Dispatch kAvx2 = {findSubstringAvx2, findNewlineAvx2, "avx2"};
+#endif
+
+const Dispatch *chooseDispatch() {
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") ? &kAvx2 : &kSse2;
+#else
+    return &kScalar;
+#endif
+}
+const Dispatch *g_dispatch = chooseDispatch();
+} // namespace
+
+const char *findSubstring(const char *begin, const char *end, const char *needle, size_t needleLen) {
+    return g_dispatch->findSubstring(begin, end, needle, needleLen);
+}
+const char *findNewline(const char *begin, const char *end) {
+    return g_dispatch->findNewline(begin, end);
+}
+const char *simdLevel() {
+    return g_dispatch->name;
+}
+bool setSimdLevel(const string &level) {
+    if (level == "scalar") {
+        g_dispatch = &kScalar;
+        return true;
+    }
+#if defined(__x86_64__)
+    if (level == "sse2") {
+        g_dispatch = &kSse2;
+        return true;
+    }
+    if (level == "avx2" && __builtin_cpu_supports("avx2")) {
+        g_dispatch = &kAvx2;
+        return true;
+    }
+#endif
+    return false;
+}
+
+bool parseLogPrefix(const char *line, size_t len, LogPrefix *prefix) {
+    size_t n = TimeStamp::parse(line, len, &prefix->time);
+    if (n == 0 || n + 2 > len || line[n] != 'Z' || line[n + 1] != ' ') {
+        return false;
+    }
+    const char *p = line + n + 2;
+    const char *end = line + len;
+    while (p < end && *p == ' ') { // 线程号按"%5d "右对齐
+        ++p;
+    }
+    int tid = 0;
+    const char *digits = p;
+    while (p < end && *p >= '0' && *p <= '9') {
+        tid = tid * 10 + (*p++ - '0');
+    }
+    if (p == digits || p >= end || *p != ' ' || end - p < 7) {
+        return false;
+    }
+    ++p;
+    for (int level = 0; level < Logger::NUM_LOG_LEVELS; ++level) {
+        if (memcmp(p, kLevelNames[level], 6) == 0) {
+            prefix->tid = tid;
+            prefix->level = static_cast<Logger::LogLevel>(level);
+            return true;
+        }
+    }
+    return false;
+}
+
+LogMatcher::LogMatcher() : minLevel_(Logger::TRACE), tid_(0), from_(TimeStamp::invalid()), to_(TimeStamp::invalid()) {}
+
+bool LogMatcher::hasPrefixFilter() const {
+    return minLevel_ > Logger::TRACE || tid_ != 0 || from_.valid() || to_.valid();
+}
+
+bool LogMatcher::matchPrefix(const char *line, size_t len, bool *hasPrefix) const {
+    LogPrefix prefix;
+    *hasPrefix = parseLogPrefix(line, len, &prefix);
+    return *hasPrefix && prefix.level >= minLevel_ && (tid_ == 0 || prefix.tid == tid_) && !(from_.valid() && prefix.time < from_) &&
+           !(to_.valid() && to_ < prefix.time);
+}
+
+// 行尾为" - 文件:行号"，只有多行日志的最后一行有
+bool LogMatcher::matchSource(const char *line, size_t len) const {
+    if (len > 0 && line[len - 1] == '\n') {
+        --len;
+    }
+    const char *end = line + len;
+    const char *dash = end;
+    while ((dash = static_cast<const char *>(::memrchr(line, '-', dash - line))) != nullptr) {
+        if (dash > line && dash[-1] == ' ' && dash + 1 < end && dash[1] == ' ') {
+            break;
+        }
+    }
+    if (!dash) {
+        return false;
+    }
+    const char *location = dash + 2;
+    size_t n = end - location;
+    if (source_.find(':') != string::npos) {
+        return n == source_.size() && memcmp(location, source_.data(), n) == 0;
+    }
+    return n > source_.size() && memcmp(location, source_.data(), source_.size()) == 0 && location[source_.size()] == ':';
+}
+
+// 来源在整条日志的最后一行，line所在条目的每一行都按它判断；*entryEnd为下一个有行首的行
+bool LogMatcher::matchEntrySource(const char *line, const char *end, const char **entryEnd) const {
+    const char *newline = findNewline(line, end);
+    const char *last = line;
+    const char *next = newline < end ? newline + 1 : end;
+    while (next < end) {
+        const char *lineEnd = findNewline(next, end);
+        LogPrefix prefix;
+        if (parseLogPrefix(next, lineEnd - next, &prefix)) {
+            break;
+        }
+        last = next;
+        next = lineEnd < end ? lineEnd + 1 : end;
+    }
+    *entryEnd = next;
+    return matchSource(last, next - last);
+}
+
+bool LogMatcher::matchOwner(const char *data, const char *line) const {
+    while (line > data) {
+        const char *previousEnd = line - 1; // 上一行的换行
+        const char *newline = static_cast<const char *>(::memrchr(data, '\n', previousEnd - data));
+        const char *previous = newline ? newline + 1 : data;
+        bool hasPrefix;
+        bool match = matchPrefix(previous, line - previous, &hasPrefix);
+        if (hasPrefix) {
+            return match;
+        }
+        line = previous;
+    }
+    return false; // 所属的行首不在这段数据中
+}
+
+template <typename Emit>
+size_t LogMatcher::scanLines(const char *data, size_t len, Emit emit) const {
+    const bool prefixFilter = hasPrefixFilter();
+    const char *const end = data + len;
+    bool ownerMatch = false; // 上一个有行首的行是否满足条件
+    bool sourceMatch = false; // 当前条目的来源是否满足条件
+    const char *entryEnd = data;
+    size_t lines = 0;
+    for (const char *line = data; line < end;) {
+        const char *newline = findNewline(line, end);
+        const char *next = newline < end ? newline + 1 : end;
+        bool match = true;
+        if (prefixFilter) {
+            bool hasPrefix;
+            bool prefixMatch = matchPrefix(line, next - line, &hasPrefix);
+            ownerMatch = hasPrefix ? prefixMatch : ownerMatch;
+            match = ownerMatch;
+        }
+        if (match && !source_.empty()) {
+            if (line >= entryEnd) {
+                sourceMatch = matchEntrySource(line, end, &entryEnd);
+            }
+            match = sourceMatch;
+        }
+        if (match) {
+            emit(line, next - line);
+            ++lines;
+        }
+        line = next;
+    }
+    return lines;
+}
+
+template <typename Emit>
+size_t LogMatcher::scanPattern(const char *data, size_t len, Emit emit) const {
+    const bool prefixFilter = hasPrefixFilter();
+    const char *const end = data + len;
+    bool sourceMatch = false; // 当前条目的来源是否满足条件
+    const char *entryEnd = data;
+    size_t lines = 0;
+    for (const char *from = data; from < end;) { // from总是行首
+        const char *hit = findSubstring(from, end, pattern_.data(), pattern_.size());
+        if (hit == end) {
+            break;
+        }
+        const char *newline = static_cast<const char *>(::memrchr(from, '\n', hit - from));
+        const char *line = newline ? newline + 1 : from;
+        const char *lineEnd = findNewline(hit + pattern_.size(), end);
+        const char *next = lineEnd < end ? lineEnd + 1 : end;
+        bool match = true;
+        if (prefixFilter) {
+            bool hasPrefix;
+            match = matchPrefix(line, next - line, &hasPrefix);
+            if (!hasPrefix) {
+                match = matchOwner(data, line);
+            }
+        }
+        if (match && !source_.empty()) {
+            if (line >= entryEnd) {
+                sourceMatch = matchEntrySource(line, end, &entryEnd);
+            }
+            match = sourceMatch;
+        }
+        if (match) {
+            emit(line, next - line);
+            ++lines;
+        }
+        from = next;
+    }
+    return lines;
+}
+
+size_t LogMatcher::scan(const char *data, size_t len, const LineCallback &cb) const {
+    auto emit = [&cb](const char *line, size_t n) { cb(line, n); };
+    return pattern_.empty() ? scanLines(data, len, emit) : scanPattern(data, len, emit);
+}
+
+size_t LogMatcher::count(const char *data, size_t len) const {
+    auto emit = [](const char *, size_t) {};
+    return pattern_.empty() ? scanLines(data, len, emit) : scanPattern(data, len, emit);
+}
+
+} // namespace myServer
@@ -0,0 +1,285 @@
+#include "LogIndex.h"
+#include "Logger.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace myServer {
+namespace {
+const char kMagic[4] = {'Y', 'K', 'L', 'X'};
+const uint32_t kVersion = 1;
+const size_t kHeaderSize = 8;
+const size_t kEntrySize = 32;
+const size_t kReadSize = 1 << 20; // 扫描时每次读取的长度
+// 共享缓存中的日志在取时间之后才加锁写入，块内相邻的行可能有微秒级的乱序，比较段的时间范围时放宽这么多
+const int64_t kSlackNs = 100 * 1000 * 1000;
+
+inline void put32(char *p, uint32_t v) {
+    for (int i = 0; i < 4; ++i) {
+        p[i] = static_cast<char>(v >> (8 * i));
+    }
+}
+inline void put64(char *p, uint64_t v) {
+    for (int i = 0; i < 8; ++i) {
+        p[i] = static_cast<char>(v >> (8 * i));
+    }
+}
+inline uint32_t get32(const char *p) {
+    uint32_t v = 0;
+    for (int i = 3; i >= 0; --i) {
+        v = (v << 8) | static_cast<unsigned char>(p[i]);
+    }
+    return v;
+}
+inline uint64_t get64(const char *p) {
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; --i) {
+        v = (v << 8) | static_cast<unsigned char>(p[i]);
+    }
+    return v;
+}
+
+// 行首的时间，没有时返回0
+inline int64_t lineTime(const char *line, size_t len) {
+    TimeStamp ts;
+    return TimeStamp::parse(line, len, &ts) > 0 ? ts.nanoSecondsSinceEpoch() : 0;
+}
+
+bool writeAll(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = ::write(fd, data, len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+} // namespace
+
+LogIndexWriter::LogIndexWriter(const string &logFile, off_t offset, off_t intervalBytes, int intervalMs)
+    : fd_(::open((logFile + ".idx").c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644)), intervalBytes_(intervalBytes > 0 ? intervalBytes : 1),
+      intervalNs_(static_cast<int64_t>(intervalMs) * 1000000), segmentOffset_(offset), segmentEnd_(offset), firstNs_(0), lastNs_(0), startNs_(0), segments_(0) {
+    if (fd_ < 0) {
+        fprintf(stderr, "LogIndexWriter open %s.idx failed %s\n", logFile.c_str(), strerror_tl(errno));
+        return;
+    }
+    struct stat st;
+    if (::fstat(fd_, &st) == 0 && st.st_size == 0) {
+        char header[kHeaderSize];
+        memcpy(header, kMagic, 4);
+        put32(header + 4, kVersion);
+        writeAll(fd_, header, sizeof(header));
+    }
+}
+
+LogIndexWriter::~LogIndexWriter() {
+    if (fd_ >= 0) {
+        closeSegment();
+        ::close(fd_);
+    }
+}
+
+/**
+ * 一块数据按段的剩余字节在行边界切分，每一部分只解析首尾两行的时间；
+ * 第一行的时间距当前段第一块的时间超过intervalMs时先结束当前段，因此日志稀疏时每段也不会跨越太长的时间
+ */
+void LogIndexWriter::append(const char *data, size_t len) {
+    if (fd_ < 0) {
+        return;
+    }
+    size_t pos = 0;
+    while (pos < len) {
+        const char *chunk = data + pos;
+        int64_t first = lineTime(chunk, len - pos);
+        if (first != 0 && startNs_ != 0 && intervalNs_ > 0 && first - startNs_ >= intervalNs_) {
+            closeSegment();
+        }
+        size_t room = static_cast<size_t>(segmentOffset_ + intervalBytes_ - segmentEnd_);
+        size_t end = len;
+        if (len - pos > room) {
+            const char *newline = static_cast<const char *>(memchr(chunk + room - 1, '\n', len - pos - room + 1));
+            end = newline ? newline - data + 1 : len;
+        }
+        addChunk(chunk, end - pos, first);
+        pos = end;
+        if (segmentEnd_ - segmentOffset_ >= intervalBytes_) {
+            closeSegment();
+        }
+    }
+}
+
+void LogIndexWriter::addChunk(const char *data, size_t len, int64_t first) {
+    // 从最后一行向前找到第一个有时间的行，多行日志的后续行没有时间
+    int64_t last = 0;
+    size_t end = len > 0 && data[len - 1] == '\n' ? len - 1 : len;
+    while (last == 0 && end > 0) {
+        const char *newline = static_cast<const char *>(::memrchr(data, '\n', end));
+        const char *line = newline ? newline + 1 : data;
+        if (line == data) {
+            last = first; // 只剩第一行
+            break;
+        }
+        last = lineTime(line, data + len - line);
+        end = newline - data;
+    }
+    for (int64_t t : {first, last}) {
+        if (t == 0) {
+            continue;
+        }
+        if (firstNs_ == 0 || t < firstNs_) {
+            firstNs_ = t;
+        }
+        if (t > lastNs_) {
+            lastNs_ = t;
+        }
+        if (startNs_ == 0) {
+            startNs_ = t;
+        }
+    }
+    segmentEnd_ += len;
+}
+
+void LogIndexWriter::closeSegment() {
+    if (segmentEnd_ > segmentOffset_) {
+        char entry[kEntrySize];
+        put64(entry, static_cast<uint64_t>(segmentOffset_));
+        put64(entry + 8, static_cast<uint64_t>(segmentEnd_ - segmentOffset_));
+        put64(entry + 16, static_cast<uint64_t>(firstNs_));
+        put64(entry + 24, static_cast<uint64_t>(lastNs_));
+        if (writeAll(fd_, entry, sizeof(entry))) {
+            ++segments_;
+        }
+    }
+    segmentOffset_ = segmentEnd_;
+    firstNs_ = lastNs_ = startNs_ = 0;
+}
+
+LogIndexReader::LogIndexReader(const string &logFile) : fd_(::open(logFile.c_str(), O_RDONLY | O_CLOEXEC)), indexed_(false), fileSize_(0) {
+    struct stat st;
+    if (fd_ < 0 || ::fstat(fd_, &st) != 0) {
+        return;
+    }
+    fileSize_ = st.st_size;
+    FILE *fp = ::fopen((logFile + ".idx").c_str(), "re");
+    if (!fp) {
+        return;
+    }
+    char header[kHeaderSize];
+    if (::fread(header, 1, sizeof(header), fp) == sizeof(header) && memcmp(header, kMagic, 4) == 0 && get32(header + 4) == kVersion) {
+        indexed_ = true;
+        char entry[kEntrySize];
+        off_t end = 0;
+        while (::fread(entry, 1, sizeof(entry), fp) == sizeof(entry)) { // 不完整的最后一项忽略
+            Segment segment;
+            segment.offset = static_cast<off_t>(get64(entry));
+            segment.length = static_cast<off_t>(get64(entry + 8));
+            segment.first = TimeStamp::fromNanoSeconds(static_cast<int64_t>(get64(entry + 16)));
+            segment.last = TimeStamp::fromNanoSeconds(static_cast<int64_t>(get64(entry + 24)));
+            if (segment.offset < end || segment.length <= 0 || segment.offset + segment.length > fileSize_) {
+                break; // 之后的索引与文件不符（文件被截断或索引损坏），当作未索引的结尾
+            }
+            segments_.push_back(segment);
+            end = segment.offset + segment.length;
+        }
+    }
+    ::fclose(fp);
+}
+
+LogIndexReader::~LogIndexReader() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+}
+
+std::vector<std::pair<off_t, off_t>> LogIndexReader::ranges(TimeStamp from, TimeStamp to) const {
+    std::vector<std::pair<off_t, off_t>> result;
+    auto add = [&result](off_t offset, off_t length) {
+        if (!result.empty() && result.back().first + result.back().second == offset) {
+            result.back().second += length;
+        } else {
+            result.emplace_back(offset, length);
+        }
+    };
+    off_t end = 0;
+    bool previous = false; // 上一段是否需要读取，没有时间的段跟随上一段
+    for (const Segment &segment : segments_) {
+        if (segment.offset > end) {
+            add(end, segment.offset - end); // 索引没有覆盖的部分
+            previous = true;
+        }
+        previous = segment.first.valid() ? !(segment.last.nanoSecondsSinceEpoch() + kSlackNs < from.nanoSecondsSinceEpoch() ||
+                                             to.nanoSecondsSinceEpoch() < segment.first.nanoSecondsSinceEpoch() - kSlackNs)
+                                         : previous;
+        if (previous) {
+            add(segment.offset, segment.length);
+        }
+        end = segment.offset + segment.length;
+    }
+    if (fileSize_ > end) {
+        add(end, fileSize_ - end);
+    }
+    return result;
+}
+
+bool LogIndexReader::readRange(TimeStamp from, TimeStamp to, const LineCallback &cb) const {
+    if (fd_ < 0) {
+        return false;
+    }
+    std::vector<char> buf(kReadSize);
+    for (const auto &range : ranges(from, to)) {
+        bool inRange = false; // 上一行是否在范围内，没有时间的行沿用
+        size_t pending = 0;   // buf开头上一次没有读完的半行
+        off_t offset = range.first;
+        const off_t end = range.first + range.second;
+        while (offset < end || pending > 0) {
+            if (pending == buf.size()) {
+                buf.resize(buf.size() * 2); // 超长的行
+            }
+            size_t want = static_cast<size_t>(std::min<off_t>(buf.size() - pending, end - offset));
+            ssize_t n = want > 0 ? ::pread(fd_, buf.data() + pending, want, offset) : 0;
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n < 0) {
+                return false;
+            }
+            offset += n;
+            size_t size = pending + n;
+            bool last = n == 0 || offset >= end; // 区间结尾的半行（进程崩溃或正在写入的文件）也输出
+            const char *data = buf.data();
+            const char *stop = data + size;
+            const char *line = data;
+            while (line < stop) {
+                const char *newline = static_cast<const char *>(memchr(line, '\n', stop - line));
+                if (!newline && !last) {
+                    break;
+                }
+                const char *next = newline ? newline + 1 : stop;
+                int64_t t = lineTime(line, next - line);
+                if (t != 0) {
+                    inRange = !(t < from.nanoSecondsSinceEpoch() || to.nanoSecondsSinceEpoch() < t);
+                }
+                if (inRange) {
+                    cb(line, next - line);
+                }
+                line = next;
+            }
+            pending = stop - line;
+            memmove(buf.data(), line, pending);
+            if (n == 0) {
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+} // namespace myServer
@@ -0,0 +1,274 @@
+#include "LogMerge.h"
+#include "LogGrep.h"
+#include "Logger.h"
+#include <algorithm>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <memory>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace myServer {
+namespace {
+const size_t kReleaseBytes = 16 << 20; // 已合并的部分每累计这么多释放一次
+} // namespace
+
+/**
+ * 一路输入：依次映射同一进程的各个文件，每次给出一条完整的日志（行首所在的行及其后续行）
+ * 下一条日志的行首在切分上一条时已经解析，每行只解析一次
+ */
+class LogMerger::Source : noncopyable {
+  public:
+    Source(std::vector<string> files, size_t index)
+        : index(index), ns(0), record(nullptr), len(0), files_(std::move(files)), next_(0), data_(nullptr), size_(0), end_(nullptr), pos_(nullptr), released_(0),
+          pendingNs_(0), pendingEnd_(nullptr), pageSize_(static_cast<size_t>(::sysconf(_SC_PAGESIZE))) {}
+    ~Source() { unmap(); }
+
+    // 前进到下一条日志，所有文件都结束时返回false
+    bool next() {
+        while (pos_ == end_) {
+            if (!openNext()) {
+                return false;
+            }
+        }
+        record = pos_;
+        ns = pendingNs_;
+        const char *line = pos_;
+        const char *lineEnd = pendingEnd_;
+        for (;;) {
+            line = lineEnd < end_ ? lineEnd + 1 : end_;
+            if (line == end_) {
+                break;
+            }
+            if (*line == '\0') { // 预分配的0字节
+                end_ = line;
+                break;
+            }
+            lineEnd = findNewline(line, end_);
+            LogPrefix prefix;
+            if (parseLogPrefix(line, lineEnd - line, &prefix)) {
+                pendingNs_ = prefix.time.nanoSecondsSinceEpoch();
+                pendingEnd_ = lineEnd;
+                break;
+            }
+        }
+        len = line - record;
+        pos_ = line;
+        release();
+        return true;
+    }
+
+    const size_t index; // 加入的顺序，时间相同时小的先输出
+    int64_t ns;         // 当前日志的时间
+    const char *record; // 当前日志，包括结尾的'\n'（文件最后没有换行时不包括）
+    size_t len;
+
+  private:
+    bool openNext() {
+        unmap();
+        while (next_ < files_.size()) {
+            const string &name = files_[next_++];
+            int fd = ::open(name.c_str(), O_RDONLY | O_CLOEXEC);
+            struct stat st;
+            if (fd < 0 || ::fstat(fd, &st) != 0) {
+                fprintf(stderr, "LogMerger open %s failed %s\n", name.c_str(), strerror_tl(errno));
+                if (fd >= 0) {
+                    ::close(fd);
+                }
+                continue;
+            }
+            size_ = static_cast<size_t>(st.st_size);
+            void *data = size_ > 0 ? ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0) : nullptr;
+            ::close(fd);
+            if (data == MAP_FAILED) {
+                fprintf(stderr, "LogMerger mmap %s failed %s\n", name.c_str(), strerror_tl(errno));
+                continue;
+            }
+            if (!data || *static_cast<const char *>(data) == '\0') {
+                if (data) {
+                    ::munmap(data, size_);
+                }
+                continue;
+            }
+            ::madvise(data, size_, MADV_SEQUENTIAL);
+            data_ = static_cast<const char *>(data);
+            pos_ = data_;
+            end_ = data_ + size_;
+            released_ = 0;
+            pendingEnd_ = findNewline(data_, end_);
+            LogPrefix prefix; // 开头没有行首时沿用上一条日志的时间
+            if (parseLogPrefix(data_, pendingEnd_ - data_, &prefix)) {
+                pendingNs_ = prefix.time.nanoSecondsSinceEpoch();
+            }
+            return true;
+        }
+        return false;
+    }
+
+    void unmap() {
+        if (data_) {
+            ::munmap(const_cast<char *>(data_), size_);
+            data_ = pos_ = end_ = nullptr;
+        }
+    }
+
+    // 释放已合并的页，record所在的页要保留到输出之后
+    void release() {
+        size_t done = (record - data_) / pageSize_ * pageSize_;
+        if (done - released_ >= kReleaseBytes) {
+            ::madvise(const_cast<char *>(data_) + released_, done - released_, MADV_DONTNEED);
+            released_ = done;
+        }
+    }
+
+    const std::vector<string> files_;
+    size_t next_; // 下一个要打开的文件
+    const char *data_;
+    size_t size_;
+    const char *end_;
+    const char *pos_;        // 下一条日志的开始
+    size_t released_;        // 已释放到的偏移
+    int64_t pendingNs_;      // pos_处日志的时间
+    const char *pendingEnd_; // pos_处第一行的结尾
+    const size_t pageSize_;
+};
+
+LogMerger::LogMerger(size_t bufferSize) : bufferSize_(std::max<size_t>(bufferSize, 4096)) {}
+
+LogMerger::~LogMerger() = default;
+
+bool LogMerger::parseLogFileName(const string &path, string *key, string *time) {
+    size_t slash = path.rfind('/');
+    size_t nameStart = slash == string::npos ? 0 : slash + 1;
+    if (path.size() < nameStart + 4 || path.compare(path.size() - 4, 4, ".log") != 0) {
+        return false;
+    }
+    // ".YYYYMMDD-HHMMSS."，basename中可能有'.'，取第一个符合的位置
+    for (size_t p = path.find('.', nameStart); p != string::npos && p + 17 <= path.size() - 4; p = path.find('.', p + 1)) {
+        if (path[p + 9] != '-' || path[p + 16] != '.') {
+            continue;
+        }
+        bool digits = true;
+        for (size_t i = 1; i <= 15 && digits; ++i) {
+            digits = i == 9 || (path[p + i] >= '0' && path[p + i] <= '9');
+        }
+        if (digits) {
+            *key = path.substr(0, p) + path.substr(p + 16, path.size() - 4 - (p + 16));
+            *time = path.substr(p + 1, 15);
+            return true;
+        }
+    }
+    return false;
+}
+
+void LogMerger::addFile(const string &path) {
+    string key, time;
+    if (parseLogFileName(path, &key, &time)) {
+        for (Group &group : groups_) {
+            if (group.key == key) {
+                auto file = std::make_pair(time, path);
+                auto it = std::lower_bound(group.files.begin(), group.files.end(), file);
+                if (it == group.files.end() || *it != file) {
+                    group.files.insert(it, file);
+                }
+                return;
+            }
+        }
+    }
+    groups_.push_back(Group{key, {std::make_pair(time, path)}});
+}
+
+bool LogMerger::add(const string &path) {
+    struct stat st;
+    if (::stat(path.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) {
+        addFile(path); // 不存在的文件在merge()时报告
+        return true;
+    }
+    DIR *dir = ::opendir(path.c_str());
+    if (!dir) {
+        fprintf(stderr, "LogMerger opendir %s failed %s\n", path.c_str(), strerror_tl(errno));
+        return false;
+    }
+    std::vector<string> names;
+    string key, time;
+    while (struct dirent *entry = ::readdir(dir)) {
+        string name = path + "/" + entry->d_name;
+        if (parseLogFileName(name, &key, &time)) {
+            names.push_back(name);
+        }
+    }
+    ::closedir(dir);
+    std::sort(names.begin(), names.end()); // 路的顺序与readdir的顺序无关
+    for (const string &name : names) {
+        addFile(name);
+    }
+    return true;
+}
+
+std::vector<string> LogMerger::files(size_t input) const {
+    std::vector<string> names;
+    for (const auto &file : groups_[input].files) {
+        names.push_back(file.second);
+    }
+    return names;
+}
+
+int64_t LogMerger::merge(const Output &output) {
+    std::vector<std::unique_ptr<Source>> sources;
+    std::vector<Source *> heap;
+    for (size_t i = 0; i < groups_.size(); ++i) {
+        sources.emplace_back(new Source(files(i), i));
+        if (sources.back()->next()) {
+            heap.push_back(sources.back().get());
+        }
+    }
+    // a在b之后输出；std::*_heap是最大堆，用"之后"比较得到最早的在堆顶
+    auto after = [](const Source *a, const Source *b) { return a->ns != b->ns ? a->ns > b->ns : a->index > b->index; };
+    std::make_heap(heap.begin(), heap.end(), after);
+
+    string buffer;
+    buffer.reserve(bufferSize_);
+    auto flush = [&] {
+        if (!buffer.empty()) {
+            output(buffer.data(), buffer.size());
+            buffer.clear();
+        }
+    };
+    int64_t records = 0;
+    while (!heap.empty()) {
+        std::pop_heap(heap.begin(), heap.end(), after);
+        Source *source = heap.back();
+        heap.pop_back();
+        // 同一路连续的日志早于其他各路时直接输出，不经过堆
+        do {
+            if (buffer.size() + source->len + 1 > bufferSize_) {
+                flush();
+            }
+            if (source->len + 1 > bufferSize_) {
+                output(source->record, source->len);
+            } else {
+                buffer.append(source->record, source->len);
+            }
+            if (source->record[source->len - 1] != '\n') {
+                buffer += '\n'; // 文件最后没有换行的半行
+            }
+            ++records;
+            if (!source->next()) {
+                source = nullptr;
+                break;
+            }
+        } while (heap.empty() || !after(source, heap.front()));
+        if (source) {
+            heap.push_back(source);
+            std::push_heap(heap.begin(), heap.end(), after);
+        }
+    }
+    flush();
+    return records;
+}
+
+} // namespace myServer
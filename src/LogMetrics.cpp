@@ -0,0 +1,39 @@
+#include "LogMetrics.h"
+
+namespace myServer {
+LogHistogram::Snapshot LogHistogram::snapshot() const {
+    Snapshot snapshot;
+    snapshot.count = 0;
+    for (int i = 0; i < kBuckets; ++i) {
+        snapshot.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+        snapshot.count += snapshot.buckets[i];
+    }
+    snapshot.sum = sum_.load(std::memory_order_relaxed);
+    snapshot.max = max_.load(std::memory_order_relaxed);
+    return snapshot;
+}
+
+void LogHistogram::reset() {
+    for (auto &bucket : buckets_) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    sum_.store(0, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+}
+
+int64_t LogHistogram::Snapshot::percentile(double q) const {
+    if (count == 0) {
+        return 0;
+    }
+    int64_t rank = static_cast<int64_t>(q * (count - 1)) + 1; // 第rank小的值
+    int64_t seen = 0;
+    for (int i = 0; i < kBuckets; ++i) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            int64_t upper = i == 0 ? 0 : (i >= 63 ? INT64_MAX : (int64_t(1) << i) - 1);
+            return upper < max ? upper : max;
+        }
+    }
+    return max;
+}
+} // namespace myServer
@@ -0,0 +1,184 @@
+#include "LogProfiler.h"
+#include <chrono>
+#include <inttypes.h>
+#include <mutex>
+#include <thread>
+
+namespace myServer {
+namespace profiler {
+const char *const StageName[kNumStages] = {
+    "construct",
+    "formatTime",
+    "operator<<",
+    "~Logger",
+    "g_output",
+    "append lock",
+    "front end",
+    "backend swap",
+    "queue",
+    "write",
+    "enqueue-to-disk",
+};
+
+__thread Record t_record;
+uint32_t g_sampleInterval = 1024;
+
+namespace {
+LogHistogram g_stages[kNumStages];
+
+// 采样的日志所在的缓存，等待后端取走和写完；默认的采样间隔下一块4MB缓存中约有几十条采样
+struct PendingSample {
+    const void *buffer;
+    uint64_t appended; // 写入缓存的时刻
+    uint64_t taken;    // 后端取走缓存的时刻，还没有取走时为0
+};
+const int kMaxPending = 16384;
+std::mutex g_pendingMutex;
+PendingSample g_pending[kMaxPending];
+int g_pendingSize = 0;
+int64_t g_untracked = 0; // 表满时新的采样不再计入后端的阶段，采样间隔太小时出现
+} // namespace
+
+bool enabled() {
+#ifdef YKLOG_PROFILE
+    return true;
+#else
+    return false;
+#endif
+}
+
+void setSampleInterval(uint32_t n) {
+    g_sampleInterval = n > 0 ? n : 1;
+}
+
+void reset() {
+    for (LogHistogram &histogram : g_stages) {
+        histogram.reset();
+    }
+    std::lock_guard<std::mutex> lck(g_pendingMutex);
+    g_pendingSize = 0;
+    g_untracked = 0;
+}
+
+LogHistogram::Snapshot snapshot(Stage stage) {
+    return g_stages[stage].snapshot();
+}
+
+void recordStage(Stage stage, uint64_t cycles) {
+    g_stages[stage].record(static_cast<int64_t>(cycles));
+}
+
+void beginSlow(Record &record) {
+    record.count = 0;
+    record.active = true;
+    record.overhead = 0;
+    record.tsc[kLockBegin] = 0;
+    record.tsc[kLockEnd] = 0; // 不经过AsyncLogging时没有锁的打点
+    record.tsc[kBegin] = now();
+}
+
+void endRecord() {
+    Record &record = t_record;
+    const uint64_t *tsc = record.tsc;
+    recordStage(kConstruct, tsc[kConstructed] - tsc[kBegin]);
+    recordStage(kFormatTime, tsc[kTimeEnd] - tsc[kTimeBegin]);
+    recordStage(kStream, tsc[kDestructBegin] - tsc[kConstructed]);
+    recordStage(kDestruct, tsc[kOutputBegin] - tsc[kDestructBegin]);
+    recordStage(kOutput, tsc[kOutputEnd] - tsc[kOutputBegin] - record.overhead);
+    if (tsc[kLockEnd] != 0) {
+        recordStage(kLockWait, tsc[kLockEnd] - tsc[kLockBegin]);
+    }
+    recordStage(kFrontEnd, tsc[kOutputEnd] - tsc[kBegin] - record.overhead);
+    record.active = false;
+}
+
+// 在append持有的锁内登记，后端只能在这之后取走buffer；登记的耗时从g_output中扣除
+void enqueued(const void *buffer) {
+    uint64_t start = now();
+    {
+        std::lock_guard<std::mutex> lck(g_pendingMutex);
+        if (g_pendingSize < kMaxPending) {
+            g_pending[g_pendingSize++] = {buffer, start, 0};
+        } else {
+            ++g_untracked;
+        }
+    }
+    t_record.overhead += now() - start;
+}
+
+void taken(const void *buffer) {
+    uint64_t tsc = now();
+    std::lock_guard<std::mutex> lck(g_pendingMutex);
+    for (int i = 0; i < g_pendingSize; ++i) {
+        if (g_pending[i].buffer == buffer && g_pending[i].taken == 0) {
+            g_pending[i].taken = tsc;
+        }
+    }
+}
+
+void written(const void *buffer) {
+    uint64_t tsc = now();
+    std::lock_guard<std::mutex> lck(g_pendingMutex);
+    for (int i = 0; i < g_pendingSize;) {
+        PendingSample &sample = g_pending[i];
+        if (sample.buffer == buffer && sample.taken != 0) {
+            recordStage(kQueue, sample.taken - sample.appended);
+            recordStage(kWrite, tsc - sample.taken);
+            recordStage(kEnqueueToDisk, tsc - sample.appended);
+            sample = g_pending[--g_pendingSize];
+        } else {
+            ++i;
+        }
+    }
+}
+
+void discarded(const void *buffer) {
+    std::lock_guard<std::mutex> lck(g_pendingMutex);
+    for (int i = 0; i < g_pendingSize;) {
+        if (g_pending[i].buffer == buffer) {
+            g_pending[i] = g_pending[--g_pendingSize];
+        } else {
+            ++i;
+        }
+    }
+}
+
+static double calibrate() {
+#if defined(__x86_64__) || defined(__i386__)
+    auto start = std::chrono::steady_clock::now();
+    uint64_t startTsc = now();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    uint64_t endTsc = now();
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    return static_cast<double>(endTsc - startTsc) / ns;
+#else
+    return 1; // 没有rdtsc时now()返回纳秒
+#endif
+}
+
+double ticksPerNanoSecond() {
+    static double ticks = calibrate();
+    return ticks;
+}
+
+void report(FILE *out) {
+    double ticks = ticksPerNanoSecond();
+    fprintf(out, "# %.3f cycles/ns, 1 in %u records sampled per thread%s\n", ticks, g_sampleInterval, enabled() ? "" : ", library built without YKLOG_PROFILE");
+    fprintf(out, "%-16s %9s %10s %10s %10s %10s %12s %10s %10s %12s\n", "stage", "samples", "mean", "p50", "p99", "p99.9", "max", "p50_ns", "p99_ns",
+            "max_ns");
+    int64_t untracked;
+    {
+        std::lock_guard<std::mutex> lck(g_pendingMutex);
+        untracked = g_untracked;
+    }
+    for (int stage = 0; stage < kNumStages; ++stage) {
+        LogHistogram::Snapshot s = g_stages[stage].snapshot();
+        fprintf(out, "%-16s %9" PRId64 " %10.0f %10" PRId64 " %10" PRId64 " %10" PRId64 " %12" PRId64 " %10.0f %10.0f %12.0f\n", StageName[stage], s.count, s.mean(), s.percentile(0.5),
+                s.percentile(0.99), s.percentile(0.999), s.max, s.percentile(0.5) / ticks, s.percentile(0.99) / ticks, s.max / ticks);
+    }
+    if (untracked > 0) {
+        fprintf(out, "# %" PRId64 " samples not tracked to the backend, increase the sample interval\n", untracked);
+    }
+}
+} // namespace profiler
+} // namespace myServer
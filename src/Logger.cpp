@@ -1,19 +1,26 @@
 #include "Logger.h"
 #include "CurrentThread.h"
+#include "LogProfiler.h"
 #include "LogStream.h"
 #include "TimeStamp.h"
+#include <algorithm>
 #include <assert.h>
+#include <fnmatch.h>
+#include <mutex>
 #include <string.h>
 #include <thread>
 
 #include <iostream>
+#include <new>
 namespace myServer {
 // Impl私有类，实现日志信息缓冲格式化处理
 class Logger::Impl {
   public:
     using LogLevel = Logger::LogLevel;
     Impl(LogLevel level, int savedErrno, const Logger::SourceFile &file, int line);
-    void formatTime(); // 格式化时间
+    Impl(const LogCallSite &site, int savedErrno);
+    void formatPrefix(int savedErrno); // 写入时间、线程id、级别和错误
+    void formatTime() { Logger::formatTime(stream_, time_); } // 格式化时间
     void finish();     // 写入文件名，前端写日志完成时由析构函数调用
 
     TimeStamp time_;              // 日志创建时的时间戳
@@ -21,6 +28,7 @@ class Logger::Impl {
     LogLevel level_;              // 日志级别
     int line_;                    // 当前记录日式宏的 源代码行号
     Logger::SourceFile basename_; // 当前记录日式宏的 源代码名称
+    const LogCallSite *site_;     // 日志宏的调用点，结尾直接拷贝其中编译期生成的" - 文件名:行号\n"；不是日志宏时为nullptr
 };
 
 // 根据level获得levelname，长度都是6
@@ -58,8 +66,19 @@ inline LogStream &operator<<(LogStream &ts, const T &t) {
 // Impl类的构造函数
 // 级别，错误(没有错误则传0),文件，行
 // Impl类主要是负责日志的格式化, 格式：“时间 线程id 级别 错误”
-Logger::Impl::Impl(LogLevel level, int savedErrno, const Logger::SourceFile &file, int line) : level_(level), basename_(file), line_(line), time_(TimeStamp::now()), stream_() {
+Logger::Impl::Impl(LogLevel level, int savedErrno, const Logger::SourceFile &file, int line) : time_((YKLOG_PROF_BEGIN(), TimeStamp::now())), level_(level), line_(line), basename_(file), site_(nullptr) { // stream_不做值初始化，避免每条日志清零4KB缓冲区
+    formatPrefix(savedErrno);
+}
+Logger::Impl::Impl(const LogCallSite &site, int savedErrno) : time_((YKLOG_PROF_BEGIN(), TimeStamp::now())), level_(site.level), line_(site.line), basename_(""), site_(&site) {
+    formatPrefix(savedErrno);
+    if (level_ <= DEBUG) { // 与原来的LOG_TRACE/LOG_DEBUG一致，写入函数名
+        stream_ << site.func << ' ';
+    }
+}
+void Logger::Impl::formatPrefix(int savedErrno) {
+    YKLOG_PROF_MARK(kTimeBegin);
     formatTime();
+    YKLOG_PROF_MARK(kTimeEnd);
     currentThread::tid(); // 缓存当前线程
 
     // #ifdef DEBUG
@@ -69,34 +88,26 @@ Logger::Impl::Impl(LogLevel level, int savedErrno, const Logger::SourceFile &fil
 
     // stream_ << T(currentThread::tidString(), 6); // FIXME:线程号可能到7位数，不能用确定的数字作为输入
     stream_ << T(currentThread::tidString(), strlen(currentThread::tidString()));
-    stream_ << T(LogLevelName[level], 6);
+    stream_ << T(LogLevelName[level_], 6);
     if (savedErrno) {
         stream_ << strerror_tl(savedErrno) << " (errno=" << savedErrno << ")";
     }
 }
 
-__thread char t_time[64];     // 线程缓存了当前时间字符串 “年:月:日 时:分:秒”
-__thread time_t t_lastSecond; // 线程缓存了上一次日志记录的秒
-void Logger::Impl::formatTime() {
-    int64_t microSecondsSinceEpoch = time_.microSecondsSinceEpoch();        // 获得当前微秒时间戳
-    time_t seconds = static_cast<time_t>(microSecondsSinceEpoch / 1000000); // 获得秒
-    int microSeconds = static_cast<int>(microSecondsSinceEpoch % 1000000);  // 获得微秒
-
-    if (seconds != t_lastSecond) {
-        // 和上一次日志记录不在同一秒
-        // 需要更新t_time 和 t_lastsecond
-        t_lastSecond = seconds;
-        struct tm tm_time;
-        // gmtime_r(&seconds, &tm_time);
-        localtime_r(&seconds, &tm_time);
-        int len = snprintf(t_time, sizeof(t_time), "%4d%02d%02d %02d:%02d:%02d",
-                           tm_time.tm_year + 1900, tm_time.tm_mon + 1, tm_time.tm_mday,
-                           tm_time.tm_hour, tm_time.tm_min, tm_time.tm_sec);
-        assert(len == 17);
+TimeStamp::Precision g_timePrecision = TimeStamp::kMicroSeconds;
+void Logger::setTimePrecision(TimeStamp::Precision precision) {
+    g_timePrecision = precision;
+}
+void Logger::formatTime(LogStream &stream, TimeStamp time) {
+    // 直接写入stream的缓冲区，格式为"年月日 时:分:秒.秒以下Z "
+    LogStream::Buffer &buffer = stream.buffer();
+    if (buffer.avail() > TimeStamp::kMaxFormattedSize + 2) {
+        char *p = buffer.current();
+        size_t len = time.formatTo(p, g_timePrecision);
+        p[len] = 'Z'; // Z表示UTC时区
+        p[len + 1] = ' ';
+        buffer.add(len + 2);
     }
-    char microBuf[32];
-    snprintf(microBuf, sizeof(microBuf), ".%06dZ ", microSeconds); // Z表示UTC时区
-    stream_ << T(t_time, 17) << T(microBuf, 9);
 }
 
 // 重载对SourceFile类型的<<
@@ -106,7 +117,11 @@ inline LogStream &operator<<(LogStream &ts, const Logger::SourceFile &file) {
 }
 void Logger::Impl::finish() {
     // 写入日志完成时的格式化，将文件名和行数写入缓存
-    stream_ << " - " << basename_ << ":" << line_ << '\n';
+    if (site_) {
+        stream_.append(site_->suffix, site_->suffixSize);
+    } else {
+        stream_ << " - " << basename_ << ":" << line_ << '\n';
+    }
 }
 
 void defaultOutput(const char *msg, int len) {
@@ -124,25 +139,38 @@ void Logger::setFlush(Logger::FlushFunc f) {
     g_flush = f;
 }
 Logger::~Logger() {
+    static_assert(sizeof(Impl) <= kImplSize && alignof(Impl) <= alignof(max_align_t), "Logger::kImplSize is too small for Logger::Impl");
     // 使用fwrite写入缓冲区，默认为stdout
+    YKLOG_PROF_MARK(kDestructBegin);
     impl_->finish();
     const LogStream::Buffer &buf(stream().buffer());
 
+    YKLOG_PROF_MARK(kOutputBegin);
     g_output(buf.data(), buf.length());
+    YKLOG_PROF_END();
     if (impl_->level_ == FATAL) {
         // 如果当前日志级别为FATAL，立刻刷新缓冲区并停止程序
         g_flush();
         abort();
     }
+    impl_->~Impl();
 }
-Logger::Logger(SourceFile file, int line) : impl_(new Impl(INFO, 0, file, line)) {
+// YKLOG_PROFILE时Impl构造的第一步打点kBegin，构造函数返回前打点kConstructed
+Logger::Logger(SourceFile file, int line) : impl_(new (implStorage_) Impl(INFO, 0, file, line)) {
+    YKLOG_PROF_MARK(kConstructed);
 }
-Logger::Logger(SourceFile file, int line, LogLevel level) : impl_(new Impl(level, 0, file, line)) {
+Logger::Logger(SourceFile file, int line, LogLevel level) : impl_(new (implStorage_) Impl(level, 0, file, line)) {
+    YKLOG_PROF_MARK(kConstructed);
 }
-Logger::Logger(SourceFile file, int line, LogLevel level, const char *func) : impl_(new Impl(level, 0, file, line)) {
+Logger::Logger(SourceFile file, int line, LogLevel level, const char *func) : impl_(new (implStorage_) Impl(level, 0, file, line)) {
     impl_->stream_ << func << ' ';
+    YKLOG_PROF_MARK(kConstructed);
+}
+Logger::Logger(SourceFile file, int line, bool toAbort) : impl_(new (implStorage_) Impl(toAbort ? FATAL : ERROR, errno, file, line)) {
+    YKLOG_PROF_MARK(kConstructed);
 }
-Logger::Logger(SourceFile file, int line, bool toAbort) : impl_(new Impl(toAbort ? FATAL : ERROR, errno, file, line)) {
+Logger::Logger(const LogCallSite &site, int savedErrno) : impl_(new (implStorage_) Impl(site, savedErrno)) {
+    YKLOG_PROF_MARK(kConstructed);
 }
 
 Logger::LogLevel initLogLevel() {
@@ -154,8 +182,92 @@ Logger::LogLevel initLogLevel() {
         return Logger::INFO;
 }
 Logger::LogLevel g_logLevel = initLogLevel();
+
+namespace {
+// 调用点注册表：已注册调用点的链表和按文件设置级别的规则，修改级别时在锁内重新计算每个调用点的state
+struct SiteRegistry {
+    std::mutex mutex;
+    LogCallSite *head = nullptr;
+    size_t count = 0;
+    std::vector<std::pair<string, Logger::LogLevel>> rules; // 后加入的优先
+};
+SiteRegistry &siteRegistry() {
+    static SiteRegistry registry; // 其他编译单元的静态初始化中也可能写日志
+    return registry;
+}
+
+bool matchSite(const string &pattern, const LogCallSite *site) {
+    return ::fnmatch(pattern.c_str(), site->file, 0) == 0 || (site->basename != site->file && ::fnmatch(pattern.c_str(), site->basename, 0) == 0);
+}
+
+// 在锁内调用
+uint8_t siteState(const SiteRegistry &registry, const LogCallSite *site) {
+    Logger::LogLevel level = g_logLevel;
+    for (auto it = registry.rules.rbegin(); it != registry.rules.rend(); ++it) {
+        if (matchSite(it->first, site)) {
+            level = it->second;
+            break;
+        }
+    }
+    return site->level >= level || site->level == Logger::FATAL ? LogCallSite::kEnabled : LogCallSite::kDisabled;
+}
+
+void updateSites(const SiteRegistry &registry) {
+    for (LogCallSite *site = registry.head; site; site = site->next) {
+        site->state.store(siteState(registry, site), std::memory_order_relaxed);
+    }
+}
+} // namespace
+
 void Logger::setLogLevel(Logger::LogLevel level) {
+    SiteRegistry &registry = siteRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
     g_logLevel = level;
+    updateSites(registry);
+}
+
+size_t Logger::setLogLevel(const string &pattern, LogLevel level) {
+    SiteRegistry &registry = siteRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    auto &rules = registry.rules;
+    rules.erase(std::remove_if(rules.begin(), rules.end(), [&pattern](const std::pair<string, LogLevel> &rule) { return rule.first == pattern; }), rules.end());
+    rules.emplace_back(pattern, level);
+    updateSites(registry);
+    size_t matched = 0;
+    for (const LogCallSite *site = registry.head; site; site = site->next) {
+        matched += matchSite(pattern, site);
+    }
+    return matched;
+}
+
+void Logger::clearLogLevels() {
+    SiteRegistry &registry = siteRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.rules.clear();
+    updateSites(registry);
+}
+
+vector<const LogCallSite *> Logger::callSites() {
+    SiteRegistry &registry = siteRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    vector<const LogCallSite *> sites;
+    sites.reserve(registry.count);
+    for (const LogCallSite *site = registry.head; site; site = site->next) {
+        sites.push_back(site);
+    }
+    return sites;
+}
+
+bool Logger::registerSite(LogCallSite *site) {
+    SiteRegistry &registry = siteRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    if (site->state.load(std::memory_order_relaxed) == LogCallSite::kUnregistered) { // 其他线程可能已经注册
+        site->next = registry.head;
+        registry.head = site;
+        ++registry.count;
+        site->state.store(siteState(registry, site), std::memory_order_relaxed);
+    }
+    return site->state.load(std::memory_order_relaxed) == LogCallSite::kEnabled;
 }
 
 LogStream &Logger::stream() {
@@ -0,0 +1,211 @@
+/** LZ4块格式：由若干序列组成，每个序列为
+ *   token（高4位字面量长度，低4位匹配长度-4，值为15时后面跟着若干字节的扩展长度，每字节累加，直到不是255）
+ *   字面量 | 2字节小端的回溯距离 | 匹配长度的扩展字节
+ * 最后一个序列只有字面量；最后5字节必须是字面量，最后一个匹配必须在结尾12字节之前开始
+ */
+#include "Lz4.h"
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+
+namespace myServer {
+namespace lz4 {
+namespace {
+const size_t kMinMatch = 4;
+const size_t kLastLiterals = 5; // 结尾必须保留的字面量
+const size_t kMfLimit = 12;     // 最后一个匹配的起点距结尾至少12字节
+const size_t kMaxDistance = 65535;
+const int kHashLog = 16;
+const int kSkipTrigger = 6; // 连续未匹配64字节后步长加1
+const size_t kWildCopy = 16; // 解压时距离缓冲区末尾足够远就按16字节整块拷贝
+
+__thread uint32_t t_hashTable[1 << kHashLog]; // 位置表，线程局部，零初始化
+
+inline uint32_t read32(const char *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+inline uint64_t read64(const char *p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+inline uint32_t hash(uint32_t sequence) { return (sequence * 2654435761U) >> (32 - kHashLog); }
+
+// 从ip、ref开始比较，返回相同的字节数，不超过limit
+inline size_t matchLength(const char *ip, const char *ref, const char *limit) {
+    const char *start = ip;
+    while (ip + 8 <= limit) {
+        uint64_t diff = read64(ip) ^ read64(ref);
+        if (diff) {
+            return ip - start + (__builtin_ctzll(diff) >> 3);
+        }
+        ip += 8;
+        ref += 8;
+    }
+    while (ip < limit && *ip == *ref) {
+        ++ip;
+        ++ref;
+    }
+    return ip - start;
+}
+
+// 写入15以上的长度扩展
+inline char *writeLength(char *op, size_t len) {
+    while (len >= 255) {
+        *op++ = static_cast<char>(255);
+        len -= 255;
+    }
+    *op++ = static_cast<char>(len);
+    return op;
+}
+
+// 写入一个序列：literalLen字节字面量，之后是距离offset、长度matchLen的匹配（matchLen为0表示最后一个序列）
+inline char *writeSequence(char *op, const char *literals, size_t literalLen, size_t offset, size_t matchLen) {
+    char *token = op++;
+    *token = static_cast<char>((literalLen >= 15 ? 15 : literalLen) << 4);
+    if (literalLen >= 15) {
+        op = writeLength(op, literalLen - 15);
+    }
+    memcpy(op, literals, literalLen);
+    op += literalLen;
+    if (matchLen == 0) {
+        return op;
+    }
+    *op++ = static_cast<char>(offset & 0xff);
+    *op++ = static_cast<char>(offset >> 8);
+    size_t code = matchLen - kMinMatch;
+    *token |= static_cast<char>(code >= 15 ? 15 : code);
+    if (code >= 15) {
+        op = writeLength(op, code - 15);
+    }
+    return op;
+}
+} // namespace
+
+size_t compress(const char *src, size_t srcLen, char *dst, size_t dstCapacity) {
+    assert(dstCapacity >= compressBound(srcLen));
+    (void)dstCapacity;
+    char *op = dst;
+    const char *anchor = src;
+    if (srcLen > kMfLimit) {
+        const char *ip = src;
+        const char *const mflimit = src + srcLen - kMfLimit;
+        const char *const matchLimit = src + srcLen - kLastLiterals;
+        uint32_t *table = t_hashTable;
+        while (ip < mflimit) {
+            uint32_t sequence = read32(ip);
+            uint32_t h = hash(sequence);
+            size_t pos = ip - src;
+            size_t refPos = table[h];
+            table[h] = static_cast<uint32_t>(pos);
+            // 残留的位置可能来自上一次调用，只要在当前位置之前且内容相同就是有效的匹配
+            if (refPos >= pos || pos - refPos > kMaxDistance || read32(src + refPos) != sequence) {
+                ip += 1 + ((ip - anchor) >> kSkipTrigger);
+                continue;
+            }
+            const char *ref = src + refPos;
+            while (ip > anchor && ref > src && ip[-1] == ref[-1]) { // 向前扩展
+                --ip;
+                --ref;
+            }
+            size_t len = kMinMatch + matchLength(ip + kMinMatch, ref + kMinMatch, matchLimit);
+            op = writeSequence(op, anchor, ip - anchor, ip - ref, len);
+            ip += len;
+            anchor = ip;
+            if (ip < mflimit) {
+                table[hash(read32(ip - 2))] = static_cast<uint32_t>(ip - 2 - src);
+            }
+        }
+    }
+    op = writeSequence(op, anchor, src + srcLen - anchor, 0, 0);
+    return op - dst;
+}
+
+long decompress(const char *src, size_t srcLen, char *dst, size_t dstCapacity) {
+    const unsigned char *ip = reinterpret_cast<const unsigned char *>(src);
+    const unsigned char *const iend = ip + srcLen;
+    char *op = dst;
+    char *const oend = dst + dstCapacity;
+    while (ip < iend) {
+        unsigned token = *ip++;
+        size_t literalLen = token >> 4;
+        if (literalLen == 15) {
+            unsigned s;
+            do {
+                if (ip >= iend) {
+                    return -1;
+                }
+                s = *ip++;
+                literalLen += s;
+            } while (s == 255);
+        }
+        if (literalLen > static_cast<size_t>(iend - ip) || literalLen > static_cast<size_t>(oend - op)) {
+            return -1;
+        }
+        if (literalLen <= kWildCopy && iend - ip >= static_cast<long>(kWildCopy) && oend - op >= static_cast<long>(kWildCopy)) {
+            memcpy(op, ip, kWildCopy); // 多拷贝的部分随后会被覆盖，省去变长memcpy
+        } else {
+            memcpy(op, ip, literalLen);
+        }
+        ip += literalLen;
+        op += literalLen;
+        if (ip == iend) {
+            break; // 最后一个序列只有字面量
+        }
+        if (iend - ip < 2) {
+            return -1;
+        }
+        size_t offset = ip[0] | (static_cast<size_t>(ip[1]) << 8);
+        ip += 2;
+        if (offset == 0 || offset > static_cast<size_t>(op - dst)) {
+            return -1;
+        }
+        size_t matchLen = token & 15;
+        if (matchLen == 15) {
+            unsigned s;
+            do {
+                if (ip >= iend) {
+                    return -1;
+                }
+                s = *ip++;
+                matchLen += s;
+            } while (s == 255);
+        }
+        matchLen += kMinMatch;
+        if (matchLen > static_cast<size_t>(oend - op)) {
+            return -1;
+        }
+        const char *ref = op - offset;
+        char *end = op + matchLen;
+        if (offset >= kWildCopy && oend - end >= static_cast<long>(kWildCopy)) {
+            // 每次16字节，源和目的相距至少16字节，读到的都已写好；末尾最多多写15字节，随后会被覆盖
+            do {
+                memcpy(op, ref, kWildCopy);
+                op += kWildCopy;
+                ref += kWildCopy;
+            } while (op < end);
+            op = end;
+        } else if (offset >= matchLen) {
+            memcpy(op, ref, matchLen);
+            op += matchLen;
+        } else if (offset >= 8) { // 重叠但每次拷贝的8字节都已经写好
+            while (end - op >= 8) {
+                memcpy(op, ref, 8);
+                op += 8;
+                ref += 8;
+            }
+            while (op < end) {
+                *op++ = *ref++;
+            }
+        } else { // 短距离的重复，逐字节拷贝
+            while (op < end) {
+                *op++ = *ref++;
+            }
+        }
+    }
+    return op - dst;
+}
+} // namespace lz4
+} // namespace myServer
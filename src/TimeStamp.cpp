@@ -1,36 +1,197 @@
 #include "TimeStamp.h"
+#include "IntegerConversion.h"
+#include "TscClock.h"
+#include <atomic>
+#include <string.h>
 
 namespace myServer {
+__thread int64_t t_cachedMinute = -1; // 线程缓存的分钟（1970至今的分钟数）
+__thread char t_cachedMinuteStr[16];  // 线程缓存的当前分钟字符串 “年月日 时:分:”
+
+// 写入17字节的"YYYYMMDD HH:MM:SS"，同一分钟内只改写秒。时区偏移按整分钟处理，秒数与UTC相同
+static void formatDateTime(char *buf, time_t seconds) {
+    int64_t minute = seconds >= 0 ? seconds / 60 : (seconds - 59) / 60;
+    if (minute != t_cachedMinute) {
+        t_cachedMinute = minute;
+        time_t start = static_cast<time_t>(minute * 60);
+        struct tm tm_time;
+        localtime_r(&start, &tm_time); // 计算机本地时区
+        char *p = t_cachedMinuteStr;
+        formatFixedWidth(p, tm_time.tm_year + 1900, 4);
+        format2Digits(p + 4, tm_time.tm_mon + 1);
+        format2Digits(p + 6, tm_time.tm_mday);
+        p[8] = ' ';
+        format2Digits(p + 9, tm_time.tm_hour);
+        p[11] = ':';
+        format2Digits(p + 12, tm_time.tm_min);
+        p[14] = ':';
+    }
+    memcpy(buf, t_cachedMinuteStr, 15);
+    format2Digits(buf + 15, static_cast<uint32_t>(seconds - minute * 60));
+}
+
+size_t TimeStamp::formatTo(char *buf, Precision precision) const {
+    // 将当前时间转换为"年月日 时:分:秒"，再按精度加上秒以下的部分
+    int64_t seconds = nanoSecondsSinceEpoch_ / kNanoSecondPerSecond;
+    int64_t nanoSeconds = nanoSecondsSinceEpoch_ % kNanoSecondPerSecond;
+    if (nanoSeconds < 0) {
+        --seconds;
+        nanoSeconds += kNanoSecondPerSecond;
+    }
+    formatDateTime(buf, static_cast<time_t>(seconds));
+    char *p = buf + 17;
+    switch (precision) {
+    case kSeconds:
+        break;
+    case kMilliSeconds:
+        *p++ = '.';
+        formatFixedWidth(p, static_cast<uint32_t>(nanoSeconds / 1000000), 3);
+        p += 3;
+        break;
+    case kMicroSeconds:
+        *p++ = '.';
+        formatFixedWidth(p, static_cast<uint32_t>(nanoSeconds / 1000), 6);
+        p += 6;
+        break;
+    case kNanoSeconds:
+        *p++ = '.';
+        formatFixedWidth(p, static_cast<uint32_t>(nanoSeconds), 9);
+        p += 9;
+        break;
+    }
+    *p = '\0';
+    return p - buf;
+}
+
+size_t TimeStamp::formatCompactTo(char *buf) const {
+    // "YYYYMMDD HH:MM:SS" -> "YYYYMMDD-HHMMSS"
+    char full[kMaxFormattedSize];
+    formatTo(full, kSeconds);
+    memcpy(buf, full, 8);
+    buf[8] = '-';
+    memcpy(buf + 9, full + 9, 2);
+    memcpy(buf + 11, full + 12, 2);
+    memcpy(buf + 13, full + 15, 2);
+    buf[15] = '\0';
+    return 15;
+}
+
+__thread char t_parsedMinuteStr[12]; // 线程缓存的上一次解析的分钟"YYYYMMDDHHMM"
+__thread int64_t t_parsedMinute = -1; // 对应的1970至今的秒数
+
+// 读取n位十进制数字，有非数字时返回-1
+static int parseDigits(const char *p, int n) {
+    int value = 0;
+    for (int i = 0; i < n; ++i) {
+        unsigned digit = static_cast<unsigned char>(p[i]) - '0';
+        if (digit > 9) {
+            return -1;
+        }
+        value = value * 10 + static_cast<int>(digit);
+    }
+    return value;
+}
+
+size_t TimeStamp::parse(const char *buf, size_t len, TimeStamp *ts) {
+    if (len < 17 || buf[8] != ' ' || buf[11] != ':' || buf[14] != ':') {
+        return 0;
+    }
+    char minuteStr[12];
+    memcpy(minuteStr, buf, 8);
+    memcpy(minuteStr + 8, buf + 9, 2);
+    memcpy(minuteStr + 10, buf + 12, 2);
+    int second = parseDigits(buf + 15, 2);
+    if (second < 0 || second > 60) {
+        return 0;
+    }
+    if (t_parsedMinute < 0 || memcmp(minuteStr, t_parsedMinuteStr, sizeof(minuteStr)) != 0) {
+        int year = parseDigits(minuteStr, 4);
+        int month = parseDigits(minuteStr + 4, 2);
+        int day = parseDigits(minuteStr + 6, 2);
+        int hour = parseDigits(minuteStr + 8, 2);
+        int minute = parseDigits(minuteStr + 10, 2);
+        if (year < 0 || month < 1 || month > 12 || day < 1 || day > 31 || hour < 0 || hour > 23 || minute < 0 || minute > 59) {
+            return 0;
+        }
+        struct tm tm_time = {};
+        tm_time.tm_year = year - 1900;
+        tm_time.tm_mon = month - 1;
+        tm_time.tm_mday = day;
+        tm_time.tm_hour = hour;
+        tm_time.tm_min = minute;
+        tm_time.tm_isdst = -1;
+        t_parsedMinute = mktime(&tm_time); // 计算机本地时区，与formatTo一致
+        memcpy(t_parsedMinuteStr, minuteStr, sizeof(minuteStr));
+    }
+    int64_t nanoSeconds = (t_parsedMinute + second) * kNanoSecondPerSecond;
+    size_t n = 17;
+    if (n < len && buf[n] == '.') {
+        int64_t fraction = 0;
+        int digits = 0;
+        while (n + 1 < len && digits < 9 && static_cast<unsigned>(buf[n + 1] - '0') <= 9) {
+            fraction = fraction * 10 + (buf[n + 1] - '0');
+            ++digits;
+            ++n;
+        }
+        if (digits > 0) { // 只有'.'时不属于时间
+            ++n;
+            for (int i = digits; i < 9; ++i) {
+                fraction *= 10;
+            }
+            nanoSeconds += fraction;
+        }
+    }
+    *ts = fromNanoSeconds(nanoSeconds);
+    return n;
+}
+
 std::string TimeStamp::toString() const {
     // 将当前时间戳转化为“秒.微秒”的形式
-    char buf[32] = {0};
-    int64_t seconds = microSecondsSinceEpoch_ / kMicroSecondPerSecond;
-    int64_t microseconds = microSecondsSinceEpoch_ % kMicroSecondPerSecond;
-    // 使用PRId64来表示32位系统和64位系统的64位整数
-    snprintf(buf, sizeof(buf) - 1, "%" PRId64 ".%.06" PRId64, seconds, microseconds);
-    return std::string(buf);
+    char buf[kMaxFormattedSize];
+    int64_t microSeconds = microSecondsSinceEpoch();
+    size_t len = formatInteger(buf, microSeconds / kMicroSecondPerSecond);
+    buf[len++] = '.';
+    formatFixedWidth(buf + len, static_cast<uint32_t>(microSeconds % kMicroSecondPerSecond), 6);
+    return std::string(buf, len + 6);
 }
 std::string TimeStamp::toFormatString(bool showMicroSeconds) const {
-    // 将当前时间转换为"年：月：日：时：分：秒"或者“年：月：日：时：分：秒.微秒”
-    char buf[64] = {0};
-    time_t seconds = static_cast<time_t>(microSecondsSinceEpoch_ / kMicroSecondPerSecond);
-    struct tm *tm_time;
-    // gmtime_r(&seconds, tm_time); // UTC时区
-    tm_time = localtime(&seconds); // 计算机本地时区
-    if (showMicroSeconds) {
-        int64_t microseconds = microSecondsSinceEpoch_ % kMicroSecondPerSecond;
-        snprintf(buf, sizeof(buf) - 1, "%4d%02d%02d% 02d:%02d:%02d.%06" PRId64, tm_time->tm_year + 1900, tm_time->tm_mon, tm_time->tm_mday, tm_time->tm_hour, tm_time->tm_min, tm_time->tm_sec, microseconds);
-    } else {
-        snprintf(buf, sizeof(buf) - 1, "%4d%02d%02d% 02d:%02d:%02d", tm_time->tm_year + 1900, tm_time->tm_mon, tm_time->tm_mday, tm_time->tm_hour, tm_time->tm_min, tm_time->tm_sec);
-    }
-    return std::string(buf);
+    // 将当前时间转换为"年月日 时:分:秒"或者“年月日 时:分:秒.微秒”
+    char buf[kMaxFormattedSize];
+    return std::string(buf, formatTo(buf, showMicroSeconds ? kMicroSeconds : kSeconds));
 }
 
+static atomic<TimeStamp::ClockSource> g_clockSource(TimeStamp::kWallClock);
+static TscClock *g_tscClock = nullptr; // 在切换到kTsc之前设置
+
 TimeStamp TimeStamp::now() {
     // 返回记录当前时间的时间戳
-    struct timeval tv;
-    gettimeofday(&tv, NULL); // 获取当前时间戳，NULL表示默认为UTC时区
-    return TimeStamp(tv.tv_sec * kMicroSecondPerSecond + tv.tv_usec);
+    struct timespec ts;
+    switch (g_clockSource.load(memory_order_acquire)) { // 与setClockSource的release配对，读到kTsc时g_tscClock已设置
+    case kTsc:
+        return fromNanoSeconds(g_tscClock->nowNanoSeconds());
+    case kRealtimeCoarse:
+        clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+        break;
+    default:
+        clock_gettime(CLOCK_REALTIME, &ts); // vDSO实现，不陷入内核
+        break;
+    }
+    return fromNanoSeconds(static_cast<int64_t>(ts.tv_sec) * kNanoSecondPerSecond + ts.tv_nsec);
+}
+
+bool TimeStamp::setClockSource(ClockSource source) {
+    if (source == kTsc) {
+        g_tscClock = TscClock::instance(); // 第一次调用时阻塞完成校准
+        if (!g_tscClock) {
+            return false;
+        }
+    }
+    g_clockSource.store(source, memory_order_release);
+    return true;
+}
+
+TimeStamp::ClockSource TimeStamp::clockSource() {
+    return g_clockSource.load(memory_order_relaxed);
 }
 
 void swap(TimeStamp &lhs, TimeStamp &rhs) {
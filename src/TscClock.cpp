@@ -0,0 +1,118 @@
+#include "TscClock.h"
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+namespace myServer {
+static int64_t wallNanoSeconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+bool TscClock::available() {
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) || eax < 0x80000007) {
+        return false;
+    }
+    __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+    return edx & (1u << 8); // Invariant TSC
+#else
+    return false;
+#endif
+}
+
+TscClock *TscClock::instance() {
+    static TscClock *clock = available() ? new TscClock : nullptr; // 不释放，其他线程可能在进程退出过程中仍在读时间
+    return clock;
+}
+
+TscClock::Sample TscClock::sample() const {
+    // 取多次中两次rdtsc间隔最短的一次，减小clock_gettime耗时带来的误差
+    Sample best{0, 0};
+    uint64_t bestGap = UINT64_MAX;
+    int64_t (*wallClock)() = wallClock_.load(memory_order_acquire);
+    for (int i = 0; i < 5; ++i) {
+        uint64_t before = rdtsc();
+        int64_t wallNs = wallClock();
+        uint64_t after = rdtsc();
+        if (after - before < bestGap) {
+            bestGap = after - before;
+            best = Sample{before + (after - before) / 2, wallNs};
+        }
+    }
+    return best;
+}
+
+TscClock::TscClock() : seq_(0), baseNs_(0), baseTsc_(0), mult_(0), lastOffset_(0), steps_(0), wallClock_(wallNanoSeconds), recalibrateInterval_(kDefaultRecalibrateInterval) {
+    anchor_ = sample();
+    this_thread::sleep_for(chrono::milliseconds(20));
+    Sample now = sample();
+    freqMult_ = static_cast<uint64_t>(static_cast<double>(now.wallNs - anchor_.wallNs) / static_cast<double>(now.tsc - anchor_.tsc) * 4294967296.0);
+    publish(now.wallNs, now.tsc, freqMult_, false);
+    thread_ = thread(&TscClock::threadFunc, this);
+    thread_.detach();
+}
+
+TscClock::~TscClock() = default;
+
+void TscClock::publish(int64_t baseNs, uint64_t baseTsc, uint64_t mult, bool step) {
+    // 只有后台线程（和构造函数）修改参数，不需要写者之间互斥
+    uint32_t seq = seq_.load(memory_order_relaxed);
+    seq_.store(seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    baseNs_.store(baseNs, memory_order_relaxed);
+    baseTsc_.store(baseTsc, memory_order_relaxed);
+    mult_.store(mult, memory_order_relaxed);
+    if (step) {
+        steps_.fetch_add(1, memory_order_relaxed);
+    }
+    seq_.store(seq + 2, memory_order_release);
+}
+
+void TscClock::recalibrate() {
+    Sample now = sample();
+    int64_t current = convert(now.tsc);
+    int64_t offset = now.wallNs - current; // 正数表示TSC时钟落后
+    lastOffset_.store(offset, memory_order_relaxed);
+    if (offset > kMaxStepNs || offset < -kMaxStepNs) {
+        // 墙上时钟被调整，重新建立基线
+        anchor_ = now;
+        publish(now.wallNs, now.tsc, freqMult_, true);
+        return;
+    }
+    if (now.tsc > anchor_.tsc && now.wallNs > anchor_.wallNs) {
+        freqMult_ = static_cast<uint64_t>(static_cast<double>(now.wallNs - anchor_.wallNs) / static_cast<double>(now.tsc - anchor_.tsc) * 4294967296.0);
+    }
+    // 在下一个校准周期内追平偏差：斜率 = 频率 * (周期 + 偏差) / 周期，限制在kMaxSlewPpm以内
+    int64_t periodNs = static_cast<int64_t>(recalibrateInterval_) * 1000000;
+    int64_t slewPpm = offset * 1000000 / periodNs;
+    slewPpm = slewPpm > kMaxSlewPpm ? kMaxSlewPpm : slewPpm < -kMaxSlewPpm ? -kMaxSlewPpm : slewPpm;
+    uint64_t mult = static_cast<uint64_t>(static_cast<__int128>(freqMult_) * (1000000 + slewPpm) / 1000000);
+    publish(current, now.tsc, mult, false); // 以当前换算值为起点，切换点连续
+}
+
+void TscClock::threadFunc() {
+    unique_lock<mutex> lck(mutex_);
+    for (;;) {
+        cond_.wait_for(lck, chrono::milliseconds(recalibrateInterval_));
+        recalibrate();
+    }
+}
+
+void TscClock::setRecalibrateInterval(int milliSeconds) {
+    lock_guard<mutex> lck(mutex_);
+    recalibrateInterval_ = milliSeconds > 0 ? milliSeconds : 1;
+    cond_.notify_one();
+}
+
+void TscClock::setWallClock(int64_t (*wallClock)()) {
+    wallClock_.store(wallClock ? wallClock : wallNanoSeconds, memory_order_release);
+}
+
+double TscClock::ticksPerSecond() const {
+    return 1e9 * 4294967296.0 / static_cast<double>(mult_.load(memory_order_relaxed));
+}
+} // namespace myServer
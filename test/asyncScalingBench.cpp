@@ -0,0 +1,84 @@
+/** 多生产者扩展性测试
+ * 比较全局互斥锁前端与线程局部暂存缓存前端在不同生产者线程数下的吞吐
+ * 使用kBlock策略，缓存池按线程数设置（每个线程都有暂存缓存），吞吐只计写入的日志，丢弃条数单独打印（应为0）
+ * 用法：asyncScalingBench [最大线程数] [每线程日志条数]
+ * 日志文件写在当前目录下，每轮结束后删除，建议在tmpfs中运行以免磁盘成为瓶颈
+ */
+#include "AsyncLogging.h"
+#include <algorithm>
+#include <chrono>
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+using namespace myServer;
+
+struct Run {
+    double seconds;  // 所有生产者写完所需的秒数，只统计前端耗时（包括等待缓存池）
+    int64_t dropped; // 被丢弃的日志条数
+};
+
+void removeLogFiles(const char *prefix) {
+    DIR *dir = opendir(".");
+    while (struct dirent *entry = readdir(dir)) {
+        if (strncmp(entry->d_name, prefix, strlen(prefix)) == 0) {
+            unlink(entry->d_name);
+        }
+    }
+    closedir(dir);
+}
+
+Run runOnce(bool threadLocal, int threads, int messagesPerThread) {
+    Run run;
+    {
+        AsyncLogging log("scaling_bench", 1024 * 1024 * 1024);
+        log.setThreadLocalBuffer(threadLocal);
+        int poolSize = 2 * threads + 2; // maxStagings()不少于线程数
+        log.setBufferPool(poolSize > AsyncLogging::kDefaultPoolSize ? poolSize : AsyncLogging::kDefaultPoolSize);
+        log.setOverflowPolicy(AsyncLogging::kBlock);
+        log.start();
+
+        char line[101];
+        memset(line, 'x', sizeof(line));
+        line[sizeof(line) - 1] = '\n';
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> producers;
+        for (int i = 0; i < threads; ++i) {
+            producers.emplace_back([&] {
+                for (int n = 0; n < messagesPerThread; ++n) {
+                    log.append(line, sizeof(line));
+                }
+            });
+        }
+        for (auto &t : producers) {
+            t.join();
+        }
+        auto end = std::chrono::steady_clock::now();
+        log.stop();
+        run.seconds = std::chrono::duration<double>(end - start).count();
+        run.dropped = log.droppedMessages();
+    }
+    removeLogFiles("scaling_bench.");
+    return run;
+}
+
+int main(int argc, char *argv[]) {
+    int maxThreads = argc > 1 ? atoi(argv[1]) : std::max(4u, std::thread::hardware_concurrency());
+    int messagesPerThread = argc > 2 ? atoi(argv[2]) : 200000;
+
+    printf("%8s %16s %16s %8s %10s %10s\n", "threads", "mutex(Mlines/s)", "local(Mlines/s)", "speedup", "dropped(m)", "dropped(l)");
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+        double total = static_cast<double>(threads) * messagesPerThread;
+        Run global = runOnce(false, threads, messagesPerThread);
+        Run local = runOnce(true, threads, messagesPerThread);
+        double globalRate = (total - global.dropped) / 1e6 / global.seconds;
+        double localRate = (total - local.dropped) / 1e6 / local.seconds;
+        printf("%8d %16.2f %16.2f %8.2f %10lld %10lld\n", threads, globalRate, localRate, localRate / globalRate, static_cast<long long>(global.dropped),
+               static_cast<long long>(local.dropped));
+    }
+    return 0;
+}
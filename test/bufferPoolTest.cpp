@@ -0,0 +1,159 @@
+/** 缓存池溢出策略测试
+ * 用4块缓存的小缓存池和多个生产者制造缓存池耗尽，检查每种策略下
+ * 写入文件的日志条数与统计的丢弃数量之和等于生产的日志条数
+ * 线程局部模式下生产者线程数多于缓存块数时，超过上限的线程使用共享缓存，kBlock不会等到后端定时收集才继续
+ */
+#include "AsyncLogging.h"
+#include <chrono>
+#include <dirent.h>
+#include <stdio.h>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+using namespace myServer;
+
+const int kThreads = 4;
+const int kLinesPerThread = 100000;
+
+// 删除或读取当前目录下以prefix开头的日志文件
+std::vector<std::string> logFiles(const std::string &prefix) {
+    std::vector<std::string> files;
+    DIR *dir = opendir(".");
+    while (struct dirent *entry = readdir(dir)) {
+        if (strncmp(entry->d_name, prefix.c_str(), prefix.size()) == 0) {
+            files.push_back(entry->d_name);
+        }
+    }
+    closedir(dir);
+    return files;
+}
+
+// 统计文件中INFO和ERROR日志的条数
+void countLines(const std::string &prefix, long *info, long *error) {
+    *info = *error = 0;
+    for (const auto &file : logFiles(prefix)) {
+        FILE *fp = fopen(file.c_str(), "r");
+        char line[512];
+        while (fgets(line, sizeof(line), fp)) {
+            if (strstr(line, "INFO  pool-test")) {
+                ++*info;
+            } else if (strstr(line, "ERROR pool-test")) {
+                ++*error;
+            }
+        }
+        fclose(fp);
+    }
+}
+
+bool runPolicy(AsyncLogging::OverflowPolicy policy, const char *name, bool threadLocal) {
+    std::string basename = std::string("pool_test_") + name + (threadLocal ? "_local" : "");
+    for (const auto &file : logFiles(basename + ".")) {
+        unlink(file.c_str());
+    }
+
+    AsyncLogging log(basename.c_str(), 1024 * 1024 * 1024);
+    log.setBufferPool(4);
+    log.setOverflowPolicy(policy, Logger::ERROR);
+    log.setThreadLocalBuffer(threadLocal);
+    log.start();
+
+    std::vector<std::thread> producers;
+    for (int i = 0; i < kThreads; ++i) {
+        producers.emplace_back([&log] {
+            char line[256];
+            for (int n = 0; n < kLinesPerThread; ++n) {
+                int len = snprintf(line, sizeof(line), "20230101 00:00:00.000000Z %5d %spool-test %0150d\n", 1234 + n % 7, n % 2 ? "ERROR " : "INFO  ", n);
+                log.append(line, len);
+            }
+        });
+    }
+    for (auto &t : producers) {
+        t.join();
+    }
+    log.stop();
+
+    long info, error;
+    countLines(basename + ".", &info, &error);
+    const long produced = static_cast<long>(kThreads) * kLinesPerThread;
+    const long lineSize = 26 + 6 + 6 + 10 + 150 + 1;
+    long lost = produced - info - error;
+    bool ok = false;
+    switch (policy) {
+    case AsyncLogging::kBlock:
+        ok = lost == 0;
+        break;
+    case AsyncLogging::kDropNewest:
+        ok = lost == log.droppedMessages();
+        break;
+    case AsyncLogging::kDropOldest:
+        ok = lost * lineSize == log.droppedBytes();
+        break;
+    case AsyncLogging::kDropByLevel:
+        ok = error == produced / 2 && lost == log.droppedMessages();
+        break;
+    }
+    printf("%-12s %-6s written=%ld dropped messages=%ld buffers=%ld bytes=%ld %s\n", name, threadLocal ? "local" : "mutex",
+           info + error, static_cast<long>(log.droppedMessages()), static_cast<long>(log.droppedBuffers()),
+           static_cast<long>(log.droppedBytes()), ok ? "OK" : "FAILED");
+    for (const auto &file : logFiles(basename + ".")) {
+        unlink(file.c_str());
+    }
+    return ok;
+}
+
+// 16个线程、4块缓存：暂存缓存只有1个，其余线程走mutex_路径；刷新间隔30秒，
+// 暂存缓存占满缓存池时阻塞的前端要等到后端定时收集，整个测试会超过30秒
+bool runManyThreads() {
+    const int kManyThreads = 16;
+    const int kLines = 20000;
+    std::string basename = "pool_test_many_local";
+    for (const auto &file : logFiles(basename + ".")) {
+        unlink(file.c_str());
+    }
+    auto start = std::chrono::steady_clock::now();
+    long stagings = 0;
+    {
+        AsyncLogging log(basename.c_str(), 1024 * 1024 * 1024, 30);
+        log.setBufferPool(4);
+        log.setOverflowPolicy(AsyncLogging::kBlock);
+        log.setThreadLocalBuffer(true);
+        log.start();
+        stagings = log.maxStagings();
+        std::vector<std::thread> producers;
+        for (int i = 0; i < kManyThreads; ++i) {
+            producers.emplace_back([&log] {
+                char line[256];
+                for (int n = 0; n < kLines; ++n) {
+                    int len = snprintf(line, sizeof(line), "20230101 00:00:00.000000Z %5d INFO  pool-test %0150d\n", 1234 + n % 7, n);
+                    log.append(line, len);
+                }
+            });
+        }
+        for (auto &t : producers) {
+            t.join();
+        }
+        log.stop();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    long info, error;
+    countLines(basename + ".", &info, &error);
+    bool ok = info == static_cast<long>(kManyThreads) * kLines && stagings == 1 && seconds < 15;
+    printf("%-12s %-6s threads=%d stagings=%ld written=%ld %.1fs %s\n", "manyThreads", "local", kManyThreads, stagings, info, seconds, ok ? "OK" : "FAILED");
+    for (const auto &file : logFiles(basename + ".")) {
+        unlink(file.c_str());
+    }
+    return ok;
+}
+
+int main() {
+    bool ok = true;
+    for (bool threadLocal : {false, true}) {
+        ok &= runPolicy(AsyncLogging::kBlock, "block", threadLocal);
+        ok &= runPolicy(AsyncLogging::kDropNewest, "dropNewest", threadLocal);
+        ok &= runPolicy(AsyncLogging::kDropOldest, "dropOldest", threadLocal);
+        ok &= runPolicy(AsyncLogging::kDropByLevel, "dropByLevel", threadLocal);
+    }
+    ok &= runManyThreads();
+    return ok ? 0 : 1;
+}
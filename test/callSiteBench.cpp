@@ -0,0 +1,72 @@
+/** 编译期调用点元数据和YKLOG_MIN_LEVEL的代价
+ * 1.输出的日志：原来的写法（运行时strrchr计算文件名，行号逐条格式化）与从调用点拷贝编译期生成的" - 文件名:行号\n"比较，输出函数丢弃日志
+ * 2.关闭的日志：运行时关闭的LOG_DEBUG（一次读和一次分支）与YKLOG_MIN_LEVEL在编译期去掉的LOG_DEBUG比较，
+ *   每次调用一个noinline函数，减去空函数调用的时间
+ * 用法：callSiteBench [调用次数]
+ */
+#include "Logger.h"
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+using namespace myServer;
+
+void discard(const char *, int) {}
+
+const char *volatile g_file = __FILE__; // 原来的SourceFile在运行时对__FILE__调用strrchr
+#define OLD_LOG_INFO \
+    if (myServer::Logger::logLevel() <= myServer::Logger::INFO) myServer::Logger(myServer::Logger::SourceFile(g_file), __LINE__).stream()
+
+__attribute__((noinline)) void oldEmitted(long i) {
+    OLD_LOG_INFO << "value " << i;
+}
+__attribute__((noinline)) void siteEmitted(long i) {
+    LOG_INFO << "value " << i;
+}
+__attribute__((noinline)) void emptyCall(long i) {
+    asm volatile("" ::"r"(i));
+}
+__attribute__((noinline)) void runtimeDisabled(long i) {
+    LOG_DEBUG << "value " << i;
+    asm volatile("" ::"r"(i));
+}
+
+// 之后的日志宏按YKLOG_MIN_LEVEL=INFO展开
+#undef YKLOG_MIN_LEVEL
+#define YKLOG_MIN_LEVEL 2
+__attribute__((noinline)) void compiledOut(long i) {
+    LOG_DEBUG << "value " << i;
+    asm volatile("" ::"r"(i));
+}
+
+template <typename F>
+double nsPerCall(long calls, F f) {
+    double best = 1e30;
+    for (int round = 0; round < 5; ++round) {
+        auto start = std::chrono::steady_clock::now();
+        for (long i = 0; i < calls; ++i) {
+            f(i);
+        }
+        best = std::min(best, std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / calls);
+    }
+    return best;
+}
+
+int main(int argc, char *argv[]) {
+    long calls = argc > 1 ? atol(argv[1]) : 50000000;
+    Logger::setOutput(discard);
+    Logger::setLogLevel(Logger::INFO);
+
+    double old = nsPerCall(calls / 10, oldEmitted);
+    double site = nsPerCall(calls / 10, siteEmitted);
+    printf("emitted, runtime basename + line          %7.3f ns\n", old);
+    printf("emitted, compile-time call-site suffix    %7.3f ns (%+.3f)\n", site, site - old);
+
+    double base = nsPerCall(calls, emptyCall);
+    double disabled = nsPerCall(calls, runtimeDisabled);
+    double stripped = nsPerCall(calls, compiledOut);
+    printf("empty noinline call                       %7.3f ns\n", base);
+    printf("LOG_DEBUG disabled at runtime             %7.3f ns (+%.3f)\n", disabled, disabled - base);
+    printf("LOG_DEBUG removed by YKLOG_MIN_LEVEL      %7.3f ns (+%.3f)\n", stripped, stripped - base);
+    return 0;
+}
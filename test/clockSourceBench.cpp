@@ -0,0 +1,41 @@
+/** 各时钟源下TimeStamp::now()的开销
+ * 用法：clockSourceBench [调用次数]
+ */
+#include "TimeStamp.h"
+#include "TscClock.h"
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+using namespace myServer;
+
+template <typename F>
+void measure(const char *name, int calls, F &&once) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < calls; ++i) {
+        once();
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    printf("%-24s %6.1f ns/timestamp\n", name, ns / calls);
+}
+
+int main(int argc, char *argv[]) {
+    int calls = argc > 1 ? atoi(argv[1]) : 10000000;
+    int64_t sink = 0; // 防止编译器优化掉调用
+
+    measure("gettimeofday", calls, [&] {
+        struct timeval tv;
+        gettimeofday(&tv, NULL);
+        sink += tv.tv_usec;
+    });
+    measure("now() kWallClock", calls, [&] { sink += TimeStamp::now().nanoSecondsSinceEpoch(); });
+    TimeStamp::setClockSource(TimeStamp::kRealtimeCoarse);
+    measure("now() kRealtimeCoarse", calls, [&] { sink += TimeStamp::now().nanoSecondsSinceEpoch(); });
+    if (TimeStamp::setClockSource(TimeStamp::kTsc)) {
+        measure("now() kTsc", calls, [&] { sink += TimeStamp::now().nanoSecondsSinceEpoch(); });
+        measure("rdtsc", calls, [&] { sink += TscClock::rdtsc(); });
+    } else {
+        printf("invariant TSC not available\n");
+    }
+    return sink == 0;
+}
@@ -0,0 +1,160 @@
+/** 时钟源测试
+ * 1.单调性：每种时钟在多个线程中各连续读取，同一线程内读到的时间不减
+ * 2.偏差：与clock_gettime(CLOCK_REALTIME)比较，墙上时钟和粗粒度时钟在一个时钟中断以内，
+ *   TSC时钟在初始校准后和频繁重新校准（含追平过程中）持续运行的2秒内都在1ms以内
+ * 3.跳变：TSC时钟参照的墙上时钟调回1小时再调回来，已经读过时间的线程也跟随跳变，不停在跳变前的时间上
+ * 不支持invariant TSC的机器上跳过TSC部分
+ */
+#include "TimeStamp.h"
+#include "TscClock.h"
+#include <atomic>
+#include <stdio.h>
+#include <thread>
+#include <vector>
+using namespace myServer;
+
+int g_failures = 0;
+
+int64_t wallNow() {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * TimeStamp::kNanoSecondPerSecond + ts.tv_nsec;
+}
+
+void checkMonotonic(const char *name) {
+    const int kThreads = 4;
+    std::vector<std::thread> threads;
+    std::vector<int> backwards(kThreads);
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back([t, &backwards] {
+            int64_t last = TimeStamp::now().nanoSecondsSinceEpoch();
+            for (int i = 0; i < 2000000; ++i) {
+                int64_t now = TimeStamp::now().nanoSecondsSinceEpoch();
+                backwards[t] += now < last;
+                last = now;
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    for (int t = 0; t < kThreads; ++t) {
+        if (backwards[t]) {
+            printf("FAIL %s: time went backwards %d times in thread %d\n", name, backwards[t], t);
+            ++g_failures;
+        }
+    }
+}
+
+std::atomic<int64_t> g_wallShift(0);
+int64_t shiftedWallNow() { return wallNow() - g_wallShift.load(); } // 被调回g_wallShift的墙上时钟
+
+// now()与wall()的偏差（纳秒）
+int64_t offsetFrom(int64_t (*wall)()) {
+    int64_t before = wall();
+    int64_t ts = TimeStamp::now().nanoSecondsSinceEpoch();
+    int64_t after = wall();
+    return ts < before ? before - ts : ts > after ? ts - after : 0;
+}
+
+// 每隔1ms比较一次，持续durationMs，返回最大偏差（纳秒）
+int64_t maxOffset(int durationMs) {
+    int64_t worst = 0;
+    for (int i = 0; i < durationMs; ++i) {
+        int64_t offset = offsetFrom(wallNow);
+        worst = offset > worst ? offset : worst;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return worst;
+}
+
+void checkOffset(const char *name, int64_t limitNs) {
+    int64_t worst = maxOffset(500);
+    printf("%s: max offset from CLOCK_REALTIME %.1f us\n", name, worst / 1000.0);
+    if (worst > limitNs) {
+        printf("FAIL %s: offset %ld ns exceeds %ld ns\n", name, static_cast<long>(worst), static_cast<long>(limitNs));
+        ++g_failures;
+    }
+}
+
+// 把墙上时钟调整为shiftNs，等待TSC时钟跳变后检查本线程和另一个跳变前读过时间的线程都跟随了跳变
+void checkStep(TscClock *clock, const char *name, int64_t shiftNs) {
+    std::atomic<int> phase(0);
+    int64_t otherOffset = -1;
+    std::thread other([&] {
+        TimeStamp::now();
+        phase = 1;
+        while (phase.load() != 2) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        otherOffset = offsetFrom(shiftedWallNow);
+    });
+    while (phase.load() != 1) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    TimeStamp::now();
+    int64_t steps = clock->steps();
+    g_wallShift = shiftNs;
+    for (int i = 0; i < 2000 && clock->steps() == steps; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    int64_t offset = offsetFrom(shiftedWallNow);
+    phase = 2;
+    other.join();
+    printf("%s: offset %.1f us, other thread %.1f us\n", name, offset / 1000.0, otherOffset / 1000.0);
+    if (clock->steps() == steps || offset > 1000000 || otherOffset > 1000000) {
+        printf("FAIL %s: %ld steps, offset %ld ns, other thread %ld ns\n", name, static_cast<long>(clock->steps() - steps),
+               static_cast<long>(offset), static_cast<long>(otherOffset));
+        ++g_failures;
+    }
+}
+
+int main() {
+    if (TimeStamp::clockSource() != TimeStamp::kWallClock) {
+        printf("FAIL default clock source\n");
+        ++g_failures;
+    }
+    checkMonotonic("wall clock");
+    checkOffset("wall clock", 1000000);
+
+    TimeStamp::setClockSource(TimeStamp::kRealtimeCoarse);
+    checkMonotonic("coarse clock");
+    checkOffset("coarse clock", 20000000);
+
+    if (!TscClock::available()) {
+        if (TimeStamp::setClockSource(TimeStamp::kTsc)) {
+            printf("FAIL kTsc accepted without invariant TSC\n");
+            ++g_failures;
+        }
+        printf("invariant TSC not available, skipped\n");
+    } else {
+        if (!TimeStamp::setClockSource(TimeStamp::kTsc) || TimeStamp::clockSource() != TimeStamp::kTsc) {
+            printf("FAIL set kTsc\n");
+            ++g_failures;
+        }
+        TscClock *clock = TscClock::instance();
+        printf("TSC frequency %.3f MHz\n", clock->ticksPerSecond() / 1e6);
+        checkOffset("tsc after calibration", 1000000);
+        clock->setRecalibrateInterval(20);
+        checkMonotonic("tsc");
+        int64_t worst = maxOffset(2000);
+        printf("tsc with recalibration: max offset %.1f us, last calibration offset %.1f us, %ld steps\n",
+               worst / 1000.0, clock->lastOffset() / 1000.0, static_cast<long>(clock->steps()));
+        if (worst > 1000000) {
+            printf("FAIL tsc drift: offset %ld ns\n", static_cast<long>(worst));
+            ++g_failures;
+        }
+
+        clock->setWallClock(shiftedWallNow);
+        checkStep(clock, "tsc step back 1h", 3600LL * TimeStamp::kNanoSecondPerSecond);
+        checkStep(clock, "tsc step forward 1h", 0);
+        clock->setWallClock(nullptr);
+    }
+
+    if (g_failures) {
+        printf("%d failures\n", g_failures);
+        return 1;
+    }
+    printf("all passed\n");
+    return 0;
+}
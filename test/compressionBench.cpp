@@ -0,0 +1,115 @@
+/** 分块压缩的吞吐
+ * 用Logger的格式生成日志文本（时间、线程号、级别、若干字段、源文件位置），测量：
+ * 1.lz4::compress/decompress按256KB分块的吞吐和压缩率
+ * 2.LogArchiveWriter（含每行时间解析和索引）的吞吐
+ * 3.compressLogFile文件到文件（含读文件、写归档和落盘），以及LogArchiveReader全文解压、按时间读取1秒数据的耗时
+ * 用法：compressionBench [MB] [目录]
+ */
+#include "LogArchive.h"
+#include "Lz4.h"
+#include <chrono>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+using namespace myServer;
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char *argv[]) {
+    long mb = argc > 1 ? atol(argv[1]) : 256;
+    if (argc > 2 && chdir(argv[2]) != 0) {
+        perror("chdir");
+        return 1;
+    }
+    static const char *messages[] = {"accept connection from 10.0.", "request GET /api/v1/items?id=", "query finished rows=",
+                                     "cache miss key=user:", "send response status=200 bytes=", "close connection fd="};
+    static const char *files[] = {"TcpServer.cpp:87", "HttpServer.cpp:142", "Database.cpp:311", "Cache.cpp:56", "HttpServer.cpp:201",
+                                  "TcpConnection.cpp:98"};
+    std::mt19937 rng(1);
+    std::string log;
+    log.reserve(mb << 20);
+    const int64_t t0 = 1700000000LL * TimeStamp::kNanoSecondPerSecond;
+    int64_t t = t0;
+    char buf[TimeStamp::kMaxFormattedSize];
+    while (log.size() < static_cast<size_t>(mb) << 20) {
+        t += rng() % 20000; // 每秒约10万行
+        int m = rng() % 6;
+        log.append(buf, TimeStamp::fromNanoSeconds(t).formatTo(buf, TimeStamp::kMicroSeconds));
+        log += "Z ";
+        log += std::to_string(4000 + rng() % 8);
+        log += m == 2 ? " DEBUG " : " INFO  ";
+        log += messages[m];
+        log += std::to_string(rng() % 100000);
+        log += " - ";
+        log += files[m];
+        log += '\n';
+    }
+    const double total = static_cast<double>(log.size());
+
+    // 1.纯编解码
+    const size_t kBlock = LogArchiveWriter::kBlockSize;
+    std::vector<char> compressed(log.size() / kBlock * (lz4::compressBound(kBlock)) + lz4::compressBound(kBlock));
+    std::vector<size_t> sizes;
+    auto start = std::chrono::steady_clock::now();
+    size_t out = 0;
+    for (size_t pos = 0; pos < log.size(); pos += kBlock) {
+        size_t len = std::min(kBlock, log.size() - pos);
+        sizes.push_back(lz4::compress(log.data() + pos, len, compressed.data() + out, lz4::compressBound(len)));
+        out += sizes.back();
+    }
+    double compressSeconds = secondsSince(start);
+    std::string decompressed(log.size(), '\0');
+    start = std::chrono::steady_clock::now();
+    size_t in = 0;
+    for (size_t i = 0, pos = 0; i < sizes.size(); ++i, pos += kBlock) {
+        lz4::decompress(compressed.data() + in, sizes[i], &decompressed[pos], std::min(kBlock, log.size() - pos));
+        in += sizes[i];
+    }
+    double decompressSeconds = secondsSince(start);
+    printf("%ld MB of log text, ratio %.2fx (%zu MB)\n", mb, total / out, out >> 20);
+    printf("lz4 compress     %8.0f MB/s\n", total / compressSeconds / 1e6);
+    printf("lz4 decompress   %8.0f MB/s%s\n", total / decompressSeconds / 1e6, decompressed == log ? "" : "  MISMATCH");
+
+    // 2.归档写入，含时间解析
+    start = std::chrono::steady_clock::now();
+    {
+        LogArchiveWriter writer("compression_bench.lz");
+        for (size_t pos = 0; pos < log.size(); pos += 4 << 20) { // 按AsyncLogging的4MB缓存写入
+            writer.append(log.data() + pos, std::min<size_t>(4 << 20, log.size() - pos));
+        }
+        writer.finish();
+    }
+    printf("archive writer   %8.0f MB/s (with fdatasync)\n", total / secondsSince(start) / 1e6);
+    unlink("compression_bench.lz");
+
+    // 3.文件到文件，再读回
+    FILE *fp = fopen("compression_bench.log", "w");
+    fwrite(log.data(), 1, log.size(), fp);
+    fclose(fp);
+    start = std::chrono::steady_clock::now();
+    compressLogFile("compression_bench.log", "compression_bench.log.lz", true);
+    printf("compressLogFile  %8.0f MB/s\n", total / secondsSince(start) / 1e6);
+
+    start = std::chrono::steady_clock::now();
+    LogArchiveReader reader("compression_bench.log.lz");
+    size_t read = 0;
+    std::string block;
+    for (size_t i = 0; i < reader.blocks().size(); ++i) {
+        reader.readBlock(i, &block);
+        read += block.size();
+    }
+    printf("reader full      %8.0f MB/s%s\n", total / secondsSince(start) / 1e6, read == log.size() ? "" : "  SIZE MISMATCH");
+
+    TimeStamp from = TimeStamp::fromNanoSeconds(t0 + (t - t0) / 2); // 中间的一秒
+    start = std::chrono::steady_clock::now();
+    size_t lines = 0;
+    reader.readRange(from, addTime(from, 1.0), [&lines](const char *, size_t) { ++lines; });
+    printf("reader 1s range  %8.2f ms (%zu lines)\n", secondsSince(start) * 1e3, lines);
+    unlink("compression_bench.log.lz");
+    return 0;
+}
@@ -0,0 +1,62 @@
+/** 延迟格式化日志的调用线程延迟测试
+ * 同样的日志内容分别用LOG_INFO的<<链和LOG_INFO_DEFER输出到AsyncLogging，
+ * 统计调用线程上每次调用的耗时分布（不含后端格式化和写文件）
+ * 用法：deferredLogBench [调用次数]，日志文件写在当前目录下
+ */
+#include "AsyncLogging.h"
+#include "DeferredLog.h"
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+using namespace myServer;
+
+AsyncLogging *g_asyncLog = NULL;
+void asyncOutput(const char *msg, int len) {
+    g_asyncLog->append(msg, len);
+}
+void asyncDeferredOutput(const char *record, int len) {
+    g_asyncLog->appendDeferred(record, len);
+}
+
+// 对每次调用计时，输出平均值和分位数
+template <typename F>
+void measure(const char *name, int calls, F &&logOnce) {
+    std::vector<int64_t> samples(calls);
+    auto begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < calls; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        logOnce(i);
+        auto end = std::chrono::steady_clock::now();
+        samples[i] = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    }
+    double total = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count();
+    std::sort(samples.begin(), samples.end());
+    printf("%-10s avg %7.1f ns  p50 %6ld ns  p99 %6ld ns  p99.9 %7ld ns  max %8ld ns\n", name, total / calls,
+           static_cast<long>(samples[calls / 2]), static_cast<long>(samples[calls * 99 / 100]),
+           static_cast<long>(samples[calls * 999 / 1000]), static_cast<long>(samples[calls - 1]));
+}
+
+int main(int argc, char *argv[]) {
+    int calls = argc > 1 ? atoi(argv[1]) : 500000;
+
+    AsyncLogging log("deferred_bench", 1024 * 1024 * 1024);
+    log.setBufferPool(64);
+    log.setOverflowPolicy(AsyncLogging::kBlock);
+    log.start();
+    g_asyncLog = &log;
+    Logger::setOutput(asyncOutput);
+    deferred::setOutput(asyncDeferredOutput);
+
+    const char *user = "alice";
+    measure("stream", calls, [user](int i) {
+        LOG_INFO << "user=" << user << " id=" << i << " latency=" << i * 0.25 << "us ptr=" << &i;
+    });
+    measure("deferred", calls, [user](int i) {
+        LOG_INFO_DEFER("user={} id={} latency={}us ptr={}", user, i, i * 0.25, &i);
+    });
+
+    log.stop();
+    return 0;
+}
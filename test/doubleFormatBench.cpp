@@ -0,0 +1,49 @@
+/** 浮点数格式化开销：formatDouble/formatFixed与原先的snprintf("%.12g")对比
+ * 输入为几种典型量级的随机数，只测量写入缓冲区的耗时
+ * 用法：doubleFormatBench [调用次数]
+ */
+#include "DoubleConversion.h"
+#include <chrono>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+using namespace myServer;
+
+template <typename F>
+void measure(const char *name, const std::vector<double> &values, int calls, F &&format) {
+    char buf[64];
+    size_t total = 0; // 防止编译器优化掉格式化
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < calls; ++i) {
+        total += format(buf, values[i % values.size()]);
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    printf("  %-16s %8.1f ns/value (%zu bytes)\n", name, ns / calls, total);
+}
+
+int main(int argc, char *argv[]) {
+    int calls = argc > 1 ? atoi(argv[1]) : 2000000;
+    std::mt19937_64 rng(1);
+    struct Case {
+        const char *name;
+        double low, high;
+    } cases[] = {
+        {"latency [0, 1000)", 0, 1000},
+        {"ratio [0, 1)", 0, 1},
+        {"large [1e10, 1e15)", 1e10, 1e15},
+    };
+    for (const Case &c : cases) {
+        std::uniform_real_distribution<double> dist(c.low, c.high);
+        std::vector<double> values(4096);
+        for (double &v : values) {
+            v = dist(rng);
+        }
+        printf("%s\n", c.name);
+        measure("snprintf %.12g", values, calls, [](char *buf, double v) { return static_cast<size_t>(snprintf(buf, 64, "%.12g", v)); });
+        measure("formatDouble", values, calls, [](char *buf, double v) { return formatDouble(buf, v); });
+        measure("snprintf %.3f", values, calls, [](char *buf, double v) { return static_cast<size_t>(snprintf(buf, 64, "%.3f", v)); });
+        measure("formatFixed(3)", values, calls, [](char *buf, double v) { return formatFixed(buf, v, 3); });
+    }
+    return 0;
+}
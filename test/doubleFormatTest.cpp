@@ -0,0 +1,163 @@
+/** 浮点数格式化测试
+ * 1.随机位模式的double/float经formatDouble/formatFloat输出后，用strtod/strtof读回必须逐位相等
+ * 2.有效数字不超过17位；与printf能还原的最短写法相比，更长的输出（Grisu2的已知情况）不超过0.2%
+ * 3.特殊值、排版边界和formatFixed的输出与预期字符串一致
+ */
+#include "DoubleConversion.h"
+#include "LogStream.h"
+#include <math.h>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+using namespace myServer;
+
+int g_failures = 0;
+
+void expect(const std::string &actual, const char *expected, const char *what) {
+    if (actual != expected) {
+        printf("FAIL %s: got \"%s\", expected \"%s\"\n", what, actual.c_str(), expected);
+        ++g_failures;
+    }
+}
+
+std::string shortest(double v) {
+    char buf[kMaxDoubleSize];
+    return std::string(buf, formatDouble(buf, v));
+}
+std::string shortestFloat(float v) {
+    char buf[kMaxDoubleSize];
+    return std::string(buf, formatFloat(buf, v));
+}
+std::string fixed(double v, int precision) {
+    char buf[kMaxDoubleSize];
+    return std::string(buf, formatFixed(buf, v, precision));
+}
+
+// 数字串中有效数字的个数（不含前导0、指数）
+int significantDigits(const char *s) {
+    int n = 0, zeros = 0;
+    bool started = false;
+    for (; *s && *s != 'e'; ++s) {
+        if (*s < '0' || *s > '9') {
+            continue;
+        }
+        if (*s == '0') {
+            zeros += started;
+        } else {
+            n += started ? zeros + 1 : 1;
+            zeros = 0;
+            started = true;
+        }
+    }
+    return n;
+}
+
+// printf能还原v的最少有效数字位数
+int minimalDigits(double v, int maxPrecision) {
+    char buf[64];
+    for (int precision = 1; precision < maxPrecision; ++precision) {
+        int len = snprintf(buf, sizeof(buf), "%.*g", precision, v); // 截断的结果不参与比较
+        if (len > 0 && len < static_cast<int>(sizeof(buf)) && strtod(buf, nullptr) == v) {
+            return precision;
+        }
+    }
+    return maxPrecision;
+}
+
+template <typename Float, typename Bits>
+void roundTrip(const char *name, int count, std::mt19937_64 &rng) {
+    int longer = 0;
+    for (int i = 0; i < count; ++i) {
+        Bits bits = static_cast<Bits>(rng());
+        Float v;
+        memcpy(&v, &bits, sizeof(v));
+        if (!isfinite(v)) {
+            continue;
+        }
+        char buf[kMaxDoubleSize + 1];
+        size_t len = sizeof(Float) == sizeof(double) ? formatDouble(buf, v) : formatFloat(buf, static_cast<float>(v));
+        buf[len] = '\0';
+        Float back = sizeof(Float) == sizeof(double) ? static_cast<Float>(strtod(buf, nullptr)) : static_cast<Float>(strtof(buf, nullptr));
+        if (memcmp(&back, &v, sizeof(v)) != 0) {
+            printf("FAIL %s round trip: %.17g -> \"%s\"\n", name, static_cast<double>(v), buf);
+            ++g_failures;
+            continue;
+        }
+        if (sizeof(Float) == sizeof(double)) {
+            int digits = significantDigits(buf);
+            int minimal = minimalDigits(static_cast<double>(v), 17);
+            if (digits > 17) {
+                printf("FAIL %s too long: %.17g -> \"%s\"\n", name, static_cast<double>(v), buf);
+                ++g_failures;
+            }
+            longer += digits > minimal;
+        }
+    }
+    printf("%s: %d values round-tripped, %d longer than shortest\n", name, count, longer);
+    if (longer > count / 500) {
+        printf("FAIL %s: too many non-shortest outputs\n", name);
+        ++g_failures;
+    }
+}
+
+int main() {
+    std::mt19937_64 rng(20240601);
+    roundTrip<double, uint64_t>("double", 1000000, rng);
+    roundTrip<float, uint32_t>("float", 1000000, rng);
+
+    // 数值范围内的均匀随机数，覆盖日志中常见的量级
+    std::uniform_real_distribution<double> uniform(-1e6, 1e6);
+    for (int i = 0; i < 200000; ++i) {
+        double v = uniform(rng);
+        if (strtod(shortest(v).c_str(), nullptr) != v) {
+            printf("FAIL uniform round trip: %.17g -> \"%s\"\n", v, shortest(v).c_str());
+            ++g_failures;
+        }
+    }
+
+    expect(shortest(0.0), "0", "zero");
+    expect(shortest(-0.0), "-0", "negative zero");
+    expect(shortest(NAN), "nan", "nan");
+    expect(shortest(INFINITY), "inf", "inf");
+    expect(shortest(-INFINITY), "-inf", "-inf");
+    expect(shortest(1.0), "1", "one");
+    expect(shortest(-1.5), "-1.5", "negative");
+    expect(shortest(100.0), "100", "integer");
+    expect(shortest(0.1), "0.1", "0.1");
+    expect(shortest(0.1 + 0.2), "0.30000000000000004", "0.1 + 0.2");
+    expect(shortest(123.456), "123.456", "decimal");
+    expect(shortest(0.0001), "0.0001", "small plain");
+    expect(shortest(0.00001), "1e-05", "small exponent");
+    expect(shortest(1e16), "10000000000000000", "large plain");
+    expect(shortest(1e17), "1e+17", "large exponent");
+    expect(shortest(1.5e300), "1.5e+300", "three digit exponent");
+    expect(shortest(5e-324), "5e-324", "min denormal");
+    expect(shortest(1.7976931348623157e308), "1.7976931348623157e+308", "max double");
+    expect(shortest(2.2250738585072014e-308), "2.2250738585072014e-308", "min normal");
+    expect(shortestFloat(0.1f), "0.1", "float 0.1");
+    expect(shortestFloat(3.4028235e38f), "3.4028235e+38", "max float");
+    expect(shortestFloat(1e-45f), "1e-45", "min float denormal");
+
+    expect(fixed(3.14159, 2), "3.14", "fixed");
+    expect(fixed(2.5, 0), "3", "fixed round half up");
+    expect(fixed(-0.001, 2), "-0.00", "fixed negative to zero");
+    expect(fixed(1.0, 3), "1.000", "fixed padding");
+    expect(fixed(0.000123, 6), "0.000123", "fixed leading zeros");
+    expect(fixed(123456.789, 9), "123456.789000000", "fixed max precision");
+    expect(fixed(1e30, 2), "1e+30", "fixed too large");
+    expect(fixed(1.25, 10), "1.25", "fixed precision out of range");
+    expect(fixed(NAN, 2), "nan", "fixed nan");
+
+    LogStream stream;
+    stream << 0.25 << ' ' << 1.0f / 3 << ' ' << Fixed(2.0 / 3, 4);
+    expect(std::string(stream.buffer().data(), stream.buffer().length()), "0.25 0.33333334 0.6667", "LogStream");
+
+    if (g_failures) {
+        printf("%d failures\n", g_failures);
+        return 1;
+    }
+    printf("all passed\n");
+    return 0;
+}
@@ -0,0 +1,73 @@
+/** 后端写文件的吞吐：kStdio（fwrite经过64KB缓冲区）与kWritev（每批缓存一次writev）
+ * 模拟AsyncLogging后端：每批16块4MB的缓存，共写入totalMB，结果包括页缓存的写入，不含落盘
+ * 用法：fileBackendBench [totalMB] [目录]
+ */
+#include "AsyncLogging.h"
+#include "LogFile.h"
+#include <chrono>
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+using namespace myServer;
+
+void removeFiles(const std::string &prefix) {
+    DIR *dir = opendir(".");
+    while (struct dirent *entry = readdir(dir)) {
+        if (strncmp(entry->d_name, prefix.c_str(), prefix.size()) == 0) {
+            unlink(entry->d_name);
+        }
+    }
+    closedir(dir);
+}
+
+int main(int argc, char *argv[]) {
+    long totalMB = argc > 1 ? atol(argv[1]) : 2048;
+    if (argc > 2 && chdir(argv[2]) != 0) {
+        perror("chdir");
+        return 1;
+    }
+    const int kBuffersPerBatch = 16;
+    std::vector<std::unique_ptr<AsyncLogging::Buffer>> buffers;
+    for (int i = 0; i < kBuffersPerBatch; ++i) {
+        buffers.emplace_back(new AsyncLogging::Buffer);
+        std::string line(99, static_cast<char>('a' + i));
+        line += '\n';
+        while (buffers.back()->avail() > static_cast<int>(line.size())) {
+            buffers.back()->append(line.data(), line.size());
+        }
+    }
+    std::vector<struct iovec> iov;
+    for (const auto &buffer : buffers) {
+        iov.push_back({const_cast<char *>(buffer->data()), static_cast<size_t>(buffer->length())});
+    }
+    const long batchBytes = static_cast<long>(kBuffersPerBatch) * buffers[0]->length();
+    const long batches = totalMB * 1024 * 1024 / batchBytes + 1;
+
+    const LogFile::Backend backends[] = {LogFile::kStdio, LogFile::kWritev};
+    const char *names[] = {"stdio", "writev"};
+    for (int b = 0; b < 2; ++b) {
+        std::string basename = std::string("backend_bench_") + names[b];
+        removeFiles(basename + ".");
+        auto start = std::chrono::steady_clock::now();
+        {
+            LogFile file(basename, 1L << 40, false, 3, 1024, backends[b]);
+            for (long i = 0; i < batches; ++i) {
+                if (backends[b] == LogFile::kWritev) {
+                    file.append(iov.data(), static_cast<int>(iov.size()));
+                } else {
+                    for (const auto &buffer : buffers) {
+                        file.append(buffer->data(), buffer->length()); // 原先后端的写法
+                    }
+                }
+            }
+            file.flush();
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        printf("%-8s %6.2f GB/s (%ld MB in %.2fs)\n", names[b], batches * batchBytes / seconds / 1e9, batches * batchBytes >> 20, seconds);
+        removeFiles(basename + ".");
+    }
+    return 0;
+}
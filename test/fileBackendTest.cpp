@@ -0,0 +1,161 @@
+/** 文件写入方式测试
+ * 1.同样的写入序列（超过IOV_MAX块的批量写入、与短消息交错）分别用kStdio、kWritev、kIoUring和kMmap写入，文件内容必须完全一致
+ * 2.kWritev下批量写入超过rollSize后按时滚动到新文件
+ * 3.kMmap超出预分配大小后继续写入，滚动时旧文件截断到实际长度
+ * 4.AsyncLogging各后端写出的日志内容一致
+ */
+#include "AsyncLogging.h"
+#include "LogFile.h"
+#include <dirent.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <vector>
+using namespace myServer;
+
+int g_failures = 0;
+
+std::vector<std::string> logFiles(const std::string &prefix) {
+    std::vector<std::string> files;
+    DIR *dir = opendir(".");
+    while (struct dirent *entry = readdir(dir)) {
+        if (strncmp(entry->d_name, prefix.c_str(), prefix.size()) == 0) {
+            files.push_back(entry->d_name);
+        }
+    }
+    closedir(dir);
+    return files;
+}
+
+void removeFiles(const std::string &prefix) {
+    for (const auto &file : logFiles(prefix)) {
+        unlink(file.c_str());
+    }
+}
+
+std::string readAll(const std::string &prefix) {
+    std::string content;
+    for (const auto &file : logFiles(prefix)) {
+        FILE *fp = fopen(file.c_str(), "r");
+        char buf[65536];
+        size_t n;
+        while ((n = fread(buf, 1, sizeof(buf), fp)) > 0) {
+            content.append(buf, n);
+        }
+        fclose(fp);
+    }
+    return content;
+}
+
+void writeSequence(LogFile::Backend backend, const std::string &basename) {
+    removeFiles(basename + ".");
+    LogFile file(basename, 1L << 30, false, 3, 1024, backend);
+    std::vector<std::string> blocks;
+    for (int i = 0; i < IOV_MAX + 500; ++i) {
+        blocks.push_back("block " + std::to_string(i) + std::string(i % 97, 'x') + "\n");
+    }
+    std::vector<struct iovec> iov;
+    for (const auto &block : blocks) {
+        iov.push_back({const_cast<char *>(block.data()), block.size()});
+    }
+    for (int round = 0; round < 3; ++round) {
+        file.append("short line before batch\n", 24);
+        file.append(iov.data(), static_cast<int>(iov.size()));
+        std::string big(100 * 1024, static_cast<char>('a' + round)); // 大于短消息缓冲区
+        big.back() = '\n';
+        file.append(big.data(), static_cast<int>(big.size()));
+        file.append("short line after batch\n", 23);
+    }
+    file.flush();
+}
+
+int main() {
+    writeSequence(LogFile::kStdio, "backend_test_stdio");
+    writeSequence(LogFile::kWritev, "backend_test_writev");
+    writeSequence(LogFile::kIoUring, "backend_test_iouring");
+    writeSequence(LogFile::kMmap, "backend_test_mmap");
+    std::string stdio = readAll("backend_test_stdio.");
+    std::string writev = readAll("backend_test_writev.");
+    std::string iouring = readAll("backend_test_iouring.");
+    std::string mapped = readAll("backend_test_mmap.");
+    if (stdio.empty() || stdio != writev || stdio != iouring || stdio != mapped) {
+        printf("FAIL content differs: stdio %zu bytes, writev %zu bytes, io_uring %zu bytes, mmap %zu bytes\n", stdio.size(), writev.size(),
+               iouring.size(), mapped.size());
+        ++g_failures;
+    }
+    removeFiles("backend_test_stdio.");
+    removeFiles("backend_test_writev.");
+    removeFiles("backend_test_iouring.");
+    removeFiles("backend_test_mmap.");
+
+    // 超过rollSize后滚动，同一秒内不会重复滚动，所以两次批量写入之间等待1秒
+    removeFiles("backend_test_roll.");
+    {
+        LogFile file("backend_test_roll", 64 * 1024, false, 3, 1024, LogFile::kWritev);
+        std::string block(48 * 1024, 'r');
+        struct iovec iov[2] = {{&block[0], block.size()}, {&block[0], block.size()}};
+        sleep(1);
+        file.append(iov, 2);
+        sleep(1);
+        file.append(iov, 2);
+    }
+    size_t rolled = logFiles("backend_test_roll.").size();
+    if (rolled != 3) {
+        printf("FAIL roll: %zu files, expected 3\n", rolled);
+        ++g_failures;
+    }
+    removeFiles("backend_test_roll.");
+
+    // kMmap预分配64KB，第一批写入超出预分配大小（跨过一个映射窗口）；滚动后旧文件去掉预分配的尾部，新文件关闭后同样截断
+    removeFiles("backend_test_mmap_roll.");
+    {
+        LogFile file("backend_test_mmap_roll", 64 * 1024, false, 3, 1024, LogFile::kMmap);
+        std::string block(12 * 1024 * 1024, 'm');
+        struct iovec iov[2] = {{&block[0], block.size()}, {&block[0], block.size()}};
+        sleep(1);
+        file.append(iov, 2);
+        sleep(1);
+        file.append("after roll\n", 11);
+    }
+    std::string rolledContent = readAll("backend_test_mmap_roll.");
+    if (logFiles("backend_test_mmap_roll.").size() != 2 || rolledContent.size() != 24 * 1024 * 1024 + 11 ||
+        rolledContent.find("after roll\n") == std::string::npos) {
+        printf("FAIL mmap roll: %zu files, %zu bytes\n", logFiles("backend_test_mmap_roll.").size(), rolledContent.size());
+        ++g_failures;
+    }
+    removeFiles("backend_test_mmap_roll.");
+
+    // AsyncLogging的各种后端
+    const LogFile::Backend backends[] = {LogFile::kStdio, LogFile::kWritev, LogFile::kIoUring, LogFile::kMmap};
+    const char *names[] = {"backend_test_async_stdio", "backend_test_async_writev", "backend_test_async_iouring", "backend_test_async_mmap"};
+    std::string contents[4];
+    for (int b = 0; b < 4; ++b) {
+        removeFiles(std::string(names[b]) + ".");
+        AsyncLogging log(names[b], 1L << 30);
+        log.setFileBackend(backends[b]);
+        log.setOverflowPolicy(AsyncLogging::kBlock);
+        log.start();
+        char line[64];
+        for (int i = 0; i < 200000; ++i) {
+            int len = snprintf(line, sizeof(line), "async line %d\n", i);
+            log.append(line, len);
+        }
+        log.stop();
+        contents[b] = readAll(std::string(names[b]) + ".");
+        removeFiles(std::string(names[b]) + ".");
+    }
+    if (contents[0].empty() || contents[0] != contents[1] || contents[0] != contents[2] || contents[0] != contents[3]) {
+        printf("FAIL async content differs: stdio %zu bytes, writev %zu bytes, io_uring %zu bytes, mmap %zu bytes\n", contents[0].size(), contents[1].size(),
+               contents[2].size(), contents[3].size());
+        ++g_failures;
+    }
+
+    if (g_failures) {
+        printf("%d failures\n", g_failures);
+        return 1;
+    }
+    printf("all passed\n");
+    return 0;
+}
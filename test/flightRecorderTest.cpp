@@ -0,0 +1,294 @@
+/** FlightRecorder测试，崩溃的场景在子进程中进行
+ * 1.正常stop()：日志全部写入日志文件，映射文件中没有需要恢复的内容，状态为stopped
+ * 2.SIGKILL（没有信号处理的机会）：还在前端缓存中的日志可以从映射文件中按顺序取出；下一次以同一路径启动时自动取出到path.tail
+ * 3.LOG_FATAL的abort()：信号处理函数把尾部（包括FATAL这一行）写到path.tail，进程仍以SIGABRT终止
+ * 4.空指针写入触发SIGSEGV：同上，进程以SIGSEGV终止
+ * 5.持续写入多块缓存时SIGKILL：日志文件加上恢复的尾部包含每一行，尾部按写入顺序排列
+ * 6.后端交换时取出新的currentBuffer_，之后前端写满它再换上更早取出的nextBuffer_，SIGKILL后恢复的尾部仍按写入顺序排列
+ */
+#include "AsyncLogging.h"
+#include "FlightRecorder.h"
+#include "Logger.h"
+#include <dirent.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+using namespace myServer;
+
+int g_failures = 0;
+AsyncLogging *g_asyncLog = nullptr;
+int *volatile g_null = nullptr; // 全局的volatile指针，优化时也会真正写入
+
+void check(bool ok, const char *what) {
+    if (!ok) {
+        printf("FAIL %s\n", what);
+        ++g_failures;
+    }
+}
+
+void asyncOutput(const char *msg, int len) {
+    g_asyncLog->append(msg, len);
+}
+
+std::vector<std::string> filesWithPrefix(const std::string &prefix) {
+    std::vector<std::string> files;
+    DIR *dir = opendir(".");
+    while (struct dirent *entry = readdir(dir)) {
+        if (strncmp(entry->d_name, prefix.c_str(), prefix.size()) == 0) {
+            files.push_back(entry->d_name);
+        }
+    }
+    closedir(dir);
+    return files;
+}
+
+void removeFiles(const std::string &prefix) {
+    for (const auto &file : filesWithPrefix(prefix)) {
+        unlink(file.c_str());
+    }
+}
+
+std::string readFile(const std::string &path) {
+    std::string content;
+    FILE *fp = fopen(path.c_str(), "r");
+    if (fp) {
+        char buf[65536];
+        size_t n;
+        while ((n = fread(buf, 1, sizeof(buf), fp)) > 0) {
+            content.append(buf, n);
+        }
+        fclose(fp);
+    }
+    return content;
+}
+
+// 日志文件basename.*.log的全部内容
+std::string readLogs(const std::string &basename) {
+    std::string content;
+    for (const auto &file : filesWithPrefix(basename + ".")) {
+        if (file.size() > 4 && file.compare(file.size() - 4, 4, ".log") == 0) {
+            content += readFile(file);
+        }
+    }
+    return content;
+}
+
+std::string recovered(const std::string &ring) {
+    std::string out = ring + ".out";
+    unlink(out.c_str());
+    int fd = ::open(out.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    std::string error;
+    int64_t bytes = FlightRecorder::recover(ring, fd, &error);
+    ::close(fd);
+    std::string content = bytes >= 0 ? readFile(out) : "";
+    unlink(out.c_str());
+    return content;
+}
+
+// 按顺序取出"flight N"中的N
+std::vector<long> lineNumbers(const std::string &content) {
+    std::vector<long> numbers;
+    for (size_t pos = content.find("flight "); pos != std::string::npos; pos = content.find("flight ", pos + 1)) {
+        numbers.push_back(atol(content.c_str() + pos + 7));
+    }
+    return numbers;
+}
+
+bool isSequence(const std::vector<long> &numbers, long count) {
+    if (static_cast<long>(numbers.size()) != count) {
+        return false;
+    }
+    for (long i = 0; i < count; ++i) {
+        if (numbers[i] != i) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 子进程中启动一个使用FlightRecorder的AsyncLogging，写lines条日志后执行crash；返回子进程的终止信号
+template <typename F>
+int runChild(const std::string &basename, long lines, int flushInterval, F crash) {
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        struct rlimit noCore = {0, 0};
+        setrlimit(RLIMIT_CORE, &noCore);
+        AsyncLogging *log = new AsyncLogging(basename.c_str(), 1024L * 1024 * 1024, flushInterval);
+        log->setFlightRecorder(basename + ".ring");
+        log->start();
+        g_asyncLog = log;
+        Logger::setOutput(asyncOutput);
+        for (long i = 0; i < lines; ++i) {
+            LOG_INFO << "flight " << i << " padding padding padding padding padding padding padding";
+        }
+        crash();
+        _exit(0);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return WIFSIGNALED(status) ? WTERMSIG(status) : 0;
+}
+
+void testCleanStop() {
+    std::string basename = "recorder_clean";
+    removeFiles(basename + ".");
+    {
+        AsyncLogging log(basename.c_str(), 1024L * 1024 * 1024);
+        log.setFlightRecorder(basename + ".ring");
+        log.start();
+        check(log.flightRecorder() != nullptr, "recorder created");
+        for (int i = 0; i < 1000; ++i) {
+            std::string line = "flight " + std::to_string(i) + "\n";
+            log.append(line.data(), static_cast<int>(line.size()));
+        }
+        log.stop();
+    }
+    check(isSequence(lineNumbers(readLogs(basename)), 1000), "all lines in the log file");
+    check(recovered(basename + ".ring").empty(), "nothing to recover after stop()");
+    char buf[4096] = {};
+    FILE *out = fmemopen(buf, sizeof(buf), "w");
+    std::string error;
+    check(FlightRecorder::describe(basename + ".ring", out, &error), "describe");
+    fclose(out);
+    check(strstr(buf, "state stopped") != nullptr && strstr(buf, "basename recorder_clean") != nullptr, "stopped state in header");
+    removeFiles(basename + ".");
+}
+
+void testKilled() {
+    std::string basename = "recorder_kill";
+    removeFiles(basename + ".");
+    int sig = runChild(basename, 5000, 60, [] { kill(getpid(), SIGKILL); });
+    check(sig == SIGKILL, "child killed");
+    check(readLogs(basename).empty(), "nothing reached the log file");
+    check(isSequence(lineNumbers(recovered(basename + ".ring")), 5000), "tail recovered in order after SIGKILL");
+
+    // 下一次启动时自动取出
+    FlightRecorder *recorder = FlightRecorder::create(basename + ".ring", 4, basename);
+    check(recorder != nullptr, "recreate");
+    delete recorder;
+    check(isSequence(lineNumbers(readFile(basename + ".ring.tail")), 5000), "tail saved on the next start");
+    check(recovered(basename + ".ring").empty(), "new file is empty");
+    removeFiles(basename + ".");
+}
+
+void testFatal() {
+    std::string basename = "recorder_fatal";
+    removeFiles(basename + ".");
+    int sig = runChild(basename, 3000, 60, [] { LOG_FATAL << "fatal error after 3000 lines"; });
+    check(sig == SIGABRT, "LOG_FATAL still aborts");
+    std::string tail = readFile(basename + ".ring.tail");
+    check(isSequence(lineNumbers(tail), 3000), "tail drained by the SIGABRT handler");
+    check(tail.find("FATAL fatal error after 3000 lines") != std::string::npos, "fatal line drained");
+    char buf[4096] = {};
+    FILE *out = fmemopen(buf, sizeof(buf), "w");
+    std::string error;
+    FlightRecorder::describe(basename + ".ring", out, &error);
+    fclose(out);
+    check(strstr(buf, "state drained") != nullptr, "drained state in header");
+    removeFiles(basename + ".");
+}
+
+void testSegv() {
+    std::string basename = "recorder_segv";
+    removeFiles(basename + ".");
+    int sig = runChild(basename, 2000, 60, [] { *g_null = 1; });
+    check(sig == SIGSEGV, "SIGSEGV still terminates");
+    check(isSequence(lineNumbers(readFile(basename + ".ring.tail")), 2000), "tail drained by the SIGSEGV handler");
+    removeFiles(basename + ".");
+}
+
+// 冻结除当前线程外的所有线程（即后端线程），之后交给后端的缓存不会被写入
+void freezeOnSignal(int) {
+    for (;;) {
+        pause();
+    }
+}
+void freezeOtherThreads() {
+    signal(SIGUSR1, freezeOnSignal);
+    long self = syscall(SYS_gettid);
+    DIR *dir = opendir("/proc/self/task");
+    while (struct dirent *entry = readdir(dir)) {
+        long tid = atol(entry->d_name);
+        if (tid > 0 && tid != self) {
+            syscall(SYS_tgkill, getpid(), tid, SIGUSR1);
+        }
+    }
+    closedir(dir);
+}
+
+void testPromotion() {
+    std::string basename = "recorder_promote";
+    removeFiles(basename + ".");
+    const long kFirst = 10;
+    const long kLines = 50000; // 多于一块缓存，写满currentBuffer_后换上nextBuffer_
+    int sig = runChild(basename, kFirst, 1, [=] {
+        usleep(1500 * 1000); // 后端超时交换：前kFirst行写入日志文件，取出新的currentBuffer_，nextBuffer_仍是启动时取出的
+        freezeOtherThreads();
+        usleep(100 * 1000);
+        for (long i = kFirst; i < kLines; ++i) {
+            LOG_INFO << "flight " << i << " padding padding padding padding padding padding padding";
+        }
+        kill(getpid(), SIGKILL);
+    });
+    check(sig == SIGKILL, "promotion child killed");
+    std::vector<long> written = lineNumbers(readLogs(basename));
+    std::vector<long> tail = lineNumbers(recovered(basename + ".ring"));
+    check(isSequence(written, kFirst), "first lines written by the timed swap");
+    bool ordered = static_cast<long>(tail.size()) == kLines - kFirst;
+    for (size_t i = 0; ordered && i < tail.size(); ++i) {
+        ordered = tail[i] == kFirst + static_cast<long>(i);
+    }
+    check(ordered, "tail in order after nextBuffer_ promotion");
+    removeFiles(basename + ".");
+}
+
+void testNoLoss() {
+    std::string basename = "recorder_stream";
+    removeFiles(basename + ".");
+    const long kLines = 150000; // 约15MB，跨越多块缓存
+    int sig = runChild(basename, kLines, 1, [] { kill(getpid(), SIGKILL); });
+    check(sig == SIGKILL, "streaming child killed");
+    std::vector<long> written = lineNumbers(readLogs(basename));
+    std::vector<long> tail = lineNumbers(recovered(basename + ".ring"));
+    std::vector<bool> seen(kLines, false);
+    for (long n : written) {
+        seen[n] = true;
+    }
+    bool ordered = true;
+    for (size_t i = 0; i < tail.size(); ++i) {
+        seen[tail[i]] = true;
+        ordered = ordered && (i == 0 || tail[i] == tail[i - 1] + 1);
+    }
+    bool all = true;
+    for (long i = 0; i < kLines; ++i) {
+        all = all && seen[i];
+    }
+    check(all, "log file plus recovered tail has every line");
+    check(ordered && (tail.empty() || tail.back() == kLines - 1), "tail is the ordered end of the stream");
+    removeFiles(basename + ".");
+}
+
+int main() {
+    testCleanStop();
+    testKilled();
+    testFatal();
+    testSegv();
+    testNoLoss();
+    testPromotion();
+
+    if (g_failures) {
+        printf("%d failures\n", g_failures);
+        return 1;
+    }
+    printf("all passed\n");
+    return 0;
+}
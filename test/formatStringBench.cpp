@@ -0,0 +1,48 @@
+/** 编译期格式串与<<链的格式化开销对比
+ * 只测量把同样的内容写入LogStream的耗时，以及完整的LOG_INFO/LOG_INFO_FMT写入空输出的耗时
+ * 用法：formatStringBench [调用次数]
+ */
+#include "Logger.h"
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+using namespace myServer;
+
+void nullOutput(const char *, int) {}
+
+template <typename F>
+void measure(const char *name, int calls, F &&once) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < calls; ++i) {
+        once(i);
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    printf("%-16s %8.1f ns/call\n", name, ns / calls);
+}
+
+int main(int argc, char *argv[]) {
+    int calls = argc > 1 ? atoi(argv[1]) : 2000000;
+    const char *user = "alice";
+    LogStream stream;
+    size_t total = 0; // 防止编译器优化掉格式化
+
+    measure("stream <<", calls, [&](int i) {
+        stream.resetBuffer();
+        stream << "user=" << user << " id=" << i << " latency=" << i * 0.25 << "us hits=" << i * 7L << " miss=" << -i;
+        total += stream.buffer().length();
+    });
+    measure("fmt::formatTo", calls, [&](int i) {
+        stream.resetBuffer();
+        fmt::formatTo(stream, YKLOG_FMT_STRING_("user={} id={} latency={}us hits={} miss={}"), user, i, i * 0.25, i * 7L, -i);
+        total += stream.buffer().length();
+    });
+
+    Logger::setOutput(nullOutput);
+    measure("LOG_INFO <<", calls, [&](int i) {
+        LOG_INFO << "user=" << user << " id=" << i << " latency=" << i * 0.25 << "us hits=" << i * 7L << " miss=" << -i;
+    });
+    measure("LOG_INFO_FMT", calls, [&](int i) {
+        LOG_INFO_FMT("user={} id={} latency={}us hits={} miss={}", user, i, i * 0.25, i * 7L, -i);
+    });
+    return total == 0;
+}
@@ -0,0 +1,100 @@
+/** 编译期格式串测试，LOG_*_FMT的输出与同样内容的<<链逐字节比较
+ * 1.各种字符串参数：const char*、char*、char[]、字符串字面量、string、空的char*
+ * 2.整数、浮点数、字符、指针、Fixed
+ * 3.{{、}}与{}混合，格式串首尾的占位符，没有占位符的格式串
+ * 4.缓冲区剩余空间不足时退化为逐段写入，结果与<<链一致
+ * 5.LOG_INFO_FMT与LOG_INFO <<输出同样的日志行
+ */
+#include "FormatString.h"
+#include "Logger.h"
+#include <stdio.h>
+#include <string.h>
+#include <string>
+using namespace myServer;
+
+int g_failures = 0;
+std::string g_line;
+
+void captureOutput(const char *msg, int len) {
+    g_line.assign(msg, len);
+}
+
+std::string text(LogStream &stream) {
+    return std::string(stream.buffer().data(), stream.buffer().length());
+}
+
+void expect(const std::string &actual, const std::string &expected, const char *what) {
+    if (actual != expected) {
+        printf("FAIL %s: got \"%s\", expected \"%s\"\n", what, actual.c_str(), expected.c_str());
+        ++g_failures;
+    }
+}
+
+#define EXPECT_FMT(expected, format, ...)                               \
+    do {                                                                \
+        LogStream stream;                                               \
+        fmt::formatTo(stream, YKLOG_FMT_STRING_(format), ##__VA_ARGS__); \
+        expect(text(stream), expected, format);                        \
+    } while (0)
+
+int main() {
+    // 1
+    const char *constPtr = "const";
+    char mutableArray[] = "mutable";
+    char *mutablePtr = mutableArray;
+    char *nullPtr = nullptr;
+    const char *constNull = nullptr;
+    std::string str = "string";
+    EXPECT_FMT("charptr=const done", "charptr={} done", constPtr);
+    EXPECT_FMT("charptr=mutable done", "charptr={} done", mutablePtr);
+    EXPECT_FMT("array=mutable done", "array={} done", mutableArray);
+    EXPECT_FMT("literal=lit done", "literal={} done", "lit");
+    EXPECT_FMT("str=string done", "str={} done", str);
+    EXPECT_FMT("null=(NULL) (NULL)", "null={} {}", nullPtr, constNull);
+    {
+        LogStream stream;
+        stream << "charptr=" << mutablePtr << " array=" << mutableArray << " null=" << nullPtr;
+        expect(text(stream), "charptr=mutable array=mutable null=(NULL)", "<< reference");
+    }
+
+    // 2
+    {
+        LogStream expected;
+        int *ptr = &g_failures;
+        expected << 42 << ' ' << -7L << ' ' << 3000000000U << ' ' << 1.5 << ' ' << 'c' << ' ' << static_cast<const void *>(ptr) << ' ' << Fixed(2.5, 2);
+        EXPECT_FMT(text(expected), "{} {} {} {} {} {} {}", 42, -7L, 3000000000U, 1.5, 'c', static_cast<const void *>(ptr), Fixed(2.5, 2));
+    }
+
+    // 3
+    EXPECT_FMT("{literal} {x}", "{{literal}} {{{}}}", "x");
+    EXPECT_FMT("a{b}c", "{}{{{}}}{}", "a", "b", 'c');
+    EXPECT_FMT("no placeholders {}", "no placeholders {{}}");
+    EXPECT_FMT("", "");
+
+    // 4
+    {
+        LogStream stream;
+        std::string fill(kSmallBuffer - 20, 'x');
+        stream << fill;
+        fmt::formatTo(stream, YKLOG_FMT_STRING_("{} {} {}"), mutablePtr, str, 123456789);
+        LogStream expected;
+        expected << fill << mutablePtr << ' ' << str << ' ' << 123456789;
+        expect(text(stream), text(expected), "near full buffer");
+    }
+
+    // 5
+    Logger::setOutput(captureOutput);
+    LOG_INFO << "charptr=" << mutablePtr << " array=" << mutableArray << " n=" << 7;
+    std::string streamed = g_line.substr(g_line.find("charptr="));
+    LOG_INFO_FMT("charptr={} array={} n={}", mutablePtr, mutableArray, 7);
+    std::string formatted = g_line.substr(g_line.find("charptr="));
+    expect(formatted.substr(0, formatted.find(" - ")), streamed.substr(0, streamed.find(" - ")), "LOG_INFO_FMT");
+    expect(formatted.substr(0, formatted.find(" - ")), "charptr=mutable array=mutable n=7", "LOG_INFO_FMT content");
+
+    if (g_failures) {
+        printf("%d failures\n", g_failures);
+        return 1;
+    }
+    printf("all passed\n");
+    return 0;
+}
@@ -0,0 +1,212 @@
+/** 流式帧压缩测试
+ * 1.encodeFrame写出的帧由LogFrameReader读回与原文一致，包括不可压缩的数据（按未压缩存储）
+ * 2.文件在任意位置截断、或最后一帧的数据被篡改时，之前的帧都能读出，truncated()只在截断不在帧边界时为true
+ * 3.LogFile的compressed模式下rollSize按压缩后的字节计算：原始数据超过rollSize但压缩后没有超过时不roll
+ * 4.AsyncLogging开启setCompressInline后，各后端写出的.log.lzs解压后与输入一致
+ */
+#include "AsyncLogging.h"
+#include "LogArchive.h"
+#include "LogFile.h"
+#include <dirent.h>
+#include <random>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <vector>
+using namespace myServer;
+
+int g_failures = 0;
+
+std::vector<std::string> logFiles(const std::string &prefix) {
+    std::vector<std::string> files;
+    DIR *dir = opendir(".");
+    while (struct dirent *entry = readdir(dir)) {
+        if (strncmp(entry->d_name, prefix.c_str(), prefix.size()) == 0) {
+            files.push_back(entry->d_name);
+        }
+    }
+    closedir(dir);
+    return files;
+}
+
+void removeFiles(const std::string &prefix) {
+    for (const auto &file : logFiles(prefix)) {
+        unlink(file.c_str());
+    }
+}
+
+// 读出文件中所有完整的帧
+std::string readFrames(const std::string &filename, int *frames, bool *truncated) {
+    LogFrameReader reader(filename);
+    std::string all;
+    std::string data;
+    *frames = 0;
+    while (reader.next(&data)) {
+        all += data;
+        ++*frames;
+    }
+    *truncated = reader.truncated();
+    return all;
+}
+
+std::string makeText(size_t size, std::mt19937 &rng) {
+    std::string text;
+    char line[128];
+    while (text.size() < size) {
+        text.append(line, snprintf(line, sizeof(line), "20240101 12:00:00.%06uZ 4242 INFO  request id=%u done - server.cpp:%u\n", static_cast<unsigned>(rng() % 1000000),
+                                   static_cast<unsigned>(rng() % 100000), static_cast<unsigned>(rng() % 500)));
+    }
+    text.resize(size);
+    return text;
+}
+
+int main() {
+    std::mt19937 rng(7);
+
+    // 1.编码后读回
+    std::vector<std::string> inputs;
+    inputs.push_back(makeText(100, rng));
+    inputs.push_back(makeText(300000, rng));
+    std::string random(70000, '\0');
+    for (auto &c : random) {
+        c = static_cast<char>(rng());
+    }
+    inputs.push_back(random);
+    inputs.push_back(std::string(1 << 20, 'x'));
+    inputs.push_back("x");
+    std::string file;
+    std::vector<size_t> boundaries; // 每帧结束的偏移
+    std::string expected;
+    for (const auto &input : inputs) {
+        std::vector<char> frame(frameBound(input.size()));
+        file.append(frame.data(), encodeFrame(input.data(), input.size(), frame.data()));
+        boundaries.push_back(file.size());
+        expected += input;
+    }
+    const char *kFramesFile = "frame_test.lzs";
+    auto writeFile = [kFramesFile](const std::string &content) {
+        FILE *fp = fopen(kFramesFile, "w");
+        fwrite(content.data(), 1, content.size(), fp);
+        fclose(fp);
+    };
+    writeFile(file);
+    int frames;
+    bool truncated;
+    if (!isFrameFile(kFramesFile) || readFrames(kFramesFile, &frames, &truncated) != expected || frames != 5 || truncated) {
+        printf("FAIL frame round trip: %d frames, truncated %d\n", frames, truncated);
+        ++g_failures;
+    }
+    if (boundaries[2] - boundaries[1] < random.size()) {
+        printf("FAIL incompressible frame is %zu bytes for %zu bytes of input\n", boundaries[2] - boundaries[1], random.size());
+        ++g_failures;
+    }
+
+    // 2.截断和篡改
+    for (int trial = 0; trial < 200; ++trial) {
+        size_t cut = rng() % (file.size() + 1);
+        writeFile(file.substr(0, cut));
+        size_t complete = 0;
+        std::string prefix;
+        while (complete < boundaries.size() && boundaries[complete] <= cut) {
+            prefix += inputs[complete++];
+        }
+        bool atBoundary = cut == 0 || (complete > 0 && boundaries[complete - 1] == cut);
+        std::string got = readFrames(kFramesFile, &frames, &truncated);
+        if (got != prefix || frames != static_cast<int>(complete) || truncated == atBoundary) {
+            printf("FAIL truncated at %zu: %d frames (expected %zu), truncated %d\n", cut, frames, complete, truncated);
+            ++g_failures;
+            break;
+        }
+    }
+    std::string corrupted = file;
+    corrupted[boundaries[3] - 1] ^= 1; // 第4帧数据的最后一个字节
+    writeFile(corrupted);
+    std::string got = readFrames(kFramesFile, &frames, &truncated);
+    if (got != inputs[0] + inputs[1] + inputs[2] || frames != 3 || !truncated) {
+        printf("FAIL corrupted frame: %d frames, truncated %d\n", frames, truncated);
+        ++g_failures;
+    }
+    std::string zeroed = file + std::string(4096, '\0'); // kMmap预分配后没有截断的情形
+    writeFile(zeroed);
+    if (readFrames(kFramesFile, &frames, &truncated) != expected || !truncated) {
+        printf("FAIL zero tail: %d frames, truncated %d\n", frames, truncated);
+        ++g_failures;
+    }
+    unlink(kFramesFile);
+
+    // 3.rollSize按压缩后的字节计算
+    removeFiles("frame_test_roll.");
+    {
+        const off_t kRollSize = 1 << 20;
+        LogFile log("frame_test_roll", kRollSize, false, 3, 1024, LogFile::kWritev, true);
+        std::string text = makeText(64 * 1024, rng);
+        struct iovec iov = {&text[0], text.size()};
+        for (int i = 0; i < 32; ++i) { // 原始2MB，压缩后远小于1MB
+            log.append(&iov, 1);
+        }
+        sleep(1); // 同一秒内不会roll
+        log.append(&iov, 1);
+        std::vector<std::string> files = logFiles("frame_test_roll.");
+        if (files.size() != 1 || files[0].find(".log.lzs") == std::string::npos) {
+            printf("FAIL compressed roll: %zu files after 2MB of compressible text\n", files.size());
+            ++g_failures;
+        }
+        std::string noise(64 * 1024, '\0');
+        for (auto &c : noise) {
+            c = static_cast<char>(rng());
+        }
+        struct iovec noiseIov = {&noise[0], noise.size()};
+        for (int i = 0; i < 20; ++i) { // 不可压缩的数据超过1MB
+            log.append(&noiseIov, 1);
+        }
+        if (logFiles("frame_test_roll.").size() != 2) {
+            printf("FAIL compressed roll: %zu files after 1.25MB of incompressible data\n", logFiles("frame_test_roll.").size());
+            ++g_failures;
+        }
+    }
+    for (const auto &name : logFiles("frame_test_roll.")) {
+        if (readFrames(name, &frames, &truncated).empty() || truncated) {
+            printf("FAIL rolled file %s: %d frames, truncated %d\n", name.c_str(), frames, truncated);
+            ++g_failures;
+        }
+    }
+    removeFiles("frame_test_roll.");
+
+    // 4.AsyncLogging的各种后端
+    const LogFile::Backend backends[] = {LogFile::kStdio, LogFile::kWritev, LogFile::kIoUring, LogFile::kMmap};
+    const char *names[] = {"frame_test_async_stdio", "frame_test_async_writev", "frame_test_async_iouring", "frame_test_async_mmap"};
+    for (int b = 0; b < 4; ++b) {
+        removeFiles(std::string(names[b]) + ".");
+        std::string input;
+        {
+            AsyncLogging log(names[b], 1L << 30);
+            log.setFileBackend(backends[b]);
+            log.setCompressInline(true);
+            log.setOverflowPolicy(AsyncLogging::kBlock);
+            log.start();
+            char line[64];
+            for (int i = 0; i < 200000; ++i) {
+                int len = snprintf(line, sizeof(line), "async line %d\n", i);
+                log.append(line, len);
+                input.append(line, len);
+            }
+            log.stop();
+        }
+        std::vector<std::string> files = logFiles(std::string(names[b]) + ".");
+        std::string content = files.size() == 1 ? readFrames(files[0], &frames, &truncated) : "";
+        if (files.size() != 1 || content != input || truncated) {
+            printf("FAIL async %s: %zu files, %zu of %zu bytes\n", names[b], files.size(), content.size(), input.size());
+            ++g_failures;
+        }
+        removeFiles(std::string(names[b]) + ".");
+    }
+
+    if (g_failures) {
+        printf("%d failures\n", g_failures);
+        return 1;
+    }
+    printf("all passed\n");
+    return 0;
+}
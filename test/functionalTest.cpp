@@ -1,4 +1,5 @@
 #include "AsyncLogging.h"
+#include "DeferredLog.h"
 #include "Logger.h"
 using namespace myServer;
 
@@ -9,6 +10,13 @@ void testlog() {
     LOG_DEBUG << "debug test";
 
     LOG_ERROR << "error";
+
+    LOG_INFO_DEFER("deferred user={} latency={}us", "test", 1.5);
+    LOG_DEBUG_DEFER("deferred {{escaped}} {}", 42);
+
+    string name("fmt");
+    LOG_INFO_FMT("user={} latency={}us ok={} ptr={}", name, 2.5, true, static_cast<const void *>(nullptr));
+    LOG_WARN_FMT("{{escaped}} {}{}", 'c', -42L);
 }
 
 AsyncLogging *g_asyncLog = NULL;
@@ -0,0 +1,67 @@
+/** 日志链路逐阶段的周期分布，需要以-DYKLOG_PROFILE=ON构建
+ * 1.同步：LOG_INFO输出到丢弃的输出函数，只有前端的阶段
+ * 2.异步：多个线程LOG_INFO输出到AsyncLogging，包括锁、后端交换、排队、写入和端到端的延迟
+ * 每个场景先预热再清空直方图，打印profiler::report()
+ * 用法：hotPathProfileBench [每个线程的条数] [线程数] [采样间隔] [日志目录]
+ */
+#include "AsyncLogging.h"
+#include "LogProfiler.h"
+#include "Logger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <thread>
+#include <vector>
+using namespace myServer;
+
+AsyncLogging *g_asyncLog = nullptr;
+
+void discard(const char *, int) {}
+void asyncOutput(const char *msg, int len) {
+    g_asyncLog->append(msg, len);
+}
+
+void logLines(long lines) {
+    for (long i = 0; i < lines; ++i) {
+        LOG_INFO << "request id=" << i << " user=" << "alice" << " latency=" << 0.25 * i << "ms";
+    }
+}
+
+int main(int argc, char *argv[]) {
+    long lines = argc > 1 ? atol(argv[1]) : 1000000;
+    int threads = argc > 2 ? atoi(argv[2]) : 4;
+    uint32_t interval = argc > 3 ? static_cast<uint32_t>(atol(argv[3])) : 64;
+    std::string dir = argc > 4 ? argv[4] : ".";
+    if (!profiler::enabled()) {
+        printf("built without YKLOG_PROFILE, rebuild with: cmake -S . -B build -DCMAKE_BUILD_TYPE=Release -DYKLOG_PROFILE=ON\n");
+        return 0;
+    }
+    profiler::setSampleInterval(interval);
+
+    Logger::setOutput(discard);
+    logLines(lines / 10);
+    profiler::reset();
+    logLines(lines);
+    printf("== sync, discarding output, %ld lines\n", lines);
+    profiler::report(stdout);
+
+    std::string basename = dir + "/hotPathProfileBench";
+    AsyncLogging log(basename.c_str(), 1024L * 1024 * 1024);
+    g_asyncLog = &log;
+    log.start();
+    Logger::setOutput(asyncOutput);
+    logLines(lines / 10);
+    profiler::reset();
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back(logLines, lines);
+    }
+    for (auto &worker : workers) {
+        worker.join();
+    }
+    log.stop();
+    Logger::setOutput(discard);
+    printf("\n== async, %d threads x %ld lines to %s.*\n", threads, lines, basename.c_str());
+    profiler::report(stdout);
+    return 0;
+}
@@ -0,0 +1,102 @@
+/** 后端写入前压缩的代价与收益：同样的日志分别以明文和setCompressInline写入，比较
+ * 吞吐、后端线程的CPU时间（进程CPU时间减去前端线程的CPU时间）和最终的文件大小
+ * 前端单线程以kBlock写入totalMB的日志文本（Logger的格式），吞吐受后端限制
+ * 用法：inlineCompressionBench [totalMB] [后端 stdio|writev|io_uring|mmap] [目录]
+ */
+#include "AsyncLogging.h"
+#include "LogFile.h"
+#include <chrono>
+#include <dirent.h>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+using namespace myServer;
+
+double cpuSeconds(int who) {
+    struct rusage usage;
+    getrusage(who, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+// 删除前缀为prefix的文件，返回它们的总大小
+off_t removeFiles(const std::string &prefix) {
+    off_t size = 0;
+    DIR *dir = opendir(".");
+    while (struct dirent *entry = readdir(dir)) {
+        struct stat st;
+        if (strncmp(entry->d_name, prefix.c_str(), prefix.size()) == 0 && ::stat(entry->d_name, &st) == 0) {
+            size += st.st_size;
+            unlink(entry->d_name);
+        }
+    }
+    closedir(dir);
+    return size;
+}
+
+int main(int argc, char *argv[]) {
+    long totalMB = argc > 1 ? atol(argv[1]) : 1024;
+    LogFile::Backend backend = LogFile::kWritev;
+    if (argc > 2) {
+        backend = strcmp(argv[2], "stdio") == 0 ? LogFile::kStdio
+                  : strcmp(argv[2], "io_uring") == 0 ? LogFile::kIoUring
+                  : strcmp(argv[2], "mmap") == 0 ? LogFile::kMmap
+                                                 : LogFile::kWritev;
+    }
+    if (argc > 3 && chdir(argv[3]) != 0) {
+        perror("chdir");
+        return 1;
+    }
+    static const char *messages[] = {"accept connection from 10.0.", "request GET /api/v1/items?id=", "query finished rows=",
+                                     "cache miss key=user:", "send response status=200 bytes=", "close connection fd="};
+    static const char *files[] = {"TcpServer.cpp:87", "HttpServer.cpp:142", "Database.cpp:311", "Cache.cpp:56", "HttpServer.cpp:201",
+                                  "TcpConnection.cpp:98"};
+    std::mt19937 rng(1);
+    std::vector<std::string> lines; // 预先生成，前端只做拷贝
+    int64_t t = 1700000000LL * TimeStamp::kNanoSecondPerSecond;
+    char buf[TimeStamp::kMaxFormattedSize];
+    for (int i = 0; i < 100000; ++i) {
+        t += rng() % 20000;
+        int m = rng() % 6;
+        std::string line(buf, TimeStamp::fromNanoSeconds(t).formatTo(buf, TimeStamp::kMicroSeconds));
+        line += "Z " + std::to_string(4000 + rng() % 8) + (m == 2 ? " DEBUG " : " INFO  ") + messages[m] + std::to_string(rng() % 100000) + " - " +
+                files[m] + "\n";
+        lines.push_back(line);
+    }
+
+    printf("%-12s %10s %12s %12s %10s\n", "mode", "MB/s", "backend cpu", "file MB", "ratio");
+    const char *modes[] = {"plain", "compressed"};
+    for (int c = 0; c < 2; ++c) {
+        std::string basename = std::string("inline_compression_bench_") + modes[c];
+        removeFiles(basename + ".");
+        long written = 0;
+        double processCpu = cpuSeconds(RUSAGE_SELF);
+        double frontendCpu = cpuSeconds(RUSAGE_THREAD);
+        auto start = std::chrono::steady_clock::now();
+        {
+            AsyncLogging log(basename.c_str(), 1L << 40);
+            log.setFileBackend(backend);
+            log.setCompressInline(c == 1);
+            log.setOverflowPolicy(AsyncLogging::kBlock);
+            log.start();
+            for (size_t i = 0; written < totalMB << 20; ++i) {
+                const std::string &line = lines[i % lines.size()];
+                log.append(line.data(), static_cast<int>(line.size()));
+                written += line.size();
+            }
+            log.stop();
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        frontendCpu = cpuSeconds(RUSAGE_THREAD) - frontendCpu;
+        processCpu = cpuSeconds(RUSAGE_SELF) - processCpu;
+        off_t size = removeFiles(basename + ".");
+        printf("%-12s %10.0f %11.2fs %12.1f %9.2fx\n", modes[c], written / seconds / 1e6, processCpu - frontendCpu, size / 1048576.0,
+               size > 0 ? static_cast<double>(written) / size : 0.0);
+    }
+    return 0;
+}
@@ -0,0 +1,76 @@
+/** 整数格式化开销：两位一组的formatInteger与原先逐位取余再reverse的实现、snprintf对比
+ * 输入分为小整数（1-3位，如计数、状态码）和全范围随机数（位数均匀分布）
+ * 用法：integerFormatBench [调用次数]
+ */
+#include "LogStream.h"
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+using namespace myServer;
+
+// 原先LogStream::convert的实现
+const char digits[] = "9876543210123456789";
+const char *zero = digits + 9;
+template <typename T>
+size_t convertReverse(char *buf, T value) {
+    char *p = buf;
+    T i = value;
+    do {
+        int lsd = static_cast<int>(i % 10);
+        i /= 10;
+        *p++ = zero[lsd];
+    } while (i != 0);
+    if (value < 0) {
+        *p++ = '-';
+    }
+    std::reverse(buf, p);
+    return p - buf;
+}
+
+template <typename T, typename F>
+void measure(const char *name, const std::vector<T> &values, int calls, F &&format) {
+    char buf[64];
+    size_t total = 0; // 防止编译器优化掉格式化
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < calls; ++i) {
+        total += format(buf, values[i & (values.size() - 1)]);
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    printf("  %-16s %6.1f ns/value (%zu bytes)\n", name, ns / calls, total);
+}
+
+template <typename T>
+void run(const char *name, const std::vector<T> &values, int calls) {
+    printf("%s\n", name);
+    measure("snprintf", values, calls, [](char *buf, T v) { return static_cast<size_t>(snprintf(buf, 64, "%lld", static_cast<long long>(v))); });
+    measure("reverse", values, calls, [](char *buf, T v) { return convertReverse(buf, v); });
+    measure("formatInteger", values, calls, [](char *buf, T v) { return formatInteger(buf, v); });
+}
+
+int main(int argc, char *argv[]) {
+    int calls = argc > 1 ? atoi(argv[1]) : 5000000;
+    std::mt19937_64 rng(1);
+    std::vector<int> small(4096);
+    std::vector<int> int32(4096);
+    std::vector<int64_t> int64(4096);
+    for (size_t i = 0; i < small.size(); ++i) {
+        small[i] = static_cast<int>(rng() % 1000);
+        int32[i] = static_cast<int>(rng() >> (32 + rng() % 32)) * (rng() & 1 ? 1 : -1);
+        int64[i] = static_cast<int64_t>(rng() >> (1 + rng() % 63)) * (rng() & 1 ? 1 : -1);
+    }
+    run("int [0, 1000)", small, calls);
+    run("int32 any length", int32, calls);
+    run("int64 any length", int64, calls);
+
+    printf("pointer hex\n");
+    std::vector<uintptr_t> pointers(4096);
+    for (uintptr_t &p : pointers) {
+        p = static_cast<uintptr_t>(rng() >> 16);
+    }
+    measure("snprintf %lX", pointers, calls, [](char *buf, uintptr_t v) { return static_cast<size_t>(snprintf(buf, 64, "%lX", static_cast<unsigned long>(v))); });
+    measure("formatHex", pointers, calls, [](char *buf, uintptr_t v) { return formatHex(buf, v); });
+    return 0;
+}
@@ -0,0 +1,119 @@
+/** 整数格式化测试
+ * 1.每种整数类型的最小值、最大值，以及每个10的幂附近的值，与snprintf的输出逐字节比较
+ * 2.随机值覆盖各种位数，十进制与十六进制都与snprintf比较
+ * 3.补齐宽度和固定宽度变体的输出与预期字符串一致
+ */
+#include "LogStream.h"
+#include <inttypes.h>
+#include <limits>
+#include <random>
+#include <stdio.h>
+#include <string>
+using namespace myServer;
+
+int g_failures = 0;
+
+void expect(const std::string &actual, const std::string &expected, const char *what) {
+    if (actual != expected) {
+        printf("FAIL %s: got \"%s\", expected \"%s\"\n", what, actual.c_str(), expected.c_str());
+        ++g_failures;
+    }
+}
+
+template <typename T>
+std::string decimal(T value) {
+    char buf[LogStream::kMaxNumericSize];
+    return std::string(buf, convert(buf, value));
+}
+
+template <typename T>
+std::string reference(T value) {
+    char buf[64];
+    if (std::is_signed<T>::value) {
+        snprintf(buf, sizeof(buf), "%lld", static_cast<long long>(value));
+    } else {
+        snprintf(buf, sizeof(buf), "%llu", static_cast<unsigned long long>(value));
+    }
+    return buf;
+}
+
+template <typename T>
+void checkValue(T value, const char *type) {
+    expect(decimal(value), reference(value), type);
+}
+
+// 类型的边界值和每个10的幂前后的值
+template <typename T>
+void checkType(const char *type) {
+    checkValue(std::numeric_limits<T>::min(), type);
+    checkValue(std::numeric_limits<T>::max(), type);
+    checkValue(static_cast<T>(0), type);
+    checkValue(static_cast<T>(std::numeric_limits<T>::min() + 1), type);
+    checkValue(static_cast<T>(std::numeric_limits<T>::max() - 1), type);
+    for (unsigned long long p = 1; p <= static_cast<unsigned long long>(std::numeric_limits<T>::max()); p *= 10) {
+        for (long long delta = -1; delta <= 1; ++delta) {
+            unsigned long long v = p + delta;
+            if (v <= static_cast<unsigned long long>(std::numeric_limits<T>::max())) {
+                checkValue(static_cast<T>(v), type);
+                if (std::is_signed<T>::value) {
+                    checkValue(static_cast<T>(-static_cast<long long>(v)), type);
+                }
+            }
+        }
+        if (p > std::numeric_limits<unsigned long long>::max() / 10) {
+            break;
+        }
+    }
+}
+
+int main() {
+    checkType<short>("short");
+    checkType<unsigned short>("unsigned short");
+    checkType<int>("int");
+    checkType<unsigned int>("unsigned int");
+    checkType<long>("long");
+    checkType<unsigned long>("unsigned long");
+    checkType<long long>("long long");
+    checkType<unsigned long long>("unsigned long long");
+
+    // 随机值：先随机位数再随机取值，各种长度的数字出现的概率相同
+    std::mt19937_64 rng(7);
+    for (int i = 0; i < 1000000; ++i) {
+        uint64_t v = rng() >> (rng() % 64);
+        checkValue(v, "random uint64");
+        checkValue(static_cast<int64_t>(v), "random int64");
+        checkValue(static_cast<int32_t>(v), "random int32");
+
+        char buf[LogStream::kMaxNumericSize];
+        char ref[32];
+        snprintf(ref, sizeof(ref), "%" PRIX64, v);
+        expect(std::string(buf, convertHex(buf, static_cast<uintptr_t>(v))), ref, "hex");
+    }
+    char buf[LogStream::kMaxNumericSize];
+    expect(std::string(buf, convertHex(buf, 0)), "0", "hex zero");
+    expect(std::string(buf, convertHex(buf, UINTPTR_MAX)), "FFFFFFFFFFFFFFFF", "hex max");
+
+    expect(std::string(buf, formatPadded(buf, 7, 3)), "007", "padded");
+    expect(std::string(buf, formatPadded(buf, 12345, 3)), "12345", "padded wider");
+    expect(std::string(buf, formatPadded(buf, 42, 5, ' ')), "   42", "padded with space");
+    expect(std::string(buf, formatPadded(buf, 0, 1)), "0", "padded zero");
+    formatFixedWidth(buf, 5, 6);
+    expect(std::string(buf, 6), "000005", "fixed width");
+    formatFixedWidth(buf, 123456789, 9);
+    expect(std::string(buf, 9), "123456789", "fixed width odd");
+    formatFixedWidth(buf, 1234567, 4);
+    expect(std::string(buf, 4), "4567", "fixed width truncated");
+    format2Digits(buf, 9);
+    expect(std::string(buf, 2), "09", "two digits");
+
+    LogStream stream;
+    stream << static_cast<short>(-32768) << ' ' << 0u << ' ' << -1L << ' ' << reinterpret_cast<const void *>(0x1f);
+    expect(std::string(stream.buffer().data(), stream.buffer().length()), "-32768 0 -1 0x1F", "LogStream");
+
+    if (g_failures) {
+        printf("%d failures\n", g_failures);
+        return 1;
+    }
+    printf("all passed\n");
+    return 0;
+}
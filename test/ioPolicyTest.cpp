@@ -0,0 +1,189 @@
+/** 页缓存与落盘策略测试
+ * 1.writeBehindBytes + dropCache：写入64MB后，统计的回写、释放字节数正确，文件实际驻留在页缓存中的部分（mincore）不超过两段
+ * 2.flushBytes：kStdio下未flush的数据达到flushBytes后立即写入文件，不等待flushInterval
+ * 3.flushLatencyMs：距上一次flush超过flushLatencyMs后的下一次写入触发flush
+ * 4.syncIntervalMs：按间隔落盘
+ * 5.roll后统计跨文件累计，dropCache时旧文件剩余的页缓存也被释放
+ * 6.不释放页缓存时，cachedBytes只计当前文件，已roll的文件不再计入
+ */
+#include "LogFile.h"
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+using namespace myServer;
+
+int g_failures = 0;
+
+#define CHECK(cond, ...)                 \
+    do {                                 \
+        if (!(cond)) {                   \
+            printf("FAIL %s: ", #cond);  \
+            printf(__VA_ARGS__);         \
+            printf("\n");                \
+            ++g_failures;                \
+        }                                \
+    } while (0)
+
+std::vector<std::string> logFiles(const std::string &prefix) {
+    std::vector<std::string> files;
+    DIR *dir = opendir(".");
+    while (struct dirent *entry = readdir(dir)) {
+        if (strncmp(entry->d_name, prefix.c_str(), prefix.size()) == 0) {
+            files.push_back(entry->d_name);
+        }
+    }
+    closedir(dir);
+    return files;
+}
+
+void removeFiles(const std::string &prefix) {
+    for (const auto &file : logFiles(prefix)) {
+        unlink(file.c_str());
+    }
+}
+
+off_t filesSize(const std::string &prefix) {
+    off_t size = 0;
+    for (const auto &file : logFiles(prefix)) {
+        struct stat st;
+        if (stat(file.c_str(), &st) == 0) {
+            size += st.st_size;
+        }
+    }
+    return size;
+}
+
+// 文件驻留在页缓存中的字节数
+off_t residentBytes(const std::string &prefix) {
+    off_t resident = 0;
+    long page = sysconf(_SC_PAGESIZE);
+    for (const auto &file : logFiles(prefix)) {
+        int fd = open(file.c_str(), O_RDONLY);
+        struct stat st;
+        if (fd >= 0 && fstat(fd, &st) == 0 && st.st_size > 0) {
+            void *addr = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+            std::vector<unsigned char> vec((st.st_size + page - 1) / page);
+            if (addr != MAP_FAILED && mincore(addr, st.st_size, vec.data()) == 0) {
+                for (unsigned char v : vec) {
+                    resident += (v & 1) ? page : 0;
+                }
+            }
+            munmap(addr, st.st_size);
+        }
+        close(fd);
+    }
+    return resident;
+}
+
+int main() {
+    const off_t kMB = 1024 * 1024;
+    std::string block(kMB, 'w');
+    block.back() = '\n';
+
+    removeFiles("policy_test_drop.");
+    {
+        LogFile file("policy_test_drop", 1L << 30, false, 3, 1024, LogFile::kWritev);
+        LogFile::IoPolicy policy;
+        policy.writeBehindBytes = 4 * kMB;
+        policy.dropCache = true;
+        file.setIoPolicy(policy);
+        for (int i = 0; i < 64; ++i) {
+            file.append(block.data(), static_cast<int>(block.size()));
+        }
+        LogFile::IoStats stats = file.ioStats();
+        CHECK(stats.writeBehindBytes == 64 * kMB, "%ld", static_cast<long>(stats.writeBehindBytes));
+        CHECK(stats.droppedCacheBytes == 60 * kMB, "%ld", static_cast<long>(stats.droppedCacheBytes));
+        CHECK(stats.cachedBytes == 4 * kMB, "%ld", static_cast<long>(stats.cachedBytes));
+        off_t resident = residentBytes("policy_test_drop.");
+        CHECK(resident <= 8 * kMB, "%ld bytes resident", static_cast<long>(resident));
+        CHECK(filesSize("policy_test_drop.") == 64 * kMB, "%ld", static_cast<long>(filesSize("policy_test_drop.")));
+    }
+    removeFiles("policy_test_drop.");
+
+    // 不设置策略时数据留在64KB的stdio缓冲区中，设置flushBytes后达到阈值即写入
+    removeFiles("policy_test_bytes.");
+    {
+        LogFile file("policy_test_bytes", 1L << 30, false, 3, 1024, LogFile::kStdio);
+        std::string line(199, 'b');
+        line += '\n';
+        for (int i = 0; i < 4; ++i) {
+            file.append(line.data(), static_cast<int>(line.size()));
+        }
+        CHECK(filesSize("policy_test_bytes.") == 0, "%ld", static_cast<long>(filesSize("policy_test_bytes.")));
+        LogFile::IoPolicy policy;
+        policy.flushBytes = 1000;
+        file.setIoPolicy(policy);
+        file.append(line.data(), static_cast<int>(line.size()));
+        CHECK(filesSize("policy_test_bytes.") == 1000, "%ld", static_cast<long>(filesSize("policy_test_bytes.")));
+        file.append(line.data(), static_cast<int>(line.size()));
+        CHECK(filesSize("policy_test_bytes.") == 1000, "%ld", static_cast<long>(filesSize("policy_test_bytes.")));
+        CHECK(file.ioStats().flushes == 1, "%ld", static_cast<long>(file.ioStats().flushes));
+    }
+    removeFiles("policy_test_bytes.");
+
+    removeFiles("policy_test_latency.");
+    {
+        LogFile file("policy_test_latency", 1L << 30, false, 3, 1024, LogFile::kStdio);
+        LogFile::IoPolicy policy;
+        policy.flushLatencyMs = 50;
+        policy.syncIntervalMs = 50;
+        file.setIoPolicy(policy);
+        sleep(1); // 跳过roll时刻所在的一秒，之后的写入都从新的时间起算
+        file.append("first\n", 6);
+        int64_t syncs = file.ioStats().syncs;
+        file.append("second\n", 7);
+        CHECK(filesSize("policy_test_latency.") == 6, "%ld", static_cast<long>(filesSize("policy_test_latency.")));
+        usleep(100 * 1000);
+        file.append("third\n", 6);
+        CHECK(filesSize("policy_test_latency.") == 19, "%ld", static_cast<long>(filesSize("policy_test_latency.")));
+        CHECK(file.ioStats().syncs == syncs + 1, "%ld", static_cast<long>(file.ioStats().syncs));
+    }
+    removeFiles("policy_test_latency.");
+
+    // 每个文件写满后roll，需要跨过一秒；旧文件的剩余部分在roll时释放
+    removeFiles("policy_test_roll.");
+    {
+        LogFile file("policy_test_roll", 6 * kMB, false, 3, 1024, LogFile::kWritev);
+        LogFile::IoPolicy policy;
+        policy.writeBehindBytes = 4 * kMB;
+        policy.dropCache = true;
+        file.setIoPolicy(policy);
+        sleep(1);
+        for (int i = 0; i < 7; ++i) {
+            file.append(block.data(), static_cast<int>(block.size()));
+        }
+        file.append(block.data(), static_cast<int>(block.size()));
+        LogFile::IoStats stats = file.ioStats();
+        CHECK(logFiles("policy_test_roll.").size() == 2, "%zu files", logFiles("policy_test_roll.").size());
+        CHECK(stats.droppedCacheBytes == 7 * kMB, "%ld", static_cast<long>(stats.droppedCacheBytes));
+        CHECK(stats.cachedBytes == kMB, "%ld", static_cast<long>(stats.cachedBytes));
+    }
+    removeFiles("policy_test_roll.");
+
+    removeFiles("policy_test_keep.");
+    {
+        LogFile file("policy_test_keep", 6 * kMB, false, 3, 1024, LogFile::kWritev);
+        sleep(1);
+        for (int i = 0; i < 8; ++i) {
+            file.append(block.data(), static_cast<int>(block.size()));
+        }
+        LogFile::IoStats stats = file.ioStats();
+        CHECK(logFiles("policy_test_keep.").size() == 2, "%zu files", logFiles("policy_test_keep.").size());
+        CHECK(stats.droppedCacheBytes == 0, "%ld", static_cast<long>(stats.droppedCacheBytes));
+        CHECK(stats.cachedBytes == kMB, "%ld", static_cast<long>(stats.cachedBytes));
+    }
+    removeFiles("policy_test_keep.");
+
+    if (g_failures) {
+        printf("%d failures\n", g_failures);
+        return 1;
+    }
+    printf("all passed\n");
+    return 0;
+}
@@ -0,0 +1,255 @@
+/** io_uring写入测试
+ * 1.LogFile::appendAsync：每块缓存恰好回调一次，sync时整批在fsync之后回调，与短消息交错写入的文件内容和kWritev一致
+ * 2.磁盘跟不上：日志文件换成FIFO，读端限速40MB/s，前端每600ms突发约32MB，下一次突发时上一次的积压还没有写完；
+ *   分别用kWritev和kIoUring，写出条数与丢弃条数之和等于生产条数，kIoUring逐块归还缓存，丢弃条数少于kWritev。
+ *   FIFO只能顺序写入，同一时刻只有一块缓存在途，这里的收益只来自逐块归还缓存
+ * 内核不支持io_uring时kIoUring退回kWritev，跳过第2部分
+ */
+#include "AsyncLogging.h"
+#include "IoUring.h"
+#include "LogFile.h"
+#include <atomic>
+#include <chrono>
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+using namespace myServer;
+
+int g_failures = 0;
+
+std::vector<std::string> logFiles(const std::string &prefix) {
+    std::vector<std::string> files;
+    DIR *dir = opendir(".");
+    while (struct dirent *entry = readdir(dir)) {
+        if (strncmp(entry->d_name, prefix.c_str(), prefix.size()) == 0) {
+            files.push_back(entry->d_name);
+        }
+    }
+    closedir(dir);
+    return files;
+}
+
+void removeFiles(const std::string &prefix) {
+    for (const auto &file : logFiles(prefix)) {
+        unlink(file.c_str());
+    }
+}
+
+std::string readAll(const std::string &prefix) {
+    std::string content;
+    for (const auto &file : logFiles(prefix)) {
+        FILE *fp = fopen(file.c_str(), "r");
+        char buf[65536];
+        size_t n;
+        while ((n = fread(buf, 1, sizeof(buf), fp)) > 0) {
+            content.append(buf, n);
+        }
+        fclose(fp);
+    }
+    return content;
+}
+
+void expect(long actual, long expected, const char *what) {
+    if (actual != expected) {
+        printf("FAIL %s: %ld, expected %ld\n", what, actual, expected);
+        ++g_failures;
+    }
+}
+
+// 与短消息交错的若干批异步写入，返回回调次数
+int writeAsync(LogFile::Backend backend, const std::string &basename, bool sync) {
+    removeFiles(basename + ".");
+    std::vector<std::string> blocks;
+    for (int i = 0; i < 300; ++i) {
+        blocks.push_back("block " + std::to_string(i) + std::string(i * 37 % 20000, static_cast<char>('a' + i % 26)) + "\n");
+    }
+    int callbacks = 0;
+    std::vector<int> seen(blocks.size());
+    {
+        LogFile file(basename, 1L << 30, false, 3, 1024, backend);
+        file.setWriteCallback([&](void *tag) {
+            ++callbacks;
+            ++seen[static_cast<std::string *>(tag) - blocks.data()];
+        });
+        for (size_t begin = 0; begin < blocks.size(); begin += 50) {
+            file.append("short line before batch\n", 24);
+            std::vector<struct iovec> iov;
+            std::vector<void *> tags;
+            for (size_t i = begin; i < begin + 50; ++i) {
+                iov.push_back({&blocks[i][0], blocks[i].size()});
+                tags.push_back(&blocks[i]);
+            }
+            file.appendAsync(iov.data(), static_cast<int>(iov.size()), tags.data(), sync);
+            if (sync && backend == LogFile::kIoUring) {
+                // 整批在fsync完成后才回调，回调之前这批缓存都还在途
+                while (callbacks < static_cast<int>(begin + 50)) {
+                    file.waitWrites(1000);
+                }
+                expect(callbacks, static_cast<long>(begin + 50), "sync batch completes together");
+            }
+            file.append("short line after batch\n", 23);
+        }
+        file.waitWrites(0);
+    } // 析构时等待所有在途写入完成
+    for (size_t i = 0; i < seen.size(); ++i) {
+        if (seen[i] != 1) {
+            printf("FAIL block %zu called back %d times\n", i, seen[i]);
+            ++g_failures;
+            break;
+        }
+    }
+    return callbacks;
+}
+
+/** 模拟卡顿的磁盘：在日志文件将要使用的文件名上预先创建FIFO，读端限速读取
+ * 文件名包含秒级时间戳，为接下来几秒的每个文件名各建一个FIFO
+ */
+class ThrottledSink {
+  public:
+    ThrottledSink(const std::string &basename, long bytesPerSecond, int stallMs)
+        : bytesPerSecond_(bytesPerSecond), stallMs_(stallMs), done_(false), marks_(0) {
+        char host[256] = {0};
+        gethostname(host, sizeof(host));
+        time_t now = time(NULL);
+        for (int i = 0; i < 5; ++i) {
+            char timeBuf[TimeStamp::kMaxFormattedSize];
+            TimeStamp(static_cast<int64_t>(now + i) * TimeStamp::kMicroSecondPerSecond).formatCompactTo(timeBuf);
+            std::string name = basename + "." + timeBuf + "." + host + "." + std::to_string(getpid()) + ".log";
+            mkfifo(name.c_str(), 0644);
+            int fd = open(name.c_str(), O_RDONLY | O_NONBLOCK);
+            fcntl(fd, F_SETPIPE_SZ, 1024 * 1024);
+            fds_.push_back(fd);
+        }
+        thread_ = std::thread([this] { run(); });
+    }
+    long finish() {
+        done_ = true;
+        thread_.join();
+        for (int fd : fds_) {
+            close(fd);
+        }
+        return marks_;
+    } // 写端关闭后调用，读完剩余数据，返回读到的日志条数
+
+  private:
+    void run() {
+        std::vector<char> buf(256 * 1024);
+        long sinceStall = 0;
+        while (true) {
+            bool done = done_.load(); // 先读标志再读数据，标志置位后读到的EOF一定是真正的结尾
+            long got = 0;
+            for (int fd : fds_) {
+                ssize_t n = read(fd, buf.data(), buf.size());
+                if (n > 0) {
+                    got += n;
+                    for (ssize_t i = 0; i < n; ++i) {
+                        marks_ += buf[i] == '#';
+                    }
+                }
+            }
+            if (got == 0) {
+                if (done) {
+                    return;
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                continue;
+            }
+            // 每读32MB停顿stallMs，其余时间按bytesPerSecond限速
+            sinceStall += got;
+            std::this_thread::sleep_for(std::chrono::microseconds(got * 1000000 / bytesPerSecond_));
+            if (sinceStall >= 32 * 1024 * 1024) {
+                sinceStall = 0;
+                std::this_thread::sleep_for(std::chrono::milliseconds(stallMs_));
+            }
+        }
+    }
+
+    long bytesPerSecond_;
+    int stallMs_;
+    std::vector<int> fds_;
+    std::atomic<bool> done_;
+    long marks_; // 日志行以'#'开头，统计读到的行数
+    std::thread thread_;
+};
+
+/** 返回丢弃的日志条数
+ * 读端按40MB/s读取，比前端的突发慢得多：每次突发约32MB（8块缓存），缓存池10块，
+ * 下一次突发在上一次的积压写出约四分之三时到来。kWritev的后端阻塞在一次writev中，这一批缓存全部写完才一起归还，
+ * 此时池中只剩少量空闲缓存；kIoUring每块缓存写完就归还，新的突发有大部分缓存可用
+ */
+long runStall(LogFile::Backend backend, const char *name) {
+    const int kBursts = 3;
+    const int kLinesPerBurst = 320000; // 100字节一条，约32MB
+    std::string basename = std::string("iouring_stall_") + name;
+    removeFiles(basename + ".");
+    ThrottledSink sink(basename, 40L * 1024 * 1024, 0);
+
+    long dropped;
+    {
+        AsyncLogging log(basename.c_str(), 1L << 40, 1);
+        log.setFileBackend(backend);
+        log.setBufferPool(10);
+        log.start();
+        std::string line = "#" + std::string(98, 'x') + "\n";
+        auto start = std::chrono::steady_clock::now();
+        for (int burst = 0; burst < kBursts; ++burst) {
+            // 按固定节拍突发，两种写入方式的生产时长相同
+            std::this_thread::sleep_until(start + std::chrono::milliseconds(600 * burst));
+            for (int i = 0; i < kLinesPerBurst; ++i) {
+                log.append(line.data(), static_cast<int>(line.size()));
+            }
+        }
+        log.stop();
+        dropped = log.droppedMessages();
+    }
+    long written = sink.finish();
+    removeFiles(basename + ".");
+    printf("%-8s written %ld, dropped %ld\n", name, written, dropped);
+    expect(written + dropped, static_cast<long>(kBursts) * kLinesPerBurst, "written + dropped == produced");
+    return dropped;
+}
+
+int main() {
+    bool available = IoUring::available();
+    {
+        LogFile file("iouring_test_probe", 1L << 30, false, 3, 1024, LogFile::kIoUring);
+        expect(file.backend(), available ? LogFile::kIoUring : LogFile::kWritev, "effective backend");
+    }
+    removeFiles("iouring_test_probe.");
+
+    expect(writeAsync(LogFile::kWritev, "iouring_test_writev", false), 300, "writev callbacks");
+    expect(writeAsync(LogFile::kIoUring, "iouring_test_async", false), 300, "io_uring callbacks");
+    expect(writeAsync(LogFile::kIoUring, "iouring_test_sync", true), 300, "io_uring sync callbacks");
+    std::string expected = readAll("iouring_test_writev.");
+    if (expected.empty() || readAll("iouring_test_async.") != expected || readAll("iouring_test_sync.") != expected) {
+        printf("FAIL io_uring content differs from writev\n");
+        ++g_failures;
+    }
+    removeFiles("iouring_test_writev.");
+    removeFiles("iouring_test_async.");
+    removeFiles("iouring_test_sync.");
+
+    if (!available) {
+        printf("io_uring not available, stall test skipped\n");
+    } else {
+        long writevDropped = runStall(LogFile::kWritev, "writev");
+        long uringDropped = runStall(LogFile::kIoUring, "io_uring");
+        printf("dropped during stalls: writev %ld, io_uring %ld\n", writevDropped, uringDropped);
+        if (uringDropped >= writevDropped) {
+            printf("FAIL io_uring should drop fewer lines than writev\n");
+            ++g_failures;
+        }
+    }
+
+    if (g_failures) {
+        printf("%d failures\n", g_failures);
+        return 1;
+    }
+    printf("all passed\n");
+    return 0;
+}
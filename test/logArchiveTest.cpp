@@ -0,0 +1,245 @@
+/** 分块压缩归档测试
+ * 1.lz4::compress/decompress往返：空输入、短输入、不可压缩的随机数据、全零、短距离重复、日志文本；
+ *   随机篡改压缩数据后decompress只能失败或返回不超过容量的长度
+ * 2.LogArchiveWriter以随机长度写入，LogArchiveReader逐块解压后与原文一致，块在行边界切分，findBlock与块的原始偏移一致
+ * 3.readRange的输出与对原文按时间逐行过滤的结果一致，没有时间的续行跟随上一行
+ * 4.文件尾损坏时reader无效
+ * 5.LogFile开启setCompressRolled后，roll出的旧文件被压缩为.lz并删除，当前文件保留
+ */
+#include "LogArchive.h"
+#include "LogFile.h"
+#include "Lz4.h"
+#include <dirent.h>
+#include <random>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+using namespace myServer;
+
+int g_failures = 0;
+
+std::vector<std::string> logFiles(const std::string &prefix) {
+    std::vector<std::string> files;
+    DIR *dir = opendir(".");
+    while (struct dirent *entry = readdir(dir)) {
+        if (strncmp(entry->d_name, prefix.c_str(), prefix.size()) == 0) {
+            files.push_back(entry->d_name);
+        }
+    }
+    closedir(dir);
+    return files;
+}
+
+void removeFiles(const std::string &prefix) {
+    for (const auto &file : logFiles(prefix)) {
+        unlink(file.c_str());
+    }
+}
+
+bool endsWith(const std::string &s, const char *suffix) {
+    size_t n = strlen(suffix);
+    return s.size() >= n && s.compare(s.size() - n, n, suffix) == 0;
+}
+
+void roundTrip(const std::string &input, const char *what) {
+    std::vector<char> compressed(lz4::compressBound(input.size()));
+    size_t n = lz4::compress(input.data(), input.size(), compressed.data(), compressed.size());
+    std::string output(input.size(), '\0');
+    long m = lz4::decompress(compressed.data(), n, &output[0], output.size());
+    if (m != static_cast<long>(input.size()) || output != input) {
+        printf("FAIL round trip %s: %zu bytes -> %zu -> %ld\n", what, input.size(), n, m);
+        ++g_failures;
+    }
+}
+
+// 模拟日志：每行以时间开头，时间整体递增但有少量乱序，偶尔有没有时间的续行
+std::string makeLog(int lines, int64_t startNs, std::mt19937_64 &rng) {
+    static const char *words[] = {"request", "user", "latency", "connection", "accepted", "closed", "timeout", "retry", "ok"};
+    std::string log;
+    char buf[TimeStamp::kMaxFormattedSize];
+    for (int i = 0; i < lines; ++i) {
+        int64_t t = startNs + i * 1000000LL + static_cast<int64_t>(rng() % 3000000);
+        log.append(buf, TimeStamp::fromNanoSeconds(t).formatTo(buf, TimeStamp::kMicroSeconds));
+        log += "Z 12345 INFO  ";
+        for (int w = 0; w < 6; ++w) {
+            log += words[rng() % 9];
+            log += w % 2 ? "=" : " ";
+            log += std::to_string(rng() % 10000);
+            log += ' ';
+        }
+        log += "- server.cpp:" + std::to_string(rng() % 500) + "\n";
+        if (rng() % 50 == 0) {
+            log += "    continuation line without time\n";
+        }
+    }
+    return log;
+}
+
+// 按时间逐行过滤，作为readRange的参照
+std::string filterLines(const std::string &log, TimeStamp from, TimeStamp to) {
+    std::string out;
+    bool inRange = false;
+    size_t pos = 0;
+    while (pos < log.size()) {
+        size_t next = log.find('\n', pos);
+        next = next == std::string::npos ? log.size() : next + 1;
+        TimeStamp ts;
+        if (TimeStamp::parse(log.data() + pos, next - pos, &ts) > 0) {
+            inRange = !(ts < from || to < ts);
+        }
+        if (inRange) {
+            out.append(log, pos, next - pos);
+        }
+        pos = next;
+    }
+    return out;
+}
+
+int main() {
+    std::mt19937_64 rng(7);
+    roundTrip("", "empty");
+    for (int len = 1; len < 40; ++len) {
+        roundTrip(std::string(len, 'a'), "short repeated");
+        std::string s;
+        for (int i = 0; i < len; ++i) {
+            s += static_cast<char>(rng());
+        }
+        roundTrip(s, "short random");
+    }
+    std::string random(1 << 20, '\0');
+    for (char &c : random) {
+        c = static_cast<char>(rng());
+    }
+    roundTrip(random, "random");
+    roundTrip(std::string(1 << 20, '\0'), "zeros");
+    for (int period = 1; period <= 9; ++period) {
+        std::string s;
+        while (s.size() < 100000) {
+            s += static_cast<char>('a' + s.size() % period);
+        }
+        roundTrip(s, "short period");
+    }
+    const int64_t kStart = 1700000000LL * TimeStamp::kNanoSecondPerSecond;
+    std::string log = makeLog(200000, kStart, rng);
+    roundTrip(log.substr(0, 1 << 20), "log");
+
+    std::vector<char> compressed(lz4::compressBound(1 << 16));
+    size_t n = lz4::compress(log.data(), 1 << 16, compressed.data(), compressed.size());
+    if (n * 2 > (1 << 16)) {
+        printf("FAIL log compression ratio: %d -> %zu\n", 1 << 16, n);
+        ++g_failures;
+    }
+    std::string output(1 << 16, '\0');
+    for (int i = 0; i < 2000; ++i) {
+        std::vector<char> corrupted(compressed.begin(), compressed.begin() + n);
+        for (int k = 0; k < 4; ++k) {
+            corrupted[rng() % n] = static_cast<char>(rng());
+        }
+        long m = lz4::decompress(corrupted.data(), rng() % 8 ? n : rng() % n, &output[0], output.size());
+        if (m > static_cast<long>(output.size())) {
+            printf("FAIL corrupted input decoded to %ld bytes\n", m);
+            ++g_failures;
+        }
+    }
+
+    // 以随机长度写入归档
+    removeFiles("archive_test.");
+    {
+        LogArchiveWriter writer("archive_test.lz");
+        size_t pos = 0;
+        while (pos < log.size()) {
+            size_t len = std::min<size_t>(log.size() - pos, rng() % 3 ? rng() % 5000 : rng() % 700000);
+            writer.append(log.data() + pos, len);
+            pos += len;
+        }
+        if (!writer.finish() || writer.rawBytes() != static_cast<int64_t>(log.size()) || writer.compressedBytes() * 2 > writer.rawBytes()) {
+            printf("FAIL writer: %lld -> %lld\n", static_cast<long long>(writer.rawBytes()), static_cast<long long>(writer.compressedBytes()));
+            ++g_failures;
+        }
+    }
+    {
+        LogArchiveReader reader("archive_test.lz");
+        std::string all;
+        std::string block;
+        bool ok = reader.valid() && reader.rawSize() == static_cast<int64_t>(log.size()) && reader.blocks().size() > 10;
+        for (size_t i = 0; ok && i < reader.blocks().size(); ++i) {
+            ok = reader.readBlock(i, &block) && reader.blocks()[i].rawOffset == static_cast<int64_t>(all.size()) &&
+                 block.size() <= LogArchiveWriter::kBlockSize && block.back() == '\n' && reader.blocks()[i].first.valid() &&
+                 reader.findBlock(reader.blocks()[i].rawOffset + block.size() - 1) == static_cast<int>(i);
+            all += block;
+        }
+        if (!ok || all != log || reader.findBlock(reader.rawSize()) != -1) {
+            printf("FAIL reader: valid %d, %zu blocks, %zu of %zu bytes\n", reader.valid(), reader.blocks().size(), all.size(), log.size());
+            ++g_failures;
+        }
+        for (int i = 0; i < 20; ++i) {
+            TimeStamp from = TimeStamp::fromNanoSeconds(kStart + static_cast<int64_t>(rng() % 200) * TimeStamp::kNanoSecondPerSecond);
+            TimeStamp to = addTime(from, (rng() % 5000) / 1000.0);
+            std::string range;
+            reader.readRange(from, to, [&range](const char *line, size_t len) { range.append(line, len); });
+            std::string expected = filterLines(log, from, to);
+            if (range != expected || (i == 0 && expected.empty())) {
+                printf("FAIL readRange %s - %s: %zu bytes, expected %zu\n", from.toFormatString(true).c_str(), to.toFormatString(true).c_str(),
+                       range.size(), expected.size());
+                ++g_failures;
+            }
+        }
+    }
+    // 截掉文件尾的最后一个字节
+    if (truncate("archive_test.lz", [] {
+            FILE *fp = fopen("archive_test.lz", "r");
+            fseek(fp, 0, SEEK_END);
+            long size = ftell(fp);
+            fclose(fp);
+            return size - 1;
+        }()) != 0 ||
+        LogArchiveReader("archive_test.lz").valid()) {
+        printf("FAIL truncated archive is still valid\n");
+        ++g_failures;
+    }
+    removeFiles("archive_test.");
+
+    // LogFile roll后压缩旧文件
+    removeFiles("archive_test_roll.");
+    std::string first = log.substr(0, 3 << 20);
+    {
+        LogFile file("archive_test_roll", 2 << 20, false, 3, 1024, LogFile::kWritev);
+        file.setCompressRolled(true);
+        sleep(1);
+        file.append(first.data(), static_cast<int>(first.size())); // 超过rollSize，roll到新文件
+        file.append("after roll\n", 11);
+    }
+    std::vector<std::string> files = logFiles("archive_test_roll.");
+    std::string archive;
+    std::string current;
+    for (const auto &f : files) {
+        (endsWith(f, ".log.lz") ? archive : current) = f;
+    }
+    std::string content;
+    if (files.size() != 2 || archive.empty() || !endsWith(current, ".log")) {
+        printf("FAIL rolled files:");
+        for (const auto &f : files) {
+            printf(" %s", f.c_str());
+        }
+        printf("\n");
+        ++g_failures;
+    } else {
+        LogArchiveReader reader(archive);
+        reader.readRange(TimeStamp::fromNanoSeconds(1), TimeStamp::fromNanoSeconds(INT64_MAX),
+                         [&content](const char *line, size_t len) { content.append(line, len); });
+        if (content != first) {
+            printf("FAIL rolled archive: %zu bytes, expected %zu\n", content.size(), first.size());
+            ++g_failures;
+        }
+    }
+    removeFiles("archive_test_roll.");
+
+    if (g_failures) {
+        printf("%d failures\n", g_failures);
+        return 1;
+    }
+    printf("all passed\n");
+    return 0;
+}
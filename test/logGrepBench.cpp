@@ -0,0 +1,85 @@
+/** LogMatcher单线程的过滤吞吐，数据在内存中
+ * 每种指令集（scalar即memmem/memchr）下测量：子串很少命中、子串常见、只按级别过滤、时间范围加级别、来源
+ * 用法：logGrepBench [MB]
+ */
+#include "LogGrep.h"
+#include <chrono>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+using namespace myServer;
+
+int main(int argc, char *argv[]) {
+    long mb = argc > 1 ? atol(argv[1]) : 512;
+    static const char *levels[] = {"DEBUG ", "INFO  ", "INFO  ", "INFO  ", "WARN  ", "ERROR "};
+    static const char *messages[] = {"accept connection from 10.0.", "request GET /api/v1/items?id=", "query finished rows=",
+                                     "cache miss key=user:", "send response status=200 bytes=", "close connection fd="};
+    static const char *files[] = {"TcpServer.cpp:87", "HttpServer.cpp:142", "Database.cpp:311", "Cache.cpp:56", "HttpServer.cpp:201",
+                                  "TcpConnection.cpp:98"};
+    std::mt19937 rng(1);
+    std::string log;
+    log.reserve(mb << 20);
+    const int64_t t0 = 1700000000LL * TimeStamp::kNanoSecondPerSecond;
+    int64_t t = t0;
+    char buf[TimeStamp::kMaxFormattedSize];
+    while (log.size() < static_cast<size_t>(mb) << 20) {
+        t += rng() % 20000;
+        int m = rng() % 6;
+        log.append(buf, TimeStamp::fromNanoSeconds(t).formatTo(buf, TimeStamp::kMicroSeconds));
+        snprintf(buf, sizeof(buf), "Z %5u ", static_cast<unsigned>(4000 + rng() % 8));
+        log += buf;
+        log += levels[rng() % 6];
+        log += messages[m];
+        log += std::to_string(rng() % 100000);
+        log += " - ";
+        log += files[m];
+        log += '\n';
+    }
+    const TimeStamp middle = TimeStamp::fromNanoSeconds(t0 + (t - t0) / 2);
+
+    struct Query {
+        const char *name;
+        const char *pattern;
+        Logger::LogLevel level;
+        bool range;
+        const char *source;
+    };
+    const Query queries[] = {
+        {"rare substring", "user:99999", Logger::TRACE, false, ""},
+        {"common substring", "status=200", Logger::TRACE, false, ""},
+        {"level >= ERROR", "", Logger::ERROR, false, ""},
+        {"1s range + WARN", "", Logger::WARN, true, ""},
+        {"source", "", Logger::TRACE, false, "Cache.cpp:56"},
+    };
+    const char *simdLevels[] = {"scalar", "sse2", "avx2"};
+    printf("%-18s", "");
+    for (const char *simd : simdLevels) {
+        printf(" %12s", simd);
+    }
+    printf("   (MB/s, %ld MB)\n", mb);
+    for (const Query &query : queries) {
+        LogMatcher matcher;
+        matcher.setPattern(query.pattern);
+        matcher.setMinLevel(query.level);
+        if (query.range) {
+            matcher.setTimeRange(middle, addTime(middle, 1.0));
+        }
+        matcher.setSource(query.source);
+        printf("%-18s", query.name);
+        size_t lines = 0;
+        for (const char *simd : simdLevels) {
+            if (!setSimdLevel(simd)) {
+                printf(" %12s", "-");
+                continue;
+            }
+            auto start = std::chrono::steady_clock::now();
+            lines = matcher.count(log.data(), log.size());
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            printf(" %12.0f", log.size() / seconds / 1e6);
+        }
+        printf("   %zu lines\n", lines);
+    }
+    return 0;
+}
@@ -0,0 +1,205 @@
+/** 日志过滤测试
+ * 1.parseLogPrefix解析Logger实际写出的行首（各种时间精度），非日志行返回false
+ * 2.findSubstring、findNewline在各个指令集下与memmem、memchr的结果一致，包括各种长度、对齐和结尾附近的匹配
+ * 3.LogMatcher在各个指令集下与逐行判断的参照实现一致：子串、级别、线程号、时间范围、来源及其组合，
+ *   多行日志的后续行跟随所属的行首，来源按整条日志最后一行的" - 文件:行号"判断
+ */
+#include "CurrentThread.h"
+#include "LogGrep.h"
+#include "Logger.h"
+#include <algorithm>
+#include <random>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+using namespace myServer;
+
+int g_failures = 0;
+std::string g_captured;
+
+void captureOutput(const char *msg, int len) {
+    g_captured.append(msg, len);
+}
+
+// 参照实现：逐行用std::string::find和parseLogPrefix判断
+std::string reference(const std::string &log, const std::string &pattern, Logger::LogLevel minLevel, int tid, TimeStamp from, TimeStamp to,
+                      const std::string &source) {
+    std::vector<std::string> lines;
+    for (size_t pos = 0; pos < log.size();) {
+        size_t newline = log.find('\n', pos);
+        size_t next = newline == std::string::npos ? log.size() : newline + 1;
+        lines.push_back(log.substr(pos, next - pos));
+        pos = next;
+    }
+    std::string out;
+    bool ownerMatch = false;
+    bool sourceMatch = false; // 来源取整条日志的最后一行
+    bool prefixFilter = minLevel > Logger::TRACE || tid != 0 || from.valid() || to.valid();
+    for (size_t i = 0; i < lines.size(); ++i) {
+        const std::string &line = lines[i];
+        LogPrefix prefix;
+        bool hasPrefix = parseLogPrefix(line.data(), line.size(), &prefix);
+        if (hasPrefix) {
+            ownerMatch = prefix.level >= minLevel && (tid == 0 || prefix.tid == tid) && !(from.valid() && prefix.time < from) &&
+                         !(to.valid() && to < prefix.time);
+        }
+        if (hasPrefix || i == 0) {
+            size_t last = i;
+            while (last + 1 < lines.size() && !parseLogPrefix(lines[last + 1].data(), lines[last + 1].size(), &prefix)) {
+                ++last;
+            }
+            std::string body = lines[last].back() == '\n' ? lines[last].substr(0, lines[last].size() - 1) : lines[last];
+            size_t dash = body.rfind(" - ");
+            std::string location = dash == std::string::npos ? "" : body.substr(dash + 3);
+            sourceMatch = source.find(':') != std::string::npos ? location == source : location.compare(0, source.size() + 1, source + ":") == 0;
+        }
+        bool match = !prefixFilter || ownerMatch;
+        if (match && !pattern.empty()) {
+            match = line.find(pattern) != std::string::npos;
+        }
+        if (match && !source.empty()) {
+            match = sourceMatch;
+        }
+        if (match) {
+            out += line;
+        }
+    }
+    return out;
+}
+
+int main() {
+    std::mt19937_64 rng(5);
+
+    // 1.Logger写出的行首
+    Logger::setOutput(captureOutput);
+    const TimeStamp::Precision precisions[] = {TimeStamp::kSeconds, TimeStamp::kMilliSeconds, TimeStamp::kMicroSeconds, TimeStamp::kNanoSeconds};
+    for (TimeStamp::Precision precision : precisions) {
+        Logger::setTimePrecision(precision);
+        g_captured.clear();
+        TimeStamp before = TimeStamp::now();
+        LOG_WARN << "precision " << static_cast<int>(precision);
+        LogPrefix prefix;
+        if (!parseLogPrefix(g_captured.data(), g_captured.size(), &prefix) || prefix.level != Logger::WARN || prefix.tid != currentThread::tid() ||
+            timeDifference(prefix.time, before) > 1.0 || timeDifference(before, prefix.time) > 1.0) {
+            printf("FAIL parse Logger line: %s", g_captured.c_str());
+            ++g_failures;
+        }
+    }
+    Logger::setTimePrecision(TimeStamp::kMicroSeconds);
+    const char *notLogLines[] = {"    continuation line\n", "20240101 12:00:00.000001 1234 INFO  no Z\n", "20240101 12:00:00.000001Z abc INFO  bad tid\n",
+                                 "20240101 12:00:00.000001Z  1234 NOTICE bad level\n", "20240101 12:00:00Z 1"};
+    for (const char *line : notLogLines) {
+        LogPrefix prefix;
+        if (parseLogPrefix(line, strlen(line), &prefix)) {
+            printf("FAIL parsed non-log line: %s\n", line);
+            ++g_failures;
+        }
+    }
+
+    // 生成日志：随机级别、线程号、正文和来源，偶尔有多行日志
+    static const char *levels[] = {"TRACE ", "DEBUG ", "INFO  ", "WARN  ", "ERROR ", "FATAL "};
+    static const char *words[] = {"connect", "timeout", "retry", "user=42", "ok", "cache miss", "query", "abcabcabd", "\xe4\xb8\xad\xe6\x96\x87"};
+    static const char *sources[] = {"TcpServer.cpp:87", "TcpServer.cpp:90", "Database.cpp:311", "Cache.cpp:56"};
+    const int64_t t0 = 1700000000LL * TimeStamp::kNanoSecondPerSecond;
+    std::string log;
+    char buf[TimeStamp::kMaxFormattedSize];
+    for (int i = 0; i < 20000; ++i) {
+        log.append(buf, TimeStamp::fromNanoSeconds(t0 + i * 1000000LL).formatTo(buf, TimeStamp::kMicroSeconds));
+        char tid[16];
+        snprintf(tid, sizeof(tid), "Z %5d ", 100 + static_cast<int>(rng() % 5) * 1111);
+        log += tid;
+        log += levels[rng() % 6];
+        for (int w = 0, n = 1 + rng() % 6; w < n; ++w) {
+            log += words[rng() % 9];
+            log += ' ';
+        }
+        if (rng() % 20 == 0) {
+            log += "first part\n  second part with timeout\n  third part";
+        }
+        log += " - ";
+        log += sources[rng() % 4];
+        log += '\n';
+    }
+    log += "20231114 22:13:20.000000Z   100 ERROR half line without newline - Cache.cpp:56";
+
+    std::vector<std::string> simdLevels = {"scalar"};
+    if (setSimdLevel("sse2")) {
+        simdLevels.push_back("sse2");
+    }
+    if (setSimdLevel("avx2")) {
+        simdLevels.push_back("avx2");
+    }
+    for (const std::string &simd : simdLevels) {
+        setSimdLevel(simd);
+
+        // 2.查找
+        for (int trial = 0; trial < 2000; ++trial) {
+            size_t len = rng() % 200;
+            std::string text(len, 'a');
+            for (auto &c : text) {
+                c = "ab\nc"[rng() % 4];
+            }
+            std::string needle(1 + rng() % 6, 'a');
+            for (auto &c : needle) {
+                c = "abc"[rng() % 3];
+            }
+            size_t offset = rng() % (len + 1);
+            const char *begin = text.data() + offset;
+            const char *end = text.data() + len;
+            const void *expected = memmem(begin, end - begin, needle.data(), needle.size());
+            const char *got = findSubstring(begin, end, needle.data(), needle.size());
+            if (got != (expected ? static_cast<const char *>(expected) : end)) {
+                printf("FAIL %s findSubstring(\"%s\") at %zu of %zu\n", simd.c_str(), needle.c_str(), offset, len);
+                ++g_failures;
+                break;
+            }
+            const void *newline = memchr(begin, '\n', end - begin);
+            if (findNewline(begin, end) != (newline ? static_cast<const char *>(newline) : end)) {
+                printf("FAIL %s findNewline at %zu of %zu\n", simd.c_str(), offset, len);
+                ++g_failures;
+                break;
+            }
+        }
+
+        // 3.过滤
+        for (int trial = 0; trial < 60; ++trial) {
+            LogMatcher matcher;
+            std::string pattern = rng() % 3 ? words[rng() % 9] : "";
+            if (trial % 10 == 9) {
+                pattern = "timeout";
+            }
+            Logger::LogLevel minLevel = rng() % 2 ? static_cast<Logger::LogLevel>(rng() % 6) : Logger::TRACE;
+            int tid = rng() % 4 == 0 ? 100 + static_cast<int>(rng() % 5) * 1111 : 0;
+            TimeStamp from = TimeStamp::invalid();
+            TimeStamp to = TimeStamp::invalid();
+            if (rng() % 2) {
+                from = TimeStamp::fromNanoSeconds(t0 + static_cast<int64_t>(rng() % 20000) * 1000000LL);
+                to = addTime(from, static_cast<double>(rng() % 5000) / 1000);
+            }
+            std::string source = rng() % 4 == 0 ? sources[rng() % 4] : rng() % 4 == 0 ? "TcpServer.cpp" : "";
+            matcher.setPattern(pattern);
+            matcher.setMinLevel(minLevel);
+            matcher.setThread(tid);
+            matcher.setTimeRange(from, to);
+            matcher.setSource(source);
+            std::string got;
+            size_t lines = matcher.scan(log.data(), log.size(), [&got](const char *line, size_t len) { got.append(line, len); });
+            std::string expected = reference(log, pattern, minLevel, tid, from, to, source);
+            size_t expectedLines = std::count(expected.begin(), expected.end(), '\n') + (!expected.empty() && expected.back() != '\n');
+            if (got != expected || lines != expectedLines || matcher.count(log.data(), log.size()) != lines) {
+                printf("FAIL %s filter pattern=\"%s\" level=%d tid=%d range=%d source=\"%s\": %zu lines, expected %zu\n", simd.c_str(), pattern.c_str(),
+                       minLevel, tid, from.valid(), source.c_str(), lines, expectedLines);
+                ++g_failures;
+                break;
+            }
+        }
+    }
+
+    if (g_failures) {
+        printf("%d failures\n", g_failures);
+        return 1;
+    }
+    printf("all passed\n");
+    return 0;
+}
@@ -0,0 +1,110 @@
+/** 时间索引的代价与收益
+ * 1.LogFile以kWritev按4MB的块写入totalMB日志，比较开启setTimeIndex(1MB, 1秒)前后的写入吞吐，两种方式交替各写两次取最好的一次
+ * 2.随机查询20个1秒的时间范围，比较借助索引的readRange与没有索引时的全文扫描（文件在页缓存中）
+ * 用法：logIndexBench [totalMB] [目录]
+ */
+#include "LogFile.h"
+#include "LogIndex.h"
+#include <chrono>
+#include <dirent.h>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <vector>
+using namespace myServer;
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void removeFiles(const std::string &prefix) {
+    DIR *dir = opendir(".");
+    while (struct dirent *entry = readdir(dir)) {
+        if (strncmp(entry->d_name, prefix.c_str(), prefix.size()) == 0) {
+            unlink(entry->d_name);
+        }
+    }
+    closedir(dir);
+}
+
+int main(int argc, char *argv[]) {
+    long totalMB = argc > 1 ? atol(argv[1]) : 1024;
+    if (argc > 2 && chdir(argv[2]) != 0) {
+        perror("chdir");
+        return 1;
+    }
+    // 64块4MB的日志，每秒约10万行
+    std::mt19937 rng(1);
+    const int kBlocks = 64;
+    std::vector<std::string> blocks(kBlocks);
+    const int64_t t0 = 1700000000LL * TimeStamp::kNanoSecondPerSecond;
+    int64_t t = t0;
+    char buf[TimeStamp::kMaxFormattedSize];
+    for (auto &block : blocks) {
+        while (block.size() < (4 << 20) - 200) {
+            t += rng() % 20000;
+            block.append(buf, TimeStamp::fromNanoSeconds(t).formatTo(buf, TimeStamp::kMicroSeconds));
+            block += "Z 4001 INFO  request GET /api/v1/items?id=" + std::to_string(rng() % 100000) + " - HttpServer.cpp:142\n";
+        }
+    }
+    const int64_t blockNs = (t - t0) / kBlocks;
+    const long rounds = (totalMB << 20) / (static_cast<long>(kBlocks) << 22) + 1;
+
+    std::string filename;
+    double best[2] = {0, 0};
+    for (int pass = 0; pass < 4; ++pass) {
+        int indexed = pass % 2;
+        removeFiles("index_bench.");
+        auto start = std::chrono::steady_clock::now();
+        long bytes = 0;
+        {
+            LogFile file("index_bench", 1L << 40, false, 3, 1024, LogFile::kWritev);
+            if (indexed) {
+                file.setTimeIndex(1 << 20, 1000);
+            }
+            filename = file.filename();
+            for (long r = 0; r < rounds; ++r) { // 每一轮的时间相同，查询在每一轮中都有命中
+                for (const auto &block : blocks) {
+                    struct iovec iov = {const_cast<char *>(block.data()), block.size()};
+                    file.append(&iov, 1);
+                    bytes += block.size();
+                }
+            }
+        }
+        best[indexed] = std::max(best[indexed], bytes / secondsSince(start) / 1e6);
+    }
+    printf("write plain        %8.0f MB/s\nwrite indexed      %8.0f MB/s\n", best[0], best[1]);
+
+    LogIndexReader reader(filename);
+    printf("index: %zu segments for %lld MB\n", reader.segments().size(), static_cast<long long>(reader.fileSize() >> 20));
+    std::vector<int64_t> queries;
+    for (int q = 0; q < 20; ++q) {
+        queries.push_back(t0 + static_cast<int64_t>(rng() % kBlocks) * blockNs + rng() % blockNs);
+    }
+    size_t indexedLines = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int64_t from : queries) {
+        reader.readRange(TimeStamp::fromNanoSeconds(from), TimeStamp::fromNanoSeconds(from + TimeStamp::kNanoSecondPerSecond),
+                         [&indexedLines](const char *, size_t) { ++indexedLines; });
+    }
+    double indexedMs = secondsSince(start) * 1e3 / queries.size();
+
+    rename((filename + ".idx").c_str(), (filename + ".idx.off").c_str());
+    LogIndexReader scanner(filename);
+    size_t scannedLines = 0;
+    start = std::chrono::steady_clock::now();
+    for (int64_t from : queries) {
+        scanner.readRange(TimeStamp::fromNanoSeconds(from), TimeStamp::fromNanoSeconds(from + TimeStamp::kNanoSecondPerSecond),
+                          [&scannedLines](const char *, size_t) { ++scannedLines; });
+    }
+    double scanMs = secondsSince(start) * 1e3 / queries.size();
+    printf("1s range, indexed  %10.2f ms/query (%zu lines)\n", indexedMs, indexedLines / queries.size());
+    printf("1s range, scan     %10.2f ms/query (%zu lines)%s\n", scanMs, scannedLines / queries.size(),
+           scannedLines == indexedLines ? "" : "  MISMATCH");
+    removeFiles("index_bench.");
+    return 0;
+}
@@ -0,0 +1,270 @@
+/** 时间索引测试
+ * 1.LogFile开启setTimeIndex后写入按块乱序的日志（模拟线程局部缓存），随机时间范围的readRange与逐行过滤全文的结果一致，
+ *   并且只读取了部分文件
+ * 2.进程崩溃的情形：索引的最后一项不完整、最后几段没有索引项、日志文件在索引之后还有数据，结果仍然一致
+ * 3.没有索引文件时退回全文扫描
+ * 4.AsyncLogging多线程写入（线程局部缓存）时生成的索引同样可用
+ * 5.compressLogFile删除原文件时一并删除索引
+ */
+#include "AsyncLogging.h"
+#include "LogArchive.h"
+#include "LogFile.h"
+#include "LogIndex.h"
+#include <dirent.h>
+#include <random>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+using namespace myServer;
+
+int g_failures = 0;
+
+std::vector<std::string> logFiles(const std::string &prefix) {
+    std::vector<std::string> files;
+    DIR *dir = opendir(".");
+    while (struct dirent *entry = readdir(dir)) {
+        if (strncmp(entry->d_name, prefix.c_str(), prefix.size()) == 0) {
+            files.push_back(entry->d_name);
+        }
+    }
+    closedir(dir);
+    return files;
+}
+
+void removeFiles(const std::string &prefix) {
+    for (const auto &file : logFiles(prefix)) {
+        unlink(file.c_str());
+    }
+}
+
+std::string readAll(const std::string &filename) {
+    std::string content;
+    FILE *fp = fopen(filename.c_str(), "r");
+    char buf[65536];
+    size_t n;
+    while (fp && (n = fread(buf, 1, sizeof(buf), fp)) > 0) {
+        content.append(buf, n);
+    }
+    if (fp) {
+        fclose(fp);
+    }
+    return content;
+}
+
+void writeFile(const std::string &filename, const std::string &content) {
+    FILE *fp = fopen(filename.c_str(), "w");
+    fwrite(content.data(), 1, content.size(), fp);
+    fclose(fp);
+}
+
+// 按时间逐行过滤，作为readRange的参照
+std::string filterLines(const std::string &log, TimeStamp from, TimeStamp to) {
+    std::string out;
+    bool inRange = false;
+    size_t pos = 0;
+    while (pos < log.size()) {
+        size_t newline = log.find('\n', pos);
+        size_t next = newline == std::string::npos ? log.size() : newline + 1;
+        TimeStamp ts;
+        if (TimeStamp::parse(log.data() + pos, next - pos, &ts) > 0) {
+            inRange = !(ts < from || to < ts);
+        }
+        if (inRange) {
+            out.append(log, pos, next - pos);
+        }
+        pos = next;
+    }
+    return out;
+}
+
+std::string readRange(const std::string &filename, TimeStamp from, TimeStamp to, off_t *readBytes = nullptr) {
+    LogIndexReader reader(filename);
+    std::string out;
+    reader.readRange(from, to, [&out](const char *line, size_t len) { out.append(line, len); });
+    if (readBytes) {
+        *readBytes = 0;
+        for (const auto &range : reader.ranges(from, to)) {
+            *readBytes += range.second;
+        }
+    }
+    return out;
+}
+
+// 随机查询若干时间范围，与逐行过滤的结果比较
+void checkQueries(const std::string &filename, int64_t startNs, int64_t spanNs, std::mt19937_64 &rng, const char *what, bool expectSkip) {
+    std::string log = readAll(filename);
+    off_t totalRead = 0;
+    for (int q = 0; q < 50; ++q) {
+        int64_t from = startNs + static_cast<int64_t>(rng() % spanNs);
+        int64_t to = from + static_cast<int64_t>(rng() % (spanNs / 20 + 1));
+        off_t readBytes;
+        std::string got = readRange(filename, TimeStamp::fromNanoSeconds(from), TimeStamp::fromNanoSeconds(to), &readBytes);
+        std::string expected = filterLines(log, TimeStamp::fromNanoSeconds(from), TimeStamp::fromNanoSeconds(to));
+        totalRead += readBytes;
+        if (got != expected) {
+            printf("FAIL %s query %d: %zu bytes, expected %zu\n", what, q, got.size(), expected.size());
+            ++g_failures;
+            return;
+        }
+    }
+    if (expectSkip && totalRead >= static_cast<off_t>(log.size()) * 50 / 2) {
+        printf("FAIL %s: queries read %lld bytes on average of %zu\n", what, static_cast<long long>(totalRead / 50), log.size());
+        ++g_failures;
+    }
+}
+
+// 4个"线程"各自按时间顺序产生日志，以32KB左右的块交错写入，块之间最多乱序约两秒；偶尔有没有时间的续行
+void writeInterleaved(LogFile &file, int64_t startNs, int blocks, std::mt19937_64 &rng) {
+    int64_t clocks[4] = {startNs, startNs, startNs, startNs};
+    char buf[TimeStamp::kMaxFormattedSize];
+    for (int b = 0; b < blocks; ++b) {
+        int thread = rng() % 4;
+        std::string block;
+        while (block.size() < 32 * 1024) {
+            clocks[thread] += static_cast<int64_t>(rng() % 400000); // 平均0.2ms一行
+            block.append(buf, TimeStamp::fromNanoSeconds(clocks[thread]).formatTo(buf, TimeStamp::kMicroSeconds));
+            block += "Z " + std::to_string(1000 + thread) + " INFO  request id=" + std::to_string(rng() % 100000) + " - server.cpp:42\n";
+            if (rng() % 40 == 0) {
+                block += "    continuation without time\n";
+            }
+        }
+        if (b % 7 == 0) {
+            file.append(block.data(), static_cast<int>(block.size())); // 同步写入的路径
+        } else {
+            struct iovec iov = {&block[0], block.size()};
+            file.append(&iov, 1);
+        }
+        // 落后太多的"线程"追上来，保持乱序在两秒左右
+        for (int64_t &clock : clocks) {
+            clock = std::max<int64_t>(clock, clocks[thread] - 2LL * TimeStamp::kNanoSecondPerSecond);
+        }
+    }
+}
+
+int main() {
+    std::mt19937_64 rng(11);
+    const int64_t startNs = 1700000000LL * TimeStamp::kNanoSecondPerSecond;
+
+    // 1.LogFile写入索引
+    removeFiles("index_test.");
+    std::string filename;
+    {
+        LogFile file("index_test", 1L << 30, false, 3, 1024, LogFile::kWritev);
+        file.setTimeIndex(64 * 1024, 1000);
+        filename = file.filename();
+        writeInterleaved(file, startNs, 400, rng); // 约13MB，跨越约70秒
+    }
+    LogIndexReader reader(filename);
+    if (!reader.indexed() || reader.segments().size() < 100) {
+        printf("FAIL index: indexed %d, %zu segments\n", reader.indexed(), reader.segments().size());
+        ++g_failures;
+    }
+    off_t end = 0;
+    for (const auto &segment : reader.segments()) {
+        if (segment.offset != end || !segment.first.valid()) {
+            printf("FAIL segment at %lld, expected %lld\n", static_cast<long long>(segment.offset), static_cast<long long>(end));
+            ++g_failures;
+            break;
+        }
+        end = segment.offset + segment.length;
+    }
+    if (end != reader.fileSize()) {
+        printf("FAIL index covers %lld of %lld bytes\n", static_cast<long long>(end), static_cast<long long>(reader.fileSize()));
+        ++g_failures;
+    }
+    const int64_t span = 80LL * TimeStamp::kNanoSecondPerSecond;
+    checkQueries(filename, startNs, span, rng, "indexed", true);
+
+    // 2.崩溃后的索引
+    std::string index = readAll(filename + ".idx");
+    writeFile(filename + ".idx", index.substr(0, index.size() - 32 * 10 - 5)); // 最后十项丢失，再截断半项
+    std::string extra;
+    char buf[TimeStamp::kMaxFormattedSize];
+    for (int i = 0; i < 1000; ++i) {
+        extra.append(buf, TimeStamp::fromNanoSeconds(startNs + i * 1000000LL).formatTo(buf, TimeStamp::kMicroSeconds));
+        extra += "Z 9999 WARN  written after the last index entry\n";
+    }
+    extra += "20231114 22:13:20.000000Z 9999 WARN  half a line"; // 没有换行的半行
+    FILE *fp = fopen(filename.c_str(), "a");
+    fwrite(extra.data(), 1, extra.size(), fp);
+    fclose(fp);
+    checkQueries(filename, startNs, span, rng, "crashed", true);
+
+    // 3.没有索引
+    unlink((filename + ".idx").c_str());
+    checkQueries(filename, startNs, span, rng, "unindexed", false);
+    removeFiles("index_test.");
+
+    // 4.AsyncLogging多线程写入
+    removeFiles("index_test_async.");
+    {
+        AsyncLogging log("index_test_async", 1L << 30, 1);
+        log.setThreadLocalBuffer(true);
+        log.setTimeIndex(16 * 1024, 100);
+        log.setOverflowPolicy(AsyncLogging::kBlock);
+        log.start();
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; ++t) {
+            threads.emplace_back([&log, t] {
+                char line[128];
+                for (int i = 0; i < 20000; ++i) {
+                    size_t len = TimeStamp::now().formatTo(line, TimeStamp::kMicroSeconds);
+                    len += snprintf(line + len, sizeof(line) - len, "Z %d INFO  async line %d\n", t, i);
+                    log.append(line, static_cast<int>(len));
+                    if (i % 1000 == 0) {
+                        usleep(10000);
+                    }
+                }
+            });
+        }
+        for (auto &thread : threads) {
+            thread.join();
+        }
+        log.stop();
+    }
+    std::vector<std::string> files = logFiles("index_test_async.");
+    std::string asyncLog;
+    for (const auto &file : files) {
+        if (file.find(".idx") == std::string::npos) {
+            asyncLog = file;
+        }
+    }
+    if (files.size() != 2 || asyncLog.empty()) {
+        printf("FAIL async index: %zu files\n", files.size());
+        ++g_failures;
+    } else {
+        LogIndexReader asyncReader(asyncLog);
+        const auto &segments = asyncReader.segments();
+        if (segments.size() < 10) {
+            printf("FAIL async index: %zu segments\n", segments.size());
+            ++g_failures;
+        } else {
+            int64_t first = segments.front().first.nanoSecondsSinceEpoch();
+            int64_t last = segments.back().last.nanoSecondsSinceEpoch();
+            checkQueries(asyncLog, first, last - first + 1, rng, "async", false);
+        }
+    }
+
+    // 5.压缩后删除索引
+    if (!asyncLog.empty()) {
+        compressLogFile(asyncLog, asyncLog + ".lz", true);
+        struct stat st;
+        if (::stat((asyncLog + ".idx").c_str(), &st) == 0) {
+            printf("FAIL compressLogFile left %s.idx\n", asyncLog.c_str());
+            ++g_failures;
+        }
+    }
+    removeFiles("index_test_async.");
+
+    if (g_failures) {
+        printf("%d failures\n", g_failures);
+        return 1;
+    }
+    printf("all passed\n");
+    return 0;
+}
@@ -0,0 +1,119 @@
+/** 日志合并的吞吐和内存
+ * 生成inputs个进程的日志，共totalMB，每个进程每256MB roll一个文件，各进程的时间交错，约5%是三行的日志；
+ * 合并全部文件，输出丢弃（只计字节数），与直接拷贝全部文件（合并的上限）比较，并报告合并期间进程RSS的峰值
+ * 用法：logMergeBench [totalMB] [inputs] [目录]
+ */
+#include "LogMerge.h"
+#include <chrono>
+#include <dirent.h>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+using namespace myServer;
+
+const char *kDir = "merge_bench.dir";
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+long maxRssMB() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss / 1024;
+}
+
+void removeDir() {
+    if (DIR *dir = opendir(kDir)) {
+        while (struct dirent *entry = readdir(dir)) {
+            unlink((std::string(kDir) + "/" + entry->d_name).c_str());
+        }
+        closedir(dir);
+    }
+    rmdir(kDir);
+}
+
+int main(int argc, char *argv[]) {
+    long totalMB = argc > 1 ? atol(argv[1]) : 2048;
+    int inputs = argc > 2 ? atoi(argv[2]) : 8;
+    if (argc > 3 && chdir(argv[3]) != 0) {
+        perror("chdir");
+        return 1;
+    }
+    removeDir();
+    mkdir(kDir, 0755);
+
+    // 每个进程的时间每行前进随机的0-40us，各进程从同一时间开始，合并时频繁切换
+    const long perInput = (totalMB << 20) / inputs;
+    const long rollBytes = 256L << 20;
+    const int64_t t0 = 1700000000LL * TimeStamp::kNanoSecondPerSecond;
+    auto start = std::chrono::steady_clock::now();
+    for (int p = 0; p < inputs; ++p) {
+        std::mt19937 rng(p);
+        int64_t t = t0;
+        long written = 0;
+        for (int f = 0; written < perInput; ++f) {
+            char name[128];
+            snprintf(name, sizeof(name), "%s/bench.20231114-%06d.host.%d.log", kDir, 221300 + f, 1000 + p);
+            FILE *fp = fopen(name, "w");
+            std::string chunk;
+            long fileBytes = 0;
+            while (fileBytes < rollBytes && written < perInput) {
+                chunk.clear();
+                while (chunk.size() < (1 << 20)) {
+                    t += rng() % 40000;
+                    char buf[TimeStamp::kMaxFormattedSize];
+                    chunk.append(buf, TimeStamp::fromNanoSeconds(t).formatTo(buf, TimeStamp::kMicroSeconds));
+                    snprintf(buf, sizeof(buf), "Z %5d ", 1000 + p);
+                    chunk += buf;
+                    chunk += "INFO  request GET /api/v1/items?id=" + std::to_string(rng() % 100000);
+                    if (rng() % 20 == 0) {
+                        chunk += "\n  at Handler::run()\n  at EventLoop::loop()";
+                    }
+                    chunk += " - HttpServer.cpp:142\n";
+                }
+                fwrite(chunk.data(), 1, chunk.size(), fp);
+                fileBytes += chunk.size();
+                written += chunk.size();
+            }
+            fclose(fp);
+        }
+    }
+    printf("generated %ld MB in %d inputs: %.1fs\n", totalMB, inputs, secondsSince(start));
+    const long rssBefore = maxRssMB();
+
+    LogMerger merger;
+    merger.add(kDir);
+    // 直接拷贝：逐个文件读入固定的缓冲区
+    start = std::chrono::steady_clock::now();
+    long copied = 0;
+    std::vector<char> buf(1 << 20);
+    for (size_t i = 0; i < merger.inputs(); ++i) {
+        for (const auto &name : merger.files(i)) {
+            FILE *fp = fopen(name.c_str(), "r");
+            size_t n;
+            while ((n = fread(buf.data(), 1, buf.size(), fp)) > 0) {
+                copied += n;
+            }
+            fclose(fp);
+        }
+    }
+    double copySeconds = secondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    long merged = 0;
+    int64_t records = merger.merge([&merged](const char *, size_t len) { merged += len; });
+    double mergeSeconds = secondsSince(start);
+    printf("copy   %8.0f MB/s\n", copied / copySeconds / 1e6);
+    printf("merge  %8.0f MB/s  %6.2f M records/s  %ld MB in %ld MB out\n", merged / mergeSeconds / 1e6, records / mergeSeconds / 1e6, copied >> 20,
+           merged >> 20);
+    printf("max RSS %ld MB before merging, %ld MB after\n", rssBefore, maxRssMB());
+    removeDir();
+    return 0;
+}
@@ -0,0 +1,188 @@
+/** 日志合并测试
+ * 1.parseLogFileName：basename和主机名中有'.'、不是LogFile命名的文件
+ * 2.多个进程各自roll出几个文件，随机的多行日志和相同的时间，目录展开后合并的结果与按(时间, 路, 原顺序)排序的参照一致，
+ *   同一进程的文件归为一路；文件开头的后续行沿用上一个文件最后的时间、最后没有换行、尾部的0字节、空文件
+ * 3.输出缓冲区很小、单条日志比缓冲区还长时结果不变
+ */
+#include "LogMerge.h"
+#include <algorithm>
+#include <dirent.h>
+#include <random>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/stat.h>
+#include <tuple>
+#include <unistd.h>
+#include <vector>
+using namespace myServer;
+
+int g_failures = 0;
+const char *kDir = "merge_test.dir";
+
+struct Record {
+    int64_t ns;
+    size_t input;
+    size_t seq;
+    std::string text;
+};
+
+void writeFile(const std::string &filename, const std::string &content) {
+    FILE *fp = fopen(filename.c_str(), "w");
+    fwrite(content.data(), 1, content.size(), fp);
+    fclose(fp);
+}
+
+void removeDir() {
+    if (DIR *dir = opendir(kDir)) {
+        while (struct dirent *entry = readdir(dir)) {
+            unlink((std::string(kDir) + "/" + entry->d_name).c_str());
+        }
+        closedir(dir);
+    }
+    rmdir(kDir);
+}
+
+std::string mergeAll(size_t bufferSize, int64_t *records, size_t *inputs) {
+    LogMerger merger(bufferSize);
+    merger.add(kDir);
+    *inputs = merger.inputs();
+    std::string out;
+    *records = merger.merge([&out](const char *data, size_t len) { out.append(data, len); });
+    return out;
+}
+
+int main() {
+    // 1.文件名
+    struct {
+        const char *path;
+        bool ok;
+        const char *key;
+        const char *time;
+    } names[] = {
+        {"app.20231114-221320.host.1234.log", true, "app.host.1234", "20231114-221320"},
+        {"/var/log/my.app.20231114-221320.web1.example.com.77.log", true, "/var/log/my.app.web1.example.com.77", "20231114-221320"},
+        {"dir.20231114-221320.x/app.log", false, "", ""},
+        {"app.20231114-221320.host.1234.log.lz", false, "", ""},
+        {"app.2023111a-221320.host.1234.log", false, "", ""},
+        {"app.log", false, "", ""},
+    };
+    for (const auto &name : names) {
+        std::string key, time;
+        bool ok = LogMerger::parseLogFileName(name.path, &key, &time);
+        if (ok != name.ok || (ok && (key != name.key || time != name.time))) {
+            printf("FAIL parseLogFileName(%s) = %d \"%s\" \"%s\"\n", name.path, ok, key.c_str(), time.c_str());
+            ++g_failures;
+        }
+    }
+
+    // 2.5个进程，每个1-3个文件
+    removeDir();
+    mkdir(kDir, 0755);
+    std::mt19937 rng(7);
+    const int64_t t0 = 1700000000LL * TimeStamp::kNanoSecondPerSecond;
+    const int kProcesses = 5;
+    std::vector<std::string> allNames;
+    std::vector<std::vector<Record>> perProcess(kProcesses);
+    std::string hugeRecord;
+    for (int p = 0; p < kProcesses; ++p) {
+        int64_t t = t0 + static_cast<int64_t>(rng() % 1000) * 1000000;
+        int files = 1 + rng() % 3;
+        int64_t lastNs = 0;
+        for (int f = 0; f < files; ++f) {
+            char name[128];
+            snprintf(name, sizeof(name), "%s/%s.20231114-2213%02d.host.%d.log", kDir, p == 2 ? "merge.a" : "merge", 10 * f + p, 1000 + p);
+            allNames.push_back(name);
+            std::string content;
+            if (f > 0 && p == 1) { // 开头没有行首
+                std::string text = "  continued from previous file\n";
+                content += text;
+                perProcess[p].push_back(Record{lastNs, 0, 0, text});
+            }
+            int count = p == 4 && f == 0 ? 0 : 200 + rng() % 300; // 一个空文件
+            for (int i = 0; i < count; ++i) {
+                t += (rng() % 3) * 1000000; // 毫秒精度，经常相同
+                char buf[TimeStamp::kMaxFormattedSize];
+                std::string text(buf, TimeStamp::fromNanoSeconds(t).formatTo(buf, TimeStamp::kMilliSeconds));
+                snprintf(buf, sizeof(buf), "Z %5d ", 1000 + p);
+                text += buf;
+                text += rng() % 4 ? "INFO  " : "ERROR ";
+                text += "process " + std::to_string(p) + " file " + std::to_string(f) + " record " + std::to_string(i);
+                if (rng() % 10 == 0) {
+                    text += "\n  second line\n  third line";
+                }
+                if (p == 3 && f == 0 && i == 10) {
+                    text += "\n" + std::string(10000, 'x'); // 比缓冲区长
+                    hugeRecord = text;
+                }
+                text += " - LogMergeTest.cpp:" + std::to_string(100 + p) + "\n";
+                content += text;
+                perProcess[p].push_back(Record{t, 0, 0, text});
+                lastNs = t;
+            }
+            if (p == 0 && f == files - 1) { // 最后没有换行
+                content.pop_back();
+                perProcess[p].back().text.pop_back();
+            }
+            if (p == 3 && f == files - 1) {
+                content += std::string(8192, '\0');
+            }
+            writeFile(name, content);
+        }
+    }
+    // 路的顺序：排序后的文件名中每个进程第一次出现的顺序
+    std::sort(allNames.begin(), allNames.end());
+    std::vector<size_t> inputOf(kProcesses, SIZE_MAX);
+    size_t nextInput = 0;
+    for (const auto &name : allNames) {
+        int pid = atoi(name.c_str() + name.rfind('.', name.size() - 5) + 1);
+        if (inputOf[pid - 1000] == SIZE_MAX) {
+            inputOf[pid - 1000] = nextInput++;
+        }
+    }
+    std::vector<Record> all;
+    for (int p = 0; p < kProcesses; ++p) {
+        for (size_t i = 0; i < perProcess[p].size(); ++i) {
+            Record record = perProcess[p][i];
+            record.input = inputOf[p];
+            record.seq = i;
+            if (record.text.back() != '\n') {
+                record.text += '\n';
+            }
+            all.push_back(record);
+        }
+    }
+    std::sort(all.begin(), all.end(),
+              [](const Record &a, const Record &b) { return std::tie(a.ns, a.input, a.seq) < std::tie(b.ns, b.input, b.seq); });
+    std::string expected;
+    for (const auto &record : all) {
+        expected += record.text;
+    }
+
+    // 3.不同的缓冲区大小
+    for (size_t bufferSize : {size_t(1) << 20, size_t(4096)}) {
+        int64_t records;
+        size_t inputs;
+        std::string got = mergeAll(bufferSize, &records, &inputs);
+        if (inputs != kProcesses || records != static_cast<int64_t>(all.size()) || got != expected) {
+            size_t diff = std::mismatch(got.begin(), got.end(), expected.begin(), expected.end()).first - got.begin();
+            printf("FAIL merge buffer %zu: %zu inputs, %ld records (expected %zu), first difference at %zu of %zu\n", bufferSize, inputs,
+                   static_cast<long>(records), all.size(), diff, expected.size());
+            ++g_failures;
+        }
+        if (got.find(hugeRecord) == std::string::npos) {
+            printf("FAIL merge buffer %zu split the long record\n", bufferSize);
+            ++g_failures;
+        }
+    }
+    removeDir();
+
+    if (g_failures) {
+        printf("%d failures\n", g_failures);
+        return 1;
+    }
+    printf("all passed\n");
+    return 0;
+}
@@ -0,0 +1,225 @@
+/** 运行时指标测试
+ * 1.LogCounter多个线程同时计数，总数准确
+ * 2.LogHistogram的分桶、计数、均值、最大值和分位数
+ * 3.AsyncLogging::metrics()：写入条数和字节数（包括线程局部模式下已退出的线程）、写出的缓存块数、峰值深度、每次唤醒的缓存数、写入和flush耗时
+ * 4.缓存池耗尽时丢弃的数量与droppedMessages()一致，kBlock时记录前端等待时间
+ * 5.setMetricsReport后日志文件中有按日志行格式写入的指标行
+ * 6.LogFile::ioStats()的roll次数
+ * 7.AsyncLogging::metrics().io转发后端LogFile的页缓存统计，指标行中包含这些统计
+ */
+#include "AsyncLogging.h"
+#include "LogFile.h"
+#include "LogMetrics.h"
+#include <dirent.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+using namespace myServer;
+
+int g_failures = 0;
+
+void check(bool ok, const char *what) {
+    if (!ok) {
+        printf("FAIL %s\n", what);
+        ++g_failures;
+    }
+}
+
+std::vector<std::string> logFiles(const std::string &prefix) {
+    std::vector<std::string> files;
+    DIR *dir = opendir(".");
+    while (struct dirent *entry = readdir(dir)) {
+        if (strncmp(entry->d_name, prefix.c_str(), prefix.size()) == 0) {
+            files.push_back(entry->d_name);
+        }
+    }
+    closedir(dir);
+    return files;
+}
+
+void removeFiles(const std::string &prefix) {
+    for (const auto &file : logFiles(prefix)) {
+        unlink(file.c_str());
+    }
+}
+
+// 文件中包含text的行
+std::vector<std::string> grepLines(const std::string &prefix, const char *text) {
+    std::vector<std::string> lines;
+    for (const auto &file : logFiles(prefix)) {
+        FILE *fp = fopen(file.c_str(), "r");
+        char line[1024];
+        while (fgets(line, sizeof(line), fp)) {
+            if (strstr(line, text)) {
+                lines.push_back(line);
+            }
+        }
+        fclose(fp);
+    }
+    return lines;
+}
+
+void testCounter() {
+    LogCounter counter;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; ++t) {
+        threads.emplace_back([&counter] {
+            for (int i = 0; i < 100000; ++i) {
+                counter.add(2);
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    check(counter.value() == 8 * 100000 * 2, "sharded counter total");
+}
+
+void testHistogram() {
+    check(LogHistogram::bucketOf(0) == 0 && LogHistogram::bucketOf(1) == 1 && LogHistogram::bucketOf(2) == 2 && LogHistogram::bucketOf(3) == 2 &&
+              LogHistogram::bucketOf(1024) == 11 && LogHistogram::bucketOf(INT64_MAX) == 63,
+          "histogram buckets");
+    LogHistogram histogram;
+    check(histogram.snapshot().count == 0 && histogram.snapshot().percentile(0.5) == 0, "empty histogram");
+    for (int i = 1; i <= 1000; ++i) {
+        histogram.record(i);
+    }
+    histogram.record(100000);
+    LogHistogram::Snapshot s = histogram.snapshot();
+    check(s.count == 1001 && s.sum == 500500 + 100000 && s.max == 100000, "histogram count, sum, max");
+    check(s.mean() > 599 && s.mean() < 600, "histogram mean");
+    // 第501个值为501，在[256, 512)桶中
+    check(s.percentile(0.5) == 511 && s.percentile(0.99) == 1023 && s.percentile(1.0) == 100000 && s.percentile(0) == 1, "histogram percentiles");
+}
+
+void testAsyncMetrics(bool threadLocal) {
+    removeFiles("metrics_test.");
+    AsyncLogging log("metrics_test", 1024L * 1024 * 1024);
+    log.setThreadLocalBuffer(threadLocal);
+    log.start();
+    const int kLines = 200000;
+    std::string line(99, 'x');
+    line += '\n';
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&log, &line] {
+            for (int i = 0; i < kLines / 4; ++i) {
+                log.append(line.data(), static_cast<int>(line.size()));
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    check(log.metrics().lines == kLines, "lines counted before stop");
+    log.stop();
+    AsyncLogging::Metrics m = log.metrics();
+    check(m.lines == kLines && m.bytes == kLines * 100LL, "lines and bytes appended");
+    check(m.buffersWritten >= kLines * 100LL / kLargeBuffer && m.wakeups > 0 && m.wakeups <= m.buffersWritten, "buffers written per wakeup");
+    check(m.buffersPerWakeup.count == m.wakeups && m.buffersPerWakeup.sum == m.buffersWritten, "buffers-per-wakeup histogram");
+    check(m.peakQueueDepth >= 1 && m.peakQueueDepth <= AsyncLogging::kDefaultPoolSize, "peak queue depth");
+    check(m.writeNs.count == m.wakeups && m.writeNs.max > 0 && m.flushNs.count >= m.wakeups, "write and flush latency");
+    check(m.droppedMessages == 0 && m.rolls == 0, "no drops, no rolls");
+    check((m.lockWaits == 0) == (m.lockWaitNs == 0), "lock wait time only when contended");
+    removeFiles("metrics_test.");
+}
+
+void testDropped(AsyncLogging::OverflowPolicy policy, const char *name) {
+    std::string basename = std::string("metrics_drop_") + name;
+    removeFiles(basename + ".");
+    AsyncLogging log(basename.c_str(), 1024L * 1024 * 1024);
+    log.setBufferPool(4);
+    log.setOverflowPolicy(policy);
+    log.start();
+    std::string line(999, 'y');
+    line += '\n';
+    for (int i = 0; i < 100000; ++i) {
+        log.append(line.data(), static_cast<int>(line.size()));
+    }
+    log.stop();
+    AsyncLogging::Metrics m = log.metrics();
+    check(m.lines + m.droppedMessages == 100000 && m.droppedMessages == log.droppedMessages() && m.droppedBytes == log.droppedBytes(), "dropped counts in snapshot");
+    if (policy == AsyncLogging::kBlock) {
+        check(m.droppedMessages == 0 && (m.poolWaitNs > 0 || m.buffersWritten >= 100000LL * 1000 / kLargeBuffer), "blocked producers");
+    }
+    removeFiles(basename + ".");
+}
+
+void testReport() {
+    removeFiles("metrics_report.");
+    AsyncLogging log("metrics_report", 1024L * 1024 * 1024, 1);
+    log.setMetricsReport(1);
+    log.start();
+    std::string line = "report test line\n";
+    for (int i = 0; i < 30; ++i) {
+        log.append(line.data(), static_cast<int>(line.size()));
+        usleep(100 * 1000);
+    }
+    log.stop();
+    std::vector<std::string> reports = grepLines("metrics_report.", "yklog metrics lines=");
+    check(reports.size() >= 1, "periodic metrics line");
+    check(!reports.empty() && strstr(reports[0].c_str(), " INFO  yklog metrics") && strstr(reports[0].c_str(), " - AsyncLogging.cpp:"),
+          "metrics line uses Logger's line format");
+    check(!reports.empty() && strstr(reports[0].c_str(), " syncs=") && strstr(reports[0].c_str(), " cached_bytes=") &&
+              strstr(reports[0].c_str(), " dropped_cache_bytes="),
+          "page cache stats in metrics line");
+    removeFiles("metrics_report.");
+}
+
+void testRolls() {
+    removeFiles("metrics_roll.");
+    LogFile file("metrics_roll", 16, false);
+    file.append("0123456789abcdef0123456789\n", 27);
+    check(file.ioStats().rolls == 0, "first file is not a roll");
+    sleep(1); // 同一秒内不会roll
+    file.append("0123456789abcdef0123456789\n", 27);
+    file.append("0123456789abcdef0123456789\n", 27);
+    check(file.ioStats().rolls >= 1, "roll counted");
+    removeFiles("metrics_roll.");
+}
+
+void testIoStats() {
+    removeFiles("metrics_io.");
+    AsyncLogging log("metrics_io", 1024L * 1024 * 1024);
+    LogFile::IoPolicy policy;
+    policy.writeBehindBytes = 4 * 1024 * 1024;
+    policy.dropCache = true;
+    log.setIoPolicy(policy);
+    log.setBufferPool(4);
+    log.setOverflowPolicy(AsyncLogging::kBlock);
+    log.start();
+    std::string line(999, 'z');
+    line += '\n';
+    for (int i = 0; i < 32 * 1024; ++i) {
+        log.append(line.data(), static_cast<int>(line.size()));
+    }
+    log.stop();
+    AsyncLogging::Metrics m = log.metrics();
+    check(m.io.flushes > 0 && m.io.writeBehindBytes > 0 && m.io.writeBehindBytes <= m.bytes, "write-behind forwarded");
+    // 只有一个文件：已释放的加上仍占用的页缓存等于写入的字节数
+    check(m.io.droppedCacheBytes > 0 && m.io.droppedCacheBytes + m.io.cachedBytes == m.bytes, "page cache stats forwarded");
+    check(m.io.syncs == 0 && m.rolls == m.io.rolls, "syncs and rolls");
+    removeFiles("metrics_io.");
+}
+
+int main() {
+    testCounter();
+    testHistogram();
+    testAsyncMetrics(false);
+    testAsyncMetrics(true);
+    testDropped(AsyncLogging::kDropNewest, "newest");
+    testDropped(AsyncLogging::kBlock, "block");
+    testReport();
+    testRolls();
+    testIoStats();
+
+    if (g_failures) {
+        printf("%d failures\n", g_failures);
+        return 1;
+    }
+    printf("all passed\n");
+    return 0;
+}
@@ -0,0 +1,149 @@
+/** 逐阶段周期计数测试
+ * 库没有以YKLOG_PROFILE编译时：写日志不产生任何采样
+ * 以-DYKLOG_PROFILE=ON编译时：
+ * 1.全部采样时同步输出的每条日志都记入前端各阶段，不经过AsyncLogging时没有锁的阶段，各阶段之和不超过前端总时间
+ * 2.按间隔采样时采样数为日志条数除以间隔
+ * 3.输出到AsyncLogging（mutex_和线程局部两种模式）时，每条采样的日志都有锁、排队、写入和端到端的阶段，端到端等于排队加写入
+ * 4.后端每次交换缓存记录一次，report()输出每个阶段一行
+ */
+#include "AsyncLogging.h"
+#include "LogProfiler.h"
+#include "Logger.h"
+#include <dirent.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+using namespace myServer;
+
+int g_failures = 0;
+AsyncLogging *g_asyncLog = nullptr;
+
+void check(bool ok, const char *what) {
+    if (!ok) {
+        printf("FAIL %s\n", what);
+        ++g_failures;
+    }
+}
+
+void discard(const char *, int) {}
+void asyncOutput(const char *msg, int len) {
+    g_asyncLog->append(msg, len);
+}
+
+void removeFiles(const std::string &prefix) {
+    DIR *dir = opendir(".");
+    while (struct dirent *entry = readdir(dir)) {
+        if (strncmp(entry->d_name, prefix.c_str(), prefix.size()) == 0) {
+            unlink(entry->d_name);
+        }
+    }
+    closedir(dir);
+}
+
+int64_t count(profiler::Stage stage) {
+    return profiler::snapshot(stage).count;
+}
+
+void testDisabled() {
+    Logger::setOutput(discard);
+    profiler::setSampleInterval(1);
+    for (int i = 0; i < 1000; ++i) {
+        LOG_INFO << "value " << i;
+    }
+    for (int stage = 0; stage < profiler::kNumStages; ++stage) {
+        check(count(static_cast<profiler::Stage>(stage)) == 0, "no samples without YKLOG_PROFILE");
+    }
+}
+
+void testSync() {
+    profiler::reset();
+    profiler::setSampleInterval(1);
+    Logger::setOutput(discard);
+    const int kLines = 10000;
+    for (int i = 0; i < kLines; ++i) {
+        LOG_INFO << "value " << i << " name " << "profiler";
+    }
+    check(count(profiler::kConstruct) == kLines && count(profiler::kFormatTime) == kLines && count(profiler::kStream) == kLines &&
+              count(profiler::kDestruct) == kLines && count(profiler::kOutput) == kLines && count(profiler::kFrontEnd) == kLines,
+          "every record sampled");
+    check(count(profiler::kLockWait) == 0 && count(profiler::kEnqueueToDisk) == 0, "no AsyncLogging stages for synchronous output");
+    LogHistogram::Snapshot frontEnd = profiler::snapshot(profiler::kFrontEnd);
+    int64_t parts = profiler::snapshot(profiler::kConstruct).sum + profiler::snapshot(profiler::kStream).sum + profiler::snapshot(profiler::kDestruct).sum +
+                    profiler::snapshot(profiler::kOutput).sum;
+    check(frontEnd.sum > 0 && parts <= frontEnd.sum, "stages add up to the front end");
+    check(profiler::snapshot(profiler::kFormatTime).sum <= profiler::snapshot(profiler::kConstruct).sum, "formatTime is part of construction");
+
+    profiler::reset();
+    profiler::setSampleInterval(100);
+    for (int i = 0; i < kLines; ++i) {
+        LOG_INFO << "value " << i;
+    }
+    check(count(profiler::kFrontEnd) >= kLines / 100 - 1 && count(profiler::kFrontEnd) <= kLines / 100 + 1, "1 in 100 sampled");
+}
+
+void testAsync(bool threadLocal) {
+    removeFiles("profiler_test.");
+    profiler::reset();
+    profiler::setSampleInterval(100);
+    AsyncLogging log("profiler_test", 1024L * 1024 * 1024);
+    log.setThreadLocalBuffer(threadLocal);
+    g_asyncLog = &log;
+    log.start();
+    Logger::setOutput(asyncOutput);
+    const int kLines = 100000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 2; ++t) {
+        threads.emplace_back([] {
+            for (int i = 0; i < kLines / 2; ++i) {
+                LOG_INFO << "async value " << i;
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    log.stop();
+    Logger::setOutput(discard);
+    int64_t sampled = count(profiler::kFrontEnd);
+    check(sampled == kLines / 100, "async records sampled");
+    check(count(profiler::kLockWait) == sampled, "lock wait per sampled record");
+    check(count(profiler::kQueue) == sampled && count(profiler::kWrite) == sampled && count(profiler::kEnqueueToDisk) == sampled,
+          "every sampled record reaches the disk stages");
+    LogHistogram::Snapshot endToEnd = profiler::snapshot(profiler::kEnqueueToDisk);
+    check(endToEnd.sum == profiler::snapshot(profiler::kQueue).sum + profiler::snapshot(profiler::kWrite).sum && endToEnd.max > 0,
+          "enqueue-to-disk is queue plus write");
+    check(count(profiler::kSwap) >= 1, "backend swaps recorded");
+    removeFiles("profiler_test.");
+}
+
+void testReport() {
+    char buf[4096];
+    FILE *out = fmemopen(buf, sizeof(buf), "w");
+    profiler::report(out);
+    fclose(out);
+    for (int stage = 0; stage < profiler::kNumStages; ++stage) {
+        check(strstr(buf, profiler::StageName[stage]) != nullptr, "report has a line per stage");
+    }
+    check(profiler::ticksPerNanoSecond() > 0, "tsc calibrated");
+}
+
+int main() {
+    if (!profiler::enabled()) {
+        testDisabled();
+    } else {
+        testSync();
+        testAsync(false);
+        testAsync(true);
+    }
+    testReport();
+
+    if (g_failures) {
+        printf("%d failures\n", g_failures);
+        return 1;
+    }
+    printf("all passed%s\n", profiler::enabled() ? "" : " (built without YKLOG_PROFILE)");
+    return 0;
+}
@@ -0,0 +1,74 @@
+/** 关闭的日志调用点的代价
+ * 1.比较按调用点开关的LOG_DEBUG与原来比较全局级别的写法（if (Logger::logLevel() <= DEBUG) ...），
+ *   每次调用一个只有一个关闭的调用点的noinline函数，避免编译器把判断提到循环外，减去空函数调用的时间；
+ *   同一函数中有多个调用点时，原来的写法会被编译器合并为一次比较，不能用来比较
+ * 2.已注册调用点较多时setLogLevel(pattern)的耗时
+ * 用法：logSiteBench [调用次数]
+ */
+#include "Logger.h"
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <utility>
+using namespace myServer;
+
+#define OLD_LOG_DEBUG \
+    if (myServer::Logger::logLevel() <= myServer::Logger::DEBUG) myServer::Logger(__FILE__, __LINE__, myServer::Logger::DEBUG, __func__).stream()
+
+__attribute__((noinline)) void oldStyle(long i) {
+    OLD_LOG_DEBUG << "value " << i;
+    asm volatile("" ::"r"(i));
+}
+__attribute__((noinline)) void perSite(long i) {
+    LOG_DEBUG << "value " << i;
+    asm volatile("" ::"r"(i));
+}
+__attribute__((noinline)) void emptyCall(long i) {
+    asm volatile("" ::"r"(i));
+}
+
+// 每个实例是一个调用点，用于注册大量调用点
+template <int N>
+void manySites() {
+    LOG_DEBUG << "site " << N;
+}
+template <int... N>
+void registerSites(std::integer_sequence<int, N...>) {
+    (manySites<N>(), ...);
+}
+
+template <typename F>
+double nsPerCall(long calls, F f) {
+    double best = 1e30;
+    for (int round = 0; round < 5; ++round) {
+        auto start = std::chrono::steady_clock::now();
+        for (long i = 0; i < calls; ++i) {
+            f(i);
+        }
+        best = std::min(best, std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / calls);
+    }
+    return best;
+}
+
+int main(int argc, char *argv[]) {
+    long calls = argc > 1 ? atol(argv[1]) : 50000000;
+    Logger::setLogLevel(Logger::INFO);
+    perSite(0); // 注册
+
+    double base = nsPerCall(calls, emptyCall);
+    double old = nsPerCall(calls, oldStyle);
+    double site = nsPerCall(calls, perSite);
+    printf("empty noinline call                     %6.3f ns\n", base);
+    printf("disabled site, global logLevel() check  %6.3f ns (+%.3f)\n", old, old - base);
+    printf("disabled site, per-site state           %6.3f ns (+%.3f)\n", site, site - base);
+
+    registerSites(std::make_integer_sequence<int, 1000>());
+    Logger::setLogLevel("warm-up", Logger::INFO);
+    auto start = std::chrono::steady_clock::now();
+    size_t matched = Logger::setLogLevel("logSiteBench.cpp", Logger::DEBUG);
+    Logger::setLogLevel("logSiteBench.cpp", Logger::INFO);
+    double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / 2;
+    printf("setLogLevel(pattern) with %zu sites       %6.1f us (%zu matched)\n", Logger::callSites().size(), us, matched);
+    return 0;
+}
@@ -0,0 +1,196 @@
+/** 按调用点的日志级别测试
+ * 1.日志宏第一次执行时注册，callSites()列出文件、函数、行号和级别，模板的每个实例是不同的调用点
+ * 2.按文件名、路径通配符（模块）设置级别只影响匹配的调用点，后设置的规则优先，之后才注册的调用点同样遵守规则
+ * 3.全局级别对没有匹配规则的调用点生效，包括WARN/ERROR；FATAL总是开启；clearLogLevels()恢复
+ * 4._FMT、_DEFER和限频宏同样按调用点开关
+ * 5.多个线程同时第一次执行同一个调用点时只注册一次
+ * 6.日志宏（包括_FMT、LOG_SYSERR）用在不带花括号的if/else中，级别关闭时外层的else仍然属于外层的if
+ */
+#include "DeferredLog.h"
+#include "LogRateLimit.h"
+#include "Logger.h"
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
+using namespace myServer;
+
+int g_failures = 0;
+std::vector<std::string> g_lines;
+
+void captureOutput(const char *msg, int len) {
+    g_lines.emplace_back(msg, len);
+}
+
+void check(bool ok, const char *what) {
+    if (!ok) {
+        printf("FAIL %s: %zu lines\n", what, g_lines.size());
+        for (const auto &line : g_lines) {
+            printf("  %s", line.c_str());
+        }
+        ++g_failures;
+    }
+}
+
+// 输出中包含text的行数
+size_t count(const char *text) {
+    size_t n = 0;
+    for (const auto &line : g_lines) {
+        n += line.find(text) != std::string::npos;
+    }
+    return n;
+}
+
+const LogCallSite *findSite(const char *func, Logger::LogLevel level) {
+    for (const LogCallSite *site : Logger::callSites()) {
+        if (strcmp(site->func, func) == 0 && site->level == level) {
+            return site;
+        }
+    }
+    return nullptr;
+}
+
+// 用#line模拟其他模块的源文件
+#line 100 "/src/net/TcpServer.cpp"
+void netLog() {
+    LOG_DEBUG << "net debug";
+    LOG_INFO << "net info";
+    LOG_WARN << "net warn";
+}
+#line 200 "/src/db/Database.cpp"
+void dbLog() {
+    LOG_DEBUG << "db debug";
+    LOG_INFO << "db info";
+    LOG_ERROR << "db error";
+}
+void dbLogFmt() {
+    LOG_DEBUG_FMT("db fmt {}", 1);
+}
+void dbLogDefer() {
+    LOG_DEBUG_DEFER("db defer {}", 2);
+}
+void dbLogLimited() {
+    LOG_EVERY_N(DEBUG, 1) << "db limited";
+}
+#line 300 "/src/net/Channel.cpp"
+void channelLog() {
+    LOG_DEBUG << "channel debug";
+}
+#line 80 "logSiteTest.cpp"
+
+template <typename T>
+void templateLog(T) {
+    LOG_INFO << "template";
+}
+
+int main() {
+    Logger::setOutput(captureOutput);
+    Logger::setLogLevel(Logger::INFO);
+
+    // 1
+    netLog();
+    dbLog();
+    check(count("net info") == 1 && count("net warn") == 1 && count("db info") == 1 && count("db error") == 1 && count("debug") == 0,
+          "default level INFO");
+    const LogCallSite *netDebug = findSite("netLog", Logger::DEBUG);
+    check(netDebug && strcmp(netDebug->file, "/src/net/TcpServer.cpp") == 0 && netDebug->line == 101 &&
+              netDebug->state.load() == LogCallSite::kDisabled && !findSite("channelLog", Logger::DEBUG),
+          "callSites() lists executed sites");
+    templateLog(1);
+    templateLog(1.0);
+    templateLog(2);
+    size_t templateSites = 0;
+    for (const LogCallSite *site : Logger::callSites()) {
+        templateSites += strcmp(site->func, "templateLog") == 0;
+    }
+    check(templateSites == 2 && count("template") == 3, "template instances");
+    g_lines.clear();
+
+    // 2
+    size_t matched = Logger::setLogLevel("*/net/*", Logger::DEBUG);
+    netLog();
+    dbLog();
+    channelLog(); // 之后才注册
+    check(matched == 3 && count("net debug") == 1 && count("db debug") == 0 && count("channel debug") == 1, "module glob");
+    g_lines.clear();
+    Logger::setLogLevel("Database.cpp", Logger::DEBUG);
+    Logger::setLogLevel("TcpServer.cpp", Logger::WARN); // 比"*/net/*"后设置，优先
+    netLog();
+    dbLog();
+    channelLog();
+    check(count("net debug") == 0 && count("net info") == 0 && count("net warn") == 1 && count("db debug") == 1 && count("channel debug") == 1,
+          "later rules win");
+    g_lines.clear();
+
+    // 3
+    Logger::clearLogLevels();
+    Logger::setLogLevel(Logger::ERROR);
+    netLog();
+    dbLog();
+    check(g_lines.size() == 1 && count("db error") == 1, "global level applies to WARN");
+    check(YKLOG_SITE_ON_(Logger::FATAL), "FATAL is always enabled");
+    Logger::setLogLevel("Channel.cpp", Logger::TRACE); // 规则优先于全局级别
+    channelLog();
+    check(g_lines.size() == 2 && count("channel debug") == 1, "rule overrides global level");
+    Logger::clearLogLevels();
+    Logger::setLogLevel(Logger::INFO);
+    g_lines.clear();
+
+    // 4
+    dbLogFmt();
+    dbLogLimited();
+    dbLogDefer(); // 没有设置deferred::setOutput，在调用线程上立即格式化
+    check(g_lines.empty(), "FMT/DEFER/limited disabled");
+    Logger::setLogLevel("/src/db/*", Logger::DEBUG);
+    dbLogFmt();
+    dbLogDefer();
+    dbLogLimited();
+    check(count("db fmt 1") == 1 && count("db defer 2") == 1 && count("db limited") == 1, "FMT/DEFER/limited enabled by rule");
+    Logger::clearLogLevels();
+    g_lines.clear();
+
+    // 5
+    size_t before = Logger::callSites().size();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; ++t) {
+        threads.emplace_back([] {
+            for (int i = 0; i < 1000; ++i) {
+                LOG_DEBUG << "concurrent";
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    check(Logger::callSites().size() == before + 1 && g_lines.empty(), "concurrent registration");
+
+    // 6
+    Logger::setLogLevel(Logger::ERROR);
+    int elseTaken = 0;
+    for (int i = 0; i < 4; ++i) {
+        bool fail = i % 2 == 0;
+        if (fail)
+            LOG_WARN << "warn " << i;
+        else
+            ++elseTaken;
+        if (fail)
+            LOG_WARN_FMT("warn fmt {}", i);
+        else
+            ++elseTaken;
+        if (fail)
+            LOG_SYSERR << "syserr " << i;
+        else
+            ++elseTaken;
+    }
+    check(elseTaken == 6 && g_lines.size() == 2 && count("syserr 0") == 1 && count("syserr 2") == 1, "unbraced if/else with WARN disabled");
+    Logger::setLogLevel(Logger::INFO);
+    g_lines.clear();
+
+    if (g_failures) {
+        printf("%d failures\n", g_failures);
+        return 1;
+    }
+    printf("all passed\n");
+    return 0;
+}
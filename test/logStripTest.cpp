@@ -0,0 +1,109 @@
+/** 编译期调用点元数据和YKLOG_MIN_LEVEL测试（本文件以YKLOG_MIN_LEVEL=INFO编译）
+ * 1.文件名和日志行结尾" - 文件名:行号\n"在编译期计算，与运行时的SourceFile一致
+ * 2.低于YKLOG_MIN_LEVEL的日志宏（包括_FMT、_DEFER和限频宏）不输出、不注册调用点、不对参数求值，即使运行时级别为TRACE
+ * 3.没有被去掉的日志宏行尾正确，LOG_SYSERR写入errno，TRACE/DEBUG之外不写函数名
+ */
+#define YKLOG_MIN_LEVEL 2
+#include "DeferredLog.h"
+#include "LogRateLimit.h"
+#include "Logger.h"
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+using namespace myServer;
+
+int g_failures = 0;
+std::vector<std::string> g_lines;
+
+void captureOutput(const char *msg, int len) {
+    g_lines.emplace_back(msg, len);
+}
+
+void check(bool ok, const char *what) {
+    if (!ok) {
+        printf("FAIL %s: %zu lines\n", what, g_lines.size());
+        for (const auto &line : g_lines) {
+            printf("  %s", line.c_str());
+        }
+        ++g_failures;
+    }
+}
+
+bool endsWith(const std::string &s, const std::string &suffix) {
+    return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+constexpr bool sameString(const char *a, const char *b) {
+    for (; *a && *a == *b; ++a, ++b) {
+    }
+    return *a == *b;
+}
+
+// 1
+static_assert(sameString(detail::sourceBasename("/src/net/TcpServer.cpp"), "TcpServer.cpp"), "basename of a path");
+static_assert(sameString(detail::sourceBasename("main.cpp"), "main.cpp"), "basename without '/'");
+static_assert(detail::siteSuffixSize("/src/a.cpp", 7) == sizeof(" - a.cpp:7\n") - 1, "suffix size");
+static_assert(detail::siteSuffixSize("a.cpp", 12345) == sizeof(" - a.cpp:12345\n") - 1, "suffix size with 5 digits");
+constexpr detail::SiteSuffix<detail::siteSuffixSize("/x/y/Channel.cpp", 1090)> kSuffix("/x/y/Channel.cpp", 1090);
+static_assert(kSuffix.data[0] == ' ' && kSuffix.data[3] == 'C' && kSuffix.data[14] == ':' && kSuffix.data[15] == '1' &&
+                  kSuffix.data[16] == '0' && kSuffix.data[17] == '9' && kSuffix.data[18] == '0' && kSuffix.data[19] == '\n',
+              "suffix content");
+constexpr Logger::SourceFile kFile = "/x/y/Channel.cpp"; // 拷贝初始化才使用数组版本
+static_assert(kFile.size() == 11, "constexpr SourceFile");
+
+int g_evaluated = 0;
+int sideEffect() {
+    return ++g_evaluated;
+}
+
+size_t sitesBelowInfo() {
+    size_t n = 0;
+    for (const LogCallSite *site : Logger::callSites()) {
+        n += site->level < Logger::INFO;
+    }
+    return n;
+}
+
+int main() {
+    Logger::setOutput(captureOutput);
+
+    // 1
+    const char *path = __FILE__;
+    Logger::SourceFile runtimeFile(path);
+    check(strcmp(detail::sourceBasename(__FILE__), runtimeFile.data()) == 0, "basename matches strrchr");
+
+    // 2
+    Logger::setLogLevel(Logger::TRACE);
+    LOG_TRACE << "trace " << sideEffect();
+    LOG_DEBUG << "debug " << sideEffect();
+    LOG_DEBUG_FMT("debug fmt {}", sideEffect());
+    LOG_EVERY_N(DEBUG, 1) << "debug limited " << sideEffect();
+    LOG_DEBUG_DEFER("debug defer {}", sideEffect());
+    check(g_lines.empty() && g_evaluated == 0, "statements below YKLOG_MIN_LEVEL are removed");
+    check(sitesBelowInfo() == 0, "no call sites registered below YKLOG_MIN_LEVEL");
+
+    // 3
+    Logger::setLogLevel(Logger::INFO);
+    int line = __LINE__ + 1;
+    LOG_INFO << "info " << sideEffect();
+    check(g_lines.size() == 1 && g_evaluated == 1 && endsWith(g_lines[0], "info 1 - logStripTest.cpp:" + std::to_string(line) + "\n"),
+          "enabled statement ends with compile-time suffix");
+#line 12345
+    LOG_WARN_FMT("warn {}", 2);
+#line 96
+    check(g_lines.size() == 2 && endsWith(g_lines[1], "warn 2 - logStripTest.cpp:12345\n") && g_lines[1].find("main") == std::string::npos,
+          "five-digit line, no function name above DEBUG");
+    errno = ENOENT;
+    LOG_SYSERR << "open";
+    check(g_lines.size() == 3 && g_lines[2].find(strerror(ENOENT)) != std::string::npos && g_lines[2].find("(errno=2)") != std::string::npos,
+          "LOG_SYSERR writes errno");
+
+    if (g_failures) {
+        printf("%d failures\n", g_failures);
+        return 1;
+    }
+    printf("all passed\n");
+    return 0;
+}
@@ -0,0 +1,49 @@
+/** Logger每条日志的堆分配次数和耗时
+ * 替换全局operator new统计分配次数，日志输出到空函数，只测前端构造、格式化和析构
+ * "heap Logger"一行把Logger整体放到堆上，模拟原先每条日志new一个Impl的开销，作为对照
+ * 用法：loggerAllocBench [调用次数]
+ */
+#include "Logger.h"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+using namespace myServer;
+
+static std::atomic<long> g_allocations(0);
+void *operator new(size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = malloc(size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+void nullOutput(const char *, int) {}
+
+template <typename F>
+void measure(const char *name, int calls, F &&once) {
+    long allocations = g_allocations.load();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < calls; ++i) {
+        once(i);
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    printf("%-14s %8.1f ns/line %6.2f allocations/line\n", name, ns / calls, static_cast<double>(g_allocations.load() - allocations) / calls);
+}
+
+int main(int argc, char *argv[]) {
+    int calls = argc > 1 ? atoi(argv[1]) : 1000000;
+    Logger::setOutput(nullOutput);
+    Logger::setLogLevel(Logger::TRACE);
+
+    measure("LOG_INFO", calls, [](int i) { LOG_INFO << "request id=" << i << " done"; });
+    measure("LOG_DEBUG", calls, [](int i) { LOG_DEBUG << "request id=" << i << " done"; });
+    measure("heap Logger", calls, [](int i) { unique_ptr<Logger>(new Logger(__FILE__, __LINE__))->stream() << "request id=" << i << " done"; });
+    measure("LOG_ERROR", calls, [](int i) { LOG_ERROR << "request id=" << i << " done"; });
+    return 0;
+}
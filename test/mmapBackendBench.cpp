@@ -0,0 +1,79 @@
+/** mmap写入与fwrite写入的吞吐，按不同的rollSize分别测试
+ * 模拟AsyncLogging后端：每批16块4MB的缓存，kStdio逐块fwrite，kWritev和kMmap整批写入，共写入totalMB
+ * 同一秒内最多roll一次，rollSize较小时每个文件会超出rollSize直到下一秒，kMmap按窗口继续预分配
+ * 结果包括页缓存的写入和关闭文件（kMmap的ftruncate），不含落盘
+ * 用法：mmapBackendBench [totalMB] [目录]
+ */
+#include "AsyncLogging.h"
+#include "LogFile.h"
+#include <chrono>
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+using namespace myServer;
+
+void removeFiles(const std::string &prefix) {
+    DIR *dir = opendir(".");
+    while (struct dirent *entry = readdir(dir)) {
+        if (strncmp(entry->d_name, prefix.c_str(), prefix.size()) == 0) {
+            unlink(entry->d_name);
+        }
+    }
+    closedir(dir);
+}
+
+int main(int argc, char *argv[]) {
+    long totalMB = argc > 1 ? atol(argv[1]) : 2048;
+    if (argc > 2 && chdir(argv[2]) != 0) {
+        perror("chdir");
+        return 1;
+    }
+    const int kBuffersPerBatch = 16;
+    std::vector<std::unique_ptr<AsyncLogging::Buffer>> buffers;
+    for (int i = 0; i < kBuffersPerBatch; ++i) {
+        buffers.emplace_back(new AsyncLogging::Buffer);
+        std::string line(99, static_cast<char>('a' + i));
+        line += '\n';
+        while (buffers.back()->avail() > static_cast<int>(line.size())) {
+            buffers.back()->append(line.data(), line.size());
+        }
+    }
+    std::vector<struct iovec> iov;
+    for (const auto &buffer : buffers) {
+        iov.push_back({const_cast<char *>(buffer->data()), static_cast<size_t>(buffer->length())});
+    }
+    const long batchBytes = static_cast<long>(kBuffersPerBatch) * buffers[0]->length();
+    const long batches = totalMB * 1024 * 1024 / batchBytes + 1;
+
+    const off_t rollSizes[] = {16L << 20, 64L << 20, 256L << 20, 1L << 30};
+    const LogFile::Backend backends[] = {LogFile::kStdio, LogFile::kWritev, LogFile::kMmap};
+    const char *names[] = {"stdio", "writev", "mmap"};
+    for (off_t rollSize : rollSizes) {
+        for (int b = 0; b < 3; ++b) {
+            std::string basename = std::string("mmap_bench_") + names[b];
+            removeFiles(basename + ".");
+            auto start = std::chrono::steady_clock::now();
+            {
+                LogFile file(basename, rollSize, false, 3, 1024, backends[b]);
+                for (long i = 0; i < batches; ++i) {
+                    if (backends[b] == LogFile::kStdio) {
+                        for (const auto &buffer : buffers) {
+                            file.append(buffer->data(), buffer->length());
+                        }
+                    } else {
+                        file.append(iov.data(), static_cast<int>(iov.size()));
+                    }
+                }
+                file.flush();
+            }
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            printf("rollSize %5ldMB %-7s %6.2f GB/s (%ld MB in %.2fs)\n", static_cast<long>(rollSize >> 20), names[b],
+                   batches * batchBytes / seconds / 1e9, batches * batchBytes >> 20, seconds);
+            removeFiles(basename + ".");
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,54 @@
+/** 限频日志宏被抑制时的代价
+ * 每种宏在一个调用点上循环调用，几乎全部被抑制，输出函数丢弃日志；
+ * 与级别关闭的LOG_DEBUG（一次比较）和实际输出的LOG_WARN（格式化后丢弃）比较，1个线程和threads个线程同时调用同一调用点，
+ * 结果为总时间除以总调用次数（多个线程时包括同一缓存行在核间传递的代价）
+ * 用法：rateLimitBench [每线程调用次数] [threads]
+ */
+#include "LogRateLimit.h"
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <thread>
+#include <vector>
+using namespace myServer;
+
+void discard(const char *, int) {}
+
+template <typename Body>
+double nsPerCall(int threads, long calls, Body body) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> pool;
+    for (int t = 0; t < threads; ++t) {
+        pool.emplace_back([calls, &body] {
+            for (long i = 0; i < calls; ++i) {
+                body(i);
+            }
+        });
+    }
+    for (auto &thread : pool) {
+        thread.join();
+    }
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / calls / threads; // 总时间除以总调用次数
+}
+
+int main(int argc, char *argv[]) {
+    long calls = argc > 1 ? atol(argv[1]) : 20000000;
+    int threads = argc > 2 ? atoi(argv[2]) : 4;
+    Logger::setOutput(discard);
+    Logger::setLogLevel(Logger::INFO);
+
+    printf("%-28s %12s %12s   (ns/call)\n", "", "1 thread", (std::to_string(threads) + " threads").c_str());
+    auto run = [&](const char *name, long n, auto body) {
+        double one = nsPerCall(1, n, body);
+        double many = nsPerCall(threads, n, body);
+        printf("%-28s %12.2f %12.2f\n", name, one, many);
+    };
+    run("LOG_DEBUG (disabled)", calls, [](long i) { LOG_DEBUG << "value " << i; });
+    run("LOG_EVERY_N(1000000)", calls, [](long i) { LOG_EVERY_N(WARN, 1000000) << "value " << i; });
+    run("LOG_FIRST_N(10)", calls, [](long i) { LOG_FIRST_N(WARN, 10) << "value " << i; });
+    run("LOG_EVERY_MS(1000)", calls, [](long i) { LOG_EVERY_MS(WARN, 1000) << "value " << i; });
+    run("LOG_RATE_LIMITED(10/s, 5)", calls, [](long i) { LOG_RATE_LIMITED(WARN, 10, 5) << "value " << i; });
+    run("LOG_WARN (emitted)", calls / 10, [](long i) { LOG_WARN << "value " << i; });
+    return 0;
+}
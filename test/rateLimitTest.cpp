@@ -0,0 +1,146 @@
+/** 限频日志宏测试
+ * 1.LOG_EVERY_N：输出第1、N+1...次，之后的每条报告"[suppressed N-1] "；LOG_FIRST_N只输出前N次
+ * 2.LOG_EVERY_MS：一段时间内输出的条数与时间相符，输出和报告的抑制次数之和等于调用次数（最后一次输出之后的除外）
+ * 3.LOG_RATE_LIMITED：立即输出burst条，之后按速率补充
+ * 4.级别被关闭时不输出也不计数；不同调用点的状态互相独立；宏用在不带花括号的if/else中
+ * 5.多线程同时调用同一个LOG_EVERY_N，输出的条数精确，报告的抑制次数之和与调用次数一致
+ */
+#include "LogRateLimit.h"
+#include <chrono>
+#include <mutex>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
+using namespace myServer;
+
+int g_failures = 0;
+std::mutex g_mutex;
+std::vector<std::string> g_lines;
+
+void captureOutput(const char *msg, int len) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    g_lines.emplace_back(msg, len);
+}
+
+// 每行报告的抑制次数之和
+uint64_t suppressedSum() {
+    uint64_t sum = 0;
+    for (const auto &line : g_lines) {
+        const char *p = strstr(line.c_str(), "[suppressed ");
+        if (p) {
+            sum += strtoull(p + 12, nullptr, 10);
+        }
+    }
+    return sum;
+}
+
+void check(bool ok, const char *what) {
+    if (!ok) {
+        printf("FAIL %s: %zu lines, %llu suppressed\n", what, g_lines.size(), static_cast<unsigned long long>(suppressedSum()));
+        ++g_failures;
+    }
+}
+
+void everyN(int i) {
+    LOG_EVERY_N(WARN, 10) << "every " << i;
+}
+
+int main() {
+    Logger::setOutput(captureOutput);
+    Logger::setLogLevel(Logger::INFO);
+
+    // 1
+    for (int i = 0; i < 95; ++i) {
+        everyN(i);
+    }
+    check(g_lines.size() == 10 && g_lines[0].find("[suppressed") == std::string::npos && g_lines[1].find("[suppressed 9] every 10") != std::string::npos &&
+              g_lines[9].find("every 90") != std::string::npos,
+          "LOG_EVERY_N");
+    g_lines.clear();
+    for (int i = 0; i < 100; ++i) {
+        LOG_FIRST_N(ERROR, 3) << "first " << i;
+    }
+    check(g_lines.size() == 3 && g_lines[2].find("first 2") != std::string::npos && suppressedSum() == 0, "LOG_FIRST_N");
+    g_lines.clear();
+
+    // 2.约300ms，每50ms一条
+    uint64_t calls = 0;
+    auto start = std::chrono::steady_clock::now();
+    while (std::chrono::steady_clock::now() - start < std::chrono::milliseconds(300)) {
+        LOG_EVERY_MS(WARN, 50) << "every ms";
+        ++calls;
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    check(g_lines.size() >= 4 && g_lines.size() <= 8 && g_lines.size() + suppressedSum() <= calls &&
+              g_lines.size() + suppressedSum() + calls / g_lines.size() * 2 >= calls,
+          "LOG_EVERY_MS");
+    g_lines.clear();
+
+    // 3.每秒100条，最多连续20条
+    for (int i = 0; i < 1000; ++i) {
+        LOG_RATE_LIMITED(WARN, 100, 20) << "limited " << i;
+    }
+    check(g_lines.size() == 20, "LOG_RATE_LIMITED burst");
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    for (int i = 0; i < 1000; ++i) {
+        LOG_RATE_LIMITED(WARN, 100, 20) << "limited " << i;
+    }
+    // 与上面是不同的调用点，立即输出20条
+    check(g_lines.size() == 40, "LOG_RATE_LIMITED sites are independent");
+    g_lines.clear();
+    for (int round = 0; round < 2; ++round) {
+        for (int i = 0; i < 1000; ++i) {
+            LOG_RATE_LIMITED(WARN, 100, 20) << "refill " << i;
+        }
+        if (round == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(200)); // 补充约20个令牌
+        }
+    }
+    check(g_lines.size() >= 34 && g_lines.size() <= 42 && g_lines[20].find("[suppressed 980] refill") != std::string::npos, "LOG_RATE_LIMITED refill");
+    g_lines.clear();
+
+    // 4
+    for (int i = 0; i < 20; ++i) {
+        Logger::setLogLevel(i < 10 ? Logger::INFO : Logger::DEBUG);
+        LOG_EVERY_N(DEBUG, 3) << "debug " << i;
+    }
+    check(g_lines.size() == 4 && g_lines[0].find("debug 10") != std::string::npos && g_lines[1].find("[suppressed 2] debug 13") != std::string::npos,
+          "disabled level is not counted");
+    Logger::setLogLevel(Logger::INFO);
+    g_lines.clear();
+    for (int i = 0; i < 10; ++i) {
+        if (i % 2 == 0)
+            LOG_EVERY_N(INFO, 2) << "even " << i;
+        else
+            LOG_EVERY_N(INFO, 2) << "odd " << i;
+    }
+    check(g_lines.size() == 6 && g_lines[0].find("even 0") != std::string::npos && g_lines[1].find("odd 1") != std::string::npos, "if/else");
+    g_lines.clear();
+
+    // 5
+    const int kThreads = 8;
+    const int kCalls = 100000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back([] {
+            for (int i = 0; i < kCalls; ++i) {
+                LOG_EVERY_N(WARN, 1000) << "threads";
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    check(g_lines.size() == kThreads * kCalls / 1000 && suppressedSum() == (kThreads * kCalls / 1000 - 1) * 999, "LOG_EVERY_N threads");
+    g_lines.clear();
+
+    if (g_failures) {
+        printf("%d failures\n", g_failures);
+        return 1;
+    }
+    printf("all passed\n");
+    return 0;
+}
@@ -0,0 +1,73 @@
+/** 日志行时间前缀的开销
+ * 1.取当前时间：gettimeofday与clock_gettime(CLOCK_REALTIME)
+ * 2.格式化：原先的实现（按秒缓存"年月日 时:分:秒"，每行snprintf(".%06dZ ")）与Logger::formatTime的各种精度
+ * 输入时间每次递增约1微秒，模拟高频日志
+ * 用法：timeFormatBench [调用次数]
+ */
+#include "Logger.h"
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+using namespace myServer;
+
+// 原先Logger::formatTime的实现
+__thread char t_time[64];
+__thread time_t t_lastSecond;
+void formatTimeSnprintf(LogStream &stream, int64_t microSecondsSinceEpoch) {
+    time_t seconds = static_cast<time_t>(microSecondsSinceEpoch / 1000000);
+    int microSeconds = static_cast<int>(microSecondsSinceEpoch % 1000000);
+    if (seconds != t_lastSecond) {
+        t_lastSecond = seconds;
+        struct tm tm_time;
+        localtime_r(&seconds, &tm_time);
+        snprintf(t_time, sizeof(t_time), "%4d%02d%02d %02d:%02d:%02d",
+                 tm_time.tm_year + 1900, tm_time.tm_mon + 1, tm_time.tm_mday,
+                 tm_time.tm_hour, tm_time.tm_min, tm_time.tm_sec);
+    }
+    char microBuf[32];
+    snprintf(microBuf, sizeof(microBuf), ".%06dZ ", microSeconds);
+    stream.append(t_time, 17);
+    stream.append(microBuf, 9);
+}
+
+template <typename F>
+void measure(const char *name, int calls, F &&once) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < calls; ++i) {
+        once(i);
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    printf("%-24s %7.1f ns/call\n", name, ns / calls);
+}
+
+int main(int argc, char *argv[]) {
+    int calls = argc > 1 ? atoi(argv[1]) : 5000000;
+    int64_t sink = 0; // 防止编译器优化掉调用
+
+    measure("gettimeofday", calls, [&](int) {
+        struct timeval tv;
+        gettimeofday(&tv, NULL);
+        sink += tv.tv_usec;
+    });
+    measure("TimeStamp::now", calls, [&](int) { sink += TimeStamp::now().nanoSecondsSinceEpoch(); });
+
+    const int64_t base = TimeStamp::now().microSecondsSinceEpoch();
+    LogStream stream;
+    measure("snprintf (old)", calls, [&](int i) {
+        stream.resetBuffer();
+        formatTimeSnprintf(stream, base + i);
+        sink += stream.buffer().length();
+    });
+    const char *names[] = {"formatTime seconds", "formatTime milliseconds", "formatTime microseconds", "formatTime nanoseconds"};
+    const TimeStamp::Precision precisions[] = {TimeStamp::kSeconds, TimeStamp::kMilliSeconds, TimeStamp::kMicroSeconds, TimeStamp::kNanoSeconds};
+    for (int p = 0; p < 4; ++p) {
+        Logger::setTimePrecision(precisions[p]);
+        measure(names[p], calls, [&](int i) {
+            stream.resetBuffer();
+            Logger::formatTime(stream, TimeStamp::fromNanoSeconds((base + i) * 1000 + 789));
+            sink += stream.buffer().length();
+        });
+    }
+    return sink == 0;
+}
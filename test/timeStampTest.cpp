@@ -0,0 +1,119 @@
+/** 时间戳格式化测试
+ * 1.在几个时区（含夏令时和半小时偏移）下，随机时间和连续跨分钟、跨天、跨年的时间，
+ *   formatTo/formatCompactTo的输出与localtime_r + strftime逐字节比较，检查线程缓存在分钟切换时正确更新
+ * 2.各精度下秒以下部分的位数和取值
+ * 3.Logger::setTimePrecision对日志行前缀的影响
+ * 4.parse读回formatTo的输出，再次格式化后与原字符串相同（夏令时回拨的那一小时本地时间有歧义，不比较秒数）
+ */
+#include "Logger.h"
+#include "TimeStamp.h"
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+using namespace myServer;
+
+int g_failures = 0;
+
+void expect(const std::string &actual, const std::string &expected, const char *what) {
+    if (actual != expected) {
+        printf("FAIL %s: got \"%s\", expected \"%s\"\n", what, actual.c_str(), expected.c_str());
+        ++g_failures;
+    }
+}
+
+std::string reference(time_t seconds, const char *format) {
+    struct tm tm_time;
+    localtime_r(&seconds, &tm_time);
+    char buf[64];
+    return std::string(buf, strftime(buf, sizeof(buf), format, &tm_time));
+}
+
+void checkSecond(time_t seconds) {
+    TimeStamp ts = TimeStamp::fromUnixTime(seconds, 123456);
+    char buf[TimeStamp::kMaxFormattedSize];
+    expect(std::string(buf, ts.formatTo(buf, TimeStamp::kSeconds)), reference(seconds, "%Y%m%d %H:%M:%S"), "formatTo");
+    expect(std::string(buf, ts.formatCompactTo(buf)), reference(seconds, "%Y%m%d-%H%M%S"), "formatCompactTo");
+    std::string formatted(buf, ts.formatTo(buf, TimeStamp::kMicroSeconds));
+    TimeStamp parsed;
+    size_t n = TimeStamp::parse(formatted.data(), formatted.size(), &parsed);
+    expect(std::string(buf, parsed.formatTo(buf, TimeStamp::kMicroSeconds)), n == formatted.size() ? formatted : "", "parse");
+}
+
+void checkZone(const char *tz) {
+    setenv("TZ", tz, 1);
+    tzset();
+    std::mt19937_64 rng(3);
+    // 2000年到2100年之间的随机时间
+    for (int i = 0; i < 100000; ++i) {
+        checkSecond(static_cast<time_t>(946684800 + rng() % (100LL * 365 * 86400)));
+    }
+    // 连续的秒：跨分钟、跨天、跨年，以及2021-03-14/2021-11-07美国夏令时切换
+    const time_t starts[] = {1609459140, 1615705140, 1636264740, 1636268340};
+    for (time_t start : starts) {
+        for (time_t t = start - 120; t < start + 7200; ++t) {
+            checkSecond(t);
+        }
+    }
+}
+
+int main() {
+    checkZone("UTC0");
+    checkZone("America/New_York");
+    checkZone("IST-5:30"); // 半小时偏移
+
+    setenv("TZ", "UTC0", 1);
+    tzset();
+    TimeStamp ts = TimeStamp::fromNanoSeconds(1700000000LL * TimeStamp::kNanoSecondPerSecond + 12345678);
+    char buf[TimeStamp::kMaxFormattedSize];
+    expect(std::string(buf, ts.formatTo(buf, TimeStamp::kSeconds)), "20231114 22:13:20", "seconds");
+    expect(std::string(buf, ts.formatTo(buf, TimeStamp::kMilliSeconds)), "20231114 22:13:20.012", "milliseconds");
+    expect(std::string(buf, ts.formatTo(buf, TimeStamp::kMicroSeconds)), "20231114 22:13:20.012345", "microseconds");
+    expect(std::string(buf, ts.formatTo(buf, TimeStamp::kNanoSeconds)), "20231114 22:13:20.012345678", "nanoseconds");
+    expect(ts.toFormatString(), "20231114 22:13:20", "toFormatString");
+    expect(ts.toFormatString(true), "20231114 22:13:20.012345", "toFormatString micro");
+    expect(ts.toString(), "1700000000.012345", "toString");
+    expect(TimeStamp(1700000000LL * TimeStamp::kMicroSecondPerSecond + 5).toString(), "1700000000.000005", "microsecond constructor");
+    const char *inputs[] = {"20231114 22:13:20.012345678Z ", "20231114 22:13:20.012 INFO", "20231114 22:13:20 x", "20231114 22:13:20.", "2023111 22:13:20", "20231314 22:13:20"};
+    const size_t lengths[] = {27, 21, 17, 17, 0, 0};
+    const int64_t expected[] = {1700000000012345678LL, 1700000000012000000LL, 1700000000000000000LL, 1700000000000000000LL, 0, 0};
+    for (int i = 0; i < 6; ++i) {
+        TimeStamp parsed;
+        size_t n = TimeStamp::parse(inputs[i], strlen(inputs[i]), &parsed);
+        if (n != lengths[i] || (n > 0 && parsed.nanoSecondsSinceEpoch() != expected[i])) {
+            printf("FAIL parse \"%s\": length %zu, %s\n", inputs[i], n, parsed.toString().c_str());
+            ++g_failures;
+        }
+    }
+
+    TimeStamp before = TimeStamp::now();
+    TimeStamp after = TimeStamp::now();
+    if (after < before || before.SecondsSinceEpoch() < 1700000000) {
+        printf("FAIL now: %s %s\n", before.toString().c_str(), after.toString().c_str());
+        ++g_failures;
+    }
+
+    // 日志行前缀：时间 + 'Z' + 空格
+    const Logger::SourceFile file("timeStampTest.cpp");
+    const int kPrefixSize[] = {19, 23, 26, 29};
+    const TimeStamp::Precision precisions[] = {TimeStamp::kSeconds, TimeStamp::kMilliSeconds, TimeStamp::kMicroSeconds, TimeStamp::kNanoSeconds};
+    for (int i = 0; i < 4; ++i) {
+        Logger::setTimePrecision(precisions[i]);
+        LogStream stream;
+        Logger::formatTime(stream, ts);
+        std::string prefix(stream.buffer().data(), stream.buffer().length());
+        if (static_cast<int>(prefix.size()) != kPrefixSize[i] || prefix.compare(prefix.size() - 2, 2, "Z ") != 0) {
+            printf("FAIL prefix with precision %d: \"%s\"\n", i, prefix.c_str());
+            ++g_failures;
+        }
+    }
+    Logger::setTimePrecision(TimeStamp::kMicroSeconds);
+
+    if (g_failures) {
+        printf("%d failures\n", g_failures);
+        return 1;
+    }
+    printf("all passed\n");
+    return 0;
+}
@@ -0,0 +1,341 @@
+/** yklog_bench: 日志库的延迟与吞吐基准，不依赖外部服务，结果可以写成JSON/CSV，用于比较不同版本
+ * 1.sync_devnull、sync_file：同步Logger每条日志的平均耗时和延迟分布，分别fwrite到/dev/null和写入LogFile
+ * 2.async：1到N个生产者线程（按2倍递增，总条数不变）用LOG_INFO写入AsyncLogging，记录每次AsyncLogging::append的耗时（p50/p99/p99.9/max），
+ *   从开始写入到stop()返回（后端写完全部日志）的持续吞吐，丢弃的条数，以及运行期间进程RSS的增长
+ * 平均耗时在不计时的一轮中测量；延迟分布是另一轮中每次调用前后读steady_clock，包含一次读时钟的开销（timer_overhead_ns）
+ * CSV文件已存在时只追加数据行，不同版本的结果可以放在同一个文件中比较
+ * 用法：yklog_bench [-t 最大线程数] [-n 每个场景的总条数] [-d 日志目录] [-p block|drop] [-l 标签] [-j results.json] [-c results.csv]
+ */
+#include "AsyncLogging.h"
+#include "LogFile.h"
+#include "Logger.h"
+#include <algorithm>
+#include <chrono>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+using namespace myServer;
+
+struct Result {
+    std::string scenario;
+    int threads;
+    long lines;
+    double nsPerCall;  // 前端平均每条的耗时（多线程时为总时间除以总条数）
+    double p50, p99, p999, max;
+    double mbPerSec;   // 同步为前端写入速度，异步为直到后端写完的持续吞吐
+    int64_t dropped;
+    double dropRate;
+    long rssGrowthKb;
+};
+
+double g_timerOverhead = 0;
+
+double nowNs() {
+    return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+long rssKb() {
+    long pages = 0, resident = 0;
+    if (FILE *fp = fopen("/proc/self/statm", "r")) {
+        if (fscanf(fp, "%ld %ld", &pages, &resident) != 2) {
+            resident = 0;
+        }
+        fclose(fp);
+    }
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+// 删除日志目录（当前目录）下以prefix开头的文件
+void removeLogFiles(const std::string &prefix) {
+    DIR *dir = opendir(".");
+    if (!dir) {
+        return;
+    }
+    while (struct dirent *entry = readdir(dir)) {
+        if (strncmp(entry->d_name, prefix.c_str(), prefix.size()) == 0) {
+            unlink(entry->d_name);
+        }
+    }
+    closedir(dir);
+}
+
+void percentiles(std::vector<uint32_t> &samples, Result *result) {
+    if (samples.empty()) {
+        return;
+    }
+    auto at = [&samples](double q) {
+        auto nth = samples.begin() + static_cast<size_t>(q * (samples.size() - 1));
+        std::nth_element(samples.begin(), nth, samples.end());
+        return static_cast<double>(*nth);
+    };
+    result->p50 = at(0.5);
+    result->p99 = at(0.99);
+    result->p999 = at(0.999);
+    result->max = *std::max_element(samples.begin(), samples.end());
+}
+
+// 一条典型的日志：几个整数、一个浮点数和字符串，约100字节
+inline void logOnce(long i) {
+    LOG_INFO << "bench request id=" << i << " user=" << (i & 1023) << " latency=" << 0.125 * (i & 63) << "ms path=/api/v1/items";
+}
+
+// 输出函数把写入的字节数累加到线程局部的计数中，需要时记录输出函数本身的耗时
+thread_local int64_t t_bytes = 0;
+thread_local std::vector<uint32_t> *t_latencies = nullptr;
+FILE *g_devNull = nullptr;
+LogFile *g_logFile = nullptr;
+AsyncLogging *g_async = nullptr;
+
+template <typename Sink>
+void timedOutput(const char *msg, int len, Sink sink) {
+    t_bytes += len;
+    if (t_latencies) {
+        double start = nowNs();
+        sink(msg, len);
+        t_latencies->push_back(static_cast<uint32_t>(std::min(nowNs() - start, 4e9)));
+    } else {
+        sink(msg, len);
+    }
+}
+void devNullOutput(const char *msg, int len) {
+    timedOutput(msg, len, [](const char *m, int n) { fwrite(m, 1, n, g_devNull); });
+}
+void fileOutput(const char *msg, int len) {
+    timedOutput(msg, len, [](const char *m, int n) { g_logFile->append(m, n); });
+}
+void asyncOutput(const char *msg, int len) {
+    timedOutput(msg, len, [](const char *m, int n) { g_async->append(m, n); });
+}
+
+// 同步输出：先不计时跑一轮得到平均耗时，再逐条计时得到分布（计时的是整条日志，不只是输出函数）
+Result runSync(const char *scenario, Logger::OutputFunc output, long lines) {
+    Result result{};
+    result.scenario = scenario;
+    result.threads = 1;
+    result.lines = lines;
+    Logger::setOutput(output);
+    t_bytes = 0;
+    double start = nowNs();
+    for (long i = 0; i < lines; ++i) {
+        logOnce(i);
+    }
+    double elapsed = nowNs() - start;
+    result.nsPerCall = elapsed / lines;
+    result.mbPerSec = t_bytes / 1e6 / (elapsed / 1e9);
+
+    std::vector<uint32_t> samples;
+    samples.reserve(lines);
+    for (long i = 0; i < lines; ++i) {
+        double begin = nowNs();
+        logOnce(i);
+        samples.push_back(static_cast<uint32_t>(std::min(nowNs() - begin, 4e9)));
+    }
+    percentiles(samples, &result);
+    return result;
+}
+
+Result runAsync(int threads, long linesPerThread, AsyncLogging::OverflowPolicy policy) {
+    Result result{};
+    result.scenario = "async";
+    result.threads = threads;
+    result.lines = linesPerThread * threads;
+    std::string basename = "yklog_bench_async_" + std::to_string(threads); // AsyncLogging只保存指针
+    removeLogFiles(basename + ".");
+    long rssBefore = rssKb();
+
+    AsyncLogging log(basename.c_str(), 1024L * 1024 * 1024);
+    log.setOverflowPolicy(policy);
+    g_async = &log;
+    Logger::setOutput(asyncOutput);
+    log.start();
+
+    std::vector<std::vector<uint32_t>> latencies(threads);
+    std::vector<int64_t> bytes(threads);
+    std::vector<std::thread> producers;
+    double start = nowNs();
+    for (int t = 0; t < threads; ++t) {
+        producers.emplace_back([t, linesPerThread, &latencies, &bytes] {
+            latencies[t].reserve(linesPerThread);
+            t_latencies = &latencies[t];
+            t_bytes = 0;
+            for (long i = 0; i < linesPerThread; ++i) {
+                logOnce(i);
+            }
+            t_latencies = nullptr;
+            bytes[t] = t_bytes;
+        });
+    }
+    for (auto &producer : producers) {
+        producer.join();
+    }
+    double produced = nowNs();
+    long rssPeak = rssKb();
+    log.stop();
+    double drained = nowNs();
+    Logger::setOutput(devNullOutput);
+    g_async = nullptr;
+
+    int64_t totalBytes = 0;
+    for (int64_t b : bytes) {
+        totalBytes += b;
+    }
+    std::vector<uint32_t> samples;
+    samples.reserve(result.lines);
+    for (const auto &v : latencies) {
+        samples.insert(samples.end(), v.begin(), v.end());
+    }
+    percentiles(samples, &result);
+    result.nsPerCall = (produced - start) / result.lines;
+    result.mbPerSec = totalBytes / 1e6 / ((drained - start) / 1e9);
+    result.dropped = log.droppedMessages();
+    result.dropRate = static_cast<double>(result.dropped) / result.lines;
+    result.rssGrowthKb = std::max(rssPeak, rssKb()) - rssBefore;
+    removeLogFiles(basename + ".");
+    return result;
+}
+
+void writeJson(const char *path, const std::string &label, int maxThreads, const std::vector<Result> &results) {
+    FILE *fp = fopen(path, "w");
+    if (!fp) {
+        fprintf(stderr, "yklog_bench: cannot open %s: %s\n", path, strerror_tl(errno));
+        return;
+    }
+    fprintf(fp, "{\n  \"label\": \"%s\",\n  \"timestamp\": %ld,\n  \"cpus\": %u,\n  \"max_threads\": %d,\n  \"timer_overhead_ns\": %.1f,\n  \"results\": [\n",
+            label.c_str(), static_cast<long>(time(nullptr)), std::thread::hardware_concurrency(), maxThreads, g_timerOverhead);
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result &r = results[i];
+        fprintf(fp,
+                "    {\"scenario\": \"%s\", \"threads\": %d, \"lines\": %ld, \"ns_per_call\": %.1f, \"p50_ns\": %.0f, \"p99_ns\": %.0f, "
+                "\"p999_ns\": %.0f, \"max_ns\": %.0f, \"mb_per_s\": %.1f, \"dropped\": %lld, \"drop_rate\": %.6f, \"rss_growth_kb\": %ld}%s\n",
+                r.scenario.c_str(), r.threads, r.lines, r.nsPerCall, r.p50, r.p99, r.p999, r.max, r.mbPerSec, static_cast<long long>(r.dropped),
+                r.dropRate, r.rssGrowthKb, i + 1 < results.size() ? "," : "");
+    }
+    fprintf(fp, "  ]\n}\n");
+    fclose(fp);
+}
+
+void writeCsv(const char *path, const std::string &label, const std::vector<Result> &results) {
+    bool exists = access(path, F_OK) == 0;
+    FILE *fp = fopen(path, "a");
+    if (!fp) {
+        fprintf(stderr, "yklog_bench: cannot open %s: %s\n", path, strerror_tl(errno));
+        return;
+    }
+    if (!exists) {
+        fprintf(fp, "label,timestamp,scenario,threads,lines,ns_per_call,p50_ns,p99_ns,p999_ns,max_ns,mb_per_s,dropped,drop_rate,rss_growth_kb\n");
+    }
+    for (const Result &r : results) {
+        fprintf(fp, "%s,%ld,%s,%d,%ld,%.1f,%.0f,%.0f,%.0f,%.0f,%.1f,%lld,%.6f,%ld\n", label.c_str(), static_cast<long>(time(nullptr)),
+                r.scenario.c_str(), r.threads, r.lines, r.nsPerCall, r.p50, r.p99, r.p999, r.max, r.mbPerSec, static_cast<long long>(r.dropped),
+                r.dropRate, r.rssGrowthKb);
+    }
+    fclose(fp);
+}
+
+void usage() {
+    fprintf(stderr, "usage: yklog_bench [-t max_threads] [-n lines] [-d dir] [-p block|drop] [-l label] [-j out.json] [-c out.csv]\n");
+}
+
+int main(int argc, char *argv[]) {
+    int maxThreads = static_cast<int>(std::max(4u, std::thread::hardware_concurrency()));
+    long lines = 500000;
+    AsyncLogging::OverflowPolicy policy = AsyncLogging::kBlock;
+    std::string label = "dev";
+    const char *jsonPath = nullptr;
+    const char *csvPath = nullptr;
+    const char *dir = ".";
+    int opt;
+    while ((opt = getopt(argc, argv, "t:n:d:p:l:j:c:")) != -1) {
+        switch (opt) {
+        case 't':
+            maxThreads = std::max(1, atoi(optarg));
+            break;
+        case 'n':
+            lines = std::max(1000L, atol(optarg));
+            break;
+        case 'd':
+            dir = optarg;
+            break;
+        case 'p':
+            if (strcmp(optarg, "block") == 0) {
+                policy = AsyncLogging::kBlock;
+            } else if (strcmp(optarg, "drop") == 0) {
+                policy = AsyncLogging::kDropNewest;
+            } else {
+                usage();
+                return 1;
+            }
+            break;
+        case 'l':
+            label = optarg;
+            break;
+        case 'j':
+            jsonPath = optarg;
+            break;
+        case 'c':
+            csvPath = optarg;
+            break;
+        default:
+            usage();
+            return 1;
+        }
+    }
+
+    // LogFile的basename不能包含路径，切换到日志目录后用不带路径的basename；结果文件仍相对于原来的目录
+    int cwd = ::open(".", O_RDONLY | O_DIRECTORY);
+    if (cwd < 0 || chdir(dir) != 0) {
+        fprintf(stderr, "yklog_bench: cannot use log directory %s: %s\n", dir, strerror(errno));
+        return 1;
+    }
+
+    double start = nowNs();
+    for (int i = 0; i < 1000000; ++i) {
+        nowNs();
+    }
+    g_timerOverhead = (nowNs() - start) / 1000000;
+
+    Logger::setLogLevel(Logger::INFO);
+    g_devNull = fopen("/dev/null", "w");
+    std::vector<Result> results;
+    results.push_back(runSync("sync_devnull", devNullOutput, lines));
+    {
+        std::string prefix = "yklog_bench_sync.";
+        removeLogFiles(prefix);
+        LogFile file("yklog_bench_sync", 1024L * 1024 * 1024, false);
+        g_logFile = &file;
+        results.push_back(runSync("sync_file", fileOutput, lines));
+        Logger::setOutput(devNullOutput);
+        g_logFile = nullptr;
+        removeLogFiles(prefix);
+    }
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+        results.push_back(runAsync(threads, lines / threads, policy));
+    }
+
+    printf("%-13s %7s %10s %8s %8s %8s %10s %9s %9s %9s\n", "scenario", "threads", "ns/call", "p50", "p99", "p99.9", "max(ns)", "MB/s", "drop", "rss(KB)");
+    for (const Result &r : results) {
+        printf("%-13s %7d %10.1f %8.0f %8.0f %8.0f %10.0f %9.1f %8.4f%% %9ld\n", r.scenario.c_str(), r.threads, r.nsPerCall, r.p50, r.p99, r.p999, r.max,
+               r.mbPerSec, r.dropRate * 100, r.rssGrowthKb);
+    }
+    printf("timer overhead %.1f ns, included in percentiles\n", g_timerOverhead);
+    if (fchdir(cwd) != 0) {
+        fprintf(stderr, "yklog_bench: cannot return to the working directory: %s\n", strerror(errno));
+    }
+    ::close(cwd);
+    if (jsonPath) {
+        writeJson(jsonPath, label, maxThreads, results);
+    }
+    if (csvPath) {
+        writeCsv(csvPath, label, results);
+    }
+    fclose(g_devNull);
+    return 0;
+}
@@ -0,0 +1,313 @@
+/** yklog-grep: 按Logger的行格式并行过滤日志文件
+ * 用法：yklog-grep [-e 子串] [-L 最低级别] [-T 线程号] [-f 起始时间] [-t 结束时间] [-s 文件[:行号]] [-j 线程数] [-c] [-H] 文件或目录...
+ *   -e  行中包含的子串（区分大小写）       -L  TRACE/DEBUG/INFO/WARN/ERROR/FATAL，输出不低于该级别的日志
+ *   -T  线程号                             -f/-t  时间范围，格式与日志行首相同："YYYYMMDD HH:MM:SS[.秒以下]"
+ *   -s  来源文件，或"文件:行号"，与行尾的" - 文件:行号"比较，多行日志只有最后一行有来源
+ *   -j  工作线程数，默认为CPU核数         -c  只输出每个文件满足条件的行数       -H  每行前加上文件名
+ * 目录参数展开为其中LogFile命名的日志文件（"basename.YYYYMMDD-HHMMSS.host.pid.log"），按文件名排序
+ * 文件整体mmap，切分为8MB的块（在有行首的行上切分，多行日志不会被分开）分给所有线程扫描，输出按文件和块的顺序；
+ * 有时间范围且文件有时间索引（.idx，见LogIndex.h）时只扫描时间范围有交集的段
+ */
+#include "LogGrep.h"
+#include "LogIndex.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <dirent.h>
+#include <fcntl.h>
+#include <mutex>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+using namespace myServer;
+
+namespace {
+const size_t kChunkSize = 8 << 20;
+const size_t kMaxAlign = 1 << 20; // 切分点向后寻找有行首的行的最大距离
+
+struct MappedFile {
+    string name;
+    const char *data;
+    size_t size;
+};
+
+struct Task {
+    size_t file;
+    const char *begin;
+    size_t len;
+    string output;
+    size_t lines;
+    bool done;
+};
+
+bool isLogFileName(const char *name) {
+    size_t len = strlen(name);
+    if (len < 4 || strcmp(name + len - 4, ".log") != 0) {
+        return false;
+    }
+    for (const char *p = strchr(name, '.'); p; p = strchr(p + 1, '.')) { // ".YYYYMMDD-HHMMSS."
+        if (strlen(p) > 17 && p[9] == '-' && p[16] == '.') {
+            bool digits = true;
+            for (int i = 1; i <= 15 && digits; ++i) {
+                digits = i == 9 || (p[i] >= '0' && p[i] <= '9');
+            }
+            if (digits) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void expand(const char *arg, std::vector<string> *files) {
+    struct stat st;
+    if (::stat(arg, &st) == 0 && S_ISDIR(st.st_mode)) {
+        std::vector<string> names;
+        DIR *dir = opendir(arg);
+        while (struct dirent *entry = dir ? readdir(dir) : nullptr) {
+            if (isLogFileName(entry->d_name)) {
+                names.push_back(string(arg) + "/" + entry->d_name);
+            }
+        }
+        if (dir) {
+            closedir(dir);
+        }
+        std::sort(names.begin(), names.end());
+        files->insert(files->end(), names.begin(), names.end());
+    } else {
+        files->push_back(arg);
+    }
+}
+
+bool parseLevel(const char *arg, Logger::LogLevel *level) {
+    static const char *names[Logger::NUM_LOG_LEVELS] = {"TRACE", "DEBUG", "INFO", "WARN", "ERROR", "FATAL"};
+    for (int i = 0; i < Logger::NUM_LOG_LEVELS; ++i) {
+        if (strcasecmp(arg, names[i]) == 0) {
+            *level = static_cast<Logger::LogLevel>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool parseTime(const char *arg, TimeStamp *ts) {
+    size_t len = strlen(arg);
+    return TimeStamp::parse(arg, len, ts) == len;
+}
+
+// 从pos开始的下一个有行首的行，找不到时退回pos之后的第一个行首
+const char *alignChunk(const char *pos, const char *end) {
+    const char *newline = findNewline(pos, end);
+    const char *first = newline < end ? newline + 1 : end;
+    const char *limit = std::min(end, first + kMaxAlign);
+    for (const char *line = first; line < limit;) {
+        const char *lineEnd = findNewline(line, end);
+        LogPrefix prefix;
+        if (parseLogPrefix(line, lineEnd - line, &prefix)) {
+            return line;
+        }
+        line = lineEnd < end ? lineEnd + 1 : end;
+    }
+    return first;
+}
+
+void usage() {
+    fprintf(stderr, "usage: yklog-grep [-e pattern] [-L level] [-T tid] [-f from] [-t to] [-s file[:line]] [-j threads] [-c] [-H] file|dir...\n");
+}
+} // namespace
+
+int main(int argc, char *argv[]) {
+    LogMatcher matcher;
+    TimeStamp from = TimeStamp::invalid();
+    TimeStamp to = TimeStamp::invalid();
+    int threads = static_cast<int>(std::thread::hardware_concurrency());
+    bool countOnly = false;
+    bool withFilename = false;
+    int opt;
+    while ((opt = getopt(argc, argv, "e:L:T:f:t:s:j:cH")) != -1) {
+        switch (opt) {
+        case 'e':
+            if (strchr(optarg, '\n')) {
+                fprintf(stderr, "yklog-grep: pattern must not contain a newline\n");
+                return 2;
+            }
+            matcher.setPattern(optarg);
+            break;
+        case 'L': {
+            Logger::LogLevel level;
+            if (!parseLevel(optarg, &level)) {
+                fprintf(stderr, "yklog-grep: bad level \"%s\"\n", optarg);
+                return 2;
+            }
+            matcher.setMinLevel(level);
+            break;
+        }
+        case 'T':
+            matcher.setThread(atoi(optarg));
+            break;
+        case 'f':
+        case 't':
+            if (!parseTime(optarg, opt == 'f' ? &from : &to)) {
+                fprintf(stderr, "yklog-grep: bad time \"%s\", expected \"YYYYMMDD HH:MM:SS[.fraction]\"\n", optarg);
+                return 2;
+            }
+            break;
+        case 's':
+            matcher.setSource(optarg);
+            break;
+        case 'j':
+            threads = atoi(optarg);
+            break;
+        case 'c':
+            countOnly = true;
+            break;
+        case 'H':
+            withFilename = true;
+            break;
+        default:
+            usage();
+            return 2;
+        }
+    }
+    if (optind >= argc) {
+        usage();
+        return 2;
+    }
+    matcher.setTimeRange(from, to);
+    threads = std::max(threads, 1);
+
+    std::vector<string> names;
+    for (int i = optind; i < argc; ++i) {
+        expand(argv[i], &names);
+    }
+    int status = 0;
+    std::vector<MappedFile> files;
+    std::vector<Task> tasks;
+    const TimeStamp queryFrom = from.valid() ? from : TimeStamp::fromNanoSeconds(1);
+    const TimeStamp queryTo = to.valid() ? to : TimeStamp::fromNanoSeconds(INT64_MAX);
+    for (const string &name : names) {
+        int fd = ::open(name.c_str(), O_RDONLY | O_CLOEXEC);
+        struct stat st;
+        if (fd < 0 || ::fstat(fd, &st) != 0) {
+            fprintf(stderr, "yklog-grep: cannot open %s\n", name.c_str());
+            status = 2;
+            if (fd >= 0) {
+                ::close(fd);
+            }
+            continue;
+        }
+        size_t size = static_cast<size_t>(st.st_size);
+        void *data = size > 0 ? ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : nullptr;
+        ::close(fd);
+        if (data == MAP_FAILED) {
+            fprintf(stderr, "yklog-grep: cannot map %s\n", name.c_str());
+            status = 2;
+            continue;
+        }
+        if (data) {
+            ::madvise(data, size, MADV_SEQUENTIAL);
+        }
+        files.push_back(MappedFile{name, static_cast<const char *>(data), size});
+        // 需要扫描的区间：有时间范围和索引时只取有交集的段
+        std::vector<std::pair<off_t, off_t>> ranges;
+        LogIndexReader index(name);
+        if ((from.valid() || to.valid()) && index.indexed()) {
+            ranges = index.ranges(queryFrom, queryTo);
+        } else if (size > 0) {
+            ranges.emplace_back(0, static_cast<off_t>(size));
+        }
+        const char *base = static_cast<const char *>(data);
+        for (const auto &range : ranges) {
+            const char *begin = base + range.first;
+            const char *end = base + std::min<size_t>(size, range.first + range.second);
+            while (begin < end) {
+                const char *next = end - begin > static_cast<long>(kChunkSize) ? alignChunk(begin + kChunkSize, end) : end;
+                tasks.push_back(Task{files.size() - 1, begin, static_cast<size_t>(next - begin), string(), 0, false});
+                begin = next;
+            }
+        }
+    }
+
+    // 工作线程按顺序领取块，最多领先输出2*threads块，避免输出全部缓存在内存中
+    std::mutex mutex;
+    std::condition_variable doneCond;
+    std::condition_variable windowCond;
+    std::atomic<size_t> nextTask(0);
+    size_t printed = 0;
+    const size_t window = 2 * static_cast<size_t>(threads);
+    auto worker = [&] {
+        for (;;) {
+            size_t i = nextTask.fetch_add(1);
+            if (i >= tasks.size()) {
+                return;
+            }
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                windowCond.wait(lock, [&] { return i < printed + window; });
+            }
+            Task &task = tasks[i];
+            if (countOnly) {
+                task.lines = matcher.count(task.begin, task.len);
+            } else {
+                const string &filename = files[task.file].name;
+                task.lines = matcher.scan(task.begin, task.len, [&task, &filename, withFilename](const char *line, size_t len) {
+                    if (withFilename) {
+                        task.output += filename;
+                        task.output += ':';
+                    }
+                    task.output.append(line, len);
+                    if (line[len - 1] != '\n') {
+                        task.output += '\n'; // 文件最后没有换行的半行
+                    }
+                });
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            task.done = true;
+            doneCond.notify_all();
+        }
+    };
+    std::vector<std::thread> pool;
+    for (int i = 0; i < threads; ++i) {
+        pool.emplace_back(worker);
+    }
+    std::vector<size_t> counts(files.size(), 0);
+    size_t matched = 0;
+    for (size_t i = 0; i < tasks.size(); ++i) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            doneCond.wait(lock, [&] { return tasks[i].done; });
+        }
+        Task &task = tasks[i];
+        counts[task.file] += task.lines;
+        matched += task.lines;
+        fwrite_unlocked(task.output.data(), 1, task.output.size(), stdout);
+        string().swap(task.output);
+        std::lock_guard<std::mutex> lock(mutex);
+        ++printed;
+        windowCond.notify_all();
+    }
+    for (auto &thread : pool) {
+        thread.join();
+    }
+    if (countOnly) {
+        for (size_t i = 0; i < files.size(); ++i) {
+            if (files.size() > 1 || withFilename) {
+                printf("%s:%zu\n", files[i].name.c_str(), counts[i]);
+            } else {
+                printf("%zu\n", counts[i]);
+            }
+        }
+    }
+    for (const MappedFile &file : files) {
+        if (file.data) {
+            ::munmap(const_cast<char *>(file.data), file.size);
+        }
+    }
+    return status != 0 ? status : matched > 0 ? 0 : 1;
+}
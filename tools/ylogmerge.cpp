@@ -0,0 +1,65 @@
+/** ylogmerge: 把多个进程的日志文件按时间合并输出（见LogMerge.h）
+ * 用法：ylogmerge [-l] [-o 输出文件] 文件或目录...
+ *   -l  列出每一路输入及其中按时间排序的文件，不合并
+ *   -o  输出到文件，默认输出到标准输出
+ * 目录参数展开为其中LogFile命名的.log文件，同一进程依次roll出的文件首尾相接作为一路；压缩的文件需先用ylzcat解压
+ */
+#include "LogMerge.h"
+#include <stdio.h>
+#include <unistd.h>
+using namespace myServer;
+
+void usage() {
+    fprintf(stderr, "usage: ylogmerge [-l] [-o output] file|dir...\n");
+}
+
+int main(int argc, char *argv[]) {
+    bool list = false;
+    const char *outputName = nullptr;
+    int opt;
+    while ((opt = getopt(argc, argv, "lo:")) != -1) {
+        switch (opt) {
+        case 'l':
+            list = true;
+            break;
+        case 'o':
+            outputName = optarg;
+            break;
+        default:
+            usage();
+            return 2;
+        }
+    }
+    if (optind >= argc) {
+        usage();
+        return 2;
+    }
+    LogMerger merger;
+    int status = 0;
+    for (int i = optind; i < argc; ++i) {
+        if (!merger.add(argv[i])) {
+            status = 2;
+        }
+    }
+    if (list) {
+        for (size_t i = 0; i < merger.inputs(); ++i) {
+            printf("input %zu:\n", i);
+            for (const auto &name : merger.files(i)) {
+                printf("  %s\n", name.c_str());
+            }
+        }
+        return status;
+    }
+    FILE *out = outputName ? fopen(outputName, "we") : stdout;
+    if (!out) {
+        perror(outputName);
+        return 2;
+    }
+    bool failed = false;
+    merger.merge([out, &failed](const char *data, size_t len) { failed = failed || fwrite_unlocked(data, 1, len, out) != len; });
+    if (fclose(out) != 0 || failed) {
+        perror("ylogmerge write");
+        return 2;
+    }
+    return status;
+}
@@ -0,0 +1,140 @@
+/** ylogrange: 借助时间索引（.idx，见LogIndex.h）输出日志文件中一段时间内的行
+ * 用法：ylogrange [-l] [-b] [-f 起始时间] [-t 结束时间] 文件...
+ *   -f/-t  时间格式与日志行首相同："YYYYMMDD HH:MM:SS[.秒以下]"，只读取时间范围有交集的段
+ *   -l  列出每段的偏移、长度和时间范围，以及这次查询需要读取的字节数，不输出日志
+ *   -b  为没有索引的日志文件（如未开启setTimeIndex时写入的文件）扫描全文生成索引，每1MB或1秒一项
+ * 没有索引的文件退回全文扫描
+ */
+#include "LogIndex.h"
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+using namespace myServer;
+
+bool parseTime(const char *arg, TimeStamp *ts) {
+    size_t len = strlen(arg);
+    return TimeStamp::parse(arg, len, ts) == len;
+}
+
+// 按4MB读取全文，在最后一个完整行之后切分交给writer
+void feedIndex(int fd, LogIndexWriter *writer) {
+    std::vector<char> buf(4 << 20);
+    size_t pending = 0;
+    ssize_t n;
+    while ((n = ::read(fd, buf.data() + pending, buf.size() - pending)) > 0 || pending > 0) {
+        size_t size = pending + (n > 0 ? n : 0);
+        const char *newline = n > 0 ? static_cast<const char *>(::memrchr(buf.data(), '\n', size)) : nullptr;
+        size_t cut = newline ? newline - buf.data() + 1 : size;
+        if (!newline && n > 0 && size < buf.size()) {
+            pending = size; // 还没有完整的行，继续读
+            continue;
+        }
+        writer->append(buf.data(), cut);
+        pending = size - cut;
+        memmove(buf.data(), buf.data() + cut, pending);
+        if (n <= 0) {
+            break;
+        }
+    }
+}
+
+bool buildIndex(const char *filename) {
+    int fd = ::open(filename, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    ::unlink((std::string(filename) + ".idx").c_str());
+    {
+        LogIndexWriter writer(filename, 0, 1 << 20, 1000);
+        feedIndex(fd, &writer);
+    } // 析构时写出最后一段
+    ::close(fd);
+    LogIndexReader reader(filename);
+    printf("%s.idx: %zu segments\n", filename, reader.segments().size());
+    return reader.indexed();
+}
+
+void listSegments(const char *filename, const LogIndexReader &reader, TimeStamp from, TimeStamp to) {
+    printf("%s\n%8s %14s %10s  %-26s  %-26s\n", filename, "segment", "offset", "length", "first", "last");
+    char first[TimeStamp::kMaxFormattedSize];
+    char last[TimeStamp::kMaxFormattedSize];
+    for (size_t i = 0; i < reader.segments().size(); ++i) {
+        const LogIndexReader::Segment &segment = reader.segments()[i];
+        if (segment.first.valid()) {
+            segment.first.formatTo(first, TimeStamp::kMicroSeconds);
+            segment.last.formatTo(last, TimeStamp::kMicroSeconds);
+        } else {
+            strcpy(first, "-");
+            strcpy(last, "-");
+        }
+        printf("%8zu %14lld %10lld  %-26s  %-26s\n", i, static_cast<long long>(segment.offset), static_cast<long long>(segment.length), first, last);
+    }
+    long long read = 0;
+    for (const auto &range : reader.ranges(from, to)) {
+        read += range.second;
+    }
+    printf("%zu segments, %lld bytes, query reads %lld bytes\n", reader.segments().size(), static_cast<long long>(reader.fileSize()), read);
+}
+
+int main(int argc, char *argv[]) {
+    bool list = false;
+    bool build = false;
+    TimeStamp from = TimeStamp::fromNanoSeconds(1);
+    TimeStamp to = TimeStamp::fromNanoSeconds(LLONG_MAX);
+    int opt;
+    while ((opt = getopt(argc, argv, "lbf:t:")) != -1) {
+        switch (opt) {
+        case 'l':
+            list = true;
+            break;
+        case 'b':
+            build = true;
+            break;
+        case 'f':
+        case 't':
+            if (!parseTime(optarg, opt == 'f' ? &from : &to)) {
+                fprintf(stderr, "ylogrange: bad time \"%s\", expected \"YYYYMMDD HH:MM:SS[.fraction]\"\n", optarg);
+                return 2;
+            }
+            break;
+        default:
+            fprintf(stderr, "usage: ylogrange [-l] [-b] [-f from] [-t to] file...\n");
+            return 2;
+        }
+    }
+    if (optind >= argc) {
+        fprintf(stderr, "usage: ylogrange [-l] [-b] [-f from] [-t to] file...\n");
+        return 2;
+    }
+    int status = 0;
+    for (int i = optind; i < argc; ++i) {
+        if (build) {
+            if (!buildIndex(argv[i])) {
+                fprintf(stderr, "ylogrange: cannot index %s\n", argv[i]);
+                status = 1;
+            }
+            continue;
+        }
+        LogIndexReader reader(argv[i]);
+        if (!reader.valid()) {
+            fprintf(stderr, "ylogrange: cannot open %s\n", argv[i]);
+            status = 1;
+            continue;
+        }
+        if (!reader.indexed()) {
+            fprintf(stderr, "ylogrange: %s has no index, scanning the whole file\n", argv[i]);
+        }
+        if (list) {
+            listSegments(argv[i], reader, from, to);
+            continue;
+        }
+        if (!reader.readRange(from, to, [](const char *line, size_t len) { fwrite_unlocked(line, 1, len, stdout); })) {
+            fprintf(stderr, "ylogrange: read %s failed\n", argv[i]);
+            status = 1;
+        }
+    }
+    return status;
+}
@@ -0,0 +1,67 @@
+/** ylogrecover: 从FlightRecorder的映射文件中取出进程崩溃时还没有写入日志文件的尾部
+ * 用法：ylogrecover [-l] [-o 输出文件] 映射文件...
+ *   默认按写入顺序输出到标准输出，-o追加到文件
+ *   -l  列出文件头（进程号、状态、缓存数）和每块未写入的缓存的序号和长度，不输出日志
+ * 信号处理函数已经写过path.tail（状态为drained）时照常输出，可能与path.tail重复
+ */
+#include "FlightRecorder.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <unistd.h>
+using namespace myServer;
+
+int main(int argc, char *argv[]) {
+    bool list = false;
+    const char *output = nullptr;
+    int opt;
+    while ((opt = getopt(argc, argv, "lo:")) != -1) {
+        switch (opt) {
+        case 'l':
+            list = true;
+            break;
+        case 'o':
+            output = optarg;
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-l] [-o output] recorder_file...\n", argv[0]);
+            return 2;
+        }
+    }
+    if (optind >= argc) {
+        fprintf(stderr, "usage: %s [-l] [-o output] recorder_file...\n", argv[0]);
+        return 2;
+    }
+    int fd = STDOUT_FILENO;
+    if (output && !list) {
+        fd = ::open(output, O_WRONLY | O_CREAT | O_APPEND, 0644);
+        if (fd < 0) {
+            fprintf(stderr, "%s: %s\n", output, strerror(errno));
+            return 1;
+        }
+    }
+    int status = 0;
+    for (int i = optind; i < argc; ++i) {
+        std::string error;
+        if (list) {
+            if (!FlightRecorder::describe(argv[i], stdout, &error)) {
+                fprintf(stderr, "%s\n", error.c_str());
+                status = 1;
+            }
+        } else {
+            int64_t bytes = FlightRecorder::recover(argv[i], fd, &error);
+            if (bytes < 0) {
+                fprintf(stderr, "%s\n", error.c_str());
+                status = 1;
+            } else if (output) {
+                fprintf(stderr, "%s: %lld bytes\n", argv[i], static_cast<long long>(bytes));
+            }
+        }
+    }
+    if (fd != STDOUT_FILENO) {
+        ::close(fd);
+    }
+    return status;
+}